@@ -15,17 +15,22 @@
  */
  
 #include "common.glh"
+#include "instancing.glh"
 
 varying vec2 texCoord0;
 
 #if defined(VS_BUILD)
 Layout(0) attribute vec3 position;
 Layout(1) attribute vec2 texCoord;
-Layout(4) attribute mat4 transformMat;
+
+layout(std140) uniform SceneData
+{
+	mat4 viewProjection;
+};
 
 void main()
 {
-    gl_Position = vec4(position, 1.0) * transformMat;
+    gl_Position = vec4(position, 1.0) * getInstanceTransform() * viewProjection;
     texCoord0 = texCoord;
 }
 
@@ -0,0 +1,120 @@
+#include "cpuInfo.hpp"
+
+#if SIMD_CPU_ARCH == SIMD_CPU_ARCH_x86 || SIMD_CPU_ARCH == SIMD_CPU_ARCH_x86_64
+	#if defined(COMPILER_MSVC)
+		#include <intrin.h>
+	#else
+		#include <cpuid.h>
+	#endif
+	#define CPU_INFO_X86
+#endif
+
+#ifdef CPU_INFO_X86
+static void cpuid(uint32 leaf, uint32 subleaf, uint32 regs[4])
+{
+#if defined(COMPILER_MSVC)
+	__cpuidex((int*)regs, (int)leaf, (int)subleaf);
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// XCR0: which register state the OS saves on a context switch
+static uint64 getXCR0()
+{
+#if defined(COMPILER_MSVC)
+	return _xgetbv(0);
+#else
+	uint32 eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((uint64)edx << 32) | eax;
+#endif
+}
+#endif
+
+struct CPUFeatures
+{
+	uint32 simdLevel;
+	bool hasFMA;
+};
+
+static CPUFeatures detectFeatures()
+{
+	CPUFeatures features;
+	features.simdLevel = SIMD_LEVEL_NONE;
+	features.hasFMA = false;
+#ifdef CPU_INFO_X86
+	uint32 regs[4];
+	cpuid(0, 0, regs);
+	uint32 maxLeaf = regs[0];
+	if(maxLeaf < 1) {
+		return features;
+	}
+	cpuid(1, 0, regs);
+	uint32 ecx = regs[2];
+
+	// Leaf 1 register (2 = ecx, 3 = edx) and bit for each level, in order;
+	// a level only counts if every level before it is also present.
+	static const struct { uint32 reg; uint32 bit; uint32 level; } SSE_LEVELS[] = {
+		{ 3, 25, SIMD_LEVEL_x86_SSE },
+		{ 3, 26, SIMD_LEVEL_x86_SSE2 },
+		{ 2, 0, SIMD_LEVEL_x86_SSE3 },
+		{ 2, 9, SIMD_LEVEL_x86_SSSE3 },
+		{ 2, 19, SIMD_LEVEL_x86_SSE4_1 },
+		{ 2, 20, SIMD_LEVEL_x86_SSE4_2 },
+	};
+	for(uint32 i = 0; i < ARRAY_SIZE_IN_ELEMENTS(SSE_LEVELS); i++) {
+		if(!(regs[SSE_LEVELS[i].reg] & (1u << SSE_LEVELS[i].bit))) {
+			return features;
+		}
+		features.simdLevel = SSE_LEVELS[i].level;
+	}
+
+	// AVX needs both the CPU flag and the OS saving the YMM registers
+	bool hasOSXSave = (ecx & (1 << 27)) != 0;
+	bool hasAVXState = hasOSXSave && (getXCR0() & 0x6) == 0x6;
+	if(!hasAVXState || !(ecx & (1 << 28))) {
+		return features;
+	}
+	features.simdLevel = SIMD_LEVEL_x86_AVX;
+	features.hasFMA = (ecx & (1 << 12)) != 0;
+	if(maxLeaf >= 7) {
+		cpuid(7, 0, regs);
+		if(regs[1] & (1 << 5)) {
+			features.simdLevel = SIMD_LEVEL_x86_AVX2;
+		}
+	}
+#endif
+	return features;
+}
+
+static const CPUFeatures& getFeatures()
+{
+	static const CPUFeatures features = detectFeatures();
+	return features;
+}
+
+uint32 CPUInfo::getSIMDLevel()
+{
+	return getFeatures().simdLevel;
+}
+
+bool CPUInfo::hasFMA()
+{
+	return getFeatures().hasFMA;
+}
+
+const char* CPUInfo::getSIMDLevelName(uint32 simdLevel)
+{
+	switch(simdLevel) {
+	case SIMD_LEVEL_x86_SSE: return "SSE";
+	case SIMD_LEVEL_x86_SSE2: return "SSE2";
+	case SIMD_LEVEL_x86_SSE3: return "SSE3";
+	case SIMD_LEVEL_x86_SSSE3: return "SSSE3";
+	case SIMD_LEVEL_x86_SSE4_1: return "SSE4.1";
+	case SIMD_LEVEL_x86_SSE4_2: return "SSE4.2";
+	case SIMD_LEVEL_x86_AVX: return "AVX";
+	case SIMD_LEVEL_x86_AVX2: return "AVX2";
+	default: return "None";
+	}
+}
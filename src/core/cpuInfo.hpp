@@ -0,0 +1,19 @@
+#pragma once
+
+#include "common.hpp"
+#include "platform/platform.hpp"
+
+/**
+ * CPU features detected at runtime.
+ *
+ * SIMD_SUPPORTED_LEVEL only says what the compiler was allowed to use; this
+ * says what the machine running the binary can actually execute, including
+ * whether the OS saves the AVX register state.
+ */
+namespace CPUInfo
+{
+	/** Highest SIMD_LEVEL_* the host supports. */
+	uint32 getSIMDLevel();
+	bool hasFMA();
+	const char* getSIMDLevelName(uint32 simdLevel);
+};
@@ -0,0 +1,184 @@
+#include "frameArena.hpp"
+#include "math/math.hpp"
+
+// Threads are numbered on their first allocation from any arena, and keep
+// the same slot in every arena. Numbers are given back when their thread
+// exits, so short-lived threads, such as BVH build workers, don't use up
+// the slots. A thread started while all MAX_THREADS are taken uses the
+// shared slot for as long as it runs.
+static std::mutex threadIndexMutex;
+static uint32 numThreadIndices = 0;
+static uint32 freeThreadIndices[FrameArena::MAX_THREADS];
+static uint32 numFreeThreadIndices = 0;
+static thread_local uint32 threadIndex = (uint32)-1;
+
+// Gives the thread's number back when the thread exits
+struct ThreadIndexReleaser
+{
+	FORCEINLINE void activate() {}
+	~ThreadIndexReleaser();
+};
+static thread_local ThreadIndexReleaser threadIndexReleaser;
+
+ThreadIndexReleaser::~ThreadIndexReleaser()
+{
+	if(threadIndex >= FrameArena::MAX_THREADS) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(threadIndexMutex);
+	freeThreadIndices[numFreeThreadIndices++] = threadIndex;
+	// Anything the thread allocates from here on is from the shared slot
+	threadIndex = FrameArena::MAX_THREADS;
+}
+
+static uint32 addThreadIndex()
+{
+	std::lock_guard<std::mutex> lock(threadIndexMutex);
+	if(numFreeThreadIndices > 0) {
+		threadIndex = freeThreadIndices[--numFreeThreadIndices];
+	} else if(numThreadIndices < FrameArena::MAX_THREADS) {
+		threadIndex = numThreadIndices++;
+	} else {
+		threadIndex = FrameArena::MAX_THREADS;
+		return threadIndex;
+	}
+	threadIndexReleaser.activate();
+	return threadIndex;
+}
+
+static FORCEINLINE uint32 getThreadIndex()
+{
+	if(threadIndex == (uint32)-1) {
+		return addThreadIndex();
+	}
+	return threadIndex;
+}
+
+FrameArena::FrameArena(uintptr chunkSizeIn, uint32 numFramesIn) :
+	freeChunks(nullptr),
+	chunkSize(chunkSizeIn),
+	numFrames(numFramesIn),
+	currentFrame(0),
+	highWaterMark(0),
+	bytesAllocatedLastFrame(0),
+	bytesReserved(0)
+{
+	assertCheck(numFrames >= 1 && numFrames <= MAX_FRAMES);
+	assertCheck(chunkSize > sizeof(Chunk));
+	for(uint32 i = 0; i <= MAX_THREADS; i++) {
+		slots[i].cursor = nullptr;
+		slots[i].end = nullptr;
+		slots[i].bytesAllocated.store(0, std::memory_order_relaxed);
+	}
+	for(uint32 i = 0; i < MAX_FRAMES; i++) {
+		frameChunks[i] = nullptr;
+	}
+}
+
+FrameArena::~FrameArena()
+{
+	for(uint32 i = 0; i < MAX_FRAMES; i++) {
+		releaseChunks(frameChunks[i]);
+	}
+	while(freeChunks != nullptr) {
+		Chunk* next = freeChunks->next;
+		Memory::free(freeChunks, chunkSize);
+		freeChunks = next;
+	}
+}
+
+void* FrameArena::allocate(uintptr amt, uint32 alignment)
+{
+	uint32 index = getThreadIndex();
+	if(index < MAX_THREADS) {
+		return allocateFromSlot(slots[index], amt, alignment);
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	return allocateFromSlot(slots[MAX_THREADS], amt, alignment);
+}
+
+void FrameArena::endFrame()
+{
+	uintptr bytesAllocated = 0;
+	for(uint32 i = 0; i <= MAX_THREADS; i++) {
+		bytesAllocated += slots[i].bytesAllocated.load(std::memory_order_relaxed);
+		slots[i].bytesAllocated.store(0, std::memory_order_relaxed);
+		// The rest of each chunk belongs to the frame that just ended
+		slots[i].cursor = nullptr;
+		slots[i].end = nullptr;
+	}
+	bytesAllocatedLastFrame = bytesAllocated;
+	highWaterMark = Math::max(highWaterMark, bytesAllocated);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	currentFrame = (currentFrame + 1) % numFrames;
+	releaseChunks(frameChunks[currentFrame]);
+	frameChunks[currentFrame] = nullptr;
+}
+
+void* FrameArena::allocateFromSlot(ThreadSlot& slot, uintptr amt, uint32 alignment)
+{
+	uint8* result = Memory::align(slot.cursor, alignment);
+	if(slot.cursor == nullptr || (uintptr)result + amt > (uintptr)slot.end) {
+		result = (uint8*)allocateFromNewChunk(slot, amt, alignment);
+	} else {
+		slot.cursor = result + amt;
+	}
+	slot.bytesAllocated.store(slot.bytesAllocated.load(std::memory_order_relaxed) + amt,
+			std::memory_order_relaxed);
+	return result;
+}
+
+void* FrameArena::allocateFromNewChunk(ThreadSlot& slot, uintptr amt, uint32 alignment)
+{
+	uintptr maxOffset = sizeof(Chunk) + alignment;
+	if(amt + maxOffset > chunkSize) {
+		// Given its own chunk, leaving the slot's chunk in use
+		Chunk* chunk = createChunk(amt + maxOffset);
+		return Memory::align((uint8*)chunk + sizeof(Chunk), alignment);
+	}
+
+	Chunk* chunk = createChunk(chunkSize);
+	uint8* result = Memory::align((uint8*)chunk + sizeof(Chunk), alignment);
+	slot.cursor = result + amt;
+	slot.end = (uint8*)chunk + chunkSize;
+	return result;
+}
+
+FrameArena::Chunk* FrameArena::createChunk(uintptr size)
+{
+	// Threads using the shared slot hold the lock already
+	std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+	if(getThreadIndex() < MAX_THREADS) {
+		lock.lock();
+	}
+
+	Chunk* chunk;
+	if(size == chunkSize && freeChunks != nullptr) {
+		chunk = freeChunks;
+		freeChunks = chunk->next;
+	} else {
+		chunk = (Chunk*)Memory::malloc(size, Memory::DEFAULT_ALIGNMENT,
+				MEMORY_TAG_FRAME_ARENA);
+		chunk->size = size;
+		bytesReserved += size;
+	}
+	chunk->next = frameChunks[currentFrame];
+	frameChunks[currentFrame] = chunk;
+	return chunk;
+}
+
+void FrameArena::releaseChunks(Chunk* chunks)
+{
+	while(chunks != nullptr) {
+		Chunk* next = chunks->next;
+		if(chunks->size == chunkSize) {
+			chunks->next = freeChunks;
+			freeChunks = chunks;
+		} else {
+			bytesReserved -= chunks->size;
+			Memory::free(chunks, chunks->size);
+		}
+		chunks = next;
+	}
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "common.hpp"
+#include "memory.hpp"
+#include <atomic>
+#include <mutex>
+
+/**
+ * Bump allocator for temporaries that only need to live until the end of
+ * the frame, or for numFrames frames when double buffered.
+ *
+ * Each thread allocates from a chunk of its own, so allocating takes no lock
+ * until the chunk runs out. Nothing is freed individually; endFrame releases
+ * everything allocated numFrames frames ago at once, and keeps its chunks to
+ * reuse. Once the arena has grown to its high-water mark, it makes no
+ * further heap allocations.
+ *
+ * Allocations too large for a chunk get a chunk of their own, which is
+ * freed rather than kept.
+ *
+ * Containers take it as their allocator, as in Array<uint32, FrameArena>,
+ * and must not outlive the frame.
+ */
+class FrameArena
+{
+public:
+	enum
+	{
+		DEFAULT_CHUNK_SIZE = 64 * 1024,
+		MAX_FRAMES = 2,
+		// Threads beyond this share a single chunk under a lock
+		MAX_THREADS = 32
+	};
+
+	FrameArena(uintptr chunkSize = DEFAULT_CHUNK_SIZE, uint32 numFrames = 1);
+	~FrameArena();
+
+	void* allocate(uintptr amt, uint32 alignment = Memory::DEFAULT_ALIGNMENT);
+
+	/** Does nothing; the memory is released by endFrame. */
+	FORCEINLINE void deallocate(void* ptr, uintptr amt, uint32 alignment)
+	{
+		(void)ptr;
+		(void)amt;
+		(void)alignment;
+	}
+
+	template<typename T>
+	FORCEINLINE T* allocate(uintptr count)
+	{
+		return (T*)allocate(count * sizeof(T), alignof(T));
+	}
+
+	/**
+	 * Releases what was allocated numFrames frames ago. No other thread may
+	 * be allocating from the arena during the call.
+	 */
+	void endFrame();
+
+	/** Most bytes allocated in any one frame, not counting alignment padding. */
+	FORCEINLINE uintptr getHighWaterMark() const { return highWaterMark; }
+	FORCEINLINE uintptr getBytesAllocatedLastFrame() const
+	{
+		return bytesAllocatedLastFrame;
+	}
+	/** Bytes of chunks the arena holds, whether in use or kept for reuse. */
+	FORCEINLINE uintptr getBytesReserved() const { return bytesReserved; }
+private:
+	struct Chunk
+	{
+		Chunk* next;
+		uintptr size;
+	};
+
+	struct ThreadSlot
+	{
+		uint8* cursor;
+		uint8* end;
+		// Only written by the slot's thread, and read by endFrame
+		std::atomic<uintptr> bytesAllocated;
+		// Keeps each thread's slot on its own cache line
+		uint8 padding[64 - 2 * sizeof(uint8*) - sizeof(std::atomic<uintptr>)];
+	};
+
+	ThreadSlot slots[MAX_THREADS + 1];
+	// Guards the chunk lists and the slot shared by threads beyond MAX_THREADS
+	std::mutex mutex;
+	Chunk* freeChunks;
+	Chunk* frameChunks[MAX_FRAMES];
+	uintptr chunkSize;
+	uint32 numFrames;
+	uint32 currentFrame;
+	uintptr highWaterMark;
+	uintptr bytesAllocatedLastFrame;
+	uintptr bytesReserved;
+
+	void* allocateFromSlot(ThreadSlot& slot, uintptr amt, uint32 alignment);
+	void* allocateFromNewChunk(ThreadSlot& slot, uintptr amt, uint32 alignment);
+	Chunk* createChunk(uintptr size);
+	void releaseChunks(Chunk* chunks);
+
+	NULL_COPY_AND_ASSIGN(FrameArena);
+};
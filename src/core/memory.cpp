@@ -2,10 +2,10 @@
 #include "memory.hpp"
 #include <new>
 
-static void* newFunc(std::size_t size)
+static void* newFunc(std::size_t size, uint32 alignment=Memory::DEFAULT_ALIGNMENT)
 {
 	void* p = nullptr;
-	while((p = Memory::malloc(size)) == nullptr) {
+	while((p = Memory::malloc(size, alignment)) == nullptr) {
 		void (*l_handler)() = std::set_new_handler(NULL);
 		std::set_new_handler(l_handler);
 		if (l_handler == NULL) {
@@ -56,3 +56,59 @@ void operator delete[](void *p) throw()
 {
 	deleteFunc(p);
 }
+
+// The sized and aligned forms pass on what they know about the block, so
+// small blocks are freed without looking up their size.
+#if defined(__cpp_sized_deallocation) || (defined(_MSC_VER) && _MSC_VER >= 1900)
+void operator delete(void* p, std::size_t size) throw()
+{
+	if(p != nullptr) {
+		Memory::free(p, size);
+	}
+}
+void operator delete[](void* p, std::size_t size) throw()
+{
+	if(p != nullptr) {
+		Memory::free(p, size);
+	}
+}
+#endif
+
+#if defined(__cpp_aligned_new)
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	void* result = newFunc(size, (uint32)alignment);
+	if(result == nullptr) {
+		throw std::bad_alloc();
+	}
+	return result;
+}
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	void* result = newFunc(size, (uint32)alignment);
+	if(result == nullptr) {
+		throw std::bad_alloc();
+	}
+	return result;
+}
+void operator delete(void* p, std::align_val_t alignment) throw()
+{
+	deleteFunc(p);
+}
+void operator delete[](void* p, std::align_val_t alignment) throw()
+{
+	deleteFunc(p);
+}
+void operator delete(void* p, std::size_t size, std::align_val_t alignment) throw()
+{
+	if(p != nullptr) {
+		Memory::free(p, size, (uint32)alignment);
+	}
+}
+void operator delete[](void* p, std::size_t size, std::align_val_t alignment) throw()
+{
+	if(p != nullptr) {
+		Memory::free(p, size, (uint32)alignment);
+	}
+}
+#endif
@@ -2,6 +2,7 @@
 
 #include "common.hpp"
 #include "platform/platformMemory.hpp"
+#include "memoryTracker.hpp"
 #include <cstring>
 
 /**
@@ -60,21 +61,72 @@ struct Memory
 
 	static inline void* malloc(uintptr amt, uint32 alignment=DEFAULT_ALIGNMENT)
 	{
+#if MEMORY_TRACKING
+		return MemoryTracker::malloc(amt, alignment);
+#else
 		return PlatformMemory::malloc(amt, alignment);
+#endif
 	}
 
+	/** Allocates memory accounted to tag, rather than the current tag. */
+	static inline void* malloc(uintptr amt, uint32 alignment, enum MemoryTag tag)
+	{
+#if MEMORY_TRACKING
+		return MemoryTracker::malloc(amt, alignment, tag);
+#else
+		(void)tag;
+		return PlatformMemory::malloc(amt, alignment);
+#endif
+	}
+
+	/**
+	 * Resizes a block from malloc, keeping its contents up to the smaller of
+	 * the two sizes. The block is resized in place where possible. Alignment
+	 * must be the same as for malloc.
+	 */
 	static inline void* realloc(void* ptr, uintptr amt, uint32 alignment=DEFAULT_ALIGNMENT)
 	{
+#if MEMORY_TRACKING
+		return MemoryTracker::realloc(ptr, amt, alignment);
+#else
 		return PlatformMemory::realloc(ptr, amt, alignment);
+#endif
 	}
 
 	static inline void* free(void* ptr)
 	{
+#if MEMORY_TRACKING
+		MemoryTracker::free(ptr);
+		return nullptr;
+#else
 		return PlatformMemory::free(ptr);
+#endif
+	}
+
+	/**
+	 * Frees memory from malloc with the same amt and alignment, which lets
+	 * the allocator skip looking up the block's size.
+	 */
+	static inline void* free(void* ptr, uintptr amt, uint32 alignment=DEFAULT_ALIGNMENT)
+	{
+#if MEMORY_TRACKING
+		// The block's header has its size already
+		(void)amt;
+		(void)alignment;
+		MemoryTracker::free(ptr);
+		return nullptr;
+#else
+		return PlatformMemory::free(ptr, amt, alignment);
+#endif
 	}
 
+	/** Usable size of an allocation, which can be more than was asked for. */
 	static inline uintptr getAllocSize(void* ptr)
 	{
+#if MEMORY_TRACKING
+		return MemoryTracker::getAllocSize(ptr);
+#else
 		return PlatformMemory::getAllocSize(ptr);
+#endif
 	}
 };
@@ -0,0 +1,423 @@
+#include "memoryTracker.hpp"
+#include "math/math.hpp"
+#include <atomic>
+#include <mutex>
+#include <cstdarg>
+#include <stdio.h>
+
+// Blocks are allocated with offset bytes in front of them, which is their
+// alignment or 16, and the last 16 of those hold this header.
+struct AllocationHeader
+{
+	uintptr size;
+	uint32 offset;
+	uint32 tag;
+};
+#define ALLOCATION_HEADER_SIZE 16
+static_assert(sizeof(AllocationHeader) <= ALLOCATION_HEADER_SIZE,
+		"AllocationHeader must fit in front of 16 byte aligned blocks");
+
+// Live bytes a thread gathers for a tag before adding them to its total
+#define PENDING_BYTES_LIMIT (64 * 1024)
+
+struct TagCounters
+{
+	std::atomic<uint64> numAllocations;
+	std::atomic<uint64> numFrees;
+	std::atomic<uint64> bytesAllocated;
+	std::atomic<uint64> bytesFreed;
+};
+
+enum ThreadCountersState
+{
+	THREAD_COUNTERS_INACTIVE,
+	THREAD_COUNTERS_ACTIVE,
+	THREAD_COUNTERS_RETIRED
+};
+
+// Plain data, like the size class allocator's thread cache, so it's usable
+// at any point in a thread's life. Only its thread writes the counters.
+struct ThreadCounters
+{
+	TagCounters tags[NUM_MEMORY_TAGS];
+	int64 pendingBytes[NUM_MEMORY_TAGS];
+	ThreadCounters* next;
+	ThreadCounters* prev;
+	uint32 state;
+};
+
+// Folds a thread's counters into the retired ones when the thread exits
+struct ThreadCountersRetirer
+{
+	FORCEINLINE void activate() {}
+	~ThreadCountersRetirer();
+};
+
+struct TagData
+{
+	std::atomic<int64> liveBytes;
+	std::atomic<int64> peakBytes;
+	std::atomic<uint64> softBudget;
+	std::atomic<uint64> hardBudget;
+	std::atomic<bool> isOverSoftBudget;
+	// Counts of threads that have exited
+	TagCounters retired;
+};
+
+static const char* tagNames[NUM_MEMORY_TAGS] = {
+	"Untagged",
+	"Render device",
+	"Textures",
+	"Meshes",
+	"Shaders",
+	"Frame arena"
+};
+
+static TagData tagData[NUM_MEMORY_TAGS];
+// Guards the list of threads, so they aren't retired while being read
+static std::mutex threadsMutex;
+static ThreadCounters* threads = nullptr;
+static thread_local ThreadCounters threadCounters;
+static thread_local ThreadCountersRetirer threadCountersRetirer;
+static thread_local uint32 currentTag = MEMORY_TAG_UNTAGGED;
+
+static FORCEINLINE AllocationHeader* getHeader(void* ptr)
+{
+	return (AllocationHeader*)((uint8*)ptr - ALLOCATION_HEADER_SIZE);
+}
+
+// Only the owning thread writes its counters, so this needs no atomic add
+static FORCEINLINE void addToCounter(std::atomic<uint64>& counter, uint64 amt)
+{
+	counter.store(counter.load(std::memory_order_relaxed) + amt,
+			std::memory_order_relaxed);
+}
+
+static void addLiveBytes(uint32 tag, int64 bytes)
+{
+	TagData& data = tagData[tag];
+	int64 liveBytes = data.liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+	int64 peakBytes = data.peakBytes.load(std::memory_order_relaxed);
+	while(liveBytes > peakBytes && !data.peakBytes.compare_exchange_weak(peakBytes,
+				liveBytes, std::memory_order_relaxed)) {}
+
+	uint64 softBudget = data.softBudget.load(std::memory_order_relaxed);
+	if(softBudget == 0) {
+		return;
+	}
+	bool isOver = liveBytes > (int64)softBudget;
+	if(data.isOverSoftBudget.load(std::memory_order_relaxed) != isOver
+			&& data.isOverSoftBudget.exchange(isOver) != isOver && isOver) {
+		DEBUG_LOG(LOG_TYPE_MEMORY, LOG_WARNING,
+				"%s is over its soft budget of %llu bytes, with %lld bytes live",
+				tagNames[tag], (unsigned long long)softBudget, (long long)liveBytes);
+	}
+}
+
+static ThreadCounters* addThreadCounters()
+{
+	ThreadCounters& counters = threadCounters;
+	if(counters.state == THREAD_COUNTERS_RETIRED) {
+		return nullptr;
+	}
+	threadCountersRetirer.activate();
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	counters.prev = nullptr;
+	counters.next = threads;
+	if(threads != nullptr) {
+		threads->prev = &counters;
+	}
+	threads = &counters;
+	counters.state = THREAD_COUNTERS_ACTIVE;
+	return &counters;
+}
+
+static FORCEINLINE ThreadCounters* getThreadCounters()
+{
+	ThreadCounters& counters = threadCounters;
+	if(counters.state == THREAD_COUNTERS_ACTIVE) {
+		return &counters;
+	}
+	return addThreadCounters();
+}
+
+ThreadCountersRetirer::~ThreadCountersRetirer()
+{
+	ThreadCounters& counters = threadCounters;
+	if(counters.state != THREAD_COUNTERS_ACTIVE) {
+		return;
+	}
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	for(uint32 i = 0; i < NUM_MEMORY_TAGS; i++) {
+		TagCounters& retired = tagData[i].retired;
+		TagCounters& tag = counters.tags[i];
+		retired.numAllocations.fetch_add(tag.numAllocations.load(std::memory_order_relaxed));
+		retired.numFrees.fetch_add(tag.numFrees.load(std::memory_order_relaxed));
+		retired.bytesAllocated.fetch_add(tag.bytesAllocated.load(std::memory_order_relaxed));
+		retired.bytesFreed.fetch_add(tag.bytesFreed.load(std::memory_order_relaxed));
+		addLiveBytes(i, counters.pendingBytes[i]);
+	}
+	if(counters.prev != nullptr) {
+		counters.prev->next = counters.next;
+	} else {
+		threads = counters.next;
+	}
+	if(counters.next != nullptr) {
+		counters.next->prev = counters.prev;
+	}
+	counters.state = THREAD_COUNTERS_RETIRED;
+}
+
+static bool isWithinHardBudget(uint32 tag, uintptr amt, uint64 hardBudget)
+{
+	TagData& data = tagData[tag];
+	ThreadCounters* counters = getThreadCounters();
+	int64 liveBytes = data.liveBytes.load(std::memory_order_relaxed)
+		+ (counters != nullptr ? counters->pendingBytes[tag] : 0);
+	if(liveBytes + (int64)amt <= (int64)hardBudget) {
+		return true;
+	}
+	DEBUG_LOG(LOG_TYPE_MEMORY, LOG_ERROR,
+			"Allocating %llu bytes would take %s over its hard budget of %llu bytes",
+			(unsigned long long)amt, tagNames[tag], (unsigned long long)hardBudget);
+	return false;
+}
+
+static FORCEINLINE bool canAllocate(uint32 tag, uintptr amt)
+{
+	uint64 hardBudget = tagData[tag].hardBudget.load(std::memory_order_relaxed);
+	return hardBudget == 0 || isWithinHardBudget(tag, amt, hardBudget);
+}
+
+static FORCEINLINE void recordAllocation(uint32 tag, uintptr amt)
+{
+	ThreadCounters* counters = getThreadCounters();
+	if(counters == nullptr) {
+		TagCounters& retired = tagData[tag].retired;
+		retired.numAllocations.fetch_add(1, std::memory_order_relaxed);
+		retired.bytesAllocated.fetch_add(amt, std::memory_order_relaxed);
+		addLiveBytes(tag, amt);
+		return;
+	}
+	addToCounter(counters->tags[tag].numAllocations, 1);
+	addToCounter(counters->tags[tag].bytesAllocated, amt);
+	int64 pendingBytes = counters->pendingBytes[tag] + (int64)amt;
+	if(pendingBytes >= PENDING_BYTES_LIMIT) {
+		addLiveBytes(tag, pendingBytes);
+		pendingBytes = 0;
+	}
+	counters->pendingBytes[tag] = pendingBytes;
+}
+
+static FORCEINLINE void recordFree(uint32 tag, uintptr amt)
+{
+	ThreadCounters* counters = getThreadCounters();
+	if(counters == nullptr) {
+		TagCounters& retired = tagData[tag].retired;
+		retired.numFrees.fetch_add(1, std::memory_order_relaxed);
+		retired.bytesFreed.fetch_add(amt, std::memory_order_relaxed);
+		addLiveBytes(tag, -(int64)amt);
+		return;
+	}
+	addToCounter(counters->tags[tag].numFrees, 1);
+	addToCounter(counters->tags[tag].bytesFreed, amt);
+	int64 pendingBytes = counters->pendingBytes[tag] - (int64)amt;
+	if(pendingBytes <= -PENDING_BYTES_LIMIT) {
+		addLiveBytes(tag, pendingBytes);
+		pendingBytes = 0;
+	}
+	counters->pendingBytes[tag] = pendingBytes;
+}
+
+void* MemoryTracker::malloc(uintptr amt, uint32 alignment)
+{
+	return MemoryTracker::malloc(amt, alignment, (enum MemoryTag)currentTag);
+}
+
+void* MemoryTracker::malloc(uintptr amt, uint32 alignment, enum MemoryTag tag)
+{
+	assertCheck(tag < NUM_MEMORY_TAGS);
+	if(!canAllocate(tag, amt)) {
+		return nullptr;
+	}
+	uint32 offset = Math::max(alignment, (uint32)ALLOCATION_HEADER_SIZE);
+	uint8* start = (uint8*)PlatformMemory::malloc(amt + offset, offset);
+	if(start == nullptr) {
+		return nullptr;
+	}
+	recordAllocation(tag, amt);
+
+	void* result = start + offset;
+	AllocationHeader* header = getHeader(result);
+	header->size = amt;
+	header->offset = offset;
+	header->tag = tag;
+	return result;
+}
+
+void* MemoryTracker::realloc(void* ptr, uintptr amt, uint32 alignment)
+{
+	if(ptr == nullptr) {
+		return MemoryTracker::malloc(amt, alignment);
+	}
+	if(amt == 0) {
+		MemoryTracker::free(ptr);
+		return nullptr;
+	}
+
+	// The header moves along with the data, as it's at the same offset
+	AllocationHeader* header = getHeader(ptr);
+	uintptr size = header->size;
+	uint32 offset = header->offset;
+	uint32 tag = header->tag;
+	assertCheck(offset == Math::max(alignment, (uint32)ALLOCATION_HEADER_SIZE));
+	if(amt > size && !canAllocate(tag, amt - size)) {
+		return nullptr;
+	}
+	uint8* start = (uint8*)PlatformMemory::realloc((uint8*)ptr - offset, amt + offset, offset);
+	if(start == nullptr) {
+		return nullptr;
+	}
+	recordFree(tag, size);
+	recordAllocation(tag, amt);
+
+	void* result = start + offset;
+	getHeader(result)->size = amt;
+	return result;
+}
+
+void MemoryTracker::free(void* ptr)
+{
+	if(ptr == nullptr) {
+		return;
+	}
+	AllocationHeader* header = getHeader(ptr);
+	uintptr size = header->size;
+	uint32 offset = header->offset;
+	recordFree(header->tag, size);
+	PlatformMemory::free((uint8*)ptr - offset, size + offset, offset);
+}
+
+uintptr MemoryTracker::getAllocSize(void* ptr)
+{
+	uint32 offset = getHeader(ptr)->offset;
+	return PlatformMemory::getAllocSize((uint8*)ptr - offset) - offset;
+}
+
+enum MemoryTag MemoryTracker::getTag(void* ptr)
+{
+	return (enum MemoryTag)getHeader(ptr)->tag;
+}
+
+enum MemoryTag MemoryTracker::getCurrentTag()
+{
+	return (enum MemoryTag)currentTag;
+}
+
+void MemoryTracker::setCurrentTag(enum MemoryTag tag)
+{
+	assertCheck(tag < NUM_MEMORY_TAGS);
+	currentTag = tag;
+}
+
+void MemoryTracker::setBudget(enum MemoryTag tag, uint64 softBudget, uint64 hardBudget)
+{
+	assertCheck(tag < NUM_MEMORY_TAGS);
+	tagData[tag].softBudget.store(softBudget, std::memory_order_relaxed);
+	tagData[tag].hardBudget.store(hardBudget, std::memory_order_relaxed);
+	tagData[tag].isOverSoftBudget.store(false, std::memory_order_relaxed);
+}
+
+void MemoryTracker::getStats(enum MemoryTag tag, MemoryTagStats* stats)
+{
+	assertCheck(tag < NUM_MEMORY_TAGS);
+	TagData& data = tagData[tag];
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	uint64 numAllocations = data.retired.numAllocations.load(std::memory_order_relaxed);
+	uint64 numFrees = data.retired.numFrees.load(std::memory_order_relaxed);
+	uint64 bytesAllocated = data.retired.bytesAllocated.load(std::memory_order_relaxed);
+	uint64 bytesFreed = data.retired.bytesFreed.load(std::memory_order_relaxed);
+	for(ThreadCounters* thread = threads; thread != nullptr; thread = thread->next) {
+		TagCounters& counters = thread->tags[tag];
+		numAllocations += counters.numAllocations.load(std::memory_order_relaxed);
+		numFrees += counters.numFrees.load(std::memory_order_relaxed);
+		bytesAllocated += counters.bytesAllocated.load(std::memory_order_relaxed);
+		bytesFreed += counters.bytesFreed.load(std::memory_order_relaxed);
+	}
+
+	// Blocks can be freed by other threads than their allocator, and
+	// counters read while in use, so the sums may briefly disagree
+	stats->liveBytes = bytesAllocated > bytesFreed ? bytesAllocated - bytesFreed : 0;
+	int64 peakBytes = data.peakBytes.load(std::memory_order_relaxed);
+	stats->peakBytes = Math::max((uint64)Math::max(peakBytes, (int64)0), stats->liveBytes);
+	stats->numAllocations = numAllocations;
+	stats->numFrees = numFrees;
+	stats->bytesAllocated = bytesAllocated;
+}
+
+const char* MemoryTracker::getTagName(enum MemoryTag tag)
+{
+	assertCheck(tag < NUM_MEMORY_TAGS);
+	return tagNames[tag];
+}
+
+// Appends to the report like snprintf, counting what doesn't fit
+static void appendReport(char* buffer, uintptr bufferSize, uintptr* length,
+		const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	uintptr remaining = *length < bufferSize ? bufferSize - *length : 0;
+	int32 written = vsnprintf(remaining > 0 ? buffer + *length : nullptr, remaining,
+			format, args);
+	va_end(args);
+	if(written > 0) {
+		*length += written;
+	}
+}
+
+uintptr MemoryTracker::writeReport(char* buffer, uintptr bufferSize,
+		enum MemoryReportFormat format)
+{
+	if(bufferSize > 0) {
+		buffer[0] = '\0';
+	}
+	uintptr length = 0;
+	if(format == MEMORY_REPORT_JSON) {
+		appendReport(buffer, bufferSize, &length, "{\"tags\":[");
+	} else {
+		appendReport(buffer, bufferSize, &length,
+				"%-16s %12s %12s %12s %12s %14s %12s %12s\n", "Tag", "Live KB",
+				"Peak KB", "Allocations", "Frees", "Allocated KB", "Soft KB", "Hard KB");
+	}
+
+	for(uint32 i = 0; i < NUM_MEMORY_TAGS; i++) {
+		MemoryTagStats stats;
+		getStats((enum MemoryTag)i, &stats);
+		unsigned long long softBudget = tagData[i].softBudget.load(std::memory_order_relaxed);
+		unsigned long long hardBudget = tagData[i].hardBudget.load(std::memory_order_relaxed);
+		if(format == MEMORY_REPORT_JSON) {
+			appendReport(buffer, bufferSize, &length,
+					"%s{\"name\":\"%s\",\"liveBytes\":%llu,\"peakBytes\":%llu,"
+					"\"numAllocations\":%llu,\"numFrees\":%llu,\"bytesAllocated\":%llu,"
+					"\"softBudget\":%llu,\"hardBudget\":%llu}", i == 0 ? "" : ",",
+					tagNames[i], (unsigned long long)stats.liveBytes,
+					(unsigned long long)stats.peakBytes,
+					(unsigned long long)stats.numAllocations,
+					(unsigned long long)stats.numFrees,
+					(unsigned long long)stats.bytesAllocated, softBudget, hardBudget);
+		} else {
+			appendReport(buffer, bufferSize, &length,
+					"%-16s %12.1f %12.1f %12llu %12llu %14.1f %12.1f %12.1f\n",
+					tagNames[i], stats.liveBytes/1024.0, stats.peakBytes/1024.0,
+					(unsigned long long)stats.numAllocations,
+					(unsigned long long)stats.numFrees, stats.bytesAllocated/1024.0,
+					softBudget/1024.0, hardBudget/1024.0);
+		}
+	}
+
+	if(format == MEMORY_REPORT_JSON) {
+		appendReport(buffer, bufferSize, &length, "]}");
+	}
+	return length;
+}
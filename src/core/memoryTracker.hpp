@@ -0,0 +1,102 @@
+#pragma once
+
+#include "common.hpp"
+#include "platform/platformMemory.hpp"
+
+// When set, Memory accounts every allocation to a tag, at a cost of 16
+// bytes per block. Off unless the CMake option CGFX5_MEMORY_TRACKING is
+// turned on, as the header undoes the size class allocator's savings.
+#ifndef MEMORY_TRACKING
+	#define MEMORY_TRACKING 0
+#endif
+
+enum MemoryTag
+{
+	MEMORY_TAG_UNTAGGED,
+	MEMORY_TAG_RENDER_DEVICE,
+	MEMORY_TAG_TEXTURES,
+	MEMORY_TAG_MESHES,
+	MEMORY_TAG_SHADERS,
+	MEMORY_TAG_FRAME_ARENA,
+	NUM_MEMORY_TAGS
+};
+
+enum MemoryReportFormat
+{
+	MEMORY_REPORT_TEXT,
+	MEMORY_REPORT_JSON
+};
+
+struct MemoryTagStats
+{
+	uint64 liveBytes;
+	uint64 peakBytes;
+	// Totals over the life of the process, which show the tag's churn
+	uint64 numAllocations;
+	uint64 numFrees;
+	uint64 bytesAllocated;
+};
+
+/**
+ * Accounts allocations to tags, which are taken from a MemoryTagScope or
+ * passed to Memory::malloc.
+ *
+ * Each thread counts its own allocations, and the counts are merged when
+ * stats are asked for, so counting takes no lock. Threads add the live
+ * bytes of each tag to a shared total every 64KB or so, which is where
+ * peaks and budgets are taken from; those can be behind by that much per
+ * thread.
+ *
+ * A tag going over its soft budget logs a warning. An allocation that would
+ * take a tag over its hard budget fails instead, which makes operator new
+ * throw.
+ *
+ * Memory uses these functions when MEMORY_TRACKING is set. Blocks keep the
+ * tag they were allocated with, including through realloc.
+ */
+struct MemoryTracker
+{
+	static void* malloc(uintptr amt, uint32 alignment);
+	static void* malloc(uintptr amt, uint32 alignment, enum MemoryTag tag);
+	static void* realloc(void* ptr, uintptr amt, uint32 alignment);
+	static void free(void* ptr);
+	static uintptr getAllocSize(void* ptr);
+	static enum MemoryTag getTag(void* ptr);
+
+	/** The tag allocations on this thread are accounted to. */
+	static enum MemoryTag getCurrentTag();
+	static void setCurrentTag(enum MemoryTag tag);
+
+	/** Sets the budgets of tag in bytes, where 0 is no budget. */
+	static void setBudget(enum MemoryTag tag, uint64 softBudget, uint64 hardBudget);
+	static void getStats(enum MemoryTag tag, MemoryTagStats* stats);
+	static const char* getTagName(enum MemoryTag tag);
+
+	/**
+	 * Writes a report of every tag's stats and budgets to buffer, truncated
+	 * to bufferSize including the terminating null. Returns the length of
+	 * the whole report, so a buffer of that size plus one holds all of it.
+	 */
+	static uintptr writeReport(char* buffer, uintptr bufferSize,
+			enum MemoryReportFormat format);
+};
+
+/** Accounts allocations on this thread to tag until the scope ends. */
+class MemoryTagScope
+{
+public:
+	MemoryTagScope(enum MemoryTag tag) :
+		previousTag(MemoryTracker::getCurrentTag())
+	{
+		MemoryTracker::setCurrentTag(tag);
+	}
+
+	~MemoryTagScope()
+	{
+		MemoryTracker::setCurrentTag(previousTag);
+	}
+private:
+	enum MemoryTag previousTag;
+
+	NULL_COPY_AND_ASSIGN(MemoryTagScope);
+};
@@ -0,0 +1,72 @@
+#include "allocator.hpp"
+#include "math/math.hpp"
+
+PoolAllocator::PoolAllocator(uintptr blockSizeIn, uint32 blocksPerChunkIn) :
+	freeList(nullptr),
+	chunks(nullptr),
+	blockSize(0),
+	blocksPerChunk(blocksPerChunkIn),
+	numBlocksUsed(0)
+{
+	assertCheck(blocksPerChunk > 0);
+	if(blockSizeIn != 0) {
+		// Free blocks hold the free list's next pointer
+		blockSize = Memory::align(Math::max(blockSizeIn, (uintptr)sizeof(void*)),
+				(uintptr)BLOCK_ALIGNMENT);
+	}
+}
+
+PoolAllocator::~PoolAllocator()
+{
+	assertCheck(numBlocksUsed == 0);
+	while(chunks != nullptr) {
+		Chunk* next = chunks->next;
+		Memory::free(chunks);
+		chunks = next;
+	}
+}
+
+void* PoolAllocator::allocate(uintptr amt, uint32 alignment)
+{
+	if(blockSize == 0) {
+		blockSize = Memory::align(Math::max(amt, (uintptr)sizeof(void*)),
+				(uintptr)BLOCK_ALIGNMENT);
+	}
+	if(amt > blockSize || alignment > BLOCK_ALIGNMENT) {
+		return Memory::malloc(amt, alignment);
+	}
+
+	if(freeList == nullptr) {
+		addChunk();
+	}
+	void* result = freeList;
+	freeList = *(void**)freeList;
+	numBlocksUsed++;
+	return result;
+}
+
+void PoolAllocator::deallocate(void* ptr, uintptr amt, uint32 alignment)
+{
+	if(amt > blockSize || alignment > BLOCK_ALIGNMENT) {
+		Memory::free(ptr, amt, alignment);
+		return;
+	}
+	*(void**)ptr = freeList;
+	freeList = ptr;
+	numBlocksUsed--;
+}
+
+void PoolAllocator::addChunk()
+{
+	// The chunk header takes the place of one block, keeping the rest aligned
+	uint8* memory = (uint8*)Memory::malloc(blockSize * (blocksPerChunk + 1), BLOCK_ALIGNMENT);
+	Chunk* chunk = (Chunk*)memory;
+	chunk->next = chunks;
+	chunks = chunk;
+
+	uint8* block = memory + blockSize;
+	for(uint32 i = 0; i < blocksPerChunk; i++, block += blockSize) {
+		*(void**)block = freeList;
+		freeList = block;
+	}
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "core/common.hpp"
+#include "core/memory.hpp"
+#include <memory>
+#include <cstddef>
+
+/**
+ * Allocators that containers can take their memory from.
+ *
+ * An allocator is any type with
+ *     void* allocate(uintptr amt, uint32 alignment);
+ *     void deallocate(void* ptr, uintptr amt, uint32 alignment);
+ * where deallocate is given the same amt and alignment as the allocation.
+ * HeapAllocator, PoolAllocator, FixedBufferAllocator and FrameArena are
+ * allocators, and Array, Map and BasicString take one as their last
+ * template parameter, defaulting to HeapAllocator.
+ */
+
+/** The engine heap, Memory::malloc. */
+struct HeapAllocator
+{
+	FORCEINLINE void* allocate(uintptr amt, uint32 alignment)
+	{
+		return Memory::malloc(amt, alignment);
+	}
+
+	FORCEINLINE void deallocate(void* ptr, uintptr amt, uint32 alignment)
+	{
+		Memory::free(ptr, amt, alignment);
+	}
+};
+
+/**
+ * Hands out blocks of one size from chunks of blocksPerChunk blocks, and
+ * keeps freed blocks to reuse. Suits containers that allocate one element
+ * at a time, such as Map. Allocations larger than a block, or more aligned,
+ * go to the heap instead.
+ *
+ * A block size of 0 takes the size of the first allocation, which saves
+ * working out a Map's node size.
+ */
+class PoolAllocator
+{
+public:
+	enum
+	{
+		BLOCK_ALIGNMENT = 16
+	};
+
+	PoolAllocator(uintptr blockSize = 0, uint32 blocksPerChunk = 64);
+	~PoolAllocator();
+
+	void* allocate(uintptr amt, uint32 alignment);
+	void deallocate(void* ptr, uintptr amt, uint32 alignment);
+
+	FORCEINLINE uintptr getBlockSize() const { return blockSize; }
+	/** Blocks allocated and not yet deallocated. */
+	FORCEINLINE uint32 getNumBlocksUsed() const { return numBlocksUsed; }
+private:
+	struct Chunk
+	{
+		Chunk* next;
+	};
+
+	void* freeList;
+	Chunk* chunks;
+	uintptr blockSize;
+	uint32 blocksPerChunk;
+	uint32 numBlocksUsed;
+
+	void addChunk();
+
+	NULL_COPY_AND_ASSIGN(PoolAllocator);
+};
+
+/**
+ * Allocates from SIZE bytes held in the allocator itself, so a container of
+ * bounded size on the stack touches no heap at all. Allocations that don't
+ * fit go to the heap.
+ *
+ * Space is only reclaimed when the latest allocation is deallocated, so
+ * arrays should reserve their size up front rather than grow into it.
+ */
+template<uintptr SIZE>
+class FixedBufferAllocator
+{
+public:
+	FixedBufferAllocator() : used(0) {}
+
+	void* allocate(uintptr amt, uint32 alignment)
+	{
+		uintptr start = (uintptr)Memory::align(buffer + used, alignment) - (uintptr)buffer;
+		if(start + amt > SIZE) {
+			return Memory::malloc(amt, alignment);
+		}
+		used = start + amt;
+		return buffer + start;
+	}
+
+	void deallocate(void* ptr, uintptr amt, uint32 alignment)
+	{
+		if(!owns(ptr)) {
+			Memory::free(ptr, amt, alignment);
+		} else if((uint8*)ptr + amt == buffer + used) {
+			used = (uint8*)ptr - buffer;
+		}
+	}
+
+	FORCEINLINE bool owns(const void* ptr) const
+	{
+		return (const uint8*)ptr >= buffer && (const uint8*)ptr < buffer + SIZE;
+	}
+
+	FORCEINLINE uintptr getBytesUsed() const { return used; }
+private:
+	alignas(Memory::DEFAULT_ALIGNMENT) uint8 buffer[SIZE];
+	uintptr used;
+
+	NULL_COPY_AND_ASSIGN(FixedBufferAllocator);
+};
+
+/**
+ * Standard library allocator taking memory from the allocator Alloc, which
+ * must outlive the containers using it. This is what Array, Map and
+ * BasicString pass to the standard containers.
+ */
+template<typename T, typename Alloc>
+class StdAllocator
+{
+public:
+	typedef T value_type;
+
+	template<typename U>
+	struct rebind
+	{
+		typedef StdAllocator<U, Alloc> other;
+	};
+
+	StdAllocator(Alloc& allocatorIn) : allocator(&allocatorIn) {}
+
+	template<typename U>
+	StdAllocator(const StdAllocator<U, Alloc>& other) : allocator(other.getAllocator()) {}
+
+	FORCEINLINE T* allocate(std::size_t count)
+	{
+		return (T*)allocator->allocate(count * sizeof(T), alignof(T));
+	}
+
+	FORCEINLINE void deallocate(T* ptr, std::size_t count)
+	{
+		allocator->deallocate(ptr, count * sizeof(T), alignof(T));
+	}
+
+	FORCEINLINE Alloc* getAllocator() const { return allocator; }
+private:
+	Alloc* allocator;
+};
+
+template<typename T, typename U, typename Alloc>
+FORCEINLINE bool operator==(const StdAllocator<T, Alloc>& a, const StdAllocator<U, Alloc>& b)
+{
+	return a.getAllocator() == b.getAllocator();
+}
+
+template<typename T, typename U, typename Alloc>
+FORCEINLINE bool operator!=(const StdAllocator<T, Alloc>& a, const StdAllocator<U, Alloc>& b)
+{
+	return a.getAllocator() != b.getAllocator();
+}
+
+/**
+ * The standard library allocator for containers of T using Alloc.
+ *
+ * Containers on the heap use std::allocator, which goes through the global
+ * operator new that memory.cpp points at Memory::malloc. That keeps them the
+ * same types as the standard containers, so they still work with code
+ * expecting those, and keeps them free of an allocator pointer.
+ */
+template<typename T, typename Alloc>
+struct ContainerAllocator
+{
+	typedef StdAllocator<T, Alloc> Type;
+};
+
+template<typename T>
+struct ContainerAllocator<T, HeapAllocator>
+{
+	typedef std::allocator<T> Type;
+};
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "allocator.hpp"
 #include <vector>
 
-#define Array std::vector
-
+/** Dynamic array taking its memory from Alloc, which is passed on construction. */
+template<typename T, typename Alloc = HeapAllocator>
+using Array = std::vector<T, typename ContainerAllocator<T, Alloc>::Type>;
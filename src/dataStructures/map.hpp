@@ -1,5 +1,9 @@
 #pragma once
 
+#include "allocator.hpp"
 #include <map>
 
-#define Map std::map
+/** Ordered map taking its memory from Alloc, which is passed on construction. */
+template<typename K, typename V, typename Alloc = HeapAllocator>
+using Map = std::map<K, V, std::less<K>,
+	  typename ContainerAllocator<std::pair<const K, V>, Alloc>::Type>;
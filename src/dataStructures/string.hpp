@@ -5,7 +5,15 @@
 #include "core/common.hpp"
 #include "array.hpp"
 
-#define String std::string
+/**
+ * String taking its memory from Alloc, which is passed on construction.
+ * String, with the default allocator, is std::string.
+ */
+template<typename Alloc = HeapAllocator>
+using BasicString = std::basic_string<char, std::char_traits<char>,
+	  typename ContainerAllocator<char, Alloc>::Type>;
+
+typedef BasicString<> String;
 
 struct StringFuncs
 {
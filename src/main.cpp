@@ -5,6 +5,9 @@
 #include "math/transform.hpp"
 #include "rendering/renderContext.hpp"
 #include "rendering/modelLoader.hpp"
+#include "rendering/uniformBufferArena.hpp"
+#include "rendering/instanceBuffer.hpp"
+#include "rendering/renderQueue.hpp"
 
 #include "core/timing.hpp"
 #include "tests.hpp"
@@ -13,14 +16,20 @@
 #include "math/aabb.hpp"
 #include "math/plane.hpp"
 #include "math/intersects.hpp"
+#include "math/simdKernels.hpp"
 
 // NOTE: Profiling reveals that in the current instanced rendering system:
 // - Updating the buffer takes more time than
 // - Calculating the transforms which takes more time than
 // - Performing the instanced draw
+// The instance format trades upload size for shader work; see InstanceFormat.
+static const enum InstanceFormat::Format instanceFormat =
+	InstanceFormat::FORMAT_TRANSLATION_ROTATION_UNIFORM_SCALE;
+
 static int runApp(Application* app)
 {
 	Tests::runTests();
+	DEBUG_LOG("Main", "NONE", "%s", SIMDKernels::getReport().c_str());
 	Window window(*app, 800, 600, "My Window!");
 
 	// Begin scene creation
@@ -32,7 +41,7 @@ static int runApp(Application* app)
 	Array<uint32> modelMaterialIndices;
 	Array<MaterialSpec> modelMaterials;
 	ModelLoader::loadModels("./res/models/monkey3.obj", models,
-			modelMaterialIndices, modelMaterials);
+			modelMaterialIndices, modelMaterials, instanceFormat);
 //	IndexedModel model;
 //	model.allocateElement(3); // Positions
 //	model.allocateElement(2); // TexCoords
@@ -67,11 +76,15 @@ static int runApp(Application* app)
 
 	String shaderText;
 	StringFuncs::loadTextFileWithIncludes(shaderText, "./res/shaders/basicShader.glsl", "#include");
+	shaderText = "#define " + String(InstanceFormat::getShaderDefine(instanceFormat)) +
+		"\n" + shaderText;
 	Shader shader(device, shaderText);
 	shader.setSampler("diffuse", texture, sampler, 0);
 	
 	Matrix perspective(Matrix::perspective(Math::toRadians(70.0f/2.0f),
 				4.0f/3.0f, 0.1f, 1000.0f));
+	// Per-draw constant blocks are written here each frame and bound by range
+	UniformBufferArena<RenderDevice> uniformArena(device, 64 * 1024);
 	float amt = 0.0f;
 	Color color(0.0f, 0.15f, 0.3f);
 	float randZ = 20.0f;
@@ -79,19 +92,25 @@ static int runApp(Application* app)
 	float randScaleY = randZ;
 	
 	uint32 numInstances = 1000;
-	Matrix transformMatrix(Matrix::identity());
-	Transform transform;
-	Array<Matrix> transformMatrixArray;
-	Array<Matrix> transformMatrixBaseArray;
+	Array<Transform> transforms;
 	for(uint32 i = 0; i < numInstances; i++) {
-		transformMatrixArray.push_back(Matrix::identity());
-		transform.setTranslation(Vector3f(
+		transforms.push_back(Transform(Vector3f(
 					(Math::randf() * randScaleX)-randScaleX/2.0f,
 					(Math::randf() * randScaleY)-randScaleY/2.0f,
-					randZ));
-		transformMatrixBaseArray.push_back(transform.toMatrix());
+					randZ)));
+	}
+	Array<float> instanceData[InstanceFormat::MAX_ELEMENTS];
+	void* instanceElements[InstanceFormat::MAX_ELEMENTS];
+	InstanceBuffer<VertexArray>* instanceBuffers[InstanceFormat::MAX_ELEMENTS];
+	uint32 numInstanceElements = InstanceFormat::getNumElements(instanceFormat);
+	for(uint32 i = 0; i < numInstanceElements; i++) {
+		uint32 elementSize = InstanceFormat::getElementSize(instanceFormat, i);
+		instanceData[i].resize(numInstances * elementSize);
+		instanceElements[i] = &instanceData[i][0];
+		instanceBuffers[i] = new InstanceBuffer<VertexArray>(vertexArray, 4 + i,
+				elementSize * sizeof(float));
+		instanceBuffers[i]->resize(numInstances);
 	}
-	transform.setTranslation(Vector3f(0.0f,0.0f,0.0f));
 	
 	RenderDevice::DrawParams drawParams;
 	drawParams.primitiveType = RenderDevice::PRIMITIVE_TRIANGLES;
@@ -100,6 +119,9 @@ static int runApp(Application* app)
 	drawParams.depthFunc = RenderDevice::DRAW_FUNC_LESS;
 //	drawParams.sourceBlend = RenderDevice::BLEND_FUNC_ONE;
 //	drawParams.destBlend = RenderDevice::BLEND_FUNC_ONE;
+	PipelineState pipelineState(device, drawParams);
+	RenderQueue<RenderDevice> renderQueue(device);
+	renderQueue.setUniformBufferName("SceneData");
 	// End scene creation
 
 	uint32 fps = 0;
@@ -107,6 +129,10 @@ static int runApp(Application* app)
 	double fpsTimeCounter = 0.0;
 	double updateTimer = 1.0;
 	float frameTime = 1.0/60.0;
+	uint32 updates = 0;
+	uint64 bytesUploaded = 0;
+	int32 stateChangesSaved = 0;
+	FrameArena& frameArena = device.getFrameArena();
 	while(app->isRunning()) {
 		double currentTime = Time::getTime();
 		double passedTime = currentTime - lastTime;
@@ -117,21 +143,39 @@ static int runApp(Application* app)
 
 		if(fpsTimeCounter >= 1.0) {
 			double msPerFrame = 1000.0/(double)fps;
-			DEBUG_LOG("FPS", "NONE", "%f ms (%d fps)", msPerFrame, fps);
+			double kbPerUpdate = updates == 0 ? 0.0
+				: (double)bytesUploaded/(1024.0 * (double)updates);
+			double stateChangesSavedPerFrame = fps == 0 ? 0.0
+				: (double)stateChangesSaved/(double)fps;
+			DEBUG_LOG("FPS", "NONE",
+					"%f ms (%d fps), %.1f KB uploaded per update, %.1f state changes saved per frame, "
+					"%.1f KB frame arena high-water mark",
+					msPerFrame, fps, kbPerUpdate, stateChangesSavedPerFrame,
+					(double)frameArena.getHighWaterMark()/1024.0);
 			fpsTimeCounter = 0;
 			fps = 0;
+			stateChangesSaved = 0;
+			updates = 0;
+			bytesUploaded = 0;
 		}
 		
 		bool shouldRender = false;
 		while(updateTimer >= frameTime) {
 			app->processMessages(frameTime);
 			// Begin scene update
-			transform.setRotation(Quaternion(Vector3f(1.0f, 1.0f, 1.0f).normalized(), amt*10.0f/11.0f));
-			for(uint32 i = 0; i < transformMatrixArray.size(); i++) {
-				transformMatrixArray[i] = (perspective * transformMatrixBaseArray[i] * transform.toMatrix());
+			Quaternion rotation(Vector3f(1.0f, 1.0f, 1.0f).normalized(), amt*10.0f/11.0f);
+			for(uint32 i = 0; i < numInstances; i++) {
+				transforms[i].setRotation(rotation);
 			}
-			vertexArray.updateBuffer(4, &transformMatrixArray[0],
-					transformMatrixArray.size() * sizeof(Matrix));
+			InstanceFormat::pack(instanceFormat, &transforms[0], instanceElements,
+					numInstances);
+			// Every instance rotates, so all of them are dirty each update
+			for(uint32 i = 0; i < numInstanceElements; i++) {
+				instanceBuffers[i]->markAllDirty();
+				instanceBuffers[i]->update(instanceElements[i]);
+				bytesUploaded += instanceBuffers[i]->getBytesUploaded();
+			}
+			updates++;
 			amt += (float)frameTime/2.0f;
 			// End scene update
 
@@ -142,15 +186,37 @@ static int runApp(Application* app)
 		if(shouldRender) {
 			// Begin scene render
 			context.clear(color, true);
-			context.draw(shader, vertexArray, drawParams, numInstances);
+			UniformBufferArena<RenderDevice>::Block sceneData;
+			if(uniformArena.upload(&perspective, sizeof(Matrix), &sceneData)) {
+				uniformArena.flush();
+				renderQueue.submit(target.getId(), 0, pipelineState.getId(), shader.getId(), 0,
+						vertexArray.getId(), randZ, numInstances, vertexArray.getNumIndices(),
+						uniformArena.getId(), sceneData.offset, sceneData.size);
+			} else {
+				DEBUG_LOG("Main", LOG_WARNING, "Uniform buffer arena out of space; scene skipped");
+			}
+			renderQueue.flush();
+			stateChangesSaved += renderQueue.getNumStateChangesSaved();
+			uniformArena.endFrame();
 			// End scene render
 			
 			window.present();
+			frameArena.endFrame();
 			fps++;
 		} else {
 			Time::sleep(1);
 		}
 	}
+
+	for(uint32 i = 0; i < numInstanceElements; i++) {
+		delete instanceBuffers[i];
+	}
+
+#if MEMORY_TRACKING
+	char report[4096];
+	MemoryTracker::writeReport(report, sizeof(report), MEMORY_REPORT_TEXT);
+	DEBUG_LOG("Main", "NONE", "Memory by tag:\n%s", report);
+#endif
 	return 0;
 }
 
@@ -0,0 +1,41 @@
+#include "aabbArray.hpp"
+#include "simdKernels.hpp"
+
+uint32 AABBArray::add(const AABB& aabb)
+{
+	uint32 index = streams.add();
+	set(index, aabb);
+	return index;
+}
+
+void AABBArray::set(uint32 index, const AABB& aabb)
+{
+	assertCheck(index < size());
+	Vector3f center, extents;
+	aabb.getCenterAndExtents(center, extents);
+	streams.getStream(STREAM_CENTER_X)[index] = center[0];
+	streams.getStream(STREAM_CENTER_Y)[index] = center[1];
+	streams.getStream(STREAM_CENTER_Z)[index] = center[2];
+	streams.getStream(STREAM_EXTENT_X)[index] = extents[0];
+	streams.getStream(STREAM_EXTENT_Y)[index] = extents[1];
+	streams.getStream(STREAM_EXTENT_Z)[index] = extents[2];
+}
+
+AABB AABBArray::get(uint32 index) const
+{
+	assertCheck(index < size());
+	Vector3f center(streams.getStream(STREAM_CENTER_X)[index],
+			streams.getStream(STREAM_CENTER_Y)[index],
+			streams.getStream(STREAM_CENTER_Z)[index]);
+	Vector3f extents(streams.getStream(STREAM_EXTENT_X)[index],
+			streams.getStream(STREAM_EXTENT_Y)[index],
+			streams.getStream(STREAM_EXTENT_Z)[index]);
+	return AABB(center - extents, center + extents);
+}
+
+void AABBArray::cullFrustum(const Plane planes[6], uint64* visibleBits,
+		uint64* intersectingBits) const
+{
+	SIMDKernels::get().cullAABBs(streams.getData(), streams.getStride(), size(), planes,
+			visibleBits, intersectingBits);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "aabb.hpp"
+#include "plane.hpp"
+#include "soaStreams.hpp"
+
+/**
+ * A collection of AABBs stored as separate center and extent streams
+ * (structure of arrays) so they can be tested in bulk with SIMD.
+ */
+class AABBArray
+{
+public:
+	AABBArray() {}
+
+	uint32 add(const AABB& aabb);
+	void set(uint32 index, const AABB& aabb);
+	AABB get(uint32 index) const;
+	FORCEINLINE void removeSwap(uint32 index) { streams.removeSwap(index); }
+	FORCEINLINE void reserve(uint32 amt) { streams.reserve(amt); }
+	FORCEINLINE void clear() { streams.clear(); }
+
+	/**
+	 * Tests every box against the 6 frustum planes. Planes point inwards, as
+	 * produced by Matrix::extractFrustumPlanes.
+	 *
+	 * Bit i of visibleBits is set if box i is at least partially inside the
+	 * frustum; boxes with the bit cleared are fully outside. If
+	 * intersectingBits is given, bit i is set if box i is visible but
+	 * crosses at least one plane; visible boxes with the bit cleared are
+	 * fully inside. Both arrays must hold getNumBitmaskWords() entries.
+	 */
+	void cullFrustum(const Plane planes[6], uint64* visibleBits,
+			uint64* intersectingBits=nullptr) const;
+
+	FORCEINLINE uint32 size() const { return streams.size(); }
+	FORCEINLINE uint32 getNumBitmaskWords() const { return (size() + 63)/64; }
+private:
+	enum
+	{
+		STREAM_CENTER_X = 0,
+		STREAM_CENTER_Y,
+		STREAM_CENTER_Z,
+		STREAM_EXTENT_X,
+		STREAM_EXTENT_Y,
+		STREAM_EXTENT_Z,
+		NUM_STREAMS
+	};
+
+	SoAStreams<NUM_STREAMS> streams;
+
+	NULL_COPY_AND_ASSIGN(AABBArray)
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "matrix.hpp"
+
+/**
+ * The top 3 rows of a Matrix whose bottom row is (0, 0, 0, 1), such as
+ * those built from a Transform.
+ *
+ * The projective row is implied instead of stored, so multiplies skip a
+ * quarter of the work and inverses only need the 3x3 part: its cofactors are
+ * the cross products of pairs of rows, and its determinant is one dot product.
+ */
+class AffineMatrix
+{
+public:
+	FORCEINLINE AffineMatrix();
+	FORCEINLINE AffineMatrix(const Vector& row0, const Vector& row1, const Vector& row2);
+	/** Drops the bottom row of mat, which must be affine. */
+	FORCEINLINE explicit AffineMatrix(const Matrix& mat);
+
+	static FORCEINLINE AffineMatrix identity();
+
+	FORCEINLINE Matrix toMatrix() const;
+
+	FORCEINLINE AffineMatrix operator* (const AffineMatrix& other) const;
+	FORCEINLINE AffineMatrix& operator*= (const AffineMatrix& other);
+	FORCEINLINE bool equals(const AffineMatrix& other, float errorMargin=1.e-4f) const;
+	FORCEINLINE Vector transform(const Vector& vector) const;
+
+	FORCEINLINE float determinant() const;
+	FORCEINLINE AffineMatrix inverse() const;
+
+	/** Same result as Matrix::toNormalMatrix: the transpose of the inverse. */
+	FORCEINLINE Matrix toNormalMatrix() const;
+
+	FORCEINLINE Vector operator[](uint32 index) const {
+		assertCheck(index < 3);
+		return m[index];
+	}
+private:
+	Vector m[3];
+
+	static FORCEINLINE Vector mulRow(const Vector& row, const AffineMatrix& other);
+};
+
+FORCEINLINE AffineMatrix::AffineMatrix() {}
+
+FORCEINLINE AffineMatrix::AffineMatrix(const Vector& row0, const Vector& row1,
+		const Vector& row2)
+{
+	m[0] = row0;
+	m[1] = row1;
+	m[2] = row2;
+}
+
+FORCEINLINE AffineMatrix::AffineMatrix(const Matrix& mat)
+{
+	assertCheck(mat.isAffine());
+	m[0] = mat[0];
+	m[1] = mat[1];
+	m[2] = mat[2];
+}
+
+FORCEINLINE AffineMatrix AffineMatrix::identity()
+{
+	return AffineMatrix(
+			Vector::make(1.0f, 0.0f, 0.0f, 0.0f),
+			Vector::make(0.0f, 1.0f, 0.0f, 0.0f),
+			Vector::make(0.0f, 0.0f, 1.0f, 0.0f));
+}
+
+FORCEINLINE Matrix AffineMatrix::toMatrix() const
+{
+	return Matrix(m[0], m[1], m[2], Vector::make(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+FORCEINLINE Vector AffineMatrix::mulRow(const Vector& row, const AffineMatrix& other)
+{
+	// The implied bottom row of other only passes this row's w through
+	Vector result = VectorConstants::ZERO.select(VectorConstants::MASK_W, row);
+	result = row.replicate(0).mad(other.m[0], result);
+	result = row.replicate(1).mad(other.m[1], result);
+	return row.replicate(2).mad(other.m[2], result);
+}
+
+FORCEINLINE AffineMatrix AffineMatrix::operator* (const AffineMatrix& other) const
+{
+	return AffineMatrix(mulRow(m[0], other), mulRow(m[1], other), mulRow(m[2], other));
+}
+
+FORCEINLINE AffineMatrix& AffineMatrix::operator*= (const AffineMatrix& other)
+{
+	*this = *this * other;
+	return *this;
+}
+
+FORCEINLINE bool AffineMatrix::equals(const AffineMatrix& other, float errorMargin) const
+{
+	for(uint32 i = 0; i < 3; i++) {
+		if(!(m[i].notEquals(other.m[i], errorMargin)).isZero4f()) {
+			return false;
+		}
+	}
+	return true;
+}
+
+FORCEINLINE Vector AffineMatrix::transform(const Vector& vector) const
+{
+	return Vector::make(vector.dot4(m[0])[0], vector.dot4(m[1])[0],
+			vector.dot4(m[2])[0], vector[3]);
+}
+
+FORCEINLINE float AffineMatrix::determinant() const
+{
+	return m[0].dot3(m[1].cross3(m[2]))[0];
+}
+
+FORCEINLINE Matrix AffineMatrix::toNormalMatrix() const
+{
+	// The transposed inverse of the 3x3 part is its cofactor matrix over its
+	// determinant, and row i of the cofactor matrix is the cross product of
+	// the other two rows. The cross products have w = 0, which is also the
+	// last column of the result.
+	Vector cofactor0 = m[1].cross3(m[2]);
+	Vector cofactor1 = m[2].cross3(m[0]);
+	Vector cofactor2 = m[0].cross3(m[1]);
+	Vector rdet = m[0].dot3(cofactor0).reciprocal();
+	cofactor0 = cofactor0 * rdet;
+	cofactor1 = cofactor1 * rdet;
+	cofactor2 = cofactor2 * rdet;
+
+	// Bottom row is the transposed inverse translation, -inverse(A) * t
+	Vector translation = cofactor0 * m[0].replicate(3);
+	translation = cofactor1.mad(m[1].replicate(3), translation);
+	translation = cofactor2.mad(m[2].replicate(3), translation);
+	return Matrix(cofactor0, cofactor1, cofactor2,
+			(-translation).select(VectorConstants::MASK_W, VectorConstants::ONE));
+}
+
+FORCEINLINE AffineMatrix AffineMatrix::inverse() const
+{
+	// Transposing the normal matrix gives the full inverse, and its bottom
+	// row comes out as (0, 0, 0, 1).
+	Matrix normalMatrix(toNormalMatrix());
+	Vector row0 = normalMatrix[0];
+	Vector row1 = normalMatrix[1];
+	Vector row2 = normalMatrix[2];
+	Vector row3 = normalMatrix[3];
+	Vector::transpose4(row0, row1, row2, row3);
+	return AffineMatrix(row0, row1, row2);
+}
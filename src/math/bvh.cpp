@@ -0,0 +1,457 @@
+#include "bvh.hpp"
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <thread>
+
+#define BVH_NUM_BINS 16
+#define BVH_MAX_LEAF_SIZE 8
+#define BVH_MIN_PARALLEL_BUILD_SIZE 4096
+#define BVH_TRAVERSAL_COST 1.0f
+#define BVH_MAX_DEPTH 64
+
+static const float BVH_INFINITY = std::numeric_limits<float>::infinity();
+
+struct BVH::BuildContext
+{
+	const Vector* triangleMins;
+	const Vector* triangleMaxs;
+	const float* centroids;
+	uint32* triangleIndices;
+	std::atomic<uint32> nodesUsed;
+	uint32 parallelDepth;
+};
+
+static FORCEINLINE float getHalfArea(const Vector& mins, const Vector& maxs)
+{
+	float d[4];
+	(maxs - mins).store4f(d);
+	return d[0]*d[1] + d[1]*d[2] + d[2]*d[0];
+}
+
+BVH::BVH() :
+	nodes(nullptr),
+	triangles(nullptr),
+	numNodes(0),
+	numTriangles(0) {}
+
+BVH::~BVH()
+{
+	release();
+}
+
+void BVH::release()
+{
+	Memory::free(nodes);
+	Memory::free(triangles);
+	nodes = nullptr;
+	triangles = nullptr;
+	numNodes = 0;
+	numTriangles = 0;
+}
+
+void BVH::build(const float* positions, const uint32* indices,
+		uint32 numTrianglesIn, uint32 numThreads)
+{
+	release();
+	if(numTrianglesIn == 0) {
+		return;
+	}
+	numTriangles = numTrianglesIn;
+
+	Vector* triangleMins = (Vector*)Memory::malloc(sizeof(Vector) * numTriangles);
+	Vector* triangleMaxs = (Vector*)Memory::malloc(sizeof(Vector) * numTriangles);
+	float* centroids = (float*)Memory::malloc(sizeof(float) * 3 * numTriangles);
+	uint32* triangleIndices = (uint32*)Memory::malloc(sizeof(uint32) * numTriangles);
+	for(uint32 i = 0; i < numTriangles; i++) {
+		Vector v0 = Vector::load3f(&positions[indices[i*3] * 3], 0.0f);
+		Vector v1 = Vector::load3f(&positions[indices[i*3+1] * 3], 0.0f);
+		Vector v2 = Vector::load3f(&positions[indices[i*3+2] * 3], 0.0f);
+		triangleMins[i] = v0.min(v1).min(v2);
+		triangleMaxs[i] = v0.max(v1).max(v2);
+		float centroid[4];
+		((triangleMins[i] + triangleMaxs[i]) * VectorConstants::HALF).store4f(centroid);
+		Memory::memcpy(&centroids[i*3], centroid, sizeof(float) * 3);
+		triangleIndices[i] = i;
+	}
+
+	// Root at 0, then an unused node so every sibling pair starts on an
+	// even index and so on a 64-byte boundary.
+	uint32 maxNodes = Math::max(numTriangles * 2, 2u);
+	nodes = (Node*)Memory::malloc(sizeof(Node) * maxNodes, 64);
+
+	if(numThreads == 0) {
+		numThreads = Math::max(std::thread::hardware_concurrency(), 1u);
+	}
+	BuildContext context;
+	context.triangleMins = triangleMins;
+	context.triangleMaxs = triangleMaxs;
+	context.centroids = centroids;
+	context.triangleIndices = triangleIndices;
+	context.nodesUsed = 2;
+	context.parallelDepth = Math::ceilLog2(numThreads);
+	buildNode(context, 0, 0, numTriangles, 0);
+	numNodes = context.nodesUsed;
+
+	triangles = (Triangle*)Memory::malloc(sizeof(Triangle) * numTriangles);
+	for(uint32 i = 0; i < numTriangles; i++) {
+		uint32 index = triangleIndices[i];
+		const float* v0 = &positions[indices[index*3] * 3];
+		const float* v1 = &positions[indices[index*3+1] * 3];
+		const float* v2 = &positions[indices[index*3+2] * 3];
+		Triangle& triangle = triangles[i];
+		for(uint32 j = 0; j < 3; j++) {
+			triangle.v0[j] = v0[j];
+			triangle.edge1[j] = v1[j] - v0[j];
+			triangle.edge2[j] = v2[j] - v0[j];
+		}
+		triangle.index = index;
+	}
+
+	Memory::free(triangleMins);
+	Memory::free(triangleMaxs);
+	Memory::free(centroids);
+	Memory::free(triangleIndices);
+}
+
+void BVH::buildNode(BuildContext& context, uint32 nodeIndex, uint32 first,
+		uint32 count, uint32 depth)
+{
+	uint32* triangleIndices = context.triangleIndices;
+	Vector mins(VectorConstants::INF);
+	Vector maxs(-VectorConstants::INF);
+	Vector centroidMins(VectorConstants::INF);
+	Vector centroidMaxs(-VectorConstants::INF);
+	for(uint32 i = first; i < first + count; i++) {
+		uint32 index = triangleIndices[i];
+		mins = mins.min(context.triangleMins[index]);
+		maxs = maxs.max(context.triangleMaxs[index]);
+		Vector centroid = (context.triangleMins[index] + context.triangleMaxs[index])
+			* VectorConstants::HALF;
+		centroidMins = centroidMins.min(centroid);
+		centroidMaxs = centroidMaxs.max(centroid);
+	}
+
+	Node& node = nodes[nodeIndex];
+	mins.store3f(node.mins);
+	maxs.store3f(node.maxs);
+	node.leftOrFirst = first;
+	node.count = count;
+	if(count <= 2 || depth >= BVH_MAX_DEPTH) {
+		return;
+	}
+
+	// Find the cheapest split over BVH_NUM_BINS centroid bins on each axis
+	float centroidMin[4], centroidMax[4];
+	centroidMins.store4f(centroidMin);
+	centroidMaxs.store4f(centroidMax);
+	float bestCost = BVH_INFINITY;
+	uint32 bestAxis = 0;
+	uint32 bestSplit = 0;
+	for(uint32 axis = 0; axis < 3; axis++) {
+		float extent = centroidMax[axis] - centroidMin[axis];
+		if(extent <= 0.0f) {
+			continue;
+		}
+		float scale = (float)BVH_NUM_BINS / extent;
+		uint32 binCounts[BVH_NUM_BINS] = { 0 };
+		Vector binMins[BVH_NUM_BINS];
+		Vector binMaxs[BVH_NUM_BINS];
+		for(uint32 i = 0; i < BVH_NUM_BINS; i++) {
+			binMins[i] = VectorConstants::INF;
+			binMaxs[i] = -VectorConstants::INF;
+		}
+		for(uint32 i = first; i < first + count; i++) {
+			uint32 index = triangleIndices[i];
+			uint32 bin = Math::min((uint32)((context.centroids[index*3 + axis]
+						- centroidMin[axis]) * scale), (uint32)BVH_NUM_BINS - 1);
+			binCounts[bin]++;
+			binMins[bin] = binMins[bin].min(context.triangleMins[index]);
+			binMaxs[bin] = binMaxs[bin].max(context.triangleMaxs[index]);
+		}
+
+		float leftCosts[BVH_NUM_BINS];
+		Vector sweepMins(VectorConstants::INF);
+		Vector sweepMaxs(-VectorConstants::INF);
+		uint32 sweepCount = 0;
+		for(uint32 i = 0; i < BVH_NUM_BINS - 1; i++) {
+			sweepCount += binCounts[i];
+			sweepMins = sweepMins.min(binMins[i]);
+			sweepMaxs = sweepMaxs.max(binMaxs[i]);
+			leftCosts[i] = sweepCount == 0 ? 0.0f
+				: getHalfArea(sweepMins, sweepMaxs) * (float)sweepCount;
+		}
+		sweepMins = VectorConstants::INF;
+		sweepMaxs = -VectorConstants::INF;
+		sweepCount = 0;
+		for(uint32 i = BVH_NUM_BINS - 1; i > 0; i--) {
+			sweepCount += binCounts[i];
+			sweepMins = sweepMins.min(binMins[i]);
+			sweepMaxs = sweepMaxs.max(binMaxs[i]);
+			if(sweepCount == 0 || sweepCount == count) {
+				continue;
+			}
+			float cost = leftCosts[i-1] + getHalfArea(sweepMins, sweepMaxs) * (float)sweepCount;
+			if(cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i;
+			}
+		}
+	}
+
+	float leafCost = getHalfArea(mins, maxs) * (float)count;
+	float splitCost = getHalfArea(mins, maxs) * BVH_TRAVERSAL_COST + bestCost;
+	if(bestCost == BVH_INFINITY ||
+			(splitCost >= leafCost && count <= BVH_MAX_LEAF_SIZE)) {
+		return;
+	}
+
+	// Partition in place: bins below bestSplit go left
+	float scale = (float)BVH_NUM_BINS / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+	uint32 i = first;
+	uint32 j = first + count;
+	while(i < j) {
+		uint32 index = triangleIndices[i];
+		uint32 bin = Math::min((uint32)((context.centroids[index*3 + bestAxis]
+					- centroidMin[bestAxis]) * scale), (uint32)BVH_NUM_BINS - 1);
+		if(bin < bestSplit) {
+			i++;
+		} else {
+			j--;
+			triangleIndices[i] = triangleIndices[j];
+			triangleIndices[j] = index;
+		}
+	}
+	uint32 leftCount = i - first;
+	assertCheck(leftCount > 0 && leftCount < count);
+
+	uint32 children = context.nodesUsed.fetch_add(2);
+	node.leftOrFirst = children;
+	node.count = 0;
+	if(depth < context.parallelDepth && count >= BVH_MIN_PARALLEL_BUILD_SIZE) {
+		std::thread leftThread(&BVH::buildNode, this, std::ref(context),
+				children, first, leftCount, depth + 1);
+		buildNode(context, children + 1, i, count - leftCount, depth + 1);
+		leftThread.join();
+	} else {
+		buildNode(context, children, first, leftCount, depth + 1);
+		buildNode(context, children + 1, i, count - leftCount, depth + 1);
+	}
+}
+
+AABB BVH::getBounds() const
+{
+	if(numTriangles == 0) {
+		return AABB(Vector3f(0.0f), Vector3f(0.0f));
+	}
+	return AABB(Vector3f(nodes[0].mins[0], nodes[0].mins[1], nodes[0].mins[2]),
+			Vector3f(nodes[0].maxs[0], nodes[0].maxs[1], nodes[0].maxs[2]));
+}
+
+// Returns the distance at which the ray enters the node, or infinity if it
+// misses or enters past maxDistance.
+static FORCEINLINE float intersectNode(const float* mins, const float* maxs,
+		const float* start, const float* invDir, float maxDistance)
+{
+	float t1 = (mins[0] - start[0]) * invDir[0];
+	float t2 = (maxs[0] - start[0]) * invDir[0];
+	float tNear = Math::min(t1, t2);
+	float tFar = Math::max(t1, t2);
+	t1 = (mins[1] - start[1]) * invDir[1];
+	t2 = (maxs[1] - start[1]) * invDir[1];
+	tNear = Math::max(tNear, Math::min(t1, t2));
+	tFar = Math::min(tFar, Math::max(t1, t2));
+	t1 = (mins[2] - start[2]) * invDir[2];
+	t2 = (maxs[2] - start[2]) * invDir[2];
+	tNear = Math::max(tNear, Math::min(t1, t2));
+	tFar = Math::min(tFar, Math::max(t1, t2));
+	if(tFar >= tNear && tFar >= 0.0f && tNear < maxDistance) {
+		return tNear;
+	}
+	return BVH_INFINITY;
+}
+
+// Moller-Trumbore, double sided. Writes distance and returns true on a hit
+// closer than maxDistance.
+static FORCEINLINE bool intersectTriangle(const float* v0, const float* edge1,
+		const float* edge2, const float* start, const float* dir,
+		float maxDistance, float& distance)
+{
+	float p[3] = {
+		dir[1]*edge2[2] - dir[2]*edge2[1],
+		dir[2]*edge2[0] - dir[0]*edge2[2],
+		dir[0]*edge2[1] - dir[1]*edge2[0] };
+	float det = edge1[0]*p[0] + edge1[1]*p[1] + edge1[2]*p[2];
+	if(Math::abs(det) < 1.e-12f) {
+		return false;
+	}
+	float invDet = 1.0f/det;
+	float s[3] = { start[0] - v0[0], start[1] - v0[1], start[2] - v0[2] };
+	float u = (s[0]*p[0] + s[1]*p[1] + s[2]*p[2]) * invDet;
+	if(u < 0.0f || u > 1.0f) {
+		return false;
+	}
+	float q[3] = {
+		s[1]*edge1[2] - s[2]*edge1[1],
+		s[2]*edge1[0] - s[0]*edge1[2],
+		s[0]*edge1[1] - s[1]*edge1[0] };
+	float v = (dir[0]*q[0] + dir[1]*q[1] + dir[2]*q[2]) * invDet;
+	if(v < 0.0f || u + v > 1.0f) {
+		return false;
+	}
+	float t = (edge2[0]*q[0] + edge2[1]*q[1] + edge2[2]*q[2]) * invDet;
+	if(t < 0.0f || t >= maxDistance) {
+		return false;
+	}
+	distance = t;
+	return true;
+}
+
+bool BVH::closestHit(const Vector3f& startIn, const Vector3f& rayDir, float maxDistance,
+		uint32& triangleIndex, float& distance) const
+{
+	if(numTriangles == 0) {
+		return false;
+	}
+	float start[4], dir[4], invDir[4];
+	startIn.toVector().store4f(start);
+	rayDir.toVector().store4f(dir);
+	for(uint32 i = 0; i < 3; i++) {
+		invDir[i] = 1.0f/dir[i];
+	}
+
+	bool hit = false;
+	uint32 stack[BVH_MAX_DEPTH + 1];
+	uint32 stackSize = 0;
+	if(intersectNode(nodes[0].mins, nodes[0].maxs, start, invDir, maxDistance)
+			== BVH_INFINITY) {
+		return false;
+	}
+	uint32 nodeIndex = 0;
+	while(true) {
+		const Node& node = nodes[nodeIndex];
+		if(node.count > 0) {
+			for(uint32 i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+				const Triangle& triangle = triangles[i];
+				if(intersectTriangle(triangle.v0, triangle.edge1, triangle.edge2,
+							start, dir, maxDistance, maxDistance)) {
+					triangleIndex = triangle.index;
+					hit = true;
+				}
+			}
+		} else {
+			const Node& left = nodes[node.leftOrFirst];
+			const Node& right = nodes[node.leftOrFirst + 1];
+			float leftDist = intersectNode(left.mins, left.maxs, start, invDir, maxDistance);
+			float rightDist = intersectNode(right.mins, right.maxs, start, invDir, maxDistance);
+			uint32 near = node.leftOrFirst;
+			uint32 far = node.leftOrFirst + 1;
+			if(rightDist < leftDist) {
+				float temp = leftDist;
+				leftDist = rightDist;
+				rightDist = temp;
+				near = far;
+				far = node.leftOrFirst;
+			}
+			if(leftDist != BVH_INFINITY) {
+				if(rightDist != BVH_INFINITY) {
+					stack[stackSize++] = far;
+				}
+				nodeIndex = near;
+				continue;
+			}
+		}
+
+		// Pop the next node that is still closer than the best hit so far
+		bool found = false;
+		while(stackSize > 0 && !found) {
+			nodeIndex = stack[--stackSize];
+			found = intersectNode(nodes[nodeIndex].mins, nodes[nodeIndex].maxs,
+					start, invDir, maxDistance) != BVH_INFINITY;
+		}
+		if(!found) {
+			break;
+		}
+	}
+	distance = maxDistance;
+	return hit;
+}
+
+bool BVH::anyHit(const Vector3f& startIn, const Vector3f& rayDir, float maxDistance) const
+{
+	if(numTriangles == 0) {
+		return false;
+	}
+	float start[4], dir[4], invDir[4];
+	startIn.toVector().store4f(start);
+	rayDir.toVector().store4f(dir);
+	for(uint32 i = 0; i < 3; i++) {
+		invDir[i] = 1.0f/dir[i];
+	}
+
+	uint32 stack[BVH_MAX_DEPTH + 1];
+	uint32 stackSize = 0;
+	stack[stackSize++] = 0;
+	while(stackSize > 0) {
+		const Node& node = nodes[stack[--stackSize]];
+		if(intersectNode(node.mins, node.maxs, start, invDir, maxDistance)
+				== BVH_INFINITY) {
+			continue;
+		}
+		if(node.count == 0) {
+			stack[stackSize++] = node.leftOrFirst + 1;
+			stack[stackSize++] = node.leftOrFirst;
+			continue;
+		}
+		for(uint32 i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+			const Triangle& triangle = triangles[i];
+			float distance;
+			if(intersectTriangle(triangle.v0, triangle.edge1, triangle.edge2,
+						start, dir, maxDistance, distance)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+uint32 BVH::overlapAABB(const AABB& aabb, Array<uint32>& triangleIndices) const
+{
+	if(numTriangles == 0) {
+		return 0;
+	}
+	Vector queryMins = aabb.getMinExtents().toVector();
+	Vector queryMaxs = aabb.getMaxExtents().toVector();
+	uint32 numFound = 0;
+
+	uint32 stack[BVH_MAX_DEPTH + 1];
+	uint32 stackSize = 0;
+	stack[stackSize++] = 0;
+	while(stackSize > 0) {
+		const Node& node = nodes[stack[--stackSize]];
+		Vector nodeMins = Vector::load3f(node.mins, 0.0f);
+		Vector nodeMaxs = Vector::load3f(node.maxs, 0.0f);
+		if(!((nodeMins > queryMaxs) | (nodeMaxs < queryMins)).isZero3f()) {
+			continue;
+		}
+		if(node.count == 0) {
+			stack[stackSize++] = node.leftOrFirst + 1;
+			stack[stackSize++] = node.leftOrFirst;
+			continue;
+		}
+		for(uint32 i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+			const Triangle& triangle = triangles[i];
+			Vector v0 = Vector::load3f(triangle.v0, 0.0f);
+			Vector v1 = v0 + Vector::load3f(triangle.edge1, 0.0f);
+			Vector v2 = v0 + Vector::load3f(triangle.edge2, 0.0f);
+			Vector triangleMins = v0.min(v1).min(v2);
+			Vector triangleMaxs = v0.max(v1).max(v2);
+			if(((triangleMins > queryMaxs) | (triangleMaxs < queryMins)).isZero3f()) {
+				triangleIndices.push_back(triangle.index);
+				numFound++;
+			}
+		}
+	}
+	return numFound;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "aabb.hpp"
+#include "dataStructures/array.hpp"
+
+/**
+ * Static bounding volume hierarchy over a triangle mesh.
+ *
+ * Built top-down with a binned surface area heuristic. The upper levels of
+ * the tree are built in parallel, one subtree per thread. Nodes are 32 bytes
+ * and siblings are allocated together, so both children of a node share a
+ * single 64-byte cache line.
+ */
+class BVH
+{
+public:
+	BVH();
+	~BVH();
+
+	/**
+	 * Builds the hierarchy. positions holds 3 floats per vertex and indices
+	 * holds 3 vertex indices per triangle. If numThreads is 0, the number of
+	 * hardware threads is used.
+	 */
+	void build(const float* positions, const uint32* indices,
+			uint32 numTriangles, uint32 numThreads=0);
+
+	/**
+	 * Finds the closest triangle hit by the ray within maxDistance. rayDir
+	 * does not need to be normalized; distance is in units of rayDir.
+	 */
+	bool closestHit(const Vector3f& start, const Vector3f& rayDir, float maxDistance,
+			uint32& triangleIndex, float& distance) const;
+
+	/** Returns true as soon as any triangle is hit within maxDistance. */
+	bool anyHit(const Vector3f& start, const Vector3f& rayDir, float maxDistance) const;
+
+	/**
+	 * Appends the index of every triangle whose bounding box overlaps aabb.
+	 * Returns the number of indices added.
+	 */
+	uint32 overlapAABB(const AABB& aabb, Array<uint32>& triangleIndices) const;
+
+	FORCEINLINE uint32 getNumNodes() const { return numNodes; }
+	FORCEINLINE uint32 getNumTriangles() const { return numTriangles; }
+	AABB getBounds() const;
+private:
+	// Leaves have count > 0 and store their triangles at
+	// [leftOrFirst, leftOrFirst+count). Interior nodes have count == 0 and
+	// their children at leftOrFirst and leftOrFirst+1.
+	struct Node
+	{
+		float mins[3];
+		uint32 leftOrFirst;
+		float maxs[3];
+		uint32 count;
+	};
+
+	// Stored with the first vertex and two edges, ready for the ray test
+	struct Triangle
+	{
+		float v0[3];
+		float edge1[3];
+		float edge2[3];
+		uint32 index;
+	};
+
+	struct BuildContext;
+
+	Node* nodes;
+	Triangle* triangles;
+	uint32 numNodes;
+	uint32 numTriangles;
+
+	void buildNode(BuildContext& context, uint32 nodeIndex, uint32 first,
+			uint32 count, uint32 depth);
+	void release();
+
+	NULL_COPY_AND_ASSIGN(BVH)
+};
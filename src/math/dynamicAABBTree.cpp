@@ -0,0 +1,316 @@
+#include "dynamicAABBTree.hpp"
+
+// Half the surface area, which is all the insertion cost needs
+static FORCEINLINE float getHalfArea(const AABB& aabb)
+{
+	float size[4];
+	(aabb.getMaxExtents() - aabb.getMinExtents()).toVector().store4f(size);
+	return size[0]*size[1] + size[1]*size[2] + size[2]*size[0];
+}
+
+DynamicAABBTree::DynamicAABBTree(float fatMarginIn, float displacementMultiplierIn) :
+	root(NULL_NODE),
+	freeList(NULL_NODE),
+	numProxies(0),
+	fatMargin(fatMarginIn),
+	displacementMultiplier(displacementMultiplierIn) {}
+
+uint32 DynamicAABBTree::allocateNode()
+{
+	if(freeList == NULL_NODE) {
+		uint32 oldSize = (uint32)nodes.size();
+		uint32 newSize = Math::max(oldSize * 2, 16u);
+		nodes.resize(newSize);
+		for(uint32 i = oldSize; i < newSize; i++) {
+			nodes[i].parent = i + 1 < newSize ? i + 1 : NULL_NODE;
+			nodes[i].height = -1;
+		}
+		freeList = oldSize;
+	}
+	uint32 node = freeList;
+	freeList = nodes[node].parent;
+	nodes[node].parent = NULL_NODE;
+	nodes[node].children[0] = NULL_NODE;
+	nodes[node].children[1] = NULL_NODE;
+	nodes[node].height = 0;
+	return node;
+}
+
+void DynamicAABBTree::freeNode(uint32 node)
+{
+	nodes[node].parent = freeList;
+	nodes[node].height = -1;
+	freeList = node;
+}
+
+AABB DynamicAABBTree::fatten(const AABB& aabb, const Vector3f& displacement) const
+{
+	Vector3f stretch = displacement * displacementMultiplier;
+	Vector3f zero(0.0f);
+	return AABB(aabb.getMinExtents() - fatMargin + stretch.min(zero),
+			aabb.getMaxExtents() + fatMargin + stretch.max(zero));
+}
+
+uint32 DynamicAABBTree::createProxy(const AABB& aabb, uint32 userData)
+{
+	uint32 proxy = allocateNode();
+	nodes[proxy].aabb = fatten(aabb, Vector3f(0.0f));
+	nodes[proxy].userData = userData;
+	insertLeaf(proxy);
+	numProxies++;
+	return proxy;
+}
+
+void DynamicAABBTree::destroyProxy(uint32 proxy)
+{
+	assertCheck(proxy < nodes.size() && isLeaf(proxy));
+	removeLeaf(proxy);
+	freeNode(proxy);
+	numProxies--;
+}
+
+bool DynamicAABBTree::moveProxy(uint32 proxy, const AABB& aabb,
+		const Vector3f& displacement)
+{
+	assertCheck(proxy < nodes.size() && isLeaf(proxy));
+	if(nodes[proxy].aabb.contains(aabb)) {
+		return false;
+	}
+	removeLeaf(proxy);
+	nodes[proxy].aabb = fatten(aabb, displacement);
+	insertLeaf(proxy);
+	return true;
+}
+
+void DynamicAABBTree::insertLeaf(uint32 leaf)
+{
+	if(root == NULL_NODE) {
+		root = leaf;
+		nodes[leaf].parent = NULL_NODE;
+		return;
+	}
+
+	// Walk down towards the sibling that adds the least surface area. Each
+	// step compares making a new parent here against descending further,
+	// where every ancestor on the way grows by the inherited cost.
+	AABB leafAABB = nodes[leaf].aabb;
+	uint32 index = root;
+	while(!isLeaf(index)) {
+		const Node& node = nodes[index];
+		float area = getHalfArea(node.aabb);
+		float combinedArea = getHalfArea(node.aabb.addAABB(leafAABB));
+		float cost = 2.0f * combinedArea;
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCosts[2];
+		for(uint32 i = 0; i < 2; i++) {
+			const Node& child = nodes[node.children[i]];
+			float newArea = getHalfArea(child.aabb.addAABB(leafAABB));
+			childCosts[i] = isLeaf(node.children[i]) ? newArea + inheritanceCost
+				: newArea - getHalfArea(child.aabb) + inheritanceCost;
+		}
+
+		if(cost < childCosts[0] && cost < childCosts[1]) {
+			break;
+		}
+		index = childCosts[0] < childCosts[1] ? node.children[0] : node.children[1];
+	}
+
+	uint32 sibling = index;
+	uint32 oldParent = nodes[sibling].parent;
+	uint32 newParent = allocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].aabb = leafAABB.addAABB(nodes[sibling].aabb);
+	nodes[newParent].height = nodes[sibling].height + 1;
+	nodes[newParent].children[0] = sibling;
+	nodes[newParent].children[1] = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+	if(oldParent == NULL_NODE) {
+		root = newParent;
+	} else if(nodes[oldParent].children[0] == sibling) {
+		nodes[oldParent].children[0] = newParent;
+	} else {
+		nodes[oldParent].children[1] = newParent;
+	}
+
+	refitAncestors(newParent);
+}
+
+void DynamicAABBTree::removeLeaf(uint32 leaf)
+{
+	if(leaf == root) {
+		root = NULL_NODE;
+		return;
+	}
+
+	uint32 parent = nodes[leaf].parent;
+	uint32 grandParent = nodes[parent].parent;
+	uint32 sibling = nodes[parent].children[0] == leaf ?
+		nodes[parent].children[1] : nodes[parent].children[0];
+	freeNode(parent);
+	nodes[sibling].parent = grandParent;
+	if(grandParent == NULL_NODE) {
+		root = sibling;
+		return;
+	}
+	if(nodes[grandParent].children[0] == parent) {
+		nodes[grandParent].children[0] = sibling;
+	} else {
+		nodes[grandParent].children[1] = sibling;
+	}
+	refitAncestors(grandParent);
+}
+
+void DynamicAABBTree::refitAncestors(uint32 node)
+{
+	while(node != NULL_NODE) {
+		node = balance(node);
+		Node& current = nodes[node];
+		const Node& child0 = nodes[current.children[0]];
+		const Node& child1 = nodes[current.children[1]];
+		current.height = 1 + Math::max(child0.height, child1.height);
+		current.aabb = child0.aabb.addAABB(child1.aabb);
+		node = current.parent;
+	}
+}
+
+// If one child of a is more than one level taller than the other, rotates
+// that child up to take a's place and moves one of its own children down
+// under a, whichever keeps the tree shallower. Returns the node now at a's
+// position.
+uint32 DynamicAABBTree::balance(uint32 a)
+{
+	Node& nodeA = nodes[a];
+	if(nodeA.height < 2) {
+		return a;
+	}
+
+	int32 heightDifference = nodes[nodeA.children[1]].height
+		- nodes[nodeA.children[0]].height;
+	if(heightDifference >= -1 && heightDifference <= 1) {
+		return a;
+	}
+
+	// b is the taller child being rotated up, c stays below a
+	uint32 bSide = heightDifference > 0 ? 1 : 0;
+	uint32 b = nodeA.children[bSide];
+	uint32 c = nodeA.children[1 - bSide];
+	Node& nodeB = nodes[b];
+	uint32 d = nodeB.children[0];
+	uint32 e = nodeB.children[1];
+	Node& nodeD = nodes[d];
+	Node& nodeE = nodes[e];
+
+	nodeB.children[0] = a;
+	nodeB.parent = nodeA.parent;
+	nodeA.parent = b;
+	if(nodeB.parent == NULL_NODE) {
+		root = b;
+	} else if(nodes[nodeB.parent].children[0] == a) {
+		nodes[nodeB.parent].children[0] = b;
+	} else {
+		nodes[nodeB.parent].children[1] = b;
+	}
+
+	// Keep the taller of b's children under b; the other replaces b under a
+	uint32 keep = d;
+	uint32 move = e;
+	if(nodeD.height <= nodeE.height) {
+		keep = e;
+		move = d;
+	}
+	nodeB.children[1] = keep;
+	nodeA.children[bSide] = move;
+	nodes[move].parent = a;
+
+	const Node& nodeC = nodes[c];
+	nodeA.aabb = nodeC.aabb.addAABB(nodes[move].aabb);
+	nodeA.height = 1 + Math::max(nodeC.height, nodes[move].height);
+	nodeB.aabb = nodeA.aabb.addAABB(nodes[keep].aabb);
+	nodeB.height = 1 + Math::max(nodeA.height, nodes[keep].height);
+	return b;
+}
+
+void DynamicAABBTree::queryOverlaps(const AABB& aabb, Array<uint32>& proxies) const
+{
+	if(root == NULL_NODE) {
+		return;
+	}
+	uint32 stack[128];
+	uint32 stackSize = 0;
+	stack[stackSize++] = root;
+	while(stackSize > 0) {
+		uint32 index = stack[--stackSize];
+		const Node& node = nodes[index];
+		if(!node.aabb.intersects(aabb)) {
+			continue;
+		}
+		if(node.height == 0) {
+			proxies.push_back(index);
+		} else {
+			assertCheck(stackSize + 2 <= ARRAY_SIZE_IN_ELEMENTS(stack));
+			stack[stackSize++] = node.children[0];
+			stack[stackSize++] = node.children[1];
+		}
+	}
+}
+
+// Descends the tree against itself. A stack entry (a, a) finds the pairs
+// within subtree a; (a, b) finds the pairs between two disjoint subtrees, and
+// is only pushed if their bounds overlap.
+void DynamicAABBTree::queryPairs(Array<Pair>& pairs) const
+{
+	if(root == NULL_NODE) {
+		return;
+	}
+	Array<Pair> stack;
+	Pair rootPair = { root, root };
+	stack.push_back(rootPair);
+	while(!stack.empty()) {
+		Pair current = stack.back();
+		stack.pop_back();
+		const Node& nodeA = nodes[current.proxyA];
+		const Node& nodeB = nodes[current.proxyB];
+
+		if(current.proxyA == current.proxyB) {
+			if(nodeA.height == 0) {
+				continue;
+			}
+			uint32 child0 = nodeA.children[0];
+			uint32 child1 = nodeA.children[1];
+			Pair next = { child0, child0 };
+			stack.push_back(next);
+			next.proxyA = next.proxyB = child1;
+			stack.push_back(next);
+			if(nodes[child0].aabb.intersects(nodes[child1].aabb)) {
+				next.proxyA = child0;
+				stack.push_back(next);
+			}
+			continue;
+		}
+
+		if(nodeA.height == 0 && nodeB.height == 0) {
+			Pair pair = { Math::min(current.proxyA, current.proxyB),
+				Math::max(current.proxyA, current.proxyB) };
+			pairs.push_back(pair);
+			continue;
+		}
+
+		// Split the taller subtree so both sides shrink at a similar rate
+		uint32 split = current.proxyA;
+		uint32 other = current.proxyB;
+		if(nodeA.height < nodeB.height) {
+			split = current.proxyB;
+			other = current.proxyA;
+		}
+		const AABB& otherAABB = nodes[other].aabb;
+		for(uint32 i = 0; i < 2; i++) {
+			uint32 child = nodes[split].children[i];
+			if(nodes[child].aabb.intersects(otherAABB)) {
+				Pair next = { child, other };
+				stack.push_back(next);
+			}
+		}
+	}
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "aabb.hpp"
+#include "dataStructures/array.hpp"
+
+/**
+ * Bounding volume hierarchy for objects that move every frame.
+ *
+ * Each object is a proxy whose leaf stores a "fat" AABB: the object's
+ * bounds grown by a margin and stretched along its last displacement.
+ * Moving an object only touches the tree once it leaves its fat box, and
+ * then as a remove and reinsert, each O(log n). The tree is kept balanced by
+ * rotating nodes on the way back up after every insert and remove.
+ *
+ * Nodes live in a single array with a free list, so proxies are stable
+ * indices into it.
+ */
+class DynamicAABBTree
+{
+public:
+	static const uint32 NULL_NODE = 0xFFFFFFFF;
+
+	struct Pair
+	{
+		uint32 proxyA;
+		uint32 proxyB;
+	};
+
+	DynamicAABBTree(float fatMargin=0.1f, float displacementMultiplier=2.0f);
+
+	uint32 createProxy(const AABB& aabb, uint32 userData);
+	void destroyProxy(uint32 proxy);
+
+	/**
+	 * Updates a proxy to new bounds that moved by displacement since the
+	 * last update. Returns true if the proxy had to be reinserted, false if
+	 * it was still inside its fat AABB.
+	 */
+	bool moveProxy(uint32 proxy, const AABB& aabb, const Vector3f& displacement);
+
+	/** Appends every proxy whose fat AABB overlaps aabb. */
+	void queryOverlaps(const AABB& aabb, Array<uint32>& proxies) const;
+
+	/**
+	 * Appends every pair of proxies whose fat AABBs overlap. Each pair is
+	 * reported once, with proxyA < proxyB.
+	 */
+	void queryPairs(Array<Pair>& pairs) const;
+
+	FORCEINLINE const AABB& getFatAABB(uint32 proxy) const
+	{
+		assertCheck(proxy < nodes.size() && isLeaf(proxy));
+		return nodes[proxy].aabb;
+	}
+
+	FORCEINLINE uint32 getUserData(uint32 proxy) const
+	{
+		assertCheck(proxy < nodes.size() && isLeaf(proxy));
+		return nodes[proxy].userData;
+	}
+
+	FORCEINLINE uint32 getNumProxies() const { return numProxies; }
+	FORCEINLINE uint32 getHeight() const
+	{
+		return root == NULL_NODE ? 0 : (uint32)nodes[root].height;
+	}
+private:
+	// Free nodes have height -1 and use parent as the free list link
+	struct Node
+	{
+		AABB aabb;
+		uint32 parent;
+		uint32 children[2];
+		uint32 userData;
+		int32 height;
+	};
+
+	Array<Node> nodes;
+	uint32 root;
+	uint32 freeList;
+	uint32 numProxies;
+	float fatMargin;
+	float displacementMultiplier;
+
+	FORCEINLINE bool isLeaf(uint32 node) const
+	{
+		return nodes[node].height == 0;
+	}
+
+	uint32 allocateNode();
+	void freeNode(uint32 node);
+	void insertLeaf(uint32 leaf);
+	void removeLeaf(uint32 leaf);
+	void refitAncestors(uint32 node);
+	uint32 balance(uint32 node);
+	AABB fatten(const AABB& aabb, const Vector3f& displacement) const;
+
+	NULL_COPY_AND_ASSIGN(DynamicAABBTree)
+};
@@ -3,3 +3,23 @@
 #include "platform/platformMath.hpp"
 typedef PlatformMath Math;
 
+
+/**
+ * Accuracy for reciprocal and rsqrt, and the operations built on them, in
+ * the vector types. The plain versions of those functions are EXACT; the
+ * templated ones, such as normalize3<Precision::REFINED>(), let hot loops
+ * trade accuracy for avoiding a divide.
+ */
+struct Precision
+{
+	enum Level
+	{
+		// Hardware estimate only, about 12 bits. 0 gives inf.
+		ESTIMATE,
+		// Estimate plus one Newton-Raphson step, about 22 bits. 0 and inf
+		// give NaN.
+		REFINED,
+		// Full divide and square root
+		EXACT
+	};
+};
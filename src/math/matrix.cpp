@@ -1,4 +1,7 @@
 #include "matrix.hpp"
+#include "affineMatrix.hpp"
+#include "transform.hpp"
+#include "simdKernels.hpp"
 
 Quaternion Matrix::getRotation() const
 {
@@ -57,6 +60,29 @@ void Matrix::extractFrustumPlanes(Plane* planes) const
 
 Matrix Matrix::toNormalMatrix() const
 {
-	// TODO: There *should* be a faster and easier way to do this!
+	if(isAffine()) {
+		return AffineMatrix(*this).toNormalMatrix();
+	}
 	return inverse().transpose();
 }
+
+void Matrix::transformMatrixBatch(const Transform* transforms, Matrix* result,
+		uint32 count)
+{
+	SIMDKernels::get().transformMatrixBatch(transforms, result, count);
+}
+
+void Matrix::mulBatch(const Matrix& pre, const Matrix* mats, const Matrix& post,
+		Matrix* result, uint32 count)
+{
+	SIMDKernels::get().mulMatrixBatch(pre, mats, post, result, count);
+}
+
+void Matrix::toNormalMatrixBatch(const Matrix* mats, Matrix* result, uint32 count)
+{
+	// One matrix at a time beats MatrixArray4::toNormalMatrixAffineBatch here:
+	// the cross products need fewer operations than the SoA cofactors save.
+	for(uint32 i = 0; i < count; i++) {
+		result[i] = AffineMatrix(mats[i]).toNormalMatrix();
+	}
+}
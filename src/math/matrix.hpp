@@ -5,6 +5,8 @@
 #include "quaternion.hpp"
 #include "plane.hpp"
 
+class Transform;
+
 class Matrix
 {
 public:
@@ -23,6 +25,14 @@ public:
 	static FORCEINLINE Matrix transformMatrix(const Vector3f& translation,
 			const Quaternion& rotation, const Vector3f& scale);
 
+	static void transformMatrixBatch(const Transform* transforms, Matrix* result,
+			uint32 count);
+	static void mulBatch(const Matrix& pre, const Matrix* mats, const Matrix& post,
+			Matrix* result, uint32 count);
+	// toNormalMatrix for count affine matrices, such as those written by
+	// transformMatrixBatch, to fill a normal matrix stream alongside them.
+	static void toNormalMatrixBatch(const Matrix* mats, Matrix* result, uint32 count);
+
 	void extractFrustumPlanes(Plane* planes) const;
 	Matrix toNormalMatrix() const;
 	
@@ -42,6 +52,7 @@ public:
 	FORCEINLINE float determinant4x4() const;
 	FORCEINLINE float determinant3x3() const;
 	FORCEINLINE Matrix inverse() const;
+	FORCEINLINE bool isAffine() const;
 
 	FORCEINLINE Matrix applyScale(const Vector& scale);
 	FORCEINLINE Vector removeScale(float errorMargin=1.e-8f);
@@ -255,6 +266,11 @@ FORCEINLINE Matrix Matrix::inverse() const
 	return result;
 }
 
+FORCEINLINE bool Matrix::isAffine() const
+{
+	return (m[3] != Vector::make(0.0f, 0.0f, 0.0f, 1.0f)).isZero4f();
+}
+
 
 FORCEINLINE Vector Matrix::getScale() const
 {
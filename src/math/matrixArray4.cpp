@@ -0,0 +1,55 @@
+#include "matrixArray4.hpp"
+
+// Loads count matrices, up to 4, padding with identity so partial groups
+// never divide by a zero determinant.
+static FORCEINLINE MatrixArray4 loadPartial(const Matrix* mats, uint32 count)
+{
+	if(count == 4) {
+		return MatrixArray4::load(mats);
+	}
+	Matrix padded[4] = { Matrix::identity(), Matrix::identity(),
+		Matrix::identity(), Matrix::identity() };
+	for(uint32 i = 0; i < count; i++) {
+		padded[i] = mats[i];
+	}
+	return MatrixArray4::load(padded);
+}
+
+static FORCEINLINE void storePartial(const MatrixArray4& mats, Matrix* result,
+		uint32 count)
+{
+	if(count == 4) {
+		mats.store(result);
+		return;
+	}
+	Matrix padded[4];
+	mats.store(padded);
+	for(uint32 i = 0; i < count; i++) {
+		result[i] = padded[i];
+	}
+}
+
+void MatrixArray4::inverseBatch(const Matrix* mats, Matrix* result, uint32 count)
+{
+	for(uint32 i = 0; i < count; i += 4) {
+		uint32 amt = Math::min(count - i, 4u);
+		storePartial(loadPartial(mats + i, amt).inverse(), result + i, amt);
+	}
+}
+
+void MatrixArray4::inverseAffineBatch(const Matrix* mats, Matrix* result, uint32 count)
+{
+	for(uint32 i = 0; i < count; i += 4) {
+		uint32 amt = Math::min(count - i, 4u);
+		storePartial(loadPartial(mats + i, amt).inverseAffine(), result + i, amt);
+	}
+}
+
+void MatrixArray4::toNormalMatrixAffineBatch(const Matrix* mats, Matrix* result,
+		uint32 count)
+{
+	for(uint32 i = 0; i < count; i += 4) {
+		uint32 amt = Math::min(count - i, 4u);
+		storePartial(loadPartial(mats + i, amt).toNormalMatrixAffine(), result + i, amt);
+	}
+}
@@ -0,0 +1,259 @@
+#pragma once
+
+#include "matrix.hpp"
+
+/**
+ * Four matrices stored transposed across SIMD lanes (structure of arrays):
+ * m[i][j] holds element (i,j) of all four matrices, one per lane.
+ *
+ * Each operation works on whole registers with plain multiplies and adds,
+ * with no broadcasts or shuffles, and does the work of four calls to the
+ * matching Matrix function. Converting to and from Matrix costs a 4x4
+ * transpose per row, which is as much as a multiply saves, so products are
+ * only worth doing here when the inputs and result stay in this layout.
+ */
+class MatrixArray4
+{
+public:
+	FORCEINLINE MatrixArray4();
+
+	static FORCEINLINE MatrixArray4 load(const Matrix* mats);
+	FORCEINLINE void store(Matrix* mats) const;
+
+	FORCEINLINE MatrixArray4 operator* (const MatrixArray4& other) const;
+
+	/**
+	 * Returns component row of each matrix times its own vector, where x, y,
+	 * z and w hold the components of the four vectors.
+	 */
+	FORCEINLINE Vector transform(const Vector& x, const Vector& y,
+			const Vector& z, const Vector& w, uint32 row) const;
+
+	FORCEINLINE MatrixArray4 transpose() const;
+	FORCEINLINE Vector determinant4x4() const;
+	FORCEINLINE Vector determinant3x3() const;
+	FORCEINLINE MatrixArray4 inverse() const;
+
+	/**
+	 * Inverse of matrices whose bottom row is (0, 0, 0, 1), such as those
+	 * from Matrix::transformMatrix. Only the 3x3 part is inverted, which is
+	 * roughly half the work of inverse(). The bottom row is not read.
+	 */
+	FORCEINLINE MatrixArray4 inverseAffine() const;
+
+	/**
+	 * Matrix::toNormalMatrix for affine matrices, as described in
+	 * inverseAffine(): the transpose of the inverse.
+	 */
+	FORCEINLINE MatrixArray4 toNormalMatrixAffine() const;
+
+	// Each runs count matrices through the operation above, 4 at a time.
+	// result may be the same array as the input, but must not partially
+	// overlap it.
+	static void inverseBatch(const Matrix* mats, Matrix* result, uint32 count);
+	static void inverseAffineBatch(const Matrix* mats, Matrix* result, uint32 count);
+	static void toNormalMatrixAffineBatch(const Matrix* mats, Matrix* result,
+			uint32 count);
+
+	FORCEINLINE Vector get(uint32 row, uint32 col) const
+	{
+		assertCheck(row < 4 && col < 4);
+		return m[row][col];
+	}
+
+	FORCEINLINE void set(uint32 row, uint32 col, const Vector& lanes)
+	{
+		assertCheck(row < 4 && col < 4);
+		m[row][col] = lanes;
+	}
+private:
+	Vector m[4][4];
+
+	FORCEINLINE void setAffineBottomRow();
+};
+
+FORCEINLINE MatrixArray4::MatrixArray4() {}
+
+FORCEINLINE MatrixArray4 MatrixArray4::load(const Matrix* mats)
+{
+	MatrixArray4 result;
+	for(uint32 i = 0; i < 4; i++) {
+		Vector row0 = mats[0][i];
+		Vector row1 = mats[1][i];
+		Vector row2 = mats[2][i];
+		Vector row3 = mats[3][i];
+		Vector::transpose4(row0, row1, row2, row3);
+		result.m[i][0] = row0;
+		result.m[i][1] = row1;
+		result.m[i][2] = row2;
+		result.m[i][3] = row3;
+	}
+	return result;
+}
+
+FORCEINLINE void MatrixArray4::store(Matrix* mats) const
+{
+	Vector rows[4][4];
+	for(uint32 i = 0; i < 4; i++) {
+		Vector col0 = m[i][0];
+		Vector col1 = m[i][1];
+		Vector col2 = m[i][2];
+		Vector col3 = m[i][3];
+		Vector::transpose4(col0, col1, col2, col3);
+		rows[0][i] = col0;
+		rows[1][i] = col1;
+		rows[2][i] = col2;
+		rows[3][i] = col3;
+	}
+	for(uint32 i = 0; i < 4; i++) {
+		mats[i] = Matrix(rows[i][0], rows[i][1], rows[i][2], rows[i][3]);
+	}
+}
+
+FORCEINLINE MatrixArray4 MatrixArray4::operator* (const MatrixArray4& other) const
+{
+	MatrixArray4 result;
+	for(uint32 i = 0; i < 4; i++) {
+		for(uint32 j = 0; j < 4; j++) {
+			Vector temp = m[i][0] * other.m[0][j];
+			temp = m[i][1].mad(other.m[1][j], temp);
+			temp = m[i][2].mad(other.m[2][j], temp);
+			result.m[i][j] = m[i][3].mad(other.m[3][j], temp);
+		}
+	}
+	return result;
+}
+
+FORCEINLINE Vector MatrixArray4::transform(const Vector& x, const Vector& y,
+		const Vector& z, const Vector& w, uint32 row) const
+{
+	assertCheck(row < 4);
+	Vector result = m[row][0] * x;
+	result = m[row][1].mad(y, result);
+	result = m[row][2].mad(z, result);
+	return m[row][3].mad(w, result);
+}
+
+FORCEINLINE MatrixArray4 MatrixArray4::transpose() const
+{
+	MatrixArray4 result;
+	for(uint32 i = 0; i < 4; i++) {
+		for(uint32 j = 0; j < 4; j++) {
+			result.m[i][j] = m[j][i];
+		}
+	}
+	return result;
+}
+
+FORCEINLINE Vector MatrixArray4::determinant4x4() const
+{
+	Vector s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+	Vector s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+	Vector s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+	Vector s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+	Vector s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+	Vector s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+	Vector c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+	Vector c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+	Vector c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+	Vector c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+	Vector c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+	Vector c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+
+	return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+}
+
+FORCEINLINE Vector MatrixArray4::determinant3x3() const
+{
+	return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+		- m[1][0] * (m[0][1] * m[2][2] - m[0][2] * m[2][1])
+		+ m[2][0] * (m[0][1] * m[1][2] - m[0][2] * m[1][1]);
+}
+
+FORCEINLINE MatrixArray4 MatrixArray4::inverse() const
+{
+	// Cofactor expansion using the 2x2 determinants of the top two rows (s)
+	// and the bottom two rows (c), shared between all 16 cofactors.
+	Vector s0 = m[0][0] * m[1][1] - m[1][0] * m[0][1];
+	Vector s1 = m[0][0] * m[1][2] - m[1][0] * m[0][2];
+	Vector s2 = m[0][0] * m[1][3] - m[1][0] * m[0][3];
+	Vector s3 = m[0][1] * m[1][2] - m[1][1] * m[0][2];
+	Vector s4 = m[0][1] * m[1][3] - m[1][1] * m[0][3];
+	Vector s5 = m[0][2] * m[1][3] - m[1][2] * m[0][3];
+
+	Vector c0 = m[2][0] * m[3][1] - m[3][0] * m[2][1];
+	Vector c1 = m[2][0] * m[3][2] - m[3][0] * m[2][2];
+	Vector c2 = m[2][0] * m[3][3] - m[3][0] * m[2][3];
+	Vector c3 = m[2][1] * m[3][2] - m[3][1] * m[2][2];
+	Vector c4 = m[2][1] * m[3][3] - m[3][1] * m[2][3];
+	Vector c5 = m[2][2] * m[3][3] - m[3][2] * m[2][3];
+
+	Vector rdet = (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0)
+		.reciprocal();
+
+	MatrixArray4 result;
+	result.m[0][0] = (m[1][1] * c5 - m[1][2] * c4 + m[1][3] * c3) * rdet;
+	result.m[0][1] = (m[0][2] * c4 - m[0][1] * c5 - m[0][3] * c3) * rdet;
+	result.m[0][2] = (m[3][1] * s5 - m[3][2] * s4 + m[3][3] * s3) * rdet;
+	result.m[0][3] = (m[2][2] * s4 - m[2][1] * s5 - m[2][3] * s3) * rdet;
+
+	result.m[1][0] = (m[1][2] * c2 - m[1][0] * c5 - m[1][3] * c1) * rdet;
+	result.m[1][1] = (m[0][0] * c5 - m[0][2] * c2 + m[0][3] * c1) * rdet;
+	result.m[1][2] = (m[3][2] * s2 - m[3][0] * s5 - m[3][3] * s1) * rdet;
+	result.m[1][3] = (m[2][0] * s5 - m[2][2] * s2 + m[2][3] * s1) * rdet;
+
+	result.m[2][0] = (m[1][0] * c4 - m[1][1] * c2 + m[1][3] * c0) * rdet;
+	result.m[2][1] = (m[0][1] * c2 - m[0][0] * c4 - m[0][3] * c0) * rdet;
+	result.m[2][2] = (m[3][0] * s4 - m[3][1] * s2 + m[3][3] * s0) * rdet;
+	result.m[2][3] = (m[2][1] * s2 - m[2][0] * s4 - m[2][3] * s0) * rdet;
+
+	result.m[3][0] = (m[1][1] * c1 - m[1][0] * c3 - m[1][2] * c0) * rdet;
+	result.m[3][1] = (m[0][0] * c3 - m[0][1] * c1 + m[0][2] * c0) * rdet;
+	result.m[3][2] = (m[3][1] * s1 - m[3][0] * s3 - m[3][2] * s0) * rdet;
+	result.m[3][3] = (m[2][0] * s3 - m[2][1] * s1 + m[2][2] * s0) * rdet;
+	return result;
+}
+
+FORCEINLINE void MatrixArray4::setAffineBottomRow()
+{
+	m[3][0] = VectorConstants::ZERO;
+	m[3][1] = VectorConstants::ZERO;
+	m[3][2] = VectorConstants::ZERO;
+	m[3][3] = VectorConstants::ONE;
+}
+
+FORCEINLINE MatrixArray4 MatrixArray4::inverseAffine() const
+{
+	// Adjugate of the 3x3 part over its determinant, then the translation is
+	// moved back through it: inverse([A t]) = [A^-1 -A^-1*t].
+	Vector i00 = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+	Vector i10 = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+	Vector i20 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+	Vector rdet = (m[0][0] * i00 + m[0][1] * i10 + m[0][2] * i20).reciprocal();
+
+	MatrixArray4 result;
+	result.m[0][0] = i00 * rdet;
+	result.m[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * rdet;
+	result.m[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * rdet;
+	result.m[1][0] = i10 * rdet;
+	result.m[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * rdet;
+	result.m[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * rdet;
+	result.m[2][0] = i20 * rdet;
+	result.m[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * rdet;
+	result.m[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * rdet;
+
+	for(uint32 i = 0; i < 3; i++) {
+		Vector translation = result.m[i][0] * m[0][3];
+		translation = result.m[i][1].mad(m[1][3], translation);
+		translation = result.m[i][2].mad(m[2][3], translation);
+		result.m[i][3] = -translation;
+	}
+	result.setAffineBottomRow();
+	return result;
+}
+
+FORCEINLINE MatrixArray4 MatrixArray4::toNormalMatrixAffine() const
+{
+	return inverseAffine().transpose();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "transform.hpp"
+
+/**
+ * Transform packed into 10 floats (40 bytes instead of 48), for long-lived
+ * arrays that are iterated in bulk. Like Float3, it is only for storage:
+ * load it into a Transform to do math, and store the result back.
+ */
+struct PackedTransform
+{
+	Float3 translation;
+	float rotation[4];
+	Float3 scale;
+
+	FORCEINLINE PackedTransform() {}
+	FORCEINLINE PackedTransform(const Transform& transform)
+	{
+		store(transform);
+	}
+
+	FORCEINLINE Transform load() const
+	{
+		return Transform(translation.load(), Quaternion(Vector::load4f(rotation)),
+				scale.load());
+	}
+
+	FORCEINLINE void store(const Transform& transform)
+	{
+		translation.store(transform.getTranslation());
+		transform.getRotation().toVector().store4f(rotation);
+		scale.store(transform.getScale());
+	}
+};
+
+static_assert(sizeof(PackedTransform) == sizeof(float)*10, "PackedTransform must be 10 floats");
@@ -0,0 +1,80 @@
+#include "rayPacket.hpp"
+
+RayPacket::RayPacket(const Vector3f* starts, const Vector3f* rayDirs,
+		const float* maxDistancesIn, uint32 numRaysIn) :
+	numRays(Math::min(numRaysIn, (uint32)RAY_PACKET_SIZE))
+{
+	enum
+	{
+		START_X = 0,
+		START_Y,
+		START_Z,
+		INV_DIR_X,
+		INV_DIR_Y,
+		INV_DIR_Z,
+		MAX_DISTANCE,
+		NUM_LANES
+	};
+	RayPacketVector lanes[NUM_LANES];
+	float* laneData = (float*)lanes;
+	for(uint32 i = 0; i < RAY_PACKET_SIZE; i++) {
+		bool isActive = i < numRays;
+		Vector3f start = isActive ? starts[i] : Vector3f(0.0f, 0.0f, 0.0f);
+		Vector3f rayDir = isActive ? rayDirs[i] : Vector3f(1.0f, 1.0f, 1.0f);
+		laneData[START_X * RAY_PACKET_SIZE + i] = start[0];
+		laneData[START_Y * RAY_PACKET_SIZE + i] = start[1];
+		laneData[START_Z * RAY_PACKET_SIZE + i] = start[2];
+		laneData[INV_DIR_X * RAY_PACKET_SIZE + i] = 1.0f/rayDir[0];
+		laneData[INV_DIR_Y * RAY_PACKET_SIZE + i] = 1.0f/rayDir[1];
+		laneData[INV_DIR_Z * RAY_PACKET_SIZE + i] = 1.0f/rayDir[2];
+		// Inactive lanes can never pass the tNear <= maxDistance test
+		laneData[MAX_DISTANCE * RAY_PACKET_SIZE + i] =
+			isActive ? maxDistancesIn[i] : -1.0f;
+	}
+	startX = lanes[START_X];
+	startY = lanes[START_Y];
+	startZ = lanes[START_Z];
+	invDirX = lanes[INV_DIR_X];
+	invDirY = lanes[INV_DIR_Y];
+	invDirZ = lanes[INV_DIR_Z];
+	maxDistances = lanes[MAX_DISTANCE];
+}
+
+void RayPacket::nearestHits(const Vector3f* starts, const Vector3f* rayDirs,
+		const float* maxDistances, uint32 numRays,
+		const AABB* aabbs, uint32 numAABBs,
+		uint32* hitIndices, float* hitDistances)
+{
+	for(uint32 i = 0; i < numRays; i += RAY_PACKET_SIZE) {
+		RayPacket packet(starts + i, rayDirs + i, maxDistances + i, numRays - i);
+		uint32 numLanes = packet.getNumRays();
+		uint32 packetHitIndices[RAY_PACKET_SIZE];
+		for(uint32 j = 0; j < RAY_PACKET_SIZE; j++) {
+			packetHitIndices[j] = (uint32)-1;
+		}
+
+		// Shrinking each lane's max distance to its nearest hit so far means
+		// any box that passes the test is the new nearest for that lane.
+		for(uint32 j = 0; j < numAABBs; j++) {
+			RayPacketVector distances;
+			RayPacketVector hitLanes = packet.intersectAABBMask(aabbs[j], distances);
+			uint32 hitMask = hitLanes.toBitmask();
+			if(hitMask == 0) {
+				continue;
+			}
+			packet.setMaxDistances(distances.select(hitLanes, packet.getMaxDistances()));
+			for(uint32 lane = 0; lane < RAY_PACKET_SIZE; lane++) {
+				if((hitMask >> lane) & 1) {
+					packetHitIndices[lane] = j;
+				}
+			}
+		}
+
+		const float* nearest = (const float*)&packet.getMaxDistances();
+		for(uint32 j = 0; j < numLanes; j++) {
+			hitIndices[i + j] = packetHitIndices[j];
+			hitDistances[i + j] = packetHitIndices[j] == (uint32)-1
+				? maxDistances[i + j] : nearest[j];
+		}
+	}
+}
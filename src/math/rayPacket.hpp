@@ -0,0 +1,97 @@
+#pragma once
+
+#include "aabb.hpp"
+
+// Packets are one SIMD register wide: 8 rays when building with AVX,
+// 4 rays otherwise.
+#if SIMD_SUPPORTED_LEVEL >= SIMD_LEVEL_x86_AVX
+	typedef Vector8 RayPacketVector;
+	#define RAY_PACKET_SIZE 8
+#else
+	typedef Vector RayPacketVector;
+	#define RAY_PACKET_SIZE 4
+#endif
+
+/**
+ * A group of RAY_PACKET_SIZE rays stored one component per register, with
+ * reciprocal directions precomputed, so a box only has to be loaded once to
+ * be tested against every ray in the packet.
+ *
+ * Lanes past the number of rays loaded are inactive and never report hits.
+ */
+class RayPacket
+{
+public:
+	/**
+	 * Loads up to RAY_PACKET_SIZE rays. Hits are only reported between 0 and
+	 * maxDistances[i]; rayDirs do not need to be normalized, and distances
+	 * are in units of rayDirs.
+	 */
+	RayPacket(const Vector3f* starts, const Vector3f* rayDirs,
+			const float* maxDistances, uint32 numRays);
+
+	/**
+	 * Slab test of every ray against aabb. Returns a bitmask with bit i set
+	 * if ray i hits, and writes the entry distance of each lane to
+	 * distances; rays starting inside the box enter at 0.
+	 */
+	FORCEINLINE uint32 intersectAABB(const AABB& aabb, RayPacketVector& distances) const;
+
+	/** As intersectAABB, but returns the hit lanes as a per-lane mask. */
+	FORCEINLINE RayPacketVector intersectAABBMask(const AABB& aabb,
+			RayPacketVector& distances) const;
+
+	FORCEINLINE const RayPacketVector& getMaxDistances() const { return maxDistances; }
+	FORCEINLINE void setMaxDistances(const RayPacketVector& distances) { maxDistances = distances; }
+	FORCEINLINE uint32 getNumRays() const { return numRays; }
+
+	/**
+	 * Finds the nearest box hit by each ray. hitIndices[i] is set to the
+	 * index of the closest box along ray i, or (uint32)-1 on a miss, and
+	 * hitDistances[i] to its entry distance. Rays are processed in packets in
+	 * the order given, so coherent rays should be stored next to each other.
+	 */
+	static void nearestHits(const Vector3f* starts, const Vector3f* rayDirs,
+			const float* maxDistances, uint32 numRays,
+			const AABB* aabbs, uint32 numAABBs,
+			uint32* hitIndices, float* hitDistances);
+private:
+	RayPacketVector startX, startY, startZ;
+	RayPacketVector invDirX, invDirY, invDirZ;
+	RayPacketVector maxDistances;
+	uint32 numRays;
+};
+
+FORCEINLINE uint32 RayPacket::intersectAABB(const AABB& aabb,
+		RayPacketVector& distances) const
+{
+	return intersectAABBMask(aabb, distances).toBitmask();
+}
+
+FORCEINLINE RayPacketVector RayPacket::intersectAABBMask(const AABB& aabb,
+		RayPacketVector& distances) const
+{
+	Vector3f mins = aabb.getMinExtents();
+	Vector3f maxs = aabb.getMaxExtents();
+
+	RayPacketVector t1 = (RayPacketVector::load1f(mins[0]) - startX) * invDirX;
+	RayPacketVector t2 = (RayPacketVector::load1f(maxs[0]) - startX) * invDirX;
+	RayPacketVector tNear = t1.min(t2);
+	RayPacketVector tFar = t1.max(t2);
+
+	t1 = (RayPacketVector::load1f(mins[1]) - startY) * invDirY;
+	t2 = (RayPacketVector::load1f(maxs[1]) - startY) * invDirY;
+	tNear = tNear.max(t1.min(t2));
+	tFar = tFar.min(t1.max(t2));
+
+	t1 = (RayPacketVector::load1f(mins[2]) - startZ) * invDirZ;
+	t2 = (RayPacketVector::load1f(maxs[2]) - startZ) * invDirZ;
+	tNear = tNear.max(t1.min(t2));
+	tFar = tFar.min(t1.max(t2));
+
+	// Clamping tNear to 0 covers both rays starting inside the box and the
+	// tFar >= 0 test, since tFar >= tNear is required anyway.
+	tNear = tNear.max(RayPacketVector::load1f(0.0f));
+	distances = tNear;
+	return (tFar >= tNear) & (tNear <= maxDistances);
+}
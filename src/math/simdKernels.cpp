@@ -0,0 +1,29 @@
+#include "simdKernels.hpp"
+#include "core/cpuInfo.hpp"
+
+std::atomic<const SIMDKernelTable*> SIMDKernels::current(nullptr);
+
+const SIMDKernelTable& SIMDKernels::select(uint32 maxSIMDLevel)
+{
+	const SIMDKernelTable* table = getAVX2Table();
+	if(table == nullptr || maxSIMDLevel < SIMD_LEVEL_x86_AVX2
+			|| CPUInfo::getSIMDLevel() < SIMD_LEVEL_x86_AVX2 || !CPUInfo::hasFMA()) {
+		table = getBaselineTable();
+	}
+	current.store(table, std::memory_order_release);
+	return *table;
+}
+
+String SIMDKernels::getReport()
+{
+	const SIMDKernelTable& table = get();
+	String report = String("CPU supports ")
+		+ CPUInfo::getSIMDLevelName(CPUInfo::getSIMDLevel())
+		+ (CPUInfo::hasFMA() ? " with FMA" : " without FMA")
+		+ "; compiled for " + CPUInfo::getSIMDLevelName(SIMD_SUPPORTED_LEVEL)
+		+ "; kernels available: " + getBaselineTable()->name;
+	if(getAVX2Table() != nullptr) {
+		report = report + ", " + getAVX2Table()->name;
+	}
+	return report + "; using " + table.name;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "core/common.hpp"
+#include "dataStructures/string.hpp"
+#include <atomic>
+
+class Matrix;
+class Transform;
+class Plane;
+
+/**
+ * Entry points for one build of the bulk math kernels.
+ *
+ * Each table comes from its own translation unit compiled for one SIMD
+ * level, so a binary built for the SSE2 baseline can still carry an AVX2
+ * build of the kernels and pick it at runtime.
+ *
+ * Kernels on SoA data take NUM_STREAMS float streams laid out back to back,
+ * streamStride floats apart, each 32-byte aligned and padded with zeros to
+ * a multiple of 8.
+ */
+struct SIMDKernelTable
+{
+	const char* name;
+	uint32 simdLevel;
+
+	void (*transformMatrixBatch)(const Transform* transforms, Matrix* result,
+			uint32 count);
+	// Streams: translation x, y, z, rotation x, y, z, w, then scale x, y, z
+	void (*transformStreamToMatrices)(const float* streams, uint32 streamStride,
+			uint32 count, Matrix* result);
+	void (*mulMatrixBatch)(const Matrix& pre, const Matrix* mats, const Matrix& post,
+			Matrix* result, uint32 count);
+
+	// Streams: center x, y, z, then extent x, y, z
+	void (*cullAABBs)(const float* streams, uint32 streamStride, uint32 count,
+			const Plane* planes, uint64* visibleBits, uint64* intersectingBits);
+	// Streams: center x, y, z, then radius
+	void (*cullSpheres)(const float* streams, uint32 streamStride, uint32 count,
+			const Plane* planes, uint64* visibleBits, uint64* intersectingBits);
+	uint32 (*cullSpheresToIndices)(const float* streams, uint32 streamStride,
+			uint32 count, const Plane* planes, uint32* visibleIndices);
+
+	// Copies meant for large buffers; small copies just use Memory::memcpy.
+	void* (*memcpy)(void* dest, const void* src, uintptr amt);
+
+	// Writes the index of every set bit in the first numBits bits, in order,
+	// and returns how many were written. indices must hold numBits entries.
+	uint32 (*bitmaskToIndices)(const uint64* bits, uint32 numBits, uint32* indices);
+};
+
+/**
+ * Runtime selection between the kernel builds linked into the binary, based
+ * on the features CPUInfo reports for the host.
+ */
+struct SIMDKernels
+{
+	/**
+	 * The table in use, chosen on the first call. Safe to call from any
+	 * thread; threads racing on the first call choose the same table.
+	 */
+	static FORCEINLINE const SIMDKernelTable& get()
+	{
+		const SIMDKernelTable* table = current.load(std::memory_order_acquire);
+		if(table == nullptr) {
+			return select(SIMD_LEVEL_x86_AVX2);
+		}
+		return *table;
+	}
+
+	/**
+	 * Picks the best table the host supports at or below maxSIMDLevel,
+	 * always falling back to the baseline build. Returns the table chosen.
+	 */
+	static const SIMDKernelTable& select(uint32 maxSIMDLevel);
+
+	/** Describes the host CPU, the builds available and the one in use. */
+	static String getReport();
+
+	// One per kernel translation unit. The baseline is always present;
+	// getAVX2Table returns nullptr if that unit was not built with AVX2.
+	static const SIMDKernelTable* getBaselineTable();
+	static const SIMDKernelTable* getAVX2Table();
+private:
+	static std::atomic<const SIMDKernelTable*> current;
+};
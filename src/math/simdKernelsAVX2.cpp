@@ -0,0 +1,18 @@
+// Kernels built with AVX2 and FMA enabled. The build system adds those flags
+// to this file only; without them the table is left out.
+#include "simdKernels.hpp"
+
+#if SIMD_SUPPORTED_LEVEL >= SIMD_LEVEL_x86_AVX2
+#define SIMD_KERNELS_NAME "AVX2"
+#include "simdKernelsImpl.hpp"
+
+const SIMDKernelTable* SIMDKernels::getAVX2Table()
+{
+	return &SIMD_KERNEL_TABLE;
+}
+#else
+const SIMDKernelTable* SIMDKernels::getAVX2Table()
+{
+	return nullptr;
+}
+#endif
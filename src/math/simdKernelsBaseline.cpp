@@ -0,0 +1,8 @@
+// Kernels built with the project's default compiler flags
+#define SIMD_KERNELS_NAME "baseline"
+#include "simdKernelsImpl.hpp"
+
+const SIMDKernelTable* SIMDKernels::getBaselineTable()
+{
+	return &SIMD_KERNEL_TABLE;
+}
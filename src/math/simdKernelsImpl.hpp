@@ -0,0 +1,476 @@
+#pragma once
+
+// Kernel bodies shared by every simdKernels*.cpp translation unit. Each unit
+// includes this once, compiled for its own SIMD level, and gets the matching
+// Vector and Vector8 backends.
+//
+// Everything here must be static or FORCEINLINE. An ordinary inline
+// function would be emitted by every kernel unit, and the linker could keep
+// the AVX2 copy for a call made from baseline code.
+
+#include "simdKernels.hpp"
+#include "matrix.hpp"
+#include "transform.hpp"
+#include "plane.hpp"
+#include <cstring>
+
+// Writes one row of 8 consecutive matrices, given that row as 4 SoA column
+// streams (lane i holds the element of matrix i).
+static FORCEINLINE void storeMatrixRowStreams(float* dest, uint32 row,
+		Vector8 col0, Vector8 col1, Vector8 col2, Vector8 col3)
+{
+	Vector8::transpose4(col0, col1, col2, col3);
+	dest += row*4;
+	col0.store2x4f(dest, dest + 16*4);
+	col1.store2x4f(dest + 16, dest + 16*5);
+	col2.store2x4f(dest + 16*2, dest + 16*6);
+	col3.store2x4f(dest + 16*3, dest + 16*7);
+}
+
+// Writes the matrices of 8 consecutive transforms, given their components as
+// SoA streams.
+static FORCEINLINE void storeTransformMatrices(float* dest,
+		const Vector8& tx, const Vector8& ty, const Vector8& tz,
+		const Vector8& qx, const Vector8& qy, const Vector8& qz, const Vector8& qw,
+		const Vector8& sx, const Vector8& sy, const Vector8& sz)
+{
+	const Vector8 one(Vector8::load1f(1.0f));
+	const Vector8 lastRow(Vector8::make(0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f));
+
+	Vector8 x2 = qx + qx;
+	Vector8 y2 = qy + qy;
+	Vector8 z2 = qz + qz;
+	Vector8 xx2 = qx * x2;
+	Vector8 yy2 = qy * y2;
+	Vector8 zz2 = qz * z2;
+	Vector8 xy2 = qx * y2;
+	Vector8 yz2 = qy * z2;
+	Vector8 xz2 = qx * z2;
+	Vector8 xw2 = qw * x2;
+	Vector8 yw2 = qw * y2;
+	Vector8 zw2 = qw * z2;
+
+	storeMatrixRowStreams(dest, 0, (one - (yy2 + zz2)) * sx,
+			(xy2 - zw2) * sy, (xz2 + yw2) * sz, tx);
+	storeMatrixRowStreams(dest, 1, (xy2 + zw2) * sx,
+			(one - (xx2 + zz2)) * sy, (yz2 - xw2) * sz, ty);
+	storeMatrixRowStreams(dest, 2, (xz2 - yw2) * sx,
+			(yz2 + xw2) * sy, (one - (xx2 + yy2)) * sz, tz);
+	for(uint32 j = 0; j < 8; j += 2) {
+		lastRow.store2x4f(dest + j*16 + 12, dest + (j+1)*16 + 12);
+	}
+}
+
+static void transformMatrixBatchKernel(const Transform* transforms, Matrix* result,
+		uint32 count)
+{
+	// Transform is laid out as translation, rotation, scale; each padded to
+	// a full Vector. 8 transforms are transposed into SoA streams so the
+	// quaternion math runs once per 8 instances.
+	static_assert(sizeof(Transform) == sizeof(float)*12, "Unexpected Transform layout");
+	static const uint32 STRIDE = 12;
+
+	uint32 i = 0;
+	for(; i + 8 <= count; i += 8) {
+		const float* src = (const float*)&transforms[i];
+
+		Vector8 tx = Vector8::load2x4f(src, src + STRIDE*4);
+		Vector8 ty = Vector8::load2x4f(src + STRIDE, src + STRIDE*5);
+		Vector8 tz = Vector8::load2x4f(src + STRIDE*2, src + STRIDE*6);
+		Vector8 tw = Vector8::load2x4f(src + STRIDE*3, src + STRIDE*7);
+		Vector8::transpose4(tx, ty, tz, tw);
+		src += 4;
+		Vector8 qx = Vector8::load2x4f(src, src + STRIDE*4);
+		Vector8 qy = Vector8::load2x4f(src + STRIDE, src + STRIDE*5);
+		Vector8 qz = Vector8::load2x4f(src + STRIDE*2, src + STRIDE*6);
+		Vector8 qw = Vector8::load2x4f(src + STRIDE*3, src + STRIDE*7);
+		Vector8::transpose4(qx, qy, qz, qw);
+		src += 4;
+		Vector8 sx = Vector8::load2x4f(src, src + STRIDE*4);
+		Vector8 sy = Vector8::load2x4f(src + STRIDE, src + STRIDE*5);
+		Vector8 sz = Vector8::load2x4f(src + STRIDE*2, src + STRIDE*6);
+		Vector8 sw = Vector8::load2x4f(src + STRIDE*3, src + STRIDE*7);
+		Vector8::transpose4(sx, sy, sz, sw);
+
+		storeTransformMatrices((float*)&result[i], tx, ty, tz, qx, qy, qz, qw, sx, sy, sz);
+	}
+
+	for(; i < count; i++) {
+		result[i] = transforms[i].toMatrix();
+	}
+}
+
+static void transformStreamToMatricesKernel(const float* streams, uint32 streamStride,
+		uint32 count, Matrix* result)
+{
+	// Already SoA, so unlike transformMatrixBatchKernel there is nothing to
+	// transpose on the way in.
+	uint32 i = 0;
+	for(; i + 8 <= count; i += 8) {
+		const float* src = streams + i;
+		storeTransformMatrices((float*)&result[i],
+				Vector8::loadAligned(src),
+				Vector8::loadAligned(src + streamStride),
+				Vector8::loadAligned(src + streamStride*2),
+				Vector8::loadAligned(src + streamStride*3),
+				Vector8::loadAligned(src + streamStride*4),
+				Vector8::loadAligned(src + streamStride*5),
+				Vector8::loadAligned(src + streamStride*6),
+				Vector8::loadAligned(src + streamStride*7),
+				Vector8::loadAligned(src + streamStride*8),
+				Vector8::loadAligned(src + streamStride*9));
+	}
+
+	for(; i < count; i++) {
+		const float* src = streams + i;
+		result[i] = Matrix::transformMatrix(
+				Vector3f(src[0], src[streamStride], src[streamStride*2]),
+				Quaternion(src[streamStride*3], src[streamStride*4],
+					src[streamStride*5], src[streamStride*6]),
+				Vector3f(src[streamStride*7], src[streamStride*8], src[streamStride*9]));
+	}
+}
+
+static void mulMatrixBatchKernel(const Matrix& pre, const Matrix* mats,
+		const Matrix& post, Matrix* result, uint32 count)
+{
+	// Two matrices are processed per Vector8, one in each half. pre's
+	// elements are broadcast so (pre * mat) is 16 multiply-adds for both
+	// matrices, and post's rows are duplicated into both halves.
+	const float* preVals = (const float*)&pre;
+	Vector8 preElements[16];
+	for(uint32 j = 0; j < 16; j++) {
+		preElements[j] = Vector8::load1f(preVals[j]);
+	}
+	const float* postVals = (const float*)&post;
+	const Vector8 post0(Vector8::load2x4f(postVals, postVals));
+	const Vector8 post1(Vector8::load2x4f(postVals + 4, postVals + 4));
+	const Vector8 post2(Vector8::load2x4f(postVals + 8, postVals + 8));
+	const Vector8 post3(Vector8::load2x4f(postVals + 12, postVals + 12));
+
+	uint32 i = 0;
+	for(; i + 2 <= count; i += 2) {
+		const float* src = (const float*)&mats[i];
+		float* dest = (float*)&result[i];
+		const Vector8 in0(Vector8::load2x4f(src, src + 16));
+		const Vector8 in1(Vector8::load2x4f(src + 4, src + 20));
+		const Vector8 in2(Vector8::load2x4f(src + 8, src + 24));
+		const Vector8 in3(Vector8::load2x4f(src + 12, src + 28));
+
+		for(uint32 row = 0; row < 4; row++) {
+			const Vector8* preRow = &preElements[row*4];
+			Vector8 temp = preRow[0] * in0;
+			temp = preRow[1].mad(in1, temp);
+			temp = preRow[2].mad(in2, temp);
+			temp = preRow[3].mad(in3, temp);
+
+			Vector8 out = temp.replicate(0) * post0;
+			out = temp.replicate(1).mad(post1, out);
+			out = temp.replicate(2).mad(post2, out);
+			out = temp.replicate(3).mad(post3, out);
+			out.store2x4f(dest + row*4, dest + 16 + row*4);
+		}
+	}
+
+	for(; i < count; i++) {
+		result[i] = pre * mats[i] * post;
+	}
+}
+
+// Clears the bits of the padding lanes past the last element
+static FORCEINLINE void clearBitmaskPadding(uint32 count, uint64* visibleBits,
+		uint64* intersectingBits)
+{
+	uint32 remainder = count & 63;
+	if(remainder != 0) {
+		uint64 mask = (((uint64)1) << remainder) - 1;
+		visibleBits[count >> 6] &= mask;
+		if(intersectingBits) {
+			intersectingBits[count >> 6] &= mask;
+		}
+	}
+}
+
+static void cullAABBsKernel(const float* streams, uint32 streamStride, uint32 count,
+		const Plane* planes, uint64* visibleBits, uint64* intersectingBits)
+{
+	// Per plane: d = n.center + w, r = |n|.extents. A box is outside if
+	// d + r <= 0 for any plane, and crosses a plane if d - r < 0.
+	Vector8 planeX[6], planeY[6], planeZ[6], planeW[6];
+	Vector8 absPlaneX[6], absPlaneY[6], absPlaneZ[6];
+	for(uint32 i = 0; i < 6; i++) {
+		Vector plane = planes[i].toVector();
+		Vector absPlane = plane.abs();
+		planeX[i] = Vector8::load1f(plane[0]);
+		planeY[i] = Vector8::load1f(plane[1]);
+		planeZ[i] = Vector8::load1f(plane[2]);
+		planeW[i] = Vector8::load1f(plane[3]);
+		absPlaneX[i] = Vector8::load1f(absPlane[0]);
+		absPlaneY[i] = Vector8::load1f(absPlane[1]);
+		absPlaneZ[i] = Vector8::load1f(absPlane[2]);
+	}
+
+	const float* centerX = streams;
+	const float* centerY = streams + streamStride;
+	const float* centerZ = streams + streamStride*2;
+	const float* extentX = streams + streamStride*3;
+	const float* extentY = streams + streamStride*4;
+	const float* extentZ = streams + streamStride*5;
+	const Vector8 zero(Vector8::load1f(0.0f));
+
+	uint32 numWords = (count + 63)/64;
+	::memset(visibleBits, 0, numWords * sizeof(uint64));
+	if(intersectingBits) {
+		::memset(intersectingBits, 0, numWords * sizeof(uint64));
+	}
+
+	for(uint32 i = 0; i < count; i += 8) {
+		const Vector8 cx(Vector8::loadAligned(centerX + i));
+		const Vector8 cy(Vector8::loadAligned(centerY + i));
+		const Vector8 cz(Vector8::loadAligned(centerZ + i));
+		const Vector8 ex(Vector8::loadAligned(extentX + i));
+		const Vector8 ey(Vector8::loadAligned(extentY + i));
+		const Vector8 ez(Vector8::loadAligned(extentZ + i));
+
+		Vector8 outside(zero);
+		Vector8 crossing(zero);
+		for(uint32 j = 0; j < 6; j++) {
+			Vector8 d = cx.mad(planeX[j], cy.mad(planeY[j], cz.mad(planeZ[j], planeW[j])));
+			Vector8 r = ex.mad(absPlaneX[j], ey.mad(absPlaneY[j], ez * absPlaneZ[j]));
+			outside = outside | ((d + r) <= zero);
+			crossing = crossing | ((d - r) < zero);
+		}
+
+		uint32 shift = i & 63;
+		uint64 visible = (uint64)(~outside.toBitmask() & 0xFF);
+		visibleBits[i >> 6] |= visible << shift;
+		if(intersectingBits) {
+			uint64 intersecting = visible & (uint64)crossing.toBitmask();
+			intersectingBits[i >> 6] |= intersecting << shift;
+		}
+	}
+	clearBitmaskPadding(count, visibleBits, intersectingBits);
+}
+
+// Broadcasts each plane component across a Vector8; plane j's x, y, z and w
+// are stored at planes8[j*4] to planes8[j*4+3].
+static FORCEINLINE void broadcastPlanes(Vector8* planes8, const Plane* planes)
+{
+	for(uint32 i = 0; i < 6; i++) {
+		Vector plane = planes[i].toVector();
+		for(uint32 j = 0; j < 4; j++) {
+			planes8[i*4 + j] = Vector8::load1f(plane[j]);
+		}
+	}
+}
+
+// Per plane: d = n.center + w. A sphere is outside if d < -r for any plane,
+// and crosses a plane if d < r.
+static FORCEINLINE void cullSpheres8(const Vector8* planes8,
+		const Vector8& cx, const Vector8& cy, const Vector8& cz, const Vector8& r,
+		uint32& visibleMask, uint32& crossingMask)
+{
+	const Vector8 negR(-r);
+	Vector8 outside(Vector8::load1f(0.0f));
+	Vector8 crossing(outside);
+	for(uint32 j = 0; j < 6; j++) {
+		const Vector8* plane = &planes8[j*4];
+		Vector8 d = cx.mad(plane[0], cy.mad(plane[1], cz.mad(plane[2], plane[3])));
+		outside = outside | (d < negR);
+		crossing = crossing | (d < r);
+	}
+	visibleMask = ~outside.toBitmask() & 0xFF;
+	crossingMask = crossing.toBitmask();
+}
+
+static void cullSpheresKernel(const float* streams, uint32 streamStride, uint32 count,
+		const Plane* planes, uint64* visibleBits, uint64* intersectingBits)
+{
+	Vector8 planes8[24];
+	broadcastPlanes(planes8, planes);
+	const float* centerX = streams;
+	const float* centerY = streams + streamStride;
+	const float* centerZ = streams + streamStride*2;
+	const float* radius = streams + streamStride*3;
+
+	uint32 numWords = (count + 63)/64;
+	::memset(visibleBits, 0, numWords * sizeof(uint64));
+	if(intersectingBits) {
+		::memset(intersectingBits, 0, numWords * sizeof(uint64));
+	}
+
+	for(uint32 i = 0; i < count; i += 8) {
+		uint32 visibleMask, crossingMask;
+		cullSpheres8(planes8, Vector8::loadAligned(centerX + i),
+				Vector8::loadAligned(centerY + i), Vector8::loadAligned(centerZ + i),
+				Vector8::loadAligned(radius + i), visibleMask, crossingMask);
+
+		uint32 shift = i & 63;
+		visibleBits[i >> 6] |= ((uint64)visibleMask) << shift;
+		if(intersectingBits) {
+			intersectingBits[i >> 6] |= ((uint64)(visibleMask & crossingMask)) << shift;
+		}
+	}
+	clearBitmaskPadding(count, visibleBits, intersectingBits);
+}
+
+static uint32 cullSpheresToIndicesKernel(const float* streams, uint32 streamStride,
+		uint32 count, const Plane* planes, uint32* visibleIndices)
+{
+	Vector8 planes8[24];
+	broadcastPlanes(planes8, planes);
+	const float* centerX = streams;
+	const float* centerY = streams + streamStride;
+	const float* centerZ = streams + streamStride*2;
+	const float* radius = streams + streamStride*3;
+
+	uint32 numVisible = 0;
+	for(uint32 i = 0; i < count; i += 8) {
+		uint32 visibleMask, crossingMask;
+		cullSpheres8(planes8, Vector8::loadAligned(centerX + i),
+				Vector8::loadAligned(centerY + i), Vector8::loadAligned(centerZ + i),
+				Vector8::loadAligned(radius + i), visibleMask, crossingMask);
+
+		// Most blocks are usually fully culled
+		if(visibleMask == 0) {
+			continue;
+		}
+
+		// Branchless compaction: every lane writes its index, but the
+		// output cursor only advances past visible ones. The cursor never
+		// passes the lane's own index, so writes stay inside count.
+		uint32 numLanes = Math::min(count - i, 8u);
+		for(uint32 j = 0; j < numLanes; j++) {
+			visibleIndices[numVisible] = i + j;
+			numVisible += (visibleMask >> j) & 1;
+		}
+	}
+	return numVisible;
+}
+
+// Below this, copies stay in cache and the C library is hard to beat
+#define SIMD_KERNELS_STREAMING_COPY_MIN (1024 * 1024)
+
+static void* memcpyKernel(void* destIn, const void* srcIn, uintptr amt)
+{
+	if(amt < SIMD_KERNELS_STREAMING_COPY_MIN) {
+		return ::memcpy(destIn, srcIn, amt);
+	}
+
+	// Copy up to a 32 byte boundary in dest, then write whole 128 byte
+	// blocks with non-temporal stores so a large copy does not evict the
+	// rest of the cache.
+	uint8* dest = (uint8*)destIn;
+	const uint8* src = (const uint8*)srcIn;
+	uintptr head = (uintptr)(((32 - ((uintptr)dest & 31)) & 31));
+	::memcpy(dest, src, head);
+	dest += head;
+	src += head;
+	amt -= head;
+
+	uintptr numBlocks = amt / 128;
+	for(uintptr i = 0; i < numBlocks; i++, dest += 128, src += 128) {
+		const float* srcFloats = (const float*)src;
+		float* destFloats = (float*)dest;
+		Vector8 v0 = Vector8::load8f(srcFloats);
+		Vector8 v1 = Vector8::load8f(srcFloats + 8);
+		Vector8 v2 = Vector8::load8f(srcFloats + 16);
+		Vector8 v3 = Vector8::load8f(srcFloats + 24);
+		v0.storeAlignedStreamed(destFloats);
+		v1.storeAlignedStreamed(destFloats + 8);
+		v2.storeAlignedStreamed(destFloats + 16);
+		v3.storeAlignedStreamed(destFloats + 24);
+	}
+#if SIMD_SUPPORTED_LEVEL >= SIMD_LEVEL_x86_SSE
+	_mm_sfence();
+#endif
+	::memcpy(dest, src, amt - numBlocks * 128);
+	return destIn;
+}
+
+static uint32 bitmaskToIndicesScalar(const uint64* bits, uint32 numBits,
+		uint32* indices, uint32 startWord, uint32 numIndices)
+{
+	uint32 numWords = (numBits + 63)/64;
+	for(uint32 i = startWord; i < numWords; i++) {
+		uint64 word = bits[i];
+		if(i == numWords - 1 && (numBits & 63) != 0) {
+			word &= (((uint64)1) << (numBits & 63)) - 1;
+		}
+		while(word != 0) {
+			indices[numIndices++] = i * 64 + Math::getNumTrailingZeroes(word);
+			word &= word - 1;
+		}
+	}
+	return numIndices;
+}
+
+#if SIMD_SUPPORTED_LEVEL >= SIMD_LEVEL_x86_AVX2
+// For each byte value, the positions of its set bits packed one per byte,
+// and how many bits are set
+struct BitPositionTable
+{
+	uint64 positions[256];
+	uint32 counts[256];
+
+	BitPositionTable()
+	{
+		for(uint32 i = 0; i < 256; i++) {
+			uint64 packed = 0;
+			uint32 numSet = 0;
+			for(uint32 bit = 0; bit < 8; bit++) {
+				if(i & (1 << bit)) {
+					packed |= ((uint64)bit) << (numSet++ * 8);
+				}
+			}
+			positions[i] = packed;
+			counts[i] = numSet;
+		}
+	}
+};
+
+static uint32 bitmaskToIndicesKernel(const uint64* bits, uint32 numBits, uint32* indices)
+{
+	// Each byte of the mask expands to 8 candidate indices in one register
+	// and is stored whole; the cursor only advances by the number of set
+	// bits. The cursor never passes the byte's first index, so the 8 lanes
+	// stay inside numBits for every full word.
+	static const BitPositionTable table;
+	uint32 numIndices = 0;
+	uint32 numFullWords = numBits/64;
+	for(uint32 i = 0; i < numFullWords; i++) {
+		uint64 word = bits[i];
+		if(word == 0) {
+			continue;
+		}
+		for(uint32 byte = 0; byte < 8; byte++) {
+			uint32 mask = (uint32)(word >> (byte * 8)) & 0xFF;
+			__m256i positions = _mm256_cvtepu8_epi32(
+					_mm_loadl_epi64((const __m128i*)&table.positions[mask]));
+			__m256i base = _mm256_set1_epi32((int)(i * 64 + byte * 8));
+			_mm256_storeu_si256((__m256i*)(indices + numIndices),
+					_mm256_add_epi32(positions, base));
+			numIndices += table.counts[mask];
+		}
+	}
+	return bitmaskToIndicesScalar(bits, numBits, indices, numFullWords, numIndices);
+}
+#else
+static uint32 bitmaskToIndicesKernel(const uint64* bits, uint32 numBits, uint32* indices)
+{
+	return bitmaskToIndicesScalar(bits, numBits, indices, 0, 0);
+}
+#endif
+
+static const SIMDKernelTable SIMD_KERNEL_TABLE = {
+	SIMD_KERNELS_NAME,
+	SIMD_SUPPORTED_LEVEL,
+	transformMatrixBatchKernel,
+	transformStreamToMatricesKernel,
+	mulMatrixBatchKernel,
+	cullAABBsKernel,
+	cullSpheresKernel,
+	cullSpheresToIndicesKernel,
+	memcpyKernel,
+	bitmaskToIndicesKernel
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "core/common.hpp"
+#include "core/memory.hpp"
+#include "math.hpp"
+
+/**
+ * Storage for NUM_STREAMS float streams of equal length, one per component
+ * of whatever is being stored (structure of arrays).
+ *
+ * Each stream is padded to a multiple of 8 elements and 32-byte aligned, so
+ * kernels can always process full Vector8s. The streams are one allocation,
+ * getStride() floats apart, so a kernel given getData() can step from one
+ * stream to the next with a single offset.
+ *
+ * Lanes past size() are zeroed when allocated, and afterwards hold only
+ * elements since removed, so kernels never read uninitialized floats.
+ */
+template<uint32 NUM_STREAMS>
+class SoAStreams
+{
+public:
+	SoAStreams() :
+		data(nullptr),
+		count(0),
+		capacity(0) {}
+
+	~SoAStreams()
+	{
+		Memory::free(data);
+	}
+
+	/** Adds an element, whose components are for the caller to set, and returns its index. */
+	uint32 add()
+	{
+		if(count == capacity) {
+			reserve(Math::max(capacity * 2, 64u));
+		}
+		return count++;
+	}
+
+	/** Moves the last element into index, and shrinks by one. */
+	void removeSwap(uint32 index)
+	{
+		assertCheck(index < count);
+		count--;
+		for(uint32 i = 0; i < NUM_STREAMS; i++) {
+			float* stream = getStream(i);
+			stream[index] = stream[count];
+		}
+	}
+
+	void reserve(uint32 amt)
+	{
+		amt = (amt + 7) & ~7u;
+		if(amt <= capacity) {
+			return;
+		}
+		float* newData = (float*)Memory::malloc(sizeof(float) * NUM_STREAMS * amt, 32);
+		Memory::memzero(newData, sizeof(float) * NUM_STREAMS * amt);
+		for(uint32 i = 0; i < NUM_STREAMS; i++) {
+			Memory::memcpy(newData + i * amt, getStream(i), sizeof(float) * count);
+		}
+		Memory::free(data);
+		data = newData;
+		capacity = amt;
+	}
+
+	FORCEINLINE void clear() { count = 0; }
+
+	FORCEINLINE uint32 size() const { return count; }
+	FORCEINLINE float* getData() { return data; }
+	FORCEINLINE const float* getData() const { return data; }
+	FORCEINLINE uint32 getStride() const { return capacity; }
+	FORCEINLINE float* getStream(uint32 stream) { return data + stream * capacity; }
+	FORCEINLINE const float* getStream(uint32 stream) const
+	{
+		return data + stream * capacity;
+	}
+private:
+	float* data;
+	uint32 count;
+	uint32 capacity;
+
+	NULL_COPY_AND_ASSIGN(SoAStreams);
+};
@@ -0,0 +1,41 @@
+#include "sphereArray.hpp"
+#include "simdKernels.hpp"
+
+uint32 SphereArray::add(const Sphere& sphere)
+{
+	uint32 index = streams.add();
+	set(index, sphere);
+	return index;
+}
+
+void SphereArray::set(uint32 index, const Sphere& sphere)
+{
+	assertCheck(index < size());
+	Vector3f center = sphere.getCenter();
+	streams.getStream(STREAM_CENTER_X)[index] = center[0];
+	streams.getStream(STREAM_CENTER_Y)[index] = center[1];
+	streams.getStream(STREAM_CENTER_Z)[index] = center[2];
+	streams.getStream(STREAM_RADIUS)[index] = sphere.getRadius();
+}
+
+Sphere SphereArray::get(uint32 index) const
+{
+	assertCheck(index < size());
+	return Sphere(Vector3f(streams.getStream(STREAM_CENTER_X)[index],
+				streams.getStream(STREAM_CENTER_Y)[index],
+				streams.getStream(STREAM_CENTER_Z)[index]),
+			streams.getStream(STREAM_RADIUS)[index]);
+}
+
+void SphereArray::cullFrustum(const Plane planes[6], uint64* visibleBits,
+		uint64* intersectingBits) const
+{
+	SIMDKernels::get().cullSpheres(streams.getData(), streams.getStride(), size(),
+			planes, visibleBits, intersectingBits);
+}
+
+uint32 SphereArray::cullFrustum(const Plane planes[6], uint32* visibleIndices) const
+{
+	return SIMDKernels::get().cullSpheresToIndices(streams.getData(),
+			streams.getStride(), size(), planes, visibleIndices);
+}
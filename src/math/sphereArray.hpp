@@ -0,0 +1,58 @@
+#pragma once
+
+#include "sphere.hpp"
+#include "plane.hpp"
+#include "soaStreams.hpp"
+
+/**
+ * A collection of spheres stored as separate x, y, z and radius streams
+ * (structure of arrays) so they can be tested in bulk with SIMD.
+ */
+class SphereArray
+{
+public:
+	SphereArray() {}
+
+	uint32 add(const Sphere& sphere);
+	void set(uint32 index, const Sphere& sphere);
+	Sphere get(uint32 index) const;
+	FORCEINLINE void removeSwap(uint32 index) { streams.removeSwap(index); }
+	FORCEINLINE void reserve(uint32 amt) { streams.reserve(amt); }
+	FORCEINLINE void clear() { streams.clear(); }
+
+	/**
+	 * Tests every sphere against the 6 frustum planes. Planes point inwards
+	 * and must be normalized, as produced by Matrix::extractFrustumPlanes.
+	 *
+	 * Bit i of visibleBits is set if sphere i is at least partially inside
+	 * the frustum. If intersectingBits is given, bit i is set if sphere i is
+	 * visible but crosses at least one plane. Both arrays must hold
+	 * getNumBitmaskWords() entries.
+	 */
+	void cullFrustum(const Plane planes[6], uint64* visibleBits,
+			uint64* intersectingBits=nullptr) const;
+
+	/**
+	 * Same test as above, but writes the indices of the visible spheres
+	 * densely into visibleIndices, which must hold size() entries.
+	 *
+	 * Returns the number of visible spheres.
+	 */
+	uint32 cullFrustum(const Plane planes[6], uint32* visibleIndices) const;
+
+	FORCEINLINE uint32 size() const { return streams.size(); }
+	FORCEINLINE uint32 getNumBitmaskWords() const { return (size() + 63)/64; }
+private:
+	enum
+	{
+		STREAM_CENTER_X = 0,
+		STREAM_CENTER_Y,
+		STREAM_CENTER_Z,
+		STREAM_RADIUS,
+		NUM_STREAMS
+	};
+
+	SoAStreams<NUM_STREAMS> streams;
+
+	NULL_COPY_AND_ASSIGN(SphereArray)
+};
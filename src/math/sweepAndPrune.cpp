@@ -0,0 +1,191 @@
+#include "sweepAndPrune.hpp"
+#include <algorithm>
+#include <limits>
+
+SweepAndPrune::SweepAndPrune() :
+	sweepData(nullptr),
+	sweepCapacity(0),
+	numObjects(0),
+	numSortShifts(0) {}
+
+SweepAndPrune::~SweepAndPrune()
+{
+	Memory::free(sweepData);
+}
+
+uint32 SweepAndPrune::add(const AABB& aabb)
+{
+	uint32 handle;
+	if(freeHandles.empty()) {
+		handle = (uint32)bounds.size();
+		bounds.push_back(aabb);
+		isActive.push_back(1);
+	} else {
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+		bounds[handle] = aabb;
+		isActive[handle] = 1;
+	}
+	addedHandles.push_back(handle);
+	numObjects++;
+	return handle;
+}
+
+void SweepAndPrune::update(uint32 handle, const AABB& aabb)
+{
+	assertCheck(handle < bounds.size() && isActive[handle]);
+	bounds[handle] = aabb;
+}
+
+void SweepAndPrune::remove(uint32 handle)
+{
+	assertCheck(handle < bounds.size() && isActive[handle]);
+	isActive[handle] = 0;
+	removedHandles.push_back(handle);
+	numObjects--;
+}
+
+static bool comparePairs(const SweepAndPrune::Pair& a, const SweepAndPrune::Pair& b)
+{
+	return a.handleA < b.handleA || (a.handleA == b.handleA && a.handleB < b.handleB);
+}
+
+void SweepAndPrune::sortEndpoints()
+{
+	// Insertion sort is linear when little has moved, but quadratic after
+	// large changes such as a batch of new objects. Once it has shifted as
+	// much as a full O(n log n) sort would, give up and sort from scratch.
+	uint32 numEndpoints = (uint32)endpoints.size();
+	uint32 maxShifts = numEndpoints * Math::ceilLog2(numEndpoints + 1) + 64;
+	numSortShifts = 0;
+	for(uint32 i = 1; i < numEndpoints; i++) {
+		Endpoint endpoint = endpoints[i];
+		uint32 j = i;
+		while(j > 0 && endpoints[j-1].minX > endpoint.minX) {
+			endpoints[j] = endpoints[j-1];
+			j--;
+		}
+		endpoints[j] = endpoint;
+		numSortShifts += i - j;
+		if(numSortShifts > maxShifts) {
+			std::sort(endpoints.begin(), endpoints.end());
+			return;
+		}
+	}
+}
+
+void SweepAndPrune::gatherSweepData()
+{
+	uint32 numEndpoints = (uint32)endpoints.size();
+	uint32 capacity = ((numEndpoints + 7) & ~7u) + 8;
+	if(capacity > sweepCapacity) {
+		Memory::free(sweepData);
+		sweepData = (float*)Memory::malloc(sizeof(float) * NUM_STREAMS * capacity, 32);
+		sweepCapacity = capacity;
+	}
+
+	float* minX = getStream(STREAM_MIN_X);
+	float* maxX = getStream(STREAM_MAX_X);
+	float* minY = getStream(STREAM_MIN_Y);
+	float* maxY = getStream(STREAM_MAX_Y);
+	float* minZ = getStream(STREAM_MIN_Z);
+	float* maxZ = getStream(STREAM_MAX_Z);
+	for(uint32 i = 0; i < numEndpoints; i++) {
+		const AABB& aabb = bounds[endpoints[i].handle];
+		float mins[4], maxs[4];
+		aabb.getMinExtents().toVector().store4f(mins);
+		aabb.getMaxExtents().toVector().store4f(maxs);
+		minX[i] = mins[0];
+		maxX[i] = maxs[0];
+		minY[i] = mins[1];
+		maxY[i] = maxs[1];
+		minZ[i] = mins[2];
+		maxZ[i] = maxs[2];
+	}
+
+	// Padding starts after everything ends, so it stops every sweep
+	const float inf = std::numeric_limits<float>::infinity();
+	for(uint32 i = numEndpoints; i < sweepCapacity; i++) {
+		minX[i] = inf;
+		maxX[i] = inf;
+		minY[i] = inf;
+		maxY[i] = inf;
+		minZ[i] = inf;
+		maxZ[i] = inf;
+	}
+}
+
+void SweepAndPrune::findPairs(Array<Pair>& pairs)
+{
+	// Drop removed objects and refresh the sort keys of the rest, keeping
+	// last frame's order as the starting point for the sort.
+	uint32 numKept = 0;
+	for(uint32 i = 0; i < endpoints.size(); i++) {
+		uint32 handle = endpoints[i].handle;
+		if(isActive[handle]) {
+			endpoints[numKept].handle = handle;
+			endpoints[numKept].minX = bounds[handle].getMinExtents()[0];
+			numKept++;
+		}
+	}
+	endpoints.resize(numKept);
+	for(uint32 i = 0; i < addedHandles.size(); i++) {
+		uint32 handle = addedHandles[i];
+		if(isActive[handle]) {
+			Endpoint endpoint = { bounds[handle].getMinExtents()[0], handle };
+			endpoints.push_back(endpoint);
+		}
+	}
+	addedHandles.clear();
+	freeHandles.insert(freeHandles.end(), removedHandles.begin(), removedHandles.end());
+	removedHandles.clear();
+
+	sortEndpoints();
+	gatherSweepData();
+
+	const float* minX = getStream(STREAM_MIN_X);
+	const float* maxX = getStream(STREAM_MAX_X);
+	const float* minY = getStream(STREAM_MIN_Y);
+	const float* maxY = getStream(STREAM_MAX_Y);
+	const float* minZ = getStream(STREAM_MIN_Z);
+	const float* maxZ = getStream(STREAM_MAX_Z);
+
+	pairs.clear();
+	uint32 numEndpoints = (uint32)endpoints.size();
+	for(uint32 i = 0; i < numEndpoints; i++) {
+		const Vector8 endX(Vector8::load1f(maxX[i]));
+		const Vector8 startY(Vector8::load1f(minY[i]));
+		const Vector8 endY(Vector8::load1f(maxY[i]));
+		const Vector8 startZ(Vector8::load1f(minZ[i]));
+		const Vector8 endZ(Vector8::load1f(maxZ[i]));
+		uint32 handle = endpoints[i].handle;
+
+		// Everything after i starts at or after i on x, so it overlaps on x
+		// exactly when it starts before i ends. That holds for a prefix of
+		// the remaining objects; the first block that is not all inside the
+		// prefix is the last one.
+		for(uint32 j = i + 1; ; j += 8) {
+			Vector8 overlapX = Vector8::load8f(minX + j) < endX;
+			uint32 maskX = overlapX.toBitmask();
+			if(maskX == 0) {
+				break;
+			}
+			Vector8 overlap = overlapX
+				& (Vector8::load8f(minY + j) < endY) & (Vector8::load8f(maxY + j) > startY)
+				& (Vector8::load8f(minZ + j) < endZ) & (Vector8::load8f(maxZ + j) > startZ);
+			uint32 mask = overlap.toBitmask();
+			for(uint32 lane = 0; mask != 0; lane++, mask >>= 1) {
+				if(mask & 1) {
+					uint32 other = endpoints[j + lane].handle;
+					Pair pair = { Math::min(handle, other), Math::max(handle, other) };
+					pairs.push_back(pair);
+				}
+			}
+			if(maskX != 0xFF) {
+				break;
+			}
+		}
+	}
+
+	std::sort(pairs.begin(), pairs.end(), comparePairs);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "aabb.hpp"
+#include "dataStructures/array.hpp"
+
+/**
+ * Sweep-and-prune broadphase.
+ *
+ * Objects are kept sorted by the min endpoint of their bounds on the x axis.
+ * Since objects move little between frames, the order is repaired with an
+ * insertion sort that only does work for objects that swapped places. Pairs
+ * are then found by sweeping along x, testing each object against the run
+ * of objects that start before it ends, 8 at a time with SIMD on y and z.
+ *
+ * Overlap matches AABB::intersects: boxes that only touch are not a pair.
+ */
+class SweepAndPrune
+{
+public:
+	struct Pair
+	{
+		uint32 handleA;
+		uint32 handleB;
+	};
+
+	SweepAndPrune();
+	~SweepAndPrune();
+
+	uint32 add(const AABB& aabb);
+	void update(uint32 handle, const AABB& aabb);
+	void remove(uint32 handle);
+
+	/**
+	 * Replaces pairs with every overlapping pair of objects, with
+	 * handleA < handleB, sorted by handleA and then handleB so the list is
+	 * the same regardless of how objects are ordered internally.
+	 */
+	void findPairs(Array<Pair>& pairs);
+
+	FORCEINLINE uint32 size() const { return numObjects; }
+	FORCEINLINE uint32 getNumSortShifts() const { return numSortShifts; }
+private:
+	enum
+	{
+		STREAM_MIN_X = 0,
+		STREAM_MAX_X,
+		STREAM_MIN_Y,
+		STREAM_MAX_Y,
+		STREAM_MIN_Z,
+		STREAM_MAX_Z,
+		NUM_STREAMS
+	};
+
+	struct Endpoint
+	{
+		float minX;
+		uint32 handle;
+
+		FORCEINLINE bool operator<(const Endpoint& other) const
+		{
+			return minX < other.minX;
+		}
+	};
+
+	// Indexed by handle. Removed handles are only reused after the next
+	// findPairs has dropped them from endpoints.
+	Array<AABB> bounds;
+	Array<uint8> isActive;
+	Array<uint32> freeHandles;
+	Array<uint32> removedHandles;
+
+	// Sorted by minX, rebuilt from bounds on every findPairs. Handles added
+	// since the last call are waiting in addedHandles.
+	Array<Endpoint> endpoints;
+	Array<uint32> addedHandles;
+
+	// Bounds gathered into sorted order for the sweep, padded to a multiple of
+	// 8 plus 8 more entries that can never overlap anything
+	float* sweepData;
+	uint32 sweepCapacity;
+
+	uint32 numObjects;
+	uint32 numSortShifts;
+
+	void sortEndpoints();
+	void gatherSweepData();
+
+	FORCEINLINE float* getStream(uint32 stream) const
+	{
+		return sweepData + stream * sweepCapacity;
+	}
+
+	NULL_COPY_AND_ASSIGN(SweepAndPrune)
+};
@@ -1,4 +1,5 @@
 #include "transform.hpp"
+#include "affineMatrix.hpp"
 
 Matrix Transform::inverse() const
 {
@@ -12,9 +13,6 @@ Matrix Transform::inverse() const
 //	Vector3f invTranslation = invRotation.rotate(invScale*-translation);
 //	return Transform(invTranslation, invRotation, invScale);
 
-	// TODO: Use the special fast matrix inverse for transform matrices. There's an article
-	// about it in my bookmarks
-	Matrix inverse(toMatrix().inverse());
-	return inverse;
+	return AffineMatrix(toMatrix()).inverse().toMatrix();
 }
 
@@ -0,0 +1,49 @@
+#include "transformStream.hpp"
+#include "simdKernels.hpp"
+
+uint32 TransformStream::add(const Transform& transform)
+{
+	uint32 index = streams.add();
+	set(index, transform);
+	return index;
+}
+
+void TransformStream::set(uint32 index, const Transform& transform)
+{
+	assertCheck(index < size());
+	float translation[4];
+	float rotation[4];
+	float scale[4];
+	transform.getTranslation().toVector().store4f(translation);
+	transform.getRotation().toVector().store4f(rotation);
+	transform.getScale().toVector().store4f(scale);
+	for(uint32 i = 0; i < 3; i++) {
+		getStream(STREAM_TRANSLATION_X + i)[index] = translation[i];
+		getStream(STREAM_SCALE_X + i)[index] = scale[i];
+	}
+	for(uint32 i = 0; i < 4; i++) {
+		getStream(STREAM_ROTATION_X + i)[index] = rotation[i];
+	}
+}
+
+Transform TransformStream::get(uint32 index) const
+{
+	assertCheck(index < size());
+	return Transform(
+			Vector3f(getStream(STREAM_TRANSLATION_X)[index],
+				getStream(STREAM_TRANSLATION_Y)[index],
+				getStream(STREAM_TRANSLATION_Z)[index]),
+			Quaternion(getStream(STREAM_ROTATION_X)[index],
+				getStream(STREAM_ROTATION_Y)[index],
+				getStream(STREAM_ROTATION_Z)[index],
+				getStream(STREAM_ROTATION_W)[index]),
+			Vector3f(getStream(STREAM_SCALE_X)[index],
+				getStream(STREAM_SCALE_Y)[index],
+				getStream(STREAM_SCALE_Z)[index]));
+}
+
+void TransformStream::toMatrices(Matrix* result) const
+{
+	SIMDKernels::get().transformStreamToMatrices(streams.getData(), streams.getStride(),
+			size(), result);
+}
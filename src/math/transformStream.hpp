@@ -0,0 +1,56 @@
+#pragma once
+
+#include "transform.hpp"
+#include "soaStreams.hpp"
+
+/**
+ * A collection of transforms stored as 10 separate float streams (structure
+ * of arrays): translation x, y, z, rotation x, y, z, w and scale x, y, z.
+ *
+ * This is the bulk counterpart of PackedTransform. Nothing is padded out to
+ * a full Vector, and kernels load 8 transforms' worth of one component with
+ * a single aligned load, so no transposes are needed.
+ */
+class TransformStream
+{
+public:
+	enum
+	{
+		STREAM_TRANSLATION_X = 0,
+		STREAM_TRANSLATION_Y,
+		STREAM_TRANSLATION_Z,
+		STREAM_ROTATION_X,
+		STREAM_ROTATION_Y,
+		STREAM_ROTATION_Z,
+		STREAM_ROTATION_W,
+		STREAM_SCALE_X,
+		STREAM_SCALE_Y,
+		STREAM_SCALE_Z,
+		NUM_STREAMS
+	};
+
+	TransformStream() {}
+
+	uint32 add(const Transform& transform);
+	void set(uint32 index, const Transform& transform);
+	Transform get(uint32 index) const;
+	FORCEINLINE void removeSwap(uint32 index) { streams.removeSwap(index); }
+	FORCEINLINE void reserve(uint32 amt) { streams.reserve(amt); }
+	FORCEINLINE void clear() { streams.clear(); }
+
+	/** Same as Transform::toMatrix for every transform. result must hold size() entries. */
+	void toMatrices(Matrix* result) const;
+
+	FORCEINLINE uint32 size() const { return streams.size(); }
+
+	FORCEINLINE float* getStream(uint32 stream) { return streams.getStream(stream); }
+	FORCEINLINE const float* getStream(uint32 stream) const
+	{
+		return streams.getStream(stream);
+	}
+	FORCEINLINE uint32 getStreamStride() const { return streams.getStride(); }
+private:
+	SoAStreams<NUM_STREAMS> streams;
+
+	NULL_COPY_AND_ASSIGN(TransformStream)
+};
@@ -5,6 +5,7 @@
 #include "math.hpp"
 
 typedef PlatformVector Vector;
+typedef PlatformVector8 Vector8;
 
 struct VectorConstants
 {
@@ -231,6 +231,40 @@ FORCEINLINE Vector Vector3f::toVector() const
 	return vec;
 }
 
+/**
+ * Vector3f packed into 12 bytes, for long-lived arrays.
+ *
+ * Vector3f holds a full Vector so it can be computed with directly, which
+ * wastes a quarter of every cache line it is stored in. Float3 is only for
+ * storage: load it into a Vector3f to do math, and store the result back.
+ */
+struct Float3
+{
+	float x;
+	float y;
+	float z;
+
+	FORCEINLINE Float3() {}
+	FORCEINLINE Float3(float xIn, float yIn, float zIn) :
+		x(xIn), y(yIn), z(zIn) {}
+	FORCEINLINE Float3(const Vector3f& vec)
+	{
+		store(vec);
+	}
+
+	FORCEINLINE Vector3f load() const
+	{
+		return Vector3f(Vector::load3f(&x, 0.0f));
+	}
+
+	FORCEINLINE void store(const Vector3f& vec)
+	{
+		vec.toVector().store3f(&x);
+	}
+};
+
+static_assert(sizeof(Float3) == sizeof(float)*3, "Float3 must be 3 contiguous floats");
+
 
 class Vector2f
 {
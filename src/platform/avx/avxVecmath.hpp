@@ -0,0 +1,411 @@
+#pragma once
+
+#include "core/memory.hpp"
+#include "math/math.hpp"
+#include "platform/platformSIMDInclude.hpp"
+
+/**
+ * 8-wide vector backed by a single AVX register.
+ *
+ * The register is treated as two 4-float halves. Element-wise operations
+ * work on all 8 lanes, while the "vector" operations (dot3, dot4, cross3,
+ * replicate, normalize) work on each half independently, exactly like
+ * SSEVector does on its 4 lanes. That way one AVXVector8 does the work of
+ * two SSEVectors per instruction.
+ */
+struct AVXVector8
+{
+public:
+	static FORCEINLINE void transpose4(AVXVector8& vec0, AVXVector8& vec1,
+			AVXVector8& vec2, AVXVector8& vec3)
+	{
+		const __m256 t0 = _mm256_unpacklo_ps(vec0.data, vec1.data);
+		const __m256 t1 = _mm256_unpackhi_ps(vec0.data, vec1.data);
+		const __m256 t2 = _mm256_unpacklo_ps(vec2.data, vec3.data);
+		const __m256 t3 = _mm256_unpackhi_ps(vec2.data, vec3.data);
+		vec0.data = _mm256_shuffle_ps(t0, t2, 0x44);
+		vec1.data = _mm256_shuffle_ps(t0, t2, 0xEE);
+		vec2.data = _mm256_shuffle_ps(t1, t3, 0x44);
+		vec3.data = _mm256_shuffle_ps(t1, t3, 0xEE);
+	}
+
+	static FORCEINLINE AVXVector8 make(uint32 x0, uint32 y0, uint32 z0, uint32 w0,
+			uint32 x1, uint32 y1, uint32 z1, uint32 w1)
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_castsi256_ps(_mm256_setr_epi32(
+				x0, y0, z0, w0, x1, y1, z1, w1));
+		return vec;
+	}
+
+	static FORCEINLINE AVXVector8 make(float x0, float y0, float z0, float w0,
+			float x1, float y1, float z1, float w1)
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_setr_ps(x0, y0, z0, w0, x1, y1, z1, w1);
+		return vec;
+	}
+
+	static FORCEINLINE AVXVector8 load8f(const float* vals)
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_loadu_ps(vals);
+		return vec;
+	}
+
+	static FORCEINLINE AVXVector8 load2x4f(const float* vals0, const float* vals1)
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_insertf128_ps(
+				_mm256_castps128_ps256(_mm_loadu_ps(vals0)), _mm_loadu_ps(vals1), 1);
+		return vec;
+	}
+
+	static FORCEINLINE AVXVector8 load1f(float val)
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_set1_ps(val);
+		return vec;
+	}
+
+	static FORCEINLINE AVXVector8 loadAligned(const float* vals)
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_load_ps(vals);
+		return vec;
+	}
+
+	FORCEINLINE void store8f(float* result) const
+	{
+		_mm256_storeu_ps(result, data);
+	}
+
+	FORCEINLINE void store2x4f(float* result0, float* result1) const
+	{
+		_mm_storeu_ps(result0, _mm256_castps256_ps128(data));
+		_mm_storeu_ps(result1, _mm256_extractf128_ps(data, 1));
+	}
+
+	FORCEINLINE void storeAligned(float* result) const
+	{
+		_mm256_store_ps(result, data);
+	}
+
+	FORCEINLINE void storeAlignedStreamed(float* result) const
+	{
+		_mm256_stream_ps(result, data);
+	}
+
+	FORCEINLINE AVXVector8 replicate(uint32 index) const
+	{
+		assertCheck(index <= 3);
+		AVXVector8 vec;
+		switch(index) {
+		case 0: vec.data = _mm256_permute_ps(data, 0x00); break;
+		case 1: vec.data = _mm256_permute_ps(data, 0x55); break;
+		case 2: vec.data = _mm256_permute_ps(data, 0xAA); break;
+		default: vec.data = _mm256_permute_ps(data, 0xFF); break;
+		}
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 abs() const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_and_ps(data,
+				_mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF)));
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 sign() const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_and_ps(data, _mm256_set1_ps(-0.f));
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 min(const AVXVector8& other) const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_min_ps(data, other.data);
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 max(const AVXVector8& other) const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_max_ps(data, other.data);
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 neg() const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_xor_ps(data, _mm256_set1_ps(-0.f));
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 operator-() const
+	{
+		return neg();
+	}
+
+	FORCEINLINE AVXVector8 dot3(const AVXVector8& other) const
+	{
+		const __m256 mul = _mm256_mul_ps(data, other.data);
+		const __m256 x = _mm256_permute_ps(mul, 0x00);
+		const __m256 y = _mm256_permute_ps(mul, 0x55);
+		const __m256 z = _mm256_permute_ps(mul, 0xAA);
+		AVXVector8 vec;
+		vec.data = _mm256_add_ps(x, _mm256_add_ps(y, z));
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 dot4(const AVXVector8& other) const
+	{
+		const __m256 t0 = _mm256_mul_ps(data, other.data);
+		const __m256 t1 = _mm256_hadd_ps(t0, t0);
+		AVXVector8 vec;
+		vec.data = _mm256_hadd_ps(t1, t1);
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 cross3(const AVXVector8& other) const
+	{
+		const __m256 t0 = _mm256_permute_ps(data, 0xC9);
+		const __m256 t1 = _mm256_permute_ps(other.data, 0xC9);
+		AVXVector8 vec;
+		vec.data = _mm256_sub_ps(_mm256_mul_ps(data, t1), _mm256_mul_ps(other.data, t0));
+		vec.data = _mm256_permute_ps(vec.data, 0xC9);
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 rsqrt() const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(data));
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 reciprocal() const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_div_ps(_mm256_set1_ps(1.0f), data);
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 rlen4() const
+	{
+		return dot4(*this).rsqrt();
+	}
+
+	FORCEINLINE AVXVector8 rlen3() const
+	{
+		return dot3(*this).rsqrt();
+	}
+
+	FORCEINLINE AVXVector8 normalize4() const
+	{
+		return (*this) * rlen4();
+	}
+
+	FORCEINLINE AVXVector8 normalize3() const
+	{
+		return (*this) * rlen3();
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE AVXVector8 rsqrt() const
+	{
+		if(precision == Precision::EXACT) {
+			return rsqrt();
+		}
+		AVXVector8 vec;
+		vec.data = _mm256_rsqrt_ps(data);
+		if(precision == Precision::REFINED) {
+			// y' = y * (1.5 - 0.5 * x * y * y)
+			__m256 halfXY = _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.5f), data), vec.data);
+			vec.data = _mm256_mul_ps(vec.data,
+					_mm256_sub_ps(_mm256_set1_ps(1.5f), _mm256_mul_ps(halfXY, vec.data)));
+		}
+		return vec;
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE AVXVector8 reciprocal() const
+	{
+		if(precision == Precision::EXACT) {
+			return reciprocal();
+		}
+		AVXVector8 vec;
+		vec.data = _mm256_rcp_ps(data);
+		if(precision == Precision::REFINED) {
+			// y' = y * (2 - x * y)
+			vec.data = _mm256_mul_ps(vec.data,
+					_mm256_sub_ps(_mm256_set1_ps(2.0f), _mm256_mul_ps(data, vec.data)));
+		}
+		return vec;
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE AVXVector8 rlen4() const
+	{
+		return dot4(*this).rsqrt<precision>();
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE AVXVector8 rlen3() const
+	{
+		return dot3(*this).rsqrt<precision>();
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE AVXVector8 normalize4() const
+	{
+		return (*this) * rlen4<precision>();
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE AVXVector8 normalize3() const
+	{
+		return (*this) * rlen3<precision>();
+	}
+
+	FORCEINLINE AVXVector8 mad(const AVXVector8& mul, const AVXVector8& add) const
+	{
+		AVXVector8 vec;
+	#if defined(__FMA__)
+		vec.data = _mm256_fmadd_ps(data, mul.data, add.data);
+	#else
+		vec.data = _mm256_add_ps(_mm256_mul_ps(data, mul.data), add.data);
+	#endif
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 operator+(const AVXVector8& other) const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_add_ps(data, other.data);
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 operator-(const AVXVector8& other) const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_sub_ps(data, other.data);
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 operator*(const AVXVector8& other) const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_mul_ps(data, other.data);
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 operator/(const AVXVector8& other) const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_div_ps(data, other.data);
+		return vec;
+	}
+
+	FORCEINLINE bool isZero8f() const
+	{
+		return !_mm256_movemask_ps(data);
+	}
+
+	FORCEINLINE uint32 toBitmask() const
+	{
+		return (uint32)_mm256_movemask_ps(data);
+	}
+
+	FORCEINLINE AVXVector8 operator==(const AVXVector8& other) const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_cmp_ps(data, other.data, _CMP_EQ_OQ);
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 equals(const AVXVector8& other, float errorMargin) const
+	{
+		return (*this - other).abs() < AVXVector8::load1f(errorMargin);
+	}
+
+	FORCEINLINE AVXVector8 notEquals(const AVXVector8& other, float errorMargin) const
+	{
+		return (*this - other).abs() >= AVXVector8::load1f(errorMargin);
+	}
+
+	FORCEINLINE AVXVector8 operator!=(const AVXVector8& other) const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_cmp_ps(data, other.data, _CMP_NEQ_UQ);
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 operator>(const AVXVector8& other) const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_cmp_ps(data, other.data, _CMP_GT_OQ);
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 operator>=(const AVXVector8& other) const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_cmp_ps(data, other.data, _CMP_GE_OQ);
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 operator<(const AVXVector8& other) const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_cmp_ps(data, other.data, _CMP_LT_OQ);
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 operator<=(const AVXVector8& other) const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_cmp_ps(data, other.data, _CMP_LE_OQ);
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 operator|(const AVXVector8& other) const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_or_ps(data, other.data);
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 operator&(const AVXVector8& other) const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_and_ps(data, other.data);
+		return vec;
+	}
+
+	FORCEINLINE AVXVector8 operator^(const AVXVector8& other) const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_xor_ps(data, other.data);
+		return vec;
+	}
+
+	FORCEINLINE float operator[](uint32 index) const
+	{
+		assertCheck(index <= 7);
+		return ((float*)&data)[index];
+	}
+
+	FORCEINLINE AVXVector8 select(const AVXVector8& mask, const AVXVector8& other) const
+	{
+		AVXVector8 vec;
+		vec.data = _mm256_blendv_ps(other.data, data, mask.data);
+		return vec;
+	}
+
+private:
+	__m256 data;
+};
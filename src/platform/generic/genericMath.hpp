@@ -204,6 +204,23 @@ struct GenericMath
 		return 31 - floorLog2(val);
 	}
 
+	static FORCEINLINE uint32 getNumTrailingZeroes(uint64 val)
+	{
+		if(val == 0) {
+			return 64;
+		}
+#if defined(COMPILER_GCC) || defined(COMPILER_CLANG)
+		return (uint32)__builtin_ctzll(val);
+#else
+		uint32 count = 0;
+		while(!(val & 1)) {
+			val >>= 1;
+			count++;
+		}
+		return count;
+#endif
+	}
+
 	static FORCEINLINE uint32 ceilLog2(uint32 val)
 	{
 		if(val <= 1) {
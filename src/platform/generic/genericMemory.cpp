@@ -1,21 +1,170 @@
 #include "genericMemory.hpp"
+#include "sizeClassAllocator.hpp"
 #include "math/math.hpp"
 #include <cstdlib>
 #include <stdio.h>
 
-void* GenericMemory::malloc(uintptr amt, uint32 alignment)
+#ifdef OPERATING_SYSTEM_LINUX
+	#include <sys/mman.h>
+	#include <unistd.h>
+	#define GENERIC_MEMORY_USE_MMAP
+#endif
+
+// Blocks too large for SizeClassAllocator are stored after a header
+// holding their size and the start of the underlying allocation. On Linux,
+// blocks of at least GENERIC_MEMORY_MMAP_THRESHOLD bytes are mapped
+// directly, so realloc can grow them by remapping pages rather than
+// copying; the low bit of their start is set to mark them.
+#define GENERIC_MEMORY_MMAP_THRESHOLD (256 * 1024)
+
+static const uintptr LARGE_HEADER_SIZE = sizeof(void*) + sizeof(uintptr);
+
+static FORCEINLINE uintptr& getLargeSize(void* ptr)
+{
+	return *((uintptr*)((uint8*)ptr - sizeof(void*) - sizeof(uintptr)));
+}
+
+static FORCEINLINE uintptr& getLargeStart(void* ptr)
 {
-	alignment = Math::max(amt >= 16 ? 16u : 8u, alignment);
-	void* ptr = ::malloc(amt + alignment + sizeof(void*) + sizeof(uintptr));
-	void* result = align((uint8*)ptr + sizeof(void*) + sizeof(uintptr), (uintptr)alignment);
-	*((void**)((uint8*)result - sizeof(void*))) = ptr;
-	*((uintptr*)((uint8*)result - sizeof(void*) - sizeof(uintptr))) = amt;
+	return *((uintptr*)((uint8*)ptr - sizeof(void*)));
+}
+
+static FORCEINLINE void* setLargeHeader(void* start, uintptr offset, uintptr amt,
+		bool isMapped)
+{
+	void* result = (uint8*)start + offset;
+	getLargeStart(result) = (uintptr)start | (isMapped ? 1 : 0);
+	getLargeSize(result) = amt;
 	return result;
 }
 
+static FORCEINLINE uintptr getLargeAlignment(uint32 alignment)
+{
+	// Large blocks are never under 16 bytes unless over-aligned
+	return Math::max(16u, alignment);
+}
+
+static FORCEINLINE uintptr getHeapSize(uintptr amt, uintptr alignment)
+{
+	return amt + alignment + LARGE_HEADER_SIZE;
+}
+
+#ifdef GENERIC_MEMORY_USE_MMAP
+static FORCEINLINE uintptr getPageSize()
+{
+	return (uintptr)sysconf(_SC_PAGESIZE);
+}
+
+static FORCEINLINE bool shouldMap(uintptr amt, uintptr alignment)
+{
+	return amt >= GENERIC_MEMORY_MMAP_THRESHOLD && alignment <= getPageSize();
+}
+
+static FORCEINLINE uintptr getMappedSize(uintptr offset, uintptr amt)
+{
+	return GenericMemory::align(offset + amt, getPageSize());
+}
+#endif
+
+static void* mallocLarge(uintptr amt, uint32 alignmentIn)
+{
+	uintptr alignment = getLargeAlignment(alignmentIn);
+#ifdef GENERIC_MEMORY_USE_MMAP
+	if(shouldMap(amt, alignment)) {
+		// Mappings are page aligned, so the block's offset is known up front
+		uintptr offset = Math::max(alignment, LARGE_HEADER_SIZE);
+		void* start = mmap(nullptr, getMappedSize(offset, amt), PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(start == MAP_FAILED) {
+			return nullptr;
+		}
+		return setLargeHeader(start, offset, amt, true);
+	}
+#endif
+	void* start = ::malloc(getHeapSize(amt, alignment));
+	if(start == nullptr) {
+		return nullptr;
+	}
+	void* result = GenericMemory::align((uint8*)start + LARGE_HEADER_SIZE, alignment);
+	return setLargeHeader(start, (uint8*)result - (uint8*)start, amt, false);
+}
+
+static void freeLarge(void* ptr)
+{
+	uintptr start = getLargeStart(ptr);
+#ifdef GENERIC_MEMORY_USE_MMAP
+	if(start & 1) {
+		start &= ~(uintptr)1;
+		munmap((void*)start, getMappedSize((uintptr)ptr - start, getLargeSize(ptr)));
+		return;
+	}
+#endif
+	::free((void*)start);
+}
+
+// Resizes a large block to a size that is still too large for
+// SizeClassAllocator.
+static void* reallocLarge(void* ptr, uintptr amt, uint32 alignmentIn)
+{
+	uintptr alignment = getLargeAlignment(alignmentIn);
+	uintptr start = getLargeStart(ptr);
+	uintptr size = getLargeSize(ptr);
+#ifdef GENERIC_MEMORY_USE_MMAP
+	if(start & 1) {
+		// Shrinking unmaps the tail, and growing extends the mapping in place
+		// if the address space after it is free, or moves its pages if not.
+		// Either way, no data is copied.
+		start &= ~(uintptr)1;
+		uintptr offset = (uintptr)ptr - start;
+		uintptr oldMappedSize = getMappedSize(offset, size);
+		uintptr newMappedSize = getMappedSize(offset, amt);
+		void* newStart = (void*)start;
+		if(newMappedSize != oldMappedSize) {
+			newStart = mremap(newStart, oldMappedSize, newMappedSize, MREMAP_MAYMOVE);
+			if(newStart == MAP_FAILED) {
+				return nullptr;
+			}
+		}
+		return setLargeHeader(newStart, offset, amt, true);
+	}
+	if(shouldMap(amt, alignment)) {
+		// Copied once, so later growth can remap
+		void* result = mallocLarge(amt, alignmentIn);
+		if(result != nullptr) {
+			GenericMemory::memcpy(result, ptr, Math::min(size, amt));
+			::free((void*)start);
+		}
+		return result;
+	}
+#endif
+	// ::realloc shrinks in place, and grows in place when the block's slack
+	// or the memory after it allows. If it moves the block, the data keeps
+	// its old offset from the start, which may no longer be aligned.
+	uintptr offset = (uintptr)ptr - start;
+	uint8* newStart = (uint8*)::realloc((void*)start, getHeapSize(amt, alignment));
+	if(newStart == nullptr) {
+		return nullptr;
+	}
+	uintptr newOffset = (uintptr)(GenericMemory::align(newStart + LARGE_HEADER_SIZE,
+			alignment) - newStart);
+	if(newOffset != offset) {
+		GenericMemory::memmove(newStart + newOffset, newStart + offset,
+				Math::min(size, amt));
+	}
+	return setLargeHeader(newStart, newOffset, amt, false);
+}
+
+void* GenericMemory::malloc(uintptr amt, uint32 alignment)
+{
+	uint32 sizeClass = SizeClassAllocator::getSizeClass(amt, alignment);
+	if(sizeClass < SizeClassAllocator::NUM_SIZE_CLASSES) {
+		return SizeClassAllocator::allocate(sizeClass);
+	}
+	return mallocLarge(amt, alignment);
+}
+
 void* GenericMemory::realloc(void* ptr, uintptr amt, uint32 alignment)
 {
-	alignment = Math::max(amt >= 16 ? 16u : 8u, alignment);
 	if(ptr == nullptr) {
 		return GenericMemory::malloc(amt, alignment);
 	}
@@ -25,25 +174,57 @@ void* GenericMemory::realloc(void* ptr, uintptr amt, uint32 alignment)
 		return nullptr;
 	}
 
-	void* result = malloc(amt, alignment);
+	// A block only changes allocator when its size class does, so a sized
+	// free of the result still finds the right one.
+	uint32 sizeClass = SizeClassAllocator::getSizeClass(amt, alignment);
+	if(SizeClassAllocator::owns(ptr)) {
+		if(sizeClass == SizeClassAllocator::getSizeClassOf(ptr)) {
+			return ptr;
+		}
+	} else if(sizeClass == SizeClassAllocator::NUM_SIZE_CLASSES) {
+		return reallocLarge(ptr, amt, alignment);
+	}
+
+	void* result = GenericMemory::malloc(amt, alignment);
+	if(result == nullptr) {
+		return nullptr;
+	}
 	uintptr size = GenericMemory::getAllocSize(ptr);
 	GenericMemory::memcpy(result, ptr, Math::min(size, amt));
-	free(ptr);
-
+	GenericMemory::free(ptr);
 	return result;
 }
 
 void* GenericMemory::free(void* ptr)
 {
-	if(ptr) {
-		::free(*((void**)((uint8*)ptr - sizeof(void*))));
+	if(SizeClassAllocator::owns(ptr)) {
+		SizeClassAllocator::free(ptr, SizeClassAllocator::getSizeClassOf(ptr));
+	} else if(ptr) {
+		freeLarge(ptr);
+	}
+	return nullptr;
+}
+
+void* GenericMemory::free(void* ptr, uintptr amt, uint32 alignment)
+{
+	if(ptr == nullptr) {
+		return nullptr;
+	}
+	uint32 sizeClass = SizeClassAllocator::getSizeClass(amt, alignment);
+	if(sizeClass < SizeClassAllocator::NUM_SIZE_CLASSES) {
+		SizeClassAllocator::free(ptr, sizeClass);
+	} else {
+		freeLarge(ptr);
 	}
 	return nullptr;
 }
 
 uintptr GenericMemory::getAllocSize(void* ptr)
 {
-	return *((uintptr*)((uint8*)ptr - sizeof(void*) - sizeof(uintptr)));
+	if(SizeClassAllocator::owns(ptr)) {
+		return SizeClassAllocator::getBlockSize(SizeClassAllocator::getSizeClassOf(ptr));
+	}
+	return getLargeSize(ptr);
 }
 
 void GenericMemory::bigmemswap(void* a, void* b, uintptr size)
@@ -58,6 +58,7 @@ struct GenericMemory
 	static void* malloc(uintptr amt, uint32 alignment);
 	static void* realloc(void* ptr, uintptr amt, uint32 alignment);
 	static void* free(void* ptr);
+	static void* free(void* ptr, uintptr amt, uint32 alignment);
 	static uintptr getAllocSize(void* ptr);
 private:
 	static void bigmemswap(void* a, void* b, uintptr size);
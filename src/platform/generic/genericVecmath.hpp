@@ -150,13 +150,27 @@ public:
 		Memory::memcpy(dest, mat, sizeof(mat));
 	}
 	
+	static FORCEINLINE void transpose4(GenericVector& vec0, GenericVector& vec1,
+			GenericVector& vec2, GenericVector& vec3)
+	{
+		GenericVector r0 = make(vec0.v[0], vec1.v[0], vec2.v[0], vec3.v[0]);
+		GenericVector r1 = make(vec0.v[1], vec1.v[1], vec2.v[1], vec3.v[1]);
+		GenericVector r2 = make(vec0.v[2], vec1.v[2], vec2.v[2], vec3.v[2]);
+		GenericVector r3 = make(vec0.v[3], vec1.v[3], vec2.v[3], vec3.v[3]);
+		vec0 = r0;
+		vec1 = r1;
+		vec2 = r2;
+		vec3 = r3;
+	}
+
 	static FORCEINLINE GenericVector make(uint32 x, uint32 y, uint32 z, uint32 w)
 	{
 		GenericVector vec;
-		vec.v[0] = *((uint32*)&x);
-		vec.v[1] = *((uint32*)&y);
-		vec.v[2] = *((uint32*)&z);
-		vec.v[3] = *((uint32*)&w);
+		uint32* m = (uint32*)(&vec.v[0]);
+		m[0] = x;
+		m[1] = y;
+		m[2] = z;
+		m[3] = w;
 		return vec;
 	}
 
@@ -326,6 +340,42 @@ public:
 				Math::pow(v[3], exp.v[3]));
 	}
 
+	FORCEINLINE GenericVector exp() const
+	{
+		return make(
+				Math::exp(v[0]),
+				Math::exp(v[1]),
+				Math::exp(v[2]),
+				Math::exp(v[3]));
+	}
+
+	FORCEINLINE GenericVector ln() const
+	{
+		return make(
+				Math::ln(v[0]),
+				Math::ln(v[1]),
+				Math::ln(v[2]),
+				Math::ln(v[3]));
+	}
+
+	FORCEINLINE GenericVector sin() const
+	{
+		return make(
+				Math::sin(v[0]),
+				Math::sin(v[1]),
+				Math::sin(v[2]),
+				Math::sin(v[3]));
+	}
+
+	FORCEINLINE GenericVector cos() const
+	{
+		return make(
+				Math::cos(v[0]),
+				Math::cos(v[1]),
+				Math::cos(v[2]),
+				Math::cos(v[3]));
+	}
+
 	FORCEINLINE GenericVector rsqrt() const
 	{
 		return make(
@@ -364,6 +414,43 @@ public:
 		return *this * rlen3();
 	}
 
+	// There are no estimate instructions here, so every precision is exact
+	template<Precision::Level precision>
+	FORCEINLINE GenericVector rsqrt() const
+	{
+		return rsqrt();
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE GenericVector reciprocal() const
+	{
+		return reciprocal();
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE GenericVector rlen4() const
+	{
+		return dot4(*this).rsqrt<precision>();
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE GenericVector rlen3() const
+	{
+		return dot3(*this).rsqrt<precision>();
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE GenericVector normalize4() const
+	{
+		return *this * rlen4<precision>();
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE GenericVector normalize3() const
+	{
+		return *this * rlen3<precision>();
+	}
+
 	FORCEINLINE void sincos(GenericVector* outSin, GenericVector* outCos) const
 	{
 		Math::sincos(&outSin->v[0], &outCos->v[0], (*this)[0]);
@@ -462,6 +549,13 @@ public:
 	}
 
 
+	FORCEINLINE uint32 toBitmask() const
+	{
+		const uint32* m = (const uint32*)(&v[0]);
+		return (m[0] >> 31) | ((m[1] >> 31) << 1) |
+			((m[2] >> 31) << 2) | ((m[3] >> 31) << 3);
+	}
+
 	FORCEINLINE GenericVector operator==(const GenericVector& other) const
 	{
 		return make(
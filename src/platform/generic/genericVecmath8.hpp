@@ -0,0 +1,312 @@
+#pragma once
+
+#include "core/memory.hpp"
+#include "math/math.hpp"
+#include "platform/platformVecmath.hpp"
+
+/**
+ * 8-wide vector built from two PlatformVectors, used when the target has no
+ * native 8-wide registers. Mirrors AVXVector8: element-wise operations act
+ * on all 8 lanes, vector operations act on each 4-float half independently.
+ * Each half still uses the 4-wide SIMD path, so batch kernels written
+ * against Vector8 do not fall back to scalar code.
+ */
+struct GenericVector8
+{
+public:
+	static FORCEINLINE void transpose4(GenericVector8& vec0, GenericVector8& vec1,
+			GenericVector8& vec2, GenericVector8& vec3)
+	{
+		PlatformVector::transpose4(vec0.lo, vec1.lo, vec2.lo, vec3.lo);
+		PlatformVector::transpose4(vec0.hi, vec1.hi, vec2.hi, vec3.hi);
+	}
+
+	static FORCEINLINE GenericVector8 make(uint32 x0, uint32 y0, uint32 z0, uint32 w0,
+			uint32 x1, uint32 y1, uint32 z1, uint32 w1)
+	{
+		return make(PlatformVector::make(x0, y0, z0, w0),
+				PlatformVector::make(x1, y1, z1, w1));
+	}
+
+	static FORCEINLINE GenericVector8 make(float x0, float y0, float z0, float w0,
+			float x1, float y1, float z1, float w1)
+	{
+		return make(PlatformVector::make(x0, y0, z0, w0),
+				PlatformVector::make(x1, y1, z1, w1));
+	}
+
+	static FORCEINLINE GenericVector8 make(const PlatformVector& lo, const PlatformVector& hi)
+	{
+		GenericVector8 vec;
+		vec.lo = lo;
+		vec.hi = hi;
+		return vec;
+	}
+
+	static FORCEINLINE GenericVector8 load8f(const float* vals)
+	{
+		return make(PlatformVector::load4f(vals), PlatformVector::load4f(vals + 4));
+	}
+
+	static FORCEINLINE GenericVector8 load2x4f(const float* vals0, const float* vals1)
+	{
+		return make(PlatformVector::load4f(vals0), PlatformVector::load4f(vals1));
+	}
+
+	static FORCEINLINE GenericVector8 load1f(float val)
+	{
+		PlatformVector vec(PlatformVector::load1f(val));
+		return make(vec, vec);
+	}
+
+	static FORCEINLINE GenericVector8 loadAligned(const float* vals)
+	{
+		return make(PlatformVector::loadAligned(vals),
+				PlatformVector::loadAligned(vals + 4));
+	}
+
+	FORCEINLINE void store8f(float* result) const
+	{
+		lo.store4f(result);
+		hi.store4f(result + 4);
+	}
+
+	FORCEINLINE void store2x4f(float* result0, float* result1) const
+	{
+		lo.store4f(result0);
+		hi.store4f(result1);
+	}
+
+	FORCEINLINE void storeAligned(float* result) const
+	{
+		lo.storeAligned(result);
+		hi.storeAligned(result + 4);
+	}
+
+	FORCEINLINE void storeAlignedStreamed(float* result) const
+	{
+		lo.storeAlignedStreamed(result);
+		hi.storeAlignedStreamed(result + 4);
+	}
+
+	FORCEINLINE GenericVector8 replicate(uint32 index) const
+	{
+		return make(lo.replicate(index), hi.replicate(index));
+	}
+
+	FORCEINLINE GenericVector8 abs() const
+	{
+		return make(lo.abs(), hi.abs());
+	}
+
+	FORCEINLINE GenericVector8 sign() const
+	{
+		return make(lo.sign(), hi.sign());
+	}
+
+	FORCEINLINE GenericVector8 min(const GenericVector8& other) const
+	{
+		return make(lo.min(other.lo), hi.min(other.hi));
+	}
+
+	FORCEINLINE GenericVector8 max(const GenericVector8& other) const
+	{
+		return make(lo.max(other.lo), hi.max(other.hi));
+	}
+
+	FORCEINLINE GenericVector8 neg() const
+	{
+		return make(lo.neg(), hi.neg());
+	}
+
+	FORCEINLINE GenericVector8 operator-() const
+	{
+		return neg();
+	}
+
+	FORCEINLINE GenericVector8 dot3(const GenericVector8& other) const
+	{
+		return make(lo.dot3(other.lo), hi.dot3(other.hi));
+	}
+
+	FORCEINLINE GenericVector8 dot4(const GenericVector8& other) const
+	{
+		return make(lo.dot4(other.lo), hi.dot4(other.hi));
+	}
+
+	FORCEINLINE GenericVector8 cross3(const GenericVector8& other) const
+	{
+		return make(lo.cross3(other.lo), hi.cross3(other.hi));
+	}
+
+	FORCEINLINE GenericVector8 rsqrt() const
+	{
+		return make(lo.rsqrt(), hi.rsqrt());
+	}
+
+	FORCEINLINE GenericVector8 reciprocal() const
+	{
+		return make(lo.reciprocal(), hi.reciprocal());
+	}
+
+	FORCEINLINE GenericVector8 rlen4() const
+	{
+		return dot4(*this).rsqrt();
+	}
+
+	FORCEINLINE GenericVector8 rlen3() const
+	{
+		return dot3(*this).rsqrt();
+	}
+
+	FORCEINLINE GenericVector8 normalize4() const
+	{
+		return *this * rlen4();
+	}
+
+	FORCEINLINE GenericVector8 normalize3() const
+	{
+		return *this * rlen3();
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE GenericVector8 rsqrt() const
+	{
+		return make(lo.rsqrt<precision>(), hi.rsqrt<precision>());
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE GenericVector8 reciprocal() const
+	{
+		return make(lo.reciprocal<precision>(), hi.reciprocal<precision>());
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE GenericVector8 rlen4() const
+	{
+		return dot4(*this).rsqrt<precision>();
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE GenericVector8 rlen3() const
+	{
+		return dot3(*this).rsqrt<precision>();
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE GenericVector8 normalize4() const
+	{
+		return *this * rlen4<precision>();
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE GenericVector8 normalize3() const
+	{
+		return *this * rlen3<precision>();
+	}
+
+	FORCEINLINE GenericVector8 mad(const GenericVector8& mul, const GenericVector8& add) const
+	{
+		return make(lo.mad(mul.lo, add.lo), hi.mad(mul.hi, add.hi));
+	}
+
+	FORCEINLINE GenericVector8 operator+(const GenericVector8& other) const
+	{
+		return make(lo + other.lo, hi + other.hi);
+	}
+
+	FORCEINLINE GenericVector8 operator-(const GenericVector8& other) const
+	{
+		return make(lo - other.lo, hi - other.hi);
+	}
+
+	FORCEINLINE GenericVector8 operator*(const GenericVector8& other) const
+	{
+		return make(lo * other.lo, hi * other.hi);
+	}
+
+	FORCEINLINE GenericVector8 operator/(const GenericVector8& other) const
+	{
+		return make(lo / other.lo, hi / other.hi);
+	}
+
+	FORCEINLINE bool isZero8f() const
+	{
+		return toBitmask() == 0;
+	}
+
+	FORCEINLINE uint32 toBitmask() const
+	{
+		return lo.toBitmask() | (hi.toBitmask() << 4);
+	}
+
+	FORCEINLINE GenericVector8 operator==(const GenericVector8& other) const
+	{
+		return make(lo == other.lo, hi == other.hi);
+	}
+
+	FORCEINLINE GenericVector8 equals(const GenericVector8& other, float errorMargin) const
+	{
+		return (*this - other).abs() < GenericVector8::load1f(errorMargin);
+	}
+
+	FORCEINLINE GenericVector8 notEquals(const GenericVector8& other, float errorMargin) const
+	{
+		return (*this - other).abs() >= GenericVector8::load1f(errorMargin);
+	}
+
+	FORCEINLINE GenericVector8 operator!=(const GenericVector8& other) const
+	{
+		return make(lo != other.lo, hi != other.hi);
+	}
+
+	FORCEINLINE GenericVector8 operator>(const GenericVector8& other) const
+	{
+		return make(lo > other.lo, hi > other.hi);
+	}
+
+	FORCEINLINE GenericVector8 operator>=(const GenericVector8& other) const
+	{
+		return make(lo >= other.lo, hi >= other.hi);
+	}
+
+	FORCEINLINE GenericVector8 operator<(const GenericVector8& other) const
+	{
+		return make(lo < other.lo, hi < other.hi);
+	}
+
+	FORCEINLINE GenericVector8 operator<=(const GenericVector8& other) const
+	{
+		return make(lo <= other.lo, hi <= other.hi);
+	}
+
+	FORCEINLINE GenericVector8 operator|(const GenericVector8& other) const
+	{
+		return make(lo | other.lo, hi | other.hi);
+	}
+
+	FORCEINLINE GenericVector8 operator&(const GenericVector8& other) const
+	{
+		return make(lo & other.lo, hi & other.hi);
+	}
+
+	FORCEINLINE GenericVector8 operator^(const GenericVector8& other) const
+	{
+		return make(lo ^ other.lo, hi ^ other.hi);
+	}
+
+	FORCEINLINE float operator[](uint32 index) const
+	{
+		assertCheck(index <= 7);
+		return index < 4 ? lo[index] : hi[index-4];
+	}
+
+	FORCEINLINE GenericVector8 select(const GenericVector8& mask, const GenericVector8& other) const
+	{
+		return make(lo.select(mask.lo, other.lo), hi.select(mask.hi, other.hi));
+	}
+
+private:
+	PlatformVector lo;
+	PlatformVector hi;
+};
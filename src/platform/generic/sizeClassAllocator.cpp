@@ -0,0 +1,362 @@
+#include "sizeClassAllocator.hpp"
+#include <atomic>
+#include <mutex>
+#include <cstdlib>
+
+#define SLAB_SHIFT 16
+#define SLABS_PER_CHUNK 16
+#define SLAB_HEADER_SIZE 64
+// Each leaf of the page map has a bit for 2^16 slabs, 4GB of addresses, and
+// the root has enough leaves for 48-bit addresses.
+#define PAGE_MAP_LEAF_BITS 16
+#define PAGE_MAP_ROOT_SIZE (1 << 16)
+
+// 16 byte steps up to 128, then four steps between each power of 2
+const uint32 SizeClassAllocator::blockSizes[NUM_SIZE_CLASSES] = {
+	16, 32, 48, 64, 80, 96, 112, 128,
+	160, 192, 224, 256, 320, 384, 448, 512,
+	640, 768, 896, 1024
+};
+
+const uint8 SizeClassAllocator::sizeClassesBy16Bytes[MAX_SIZE/16 + 1] = {
+	0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 8, 9, 9, 10, 10, 11,
+	11, 12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15,
+	15, 16, 16, 16, 16, 16, 16, 16, 16, 17, 17, 17, 17, 17, 17, 17,
+	17, 18, 18, 18, 18, 18, 18, 18, 18, 19, 19, 19, 19, 19, 19, 19,
+	19
+};
+
+// Blocks a thread cache takes from or returns to the slabs at once, about
+// 8KB worth. A cache holds up to twice this many before returning a batch.
+static const uint32 batchSizes[SizeClassAllocator::NUM_SIZE_CLASSES] = {
+	64, 64, 64, 64, 64, 64, 64, 64, 51, 42,
+	36, 32, 25, 21, 18, 16, 12, 10, 9, 8
+};
+
+struct SlabHeader
+{
+	SlabHeader* next;
+	SlabHeader* prev;
+	void* freeList;
+	uint8* unusedStart;
+	uint32 sizeClass;
+	uint32 numUsed;
+	uint32 numBlocks;
+	bool isPartial;
+};
+static_assert(sizeof(SlabHeader) <= SLAB_HEADER_SIZE, "SlabHeader must fit before the first block");
+
+// Slabs with free blocks, for one size class
+struct SizeClassData
+{
+	std::mutex mutex;
+	SlabHeader* partialSlabs = nullptr;
+};
+
+enum ThreadCacheState
+{
+	THREAD_CACHE_INACTIVE,
+	THREAD_CACHE_ACTIVE,
+	THREAD_CACHE_DESTROYED
+};
+
+// Plain data, so it's usable at any point in a thread's life without
+// needing construction.
+struct ThreadCache
+{
+	void* freeLists[SizeClassAllocator::NUM_SIZE_CLASSES];
+	uint32 numFree[SizeClassAllocator::NUM_SIZE_CLASSES];
+	uint32 state;
+};
+
+// Returns a thread's cached blocks when the thread exits
+struct ThreadCacheFlusher
+{
+	FORCEINLINE void activate() {}
+	~ThreadCacheFlusher();
+};
+
+static SizeClassData sizeClasses[SizeClassAllocator::NUM_SIZE_CLASSES];
+static std::mutex slabPoolMutex;
+static SlabHeader* freeSlabs = nullptr;
+static std::atomic<std::atomic<uint64>*> pageMap[PAGE_MAP_ROOT_SIZE];
+static thread_local ThreadCache threadCache;
+static thread_local ThreadCacheFlusher threadCacheFlusher;
+
+static FORCEINLINE SlabHeader* getSlab(const void* ptr)
+{
+	return (SlabHeader*)((uintptr)ptr & ~(uintptr)(SizeClassAllocator::SLAB_SIZE - 1));
+}
+
+static void markSlabOwned(const void* slab)
+{
+	uintptr index = (uintptr)slab >> SLAB_SHIFT;
+	uintptr root = index >> PAGE_MAP_LEAF_BITS;
+	assertCheck(root < PAGE_MAP_ROOT_SIZE);
+	std::atomic<uint64>* leaf = pageMap[root].load(std::memory_order_relaxed);
+	if(leaf == nullptr) {
+		leaf = (std::atomic<uint64>*)::calloc((1 << PAGE_MAP_LEAF_BITS)/64, sizeof(uint64));
+		pageMap[root].store(leaf, std::memory_order_release);
+	}
+	uintptr bit = index & ((1 << PAGE_MAP_LEAF_BITS) - 1);
+	leaf[bit >> 6].fetch_or((uint64)1 << (bit & 63), std::memory_order_relaxed);
+}
+
+// Called with slabPoolMutex held. Chunks are never returned to the system;
+// their slabs go back to the pool instead.
+static bool allocateChunk()
+{
+	uintptr chunkSize = (SLABS_PER_CHUNK + 1) * SizeClassAllocator::SLAB_SIZE;
+	uint8* chunk = (uint8*)::malloc(chunkSize);
+	if(chunk == nullptr) {
+		return false;
+	}
+	uint8* slab = (uint8*)(((uintptr)chunk + SizeClassAllocator::SLAB_SIZE - 1)
+			& ~(uintptr)(SizeClassAllocator::SLAB_SIZE - 1));
+	for(; slab + SizeClassAllocator::SLAB_SIZE <= chunk + chunkSize;
+			slab += SizeClassAllocator::SLAB_SIZE) {
+		markSlabOwned(slab);
+		SlabHeader* header = (SlabHeader*)slab;
+		header->next = freeSlabs;
+		freeSlabs = header;
+	}
+	return true;
+}
+
+static SlabHeader* createSlab(uint32 sizeClass)
+{
+	SlabHeader* slab;
+	{
+		std::lock_guard<std::mutex> lock(slabPoolMutex);
+		if(freeSlabs == nullptr && !allocateChunk()) {
+			return nullptr;
+		}
+		slab = freeSlabs;
+		freeSlabs = slab->next;
+	}
+
+	// Power of 2 blocks start at a multiple of their size, so they're
+	// aligned to it.
+	uintptr blockSize = SizeClassAllocator::getBlockSize(sizeClass);
+	uintptr firstBlock = SLAB_HEADER_SIZE;
+	if((blockSize & (blockSize - 1)) == 0 && blockSize > firstBlock) {
+		firstBlock = blockSize;
+	}
+	slab->next = nullptr;
+	slab->prev = nullptr;
+	slab->freeList = nullptr;
+	slab->unusedStart = (uint8*)slab + firstBlock;
+	slab->sizeClass = sizeClass;
+	slab->numUsed = 0;
+	slab->numBlocks = (uint32)((SizeClassAllocator::SLAB_SIZE - firstBlock)/blockSize);
+	slab->isPartial = false;
+	return slab;
+}
+
+static void releaseSlab(SlabHeader* slab)
+{
+	std::lock_guard<std::mutex> lock(slabPoolMutex);
+	slab->next = freeSlabs;
+	freeSlabs = slab;
+}
+
+static void linkPartialSlab(SizeClassData& data, SlabHeader* slab)
+{
+	slab->prev = nullptr;
+	slab->next = data.partialSlabs;
+	if(data.partialSlabs != nullptr) {
+		data.partialSlabs->prev = slab;
+	}
+	data.partialSlabs = slab;
+	slab->isPartial = true;
+}
+
+static void unlinkPartialSlab(SizeClassData& data, SlabHeader* slab)
+{
+	if(slab->prev != nullptr) {
+		slab->prev->next = slab->next;
+	} else {
+		data.partialSlabs = slab->next;
+	}
+	if(slab->next != nullptr) {
+		slab->next->prev = slab->prev;
+	}
+	slab->isPartial = false;
+}
+
+// Links up to count blocks into list, and returns how many there were
+static uint32 takeBlocks(uint32 sizeClass, uint32 count, void** list)
+{
+	SizeClassData& data = sizeClasses[sizeClass];
+	uintptr blockSize = SizeClassAllocator::getBlockSize(sizeClass);
+	void* head = nullptr;
+	uint32 numTaken = 0;
+
+	std::lock_guard<std::mutex> lock(data.mutex);
+	while(numTaken < count) {
+		SlabHeader* slab = data.partialSlabs;
+		if(slab == nullptr) {
+			slab = createSlab(sizeClass);
+			if(slab == nullptr) {
+				break;
+			}
+			linkPartialSlab(data, slab);
+		}
+
+		for(; numTaken < count && slab->numUsed < slab->numBlocks; numTaken++) {
+			void* block = slab->freeList;
+			if(block != nullptr) {
+				slab->freeList = *(void**)block;
+			} else {
+				block = slab->unusedStart;
+				slab->unusedStart += blockSize;
+			}
+			*(void**)block = head;
+			head = block;
+			slab->numUsed++;
+		}
+		if(slab->numUsed == slab->numBlocks) {
+			unlinkPartialSlab(data, slab);
+		}
+	}
+	*list = head;
+	return numTaken;
+}
+
+static void returnBlocks(uint32 sizeClass, void* list)
+{
+	SizeClassData& data = sizeClasses[sizeClass];
+	std::lock_guard<std::mutex> lock(data.mutex);
+	while(list != nullptr) {
+		void* block = list;
+		list = *(void**)list;
+
+		SlabHeader* slab = getSlab(block);
+		*(void**)block = slab->freeList;
+		slab->freeList = block;
+		if(!slab->isPartial) {
+			linkPartialSlab(data, slab);
+		}
+		// Keeps one empty slab per class, so a class that allocates and frees
+		// a batch in a loop doesn't go to the pool every time.
+		if(--slab->numUsed == 0 && (slab->next != nullptr || slab->prev != nullptr)) {
+			unlinkPartialSlab(data, slab);
+			releaseSlab(slab);
+		}
+	}
+}
+
+static void flushThreadCache(ThreadCache& cache)
+{
+	for(uint32 i = 0; i < SizeClassAllocator::NUM_SIZE_CLASSES; i++) {
+		returnBlocks(i, cache.freeLists[i]);
+		cache.freeLists[i] = nullptr;
+		cache.numFree[i] = 0;
+	}
+}
+
+ThreadCacheFlusher::~ThreadCacheFlusher()
+{
+	flushThreadCache(threadCache);
+	threadCache.state = THREAD_CACHE_DESTROYED;
+}
+
+static void activateThreadCache(ThreadCache& cache)
+{
+	threadCacheFlusher.activate();
+	cache.state = THREAD_CACHE_ACTIVE;
+}
+
+static void* allocateUncached(uint32 sizeClass)
+{
+	ThreadCache& cache = threadCache;
+	void* block;
+	if(cache.state == THREAD_CACHE_DESTROYED) {
+		return takeBlocks(sizeClass, 1, &block) == 0 ? nullptr : block;
+	}
+	if(cache.state == THREAD_CACHE_INACTIVE) {
+		activateThreadCache(cache);
+	}
+
+	uint32 numTaken = takeBlocks(sizeClass, batchSizes[sizeClass], &block);
+	if(numTaken == 0) {
+		return nullptr;
+	}
+	cache.freeLists[sizeClass] = *(void**)block;
+	cache.numFree[sizeClass] = numTaken - 1;
+	return block;
+}
+
+void* SizeClassAllocator::allocate(uint32 sizeClass)
+{
+	ThreadCache& cache = threadCache;
+	void* block = cache.freeLists[sizeClass];
+	if(block == nullptr) {
+		return allocateUncached(sizeClass);
+	}
+	cache.freeLists[sizeClass] = *(void**)block;
+	cache.numFree[sizeClass]--;
+	return block;
+}
+
+static void freeUncached(void* ptr, uint32 sizeClass)
+{
+	ThreadCache& cache = threadCache;
+	if(cache.state == THREAD_CACHE_DESTROYED) {
+		*(void**)ptr = nullptr;
+		returnBlocks(sizeClass, ptr);
+		return;
+	}
+	if(cache.state == THREAD_CACHE_INACTIVE) {
+		activateThreadCache(cache);
+	}
+	*(void**)ptr = cache.freeLists[sizeClass];
+	cache.freeLists[sizeClass] = ptr;
+	cache.numFree[sizeClass]++;
+}
+
+void SizeClassAllocator::free(void* ptr, uint32 sizeClass)
+{
+	ThreadCache& cache = threadCache;
+	if(cache.state != THREAD_CACHE_ACTIVE) {
+		freeUncached(ptr, sizeClass);
+		return;
+	}
+	*(void**)ptr = cache.freeLists[sizeClass];
+	cache.freeLists[sizeClass] = ptr;
+	if(++cache.numFree[sizeClass] <= 2 * batchSizes[sizeClass]) {
+		return;
+	}
+
+	// Hand a batch back, keeping the most recently freed blocks
+	uint32 batchSize = batchSizes[sizeClass];
+	void* last = ptr;
+	for(uint32 i = 1; i < cache.numFree[sizeClass] - batchSize; i++) {
+		last = *(void**)last;
+	}
+	void* returned = *(void**)last;
+	*(void**)last = nullptr;
+	cache.numFree[sizeClass] -= batchSize;
+	returnBlocks(sizeClass, returned);
+}
+
+bool SizeClassAllocator::owns(const void* ptr)
+{
+	uintptr index = (uintptr)ptr >> SLAB_SHIFT;
+	uintptr root = index >> PAGE_MAP_LEAF_BITS;
+	if(root >= PAGE_MAP_ROOT_SIZE) {
+		return false;
+	}
+	std::atomic<uint64>* leaf = pageMap[root].load(std::memory_order_acquire);
+	if(leaf == nullptr) {
+		return false;
+	}
+	uintptr bit = index & ((1 << PAGE_MAP_LEAF_BITS) - 1);
+	return (leaf[bit >> 6].load(std::memory_order_relaxed) >> (bit & 63)) & 1;
+}
+
+uint32 SizeClassAllocator::getSizeClassOf(const void* ptr)
+{
+	assertCheck(owns(ptr));
+	return getSlab(ptr)->sizeClass;
+}
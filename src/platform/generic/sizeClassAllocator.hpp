@@ -0,0 +1,61 @@
+#pragma once
+
+#include "core/common.hpp"
+#include "math/math.hpp"
+
+/**
+ * Allocator for small blocks, used by GenericMemory for everything up to
+ * MAX_SIZE bytes.
+ *
+ * Sizes are rounded up to one of a fixed set of size classes, and each
+ * class carves its blocks out of 64KB slabs. A block's size class is kept
+ * once in its slab's header rather than in a header per block. Each thread
+ * caches free blocks of every class, so most allocations and frees take no
+ * lock; the caches trade blocks with the shared slabs in batches.
+ */
+struct SizeClassAllocator
+{
+	enum
+	{
+		MAX_SIZE = 1024,
+		NUM_SIZE_CLASSES = 20,
+		// Blocks of every class are aligned to this. Power of 2 classes are
+		// also aligned to their own size.
+		MIN_ALIGNMENT = 16,
+		SLAB_SIZE = 64 * 1024
+	};
+
+	/**
+	 * Returns the class for blocks of amt bytes at alignment, or
+	 * NUM_SIZE_CLASSES if the block is too large for the allocator.
+	 */
+	static FORCEINLINE uint32 getSizeClass(uintptr amt, uintptr alignment)
+	{
+		if(amt > MAX_SIZE) {
+			return NUM_SIZE_CLASSES;
+		}
+		if(alignment > MIN_ALIGNMENT) {
+			// Only the power of 2 classes guarantee larger alignments
+			if(alignment > MAX_SIZE) {
+				return NUM_SIZE_CLASSES;
+			}
+			amt = amt < alignment ? alignment : Math::roundUpToNextPowerOf2((uint32)amt);
+		}
+		return sizeClassesBy16Bytes[(amt + 15) >> 4];
+	}
+
+	static FORCEINLINE uintptr getBlockSize(uint32 sizeClass)
+	{
+		return blockSizes[sizeClass];
+	}
+
+	static void* allocate(uint32 sizeClass);
+	static void free(void* ptr, uint32 sizeClass);
+	/** Returns whether ptr is a block from this allocator. */
+	static bool owns(const void* ptr);
+	/** Size class of a block, which must be owned by this allocator. */
+	static uint32 getSizeClassOf(const void* ptr);
+private:
+	static const uint32 blockSizes[NUM_SIZE_CLASSES];
+	static const uint8 sizeClassesBy16Bytes[MAX_SIZE/16 + 1];
+};
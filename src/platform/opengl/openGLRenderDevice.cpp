@@ -10,7 +10,12 @@ static void addAllAttributes(GLuint program, const String& vertexShaderText, uin
 static bool checkShaderError(GLuint shader, int flag,
 		bool isProgram, const String& errorMessage);
 static void addShaderUniforms(GLuint shaderProgram, const String& shaderText,
-		Map<String, GLint>& uniformMap, Map<String, GLint>& samplerMap);
+		Map<String, GLint>& uniformMap, Map<String, GLint>& samplerMap,
+		FrameArena& arena);
+static void setVertexAttribPointer(GLuint attribute, GLint size, GLenum type,
+		GLsizei stride, const GLvoid* offset);
+static uint32 setElementAttribPointers(uint32 attribute, uint32 elementSize,
+		GLenum type, uintptr offset, bool isInstanced);
 
 bool OpenGLRenderDevice::isInitialized = false;
 
@@ -47,10 +52,14 @@ bool OpenGLRenderDevice::globalInit()
 
 OpenGLRenderDevice::OpenGLRenderDevice(Window& window) :
 	shaderVersion(""), version(0),
+	uniformBufferOffsetAlignment(256),
+	lastFence(0),
+	lastDrawParamsState(0),
 	boundFBO(0),
 	viewportFBO(0),
 	boundVAO(0),
 	boundShader(0),
+	boundPipelineState(0),
 	currentFaceCulling(FACE_CULL_NONE),
 	currentDepthFunc(DRAW_FUNC_ALWAYS),
 	currentSourceBlend(BLEND_FUNC_NONE),
@@ -67,6 +76,7 @@ OpenGLRenderDevice::OpenGLRenderDevice(Window& window) :
 	stencilTestEnabled(false),
 	scissorTestEnabled(false)
 {
+	MemoryTagScope memoryTag(MEMORY_TAG_RENDER_DEVICE);
 	context = SDL_GL_CreateContext(window.getWindowHandle());
 	glewExperimental = GL_TRUE;
 	GLenum res = glewInit();
@@ -80,6 +90,10 @@ OpenGLRenderDevice::OpenGLRenderDevice(Window& window) :
 	fboWindowData.height = window.getHeight();
 	fboMap[0] = fboWindowData;
 
+	GLint offsetAlignment;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+	uniformBufferOffsetAlignment = (uintptr)offsetAlignment;
+
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(DRAW_FUNC_ALWAYS);
 	glDepthMask(GL_FALSE);
@@ -107,6 +121,8 @@ void OpenGLRenderDevice::clear(uint32 fbo, bool shouldClearColor, bool shouldCle
 	if(shouldClearStencil) {
 		flags |= GL_STENCIL_BUFFER_BIT;
 		setStencilWriteMask(stencil);
+		// The bound pipeline state's write mask may no longer be set
+		boundPipelineState = 0;
 	}
 
 	glClear(flags);
@@ -121,7 +137,7 @@ void OpenGLRenderDevice::clear(uint32 fbo, bool shouldClearColor, bool shouldCle
  * + Ensure appropriate scissor rect, if any
  * + Ensure appropriate polygon and culling modes
  * + Ensure appropriate depth modes
- * - Ensure appropriate stencil modes
+ * + Ensure appropriate stencil modes
  * + Ensure appropriate shader programs are bound
  * = Update appropriate uniform buffers
  * = Bind appropriate textures/samplers
@@ -136,28 +152,133 @@ void OpenGLRenderDevice::draw(uint32 fbo, uint32 shader, uint32 vao,
 		const DrawParams& drawParams,
 		uint32 numInstances, uint32 numElements)
 {
+	if(lastDrawParamsState == 0 || !areDrawParamsEqual(drawParams, lastDrawParams)) {
+		lastDrawParams = drawParams;
+		lastDrawParamsState = getPipelineState(drawParams);
+	}
+	draw(fbo, shader, vao, lastDrawParamsState, numInstances, numElements);
+}
+
+void OpenGLRenderDevice::draw(uint32 fbo, uint32 shader, uint32 vao,
+		uint32 pipelineState, uint32 numInstances, uint32 numElements)
+{
+	assertCheck(pipelineState != 0 && pipelineState <= pipelineStates.size());
 	if(numInstances == 0) {
 		return;
 	}
 	setFBO(fbo);
 	setViewport(fbo);
-	setBlending(drawParams.sourceBlend, drawParams.destBlend);
-	setScissorTest(drawParams.useScissorTest,
-			drawParams.scissorStartX, drawParams.scissorStartY,
-			drawParams.scissorWidth, drawParams.scissorHeight);
-	setFaceCulling(drawParams.faceCulling);
-	setDepthTest(drawParams.shouldWriteDepth, drawParams.depthFunc);
+	setPipelineState(pipelineState);
 	setShader(shader);
 	setVAO(vao);
 
+	enum PrimitiveType primitiveType = pipelineStates[pipelineState-1].params.primitiveType;
 	if(numInstances == 1) {
-		glDrawElements(drawParams.primitiveType, (GLsizei)numElements, GL_UNSIGNED_INT, 0);
+		glDrawElements(primitiveType, (GLsizei)numElements, GL_UNSIGNED_INT, 0);
 	} else {
-		glDrawElementsInstanced(drawParams.primitiveType, (GLsizei)numElements, GL_UNSIGNED_INT, 0,
+		glDrawElementsInstanced(primitiveType, (GLsizei)numElements, GL_UNSIGNED_INT, 0,
 				numInstances);
 	}
 }
 
+// Disabled groups get the same key whatever their other fields hold, so
+// they share an id and switching between them changes nothing.
+void OpenGLRenderDevice::getPipelineGroupKey(const DrawParams& params,
+		enum PipelineStateGroup group, Array<uint32>& key)
+{
+	key.clear();
+	switch(group) {
+	case PIPELINE_GROUP_BLEND:
+		if(params.sourceBlend != BLEND_FUNC_NONE
+				&& params.destBlend != BLEND_FUNC_NONE) {
+			key.push_back(params.sourceBlend);
+			key.push_back(params.destBlend);
+		}
+		break;
+	case PIPELINE_GROUP_SCISSOR:
+		if(params.useScissorTest) {
+			key.push_back(params.scissorStartX);
+			key.push_back(params.scissorStartY);
+			key.push_back(params.scissorWidth);
+			key.push_back(params.scissorHeight);
+		}
+		break;
+	case PIPELINE_GROUP_FACE_CULLING:
+		key.push_back(params.faceCulling);
+		break;
+	case PIPELINE_GROUP_DEPTH:
+		key.push_back(params.shouldWriteDepth);
+		key.push_back(params.depthFunc);
+		break;
+	case PIPELINE_GROUP_STENCIL:
+		if(params.useStencilTest) {
+			key.push_back(params.stencilFunc);
+			key.push_back(params.stencilTestMask);
+			key.push_back(params.stencilWriteMask);
+			key.push_back((uint32)params.stencilComparisonVal);
+			key.push_back(params.stencilFail);
+			key.push_back(params.stencilPassButDepthFail);
+			key.push_back(params.stencilPass);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+bool OpenGLRenderDevice::areDrawParamsEqual(const DrawParams& a, const DrawParams& b)
+{
+	// Compared by field, as the padding after the bools is never written
+	return a.primitiveType == b.primitiveType
+		&& a.faceCulling == b.faceCulling
+		&& a.depthFunc == b.depthFunc
+		&& a.shouldWriteDepth == b.shouldWriteDepth
+		&& a.useStencilTest == b.useStencilTest
+		&& a.stencilFunc == b.stencilFunc
+		&& a.stencilTestMask == b.stencilTestMask
+		&& a.stencilWriteMask == b.stencilWriteMask
+		&& a.stencilComparisonVal == b.stencilComparisonVal
+		&& a.stencilFail == b.stencilFail
+		&& a.stencilPassButDepthFail == b.stencilPassButDepthFail
+		&& a.stencilPass == b.stencilPass
+		&& a.useScissorTest == b.useScissorTest
+		&& a.scissorStartX == b.scissorStartX
+		&& a.scissorStartY == b.scissorStartY
+		&& a.scissorWidth == b.scissorWidth
+		&& a.scissorHeight == b.scissorHeight
+		&& a.sourceBlend == b.sourceBlend
+		&& a.destBlend == b.destBlend;
+}
+
+uint32 OpenGLRenderDevice::getPipelineState(const DrawParams& drawParams)
+{
+	PipelineState state;
+	state.params = drawParams;
+	Array<uint32>& stateKey = pipelineStateKey;
+	Array<uint32>& groupKey = pipelineGroupKey;
+	stateKey.clear();
+	for(uint32 i = 0; i < NUM_PIPELINE_GROUPS; i++) {
+		getPipelineGroupKey(drawParams, (enum PipelineStateGroup)i, groupKey);
+		Map<Array<uint32>, uint32>::iterator it = pipelineGroupMaps[i].find(groupKey);
+		if(it == pipelineGroupMaps[i].end()) {
+			uint32 groupId = pipelineGroupMaps[i].size();
+			it = pipelineGroupMaps[i].insert(std::make_pair(groupKey, groupId)).first;
+		}
+		state.groupIds[i] = it->second;
+		stateKey.push_back(it->second);
+	}
+	stateKey.push_back(drawParams.primitiveType);
+
+	Map<Array<uint32>, uint32>::iterator it = pipelineStateMap.find(stateKey);
+	if(it != pipelineStateMap.end()) {
+		return it->second;
+	}
+	pipelineStates.push_back(state);
+	uint32 pipelineState = pipelineStates.size();
+	pipelineStateMap[stateKey] = pipelineState;
+	return pipelineState;
+}
+
 void OpenGLRenderDevice::setFBO(uint32 fbo)
 {
 	if(fbo == boundFBO) {
@@ -190,6 +311,57 @@ void OpenGLRenderDevice::setShader(uint32 shader)
 	boundShader = shader;
 }
 
+void OpenGLRenderDevice::setPipelineState(uint32 pipelineState)
+{
+	if(pipelineState == boundPipelineState) {
+		return;
+	}
+	assertCheck(pipelineState != 0 && pipelineState <= pipelineStates.size());
+	const PipelineState& state = pipelineStates[pipelineState-1];
+	if(boundPipelineState == 0) {
+		for(uint32 i = 0; i < NUM_PIPELINE_GROUPS; i++) {
+			setPipelineStateGroup(state.params, (enum PipelineStateGroup)i);
+		}
+	} else {
+		const PipelineState& bound = pipelineStates[boundPipelineState-1];
+		for(uint32 i = 0; i < NUM_PIPELINE_GROUPS; i++) {
+			if(state.groupIds[i] != bound.groupIds[i]) {
+				setPipelineStateGroup(state.params, (enum PipelineStateGroup)i);
+			}
+		}
+	}
+	boundPipelineState = pipelineState;
+}
+
+void OpenGLRenderDevice::setPipelineStateGroup(const DrawParams& params,
+		enum PipelineStateGroup group)
+{
+	switch(group) {
+	case PIPELINE_GROUP_BLEND:
+		setBlending(params.sourceBlend, params.destBlend);
+		break;
+	case PIPELINE_GROUP_SCISSOR:
+		setScissorTest(params.useScissorTest,
+				params.scissorStartX, params.scissorStartY,
+				params.scissorWidth, params.scissorHeight);
+		break;
+	case PIPELINE_GROUP_FACE_CULLING:
+		setFaceCulling(params.faceCulling);
+		break;
+	case PIPELINE_GROUP_DEPTH:
+		setDepthTest(params.shouldWriteDepth, params.depthFunc);
+		break;
+	case PIPELINE_GROUP_STENCIL:
+		setStencilTest(params.useStencilTest, params.stencilFunc,
+				params.stencilTestMask, params.stencilWriteMask,
+				params.stencilComparisonVal, params.stencilFail,
+				params.stencilPassButDepthFail, params.stencilPass);
+		break;
+	default:
+		break;
+	}
+}
+
 void OpenGLRenderDevice::setVAO(uint32 vao)
 {
 	if(vao == boundVAO) {
@@ -280,10 +452,13 @@ void OpenGLRenderDevice::setStencilTest(bool enable, enum DrawFunc stencilFunc,
 		}
 		stencilTestEnabled = enable;
 	}
+	if(!enable) {
+		return;
+	}
 
 	if(stencilFunc != currentStencilFunc || stencilTestMask != currentStencilTestMask
 			|| stencilComparisonVal != currentStencilComparisonVal) {
-		glStencilFunc(stencilFunc, stencilTestMask, stencilComparisonVal);
+		glStencilFunc(stencilFunc, stencilComparisonVal, stencilTestMask);
 		currentStencilComparisonVal = stencilComparisonVal;
 		currentStencilTestMask = stencilTestMask;
 		currentStencilFunc = stencilFunc;
@@ -348,7 +523,8 @@ uint32 OpenGLRenderDevice::releaseRenderTarget(uint32 fbo)
 }
 
 uint32 OpenGLRenderDevice::createVertexArray(const float** vertexData,
-		const uint32* vertexElementSizes, uint32 numVertexComponents,
+		const uint32* vertexElementSizes,
+		const enum VertexElementType* vertexElementTypes, uint32 numVertexComponents,
 		uint32 numInstanceComponents, uint32 numVertices, const uint32* indices,
 		uint32 numIndices, enum BufferUsage usage)
 {
@@ -357,6 +533,7 @@ uint32 OpenGLRenderDevice::createVertexArray(const float** vertexData,
 	GLuint VAO;
 	GLuint* buffers = new GLuint[numBuffers];
 	uintptr* bufferSizes = new uintptr[numBuffers];
+	struct VertexElementLayout* elementLayouts = new VertexElementLayout[numBuffers-1];
 
 	glGenVertexArrays(1, &VAO);
 	setVAO(VAO);
@@ -371,6 +548,7 @@ uint32 OpenGLRenderDevice::createVertexArray(const float** vertexData,
 		}
 
 		uint32 elementSize = vertexElementSizes[i];
+		enum VertexElementType elementType = vertexElementTypes[i];
 		const void* bufferData = inInstancedMode ? nullptr : vertexData[i];
 		uintptr dataSize = inInstancedMode
 			? elementSize * sizeof(float)
@@ -380,30 +558,11 @@ uint32 OpenGLRenderDevice::createVertexArray(const float** vertexData,
 		glBufferData(GL_ARRAY_BUFFER, dataSize, bufferData, attribUsage);
 		bufferSizes[i] = dataSize;
 
-		// Because OpenGL doesn't support attributes with more than 4
-		// elements, each set of 4 elements gets its own attribute.
-		uint32 elementSizeDiv = elementSize/4;
-		uint32 elementSizeRem = elementSize%4;
-		for(uint32 j = 0; j < elementSizeDiv; j++) {
-			glEnableVertexAttribArray(attribute);
-			glVertexAttribPointer(attribute, 4, GL_FLOAT, GL_FALSE,
-					elementSize * sizeof(GLfloat),
-					(const GLvoid*)(sizeof(GLfloat) * j * 4));
-			if(inInstancedMode) {
-				glVertexAttribDivisor(attribute, 1);
-			}
-			attribute++;
-		}
-		if(elementSizeRem != 0) {
-			glEnableVertexAttribArray(attribute);
-			glVertexAttribPointer(attribute, elementSize, GL_FLOAT, GL_FALSE,
-					elementSize * sizeof(GLfloat),
-					(const GLvoid*)(sizeof(GLfloat) * elementSizeDiv * 4));
-			if(inInstancedMode) {
-				glVertexAttribDivisor(attribute, 1);
-			}
-			attribute++;
-		}
+		elementLayouts[i].attribute = attribute;
+		elementLayouts[i].elementSize = elementSize;
+		elementLayouts[i].elementType = elementType;
+		attribute = setElementAttribPointers(attribute, elementSize, elementType, 0,
+				inInstancedMode);
 	}
 
 	uintptr indicesSize = numIndices * sizeof(uint32);
@@ -415,6 +574,7 @@ uint32 OpenGLRenderDevice::createVertexArray(const float** vertexData,
 	struct VertexArray vaoData;
 	vaoData.buffers = buffers;
 	vaoData.bufferSizes = bufferSizes;
+	vaoData.elementLayouts = elementLayouts;
 	vaoData.numBuffers = numBuffers;
 	vaoData.numElements = numIndices;
 	vaoData.usage = usage;
@@ -452,6 +612,140 @@ void OpenGLRenderDevice::updateVertexArrayBuffer(uint32 vao, uint32 bufferIndex,
 	}	
 }
 
+void OpenGLRenderDevice::updateVertexArrayBufferRange(uint32 vao, uint32 bufferIndex,
+			uintptr offset, const void* data, uintptr dataSize)
+{
+	if(vao == 0) {
+		return;
+	}
+
+	Map<uint32, VertexArray>::iterator it = vaoMap.find(vao);
+	if(it == vaoMap.end()) {
+		return;
+	}
+	const struct VertexArray* vaoData = &it->second;
+	assertCheck(offset + dataSize <= vaoData->bufferSizes[bufferIndex]);
+
+	setVAO(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vaoData->buffers[bufferIndex]);
+	glBufferSubData(GL_ARRAY_BUFFER, offset, dataSize, data);
+}
+
+void OpenGLRenderDevice::setVertexArrayBufferSource(uint32 vao, uint32 bufferIndex,
+		uint32 buffer, uintptr offset)
+{
+	Map<uint32, VertexArray>::iterator it = vaoMap.find(vao);
+	if(it == vaoMap.end()) {
+		return;
+	}
+	const struct VertexArray* vaoData = &it->second;
+	assertCheck(bufferIndex < vaoData->numBuffers-1);
+	const struct VertexElementLayout& layout = vaoData->elementLayouts[bufferIndex];
+
+	setVAO(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer == 0 ? vaoData->buffers[bufferIndex] : buffer);
+	setElementAttribPointers(layout.attribute, layout.elementSize, layout.elementType,
+			buffer == 0 ? 0 : offset,
+			bufferIndex >= vaoData->instanceComponentsStartIndex);
+}
+
+uint32 OpenGLRenderDevice::createStreamBuffer(uintptr dataSize, void** mappedData)
+{
+	GLuint buffer;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	*mappedData = nullptr;
+	if(!GLEW_ARB_buffer_storage) {
+		glBufferData(GL_ARRAY_BUFFER, dataSize, nullptr, USAGE_STREAM_DRAW);
+		return buffer;
+	}
+
+	// Coherent, so writes reach the GPU without explicit flushes. Reuse is
+	// guarded by fences instead.
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glBufferStorage(GL_ARRAY_BUFFER, dataSize, nullptr, flags);
+	*mappedData = glMapBufferRange(GL_ARRAY_BUFFER, 0, dataSize, flags);
+	if(*mappedData == nullptr) {
+		DEBUG_LOG(LOG_TYPE_RENDERER, LOG_WARNING,
+				"Could not map stream buffer persistently, falling back to orphaning");
+		glDeleteBuffers(1, &buffer);
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, buffer);
+		glBufferData(GL_ARRAY_BUFFER, dataSize, nullptr, USAGE_STREAM_DRAW);
+	}
+	return buffer;
+}
+
+void OpenGLRenderDevice::orphanStreamBuffer(uint32 buffer, uintptr dataSize)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, dataSize, nullptr, USAGE_STREAM_DRAW);
+}
+
+void OpenGLRenderDevice::updateStreamBuffer(uint32 buffer, uintptr offset,
+		const void* data, uintptr dataSize)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferSubData(GL_ARRAY_BUFFER, offset, dataSize, data);
+}
+
+uint32 OpenGLRenderDevice::releaseStreamBuffer(uint32 buffer)
+{
+	if(buffer == 0) {
+		return 0;
+	}
+	// Deleting a buffer also unmaps it
+	glDeleteBuffers(1, &buffer);
+	return 0;
+}
+
+uint32 OpenGLRenderDevice::createFence()
+{
+	uint32 fence = ++lastFence;
+	fenceMap[fence] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	return fence;
+}
+
+void OpenGLRenderDevice::waitFence(uint32 fence)
+{
+	Map<uint32, GLsync>::iterator it = fenceMap.find(fence);
+	if(it == fenceMap.end()) {
+		return;
+	}
+	// The first wait flushes, so the fence is certain to be signaled
+	// eventually; after that, keep waiting a millisecond at a time.
+	GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+	while(true) {
+		GLenum result = glClientWaitSync(it->second, flags, 1000000);
+		if(result != GL_TIMEOUT_EXPIRED) {
+			break;
+		}
+		flags = 0;
+	}
+	glDeleteSync(it->second);
+	fenceMap.erase(it);
+}
+
+bool OpenGLRenderDevice::isFenceSignaled(uint32 fence)
+{
+	Map<uint32, GLsync>::iterator it = fenceMap.find(fence);
+	if(it == fenceMap.end()) {
+		return true;
+	}
+	GLenum result = glClientWaitSync(it->second, 0, 0);
+	return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
+uint32 OpenGLRenderDevice::releaseFence(uint32 fence)
+{
+	Map<uint32, GLsync>::iterator it = fenceMap.find(fence);
+	if(it != fenceMap.end()) {
+		glDeleteSync(it->second);
+		fenceMap.erase(it);
+	}
+	return 0;
+}
+
 uint32 OpenGLRenderDevice::releaseVertexArray(uint32 vao)
 {
 	if(vao == 0) {
@@ -467,6 +761,7 @@ uint32 OpenGLRenderDevice::releaseVertexArray(uint32 vao)
 	glDeleteBuffers(vaoData->numBuffers, vaoData->buffers);
 	delete[] vaoData->buffers;
 	delete[] vaoData->bufferSizes;
+	delete[] vaoData->elementLayouts;
 	vaoMap.erase(it);
 	return 0;
 }
@@ -635,10 +930,10 @@ uint32 OpenGLRenderDevice::createUniformBuffer(const void* data, uintptr dataSiz
 
 void OpenGLRenderDevice::updateUniformBuffer(uint32 buffer, const void* data, uintptr dataSize)
 {
+	// Mapping costs a driver round trip per update, which dominates for the
+	// small blocks uniform buffers hold.
 	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
-	void* dest = glMapBuffer(GL_UNIFORM_BUFFER, GL_WRITE_ONLY);
-	Memory::memcpy(dest, data, dataSize);
-	glUnmapBuffer(GL_UNIFORM_BUFFER);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, dataSize, data);
 }
 
 uint32 OpenGLRenderDevice::releaseUniformBuffer(uint32 buffer)
@@ -652,6 +947,7 @@ uint32 OpenGLRenderDevice::releaseUniformBuffer(uint32 buffer)
 
 uint32 OpenGLRenderDevice::createShaderProgram(const String& shaderText)
 {
+	MemoryTagScope memoryTag(MEMORY_TAG_SHADERS);
 	GLuint shaderProgram = glCreateProgram();
 
 	if(shaderProgram == 0) 
@@ -690,7 +986,7 @@ uint32 OpenGLRenderDevice::createShaderProgram(const String& shaderText)
 
 	addAllAttributes(shaderProgram, vertexShaderText, getVersion());
 	addShaderUniforms(shaderProgram, shaderText, programData.uniformMap,
-			programData.samplerMap);
+			programData.samplerMap, frameArena);
 
 	shaderProgramMap[shaderProgram] = programData;
 	return shaderProgram;
@@ -705,6 +1001,16 @@ void OpenGLRenderDevice::setShaderUniformBuffer(uint32 shader, const String& uni
 			buffer);
 }
 
+void OpenGLRenderDevice::setShaderUniformBufferRange(uint32 shader,
+		const String& uniformBufferName, uint32 buffer, uintptr offset, uintptr dataSize)
+{
+	assertCheck(offset % uniformBufferOffsetAlignment == 0);
+	setShader(shader);
+	glBindBufferRange(GL_UNIFORM_BUFFER,
+			shaderProgramMap[shader].uniformMap[uniformBufferName],
+			buffer, offset, dataSize);
+}
+
 void OpenGLRenderDevice::setShaderSampler(uint32 shader, const String& samplerName,
 		uint32 texture, uint32 sampler, uint32 unit)
 {
@@ -885,7 +1191,8 @@ static void addAllAttributes(GLuint program, const String& vertexShaderText, uin
 }
 
 static void addShaderUniforms(GLuint shaderProgram, const String& shaderText,
-		Map<String, GLint>& uniformMap, Map<String, GLint>& samplerMap)
+		Map<String, GLint>& uniformMap, Map<String, GLint>& samplerMap,
+		FrameArena& arena)
 {
 	GLint numBlocks;
 	glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORM_BLOCKS, &numBlocks);
@@ -894,7 +1201,7 @@ static void addShaderUniforms(GLuint shaderProgram, const String& shaderText,
 		glGetActiveUniformBlockiv(shaderProgram, block,
 				GL_UNIFORM_BLOCK_NAME_LENGTH, &nameLen);
 
-		Array<GLchar> name(nameLen);
+		Array<GLchar, FrameArena> name(nameLen, 0, arena);
 		glGetActiveUniformBlockName(shaderProgram, block, nameLen, NULL, &name[0]);
 		String uniformBlockName((char*)&name[0], nameLen-1);
 		uniformMap[uniformBlockName] = glGetUniformBlockIndex(shaderProgram, &name[0]);
@@ -904,7 +1211,7 @@ static void addShaderUniforms(GLuint shaderProgram, const String& shaderText,
 	glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORMS, &numBlocks);
 	
 	// Would get GL_ACTIVE_UNIFORM_MAX_LENGTH, but buggy on some drivers
-	Array<GLchar> uniformName(256); 
+	Array<GLchar, FrameArena> uniformName(256, 0, arena);
 	for(int32 uniform = 0; uniform < numUniforms; ++uniform) {
 		GLint arraySize = 0;
 		GLenum type = 0;
@@ -921,3 +1228,41 @@ static void addShaderUniforms(GLuint shaderProgram, const String& shaderText,
 	}
 }
 
+static void setVertexAttribPointer(GLuint attribute, GLint size, GLenum type,
+		GLsizei stride, const GLvoid* offset)
+{
+	glEnableVertexAttribArray(attribute);
+	if(type == GL_FLOAT) {
+		glVertexAttribPointer(attribute, size, type, GL_FALSE, stride, offset);
+	} else {
+		// Integer attributes must not be converted to float on the way in
+		glVertexAttribIPointer(attribute, size, type, stride, offset);
+	}
+}
+
+// Because OpenGL doesn't support attributes with more than 4 elements, each
+// set of 4 elements gets its own attribute. Returns the next free attribute.
+static uint32 setElementAttribPointers(uint32 attribute, uint32 elementSize,
+		GLenum type, uintptr offset, bool isInstanced)
+{
+	uint32 elementSizeDiv = elementSize/4;
+	uint32 elementSizeRem = elementSize%4;
+	for(uint32 j = 0; j < elementSizeDiv; j++) {
+		setVertexAttribPointer(attribute, 4, type, elementSize * sizeof(GLfloat),
+				(const GLvoid*)(offset + sizeof(GLfloat) * j * 4));
+		if(isInstanced) {
+			glVertexAttribDivisor(attribute, 1);
+		}
+		attribute++;
+	}
+	if(elementSizeRem != 0) {
+		setVertexAttribPointer(attribute, elementSizeRem, type,
+				elementSize * sizeof(GLfloat),
+				(const GLvoid*)(offset + sizeof(GLfloat) * elementSizeDiv * 4));
+		if(isInstanced) {
+			glVertexAttribDivisor(attribute, 1);
+		}
+		attribute++;
+	}
+	return attribute;
+}
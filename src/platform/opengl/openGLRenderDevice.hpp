@@ -3,6 +3,7 @@
 #include "core/window.hpp"
 #include "math/color.hpp"
 #include "dataStructures/map.hpp"
+#include "core/frameArena.hpp"
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
 
@@ -38,6 +39,14 @@ public:
 		USAGE_DYNAMIC_READ = GL_DYNAMIC_READ,
 	};
 
+	// Vertex array elements are always made of 4-byte components. Integer
+	// components reach the shader unconverted, for bit-packed data.
+	enum VertexElementType
+	{
+		ELEMENT_TYPE_FLOAT = GL_FLOAT,
+		ELEMENT_TYPE_UINT = GL_UNSIGNED_INT,
+	};
+
 	enum SamplerFilter
 	{
 		FILTER_NEAREST = GL_NEAREST,
@@ -164,13 +173,43 @@ public:
 	uint32 releaseRenderTarget(uint32 fbo);
 
 	uint32 createVertexArray(const float** vertexData, const uint32* vertexElementSizes,
-			uint32 numVertexComponents, uint32 numInstanceComponents,
+			const enum VertexElementType* vertexElementTypes, uint32 numVertexComponents, uint32 numInstanceComponents,
 			uint32 numVertices, const uint32* indices,
 			uint32 numIndices, enum BufferUsage usage);
 	void updateVertexArrayBuffer(uint32 vao, uint32 bufferIndex,
 			const void* data, uintptr dataSize);
+	/** Overwrites part of a buffer, which must already hold offset + dataSize bytes. */
+	void updateVertexArrayBufferRange(uint32 vao, uint32 bufferIndex, uintptr offset,
+			const void* data, uintptr dataSize);
+	/**
+	 * Makes the element at bufferIndex read from offset in another buffer,
+	 * such as a stream buffer. A buffer of 0 switches back to its own.
+	 */
+	void setVertexArrayBufferSource(uint32 vao, uint32 bufferIndex, uint32 buffer,
+			uintptr offset);
 	uint32 releaseVertexArray(uint32 vao);
 
+	/**
+	 * Creates a buffer for data rewritten every frame. If persistent mapping
+	 * is supported, mappedData is set to memory that stays mapped for the
+	 * life of the buffer; otherwise it is set to nullptr, and the buffer has
+	 * to be written with updateStreamBuffer.
+	 */
+	uint32 createStreamBuffer(uintptr dataSize, void** mappedData);
+	/** Gives the buffer new storage, so writes need not wait for the GPU. */
+	void orphanStreamBuffer(uint32 buffer, uintptr dataSize);
+	void updateStreamBuffer(uint32 buffer, uintptr offset, const void* data,
+			uintptr dataSize);
+	uint32 releaseStreamBuffer(uint32 buffer);
+
+	/** Fence signaled once the GPU finishes all commands issued so far. */
+	uint32 createFence();
+	/** Blocks until fence is signaled, then releases it. */
+	void waitFence(uint32 fence);
+	/** Whether fence is signaled, without waiting. The fence is kept. */
+	bool isFenceSignaled(uint32 fence);
+	uint32 releaseFence(uint32 fence);
+
 	uint32 createSampler(enum SamplerFilter minFilter, enum SamplerFilter magFilter,
 			enum SamplerWrapMode wrapU, enum SamplerWrapMode wrapV, float anisotropy);
 	uint32 releaseSampler(uint32 sampler);
@@ -185,10 +224,24 @@ public:
 	uint32 createUniformBuffer(const void* data, uintptr dataSize, enum BufferUsage usage);
 	void updateUniformBuffer(uint32 buffer, const void* data, uintptr dataSize);
 	uint32 releaseUniformBuffer(uint32 buffer);
+	/** Offsets passed to setShaderUniformBufferRange must be a multiple of this. */
+	FORCEINLINE uintptr getUniformBufferOffsetAlignment() const
+	{
+		return uniformBufferOffsetAlignment;
+	}
+
+	/**
+	 * Scratch memory for temporaries, which the application releases by
+	 * calling endFrame on it once per frame.
+	 */
+	FORCEINLINE FrameArena& getFrameArena() { return frameArena; }
 
 	uint32 createShaderProgram(const String& shaderText);
 	void setShaderUniformBuffer(uint32 shader, const String& uniformBufferName,
 			uint32 buffer);
+	/** Binds dataSize bytes at offset in buffer, which can be a stream buffer. */
+	void setShaderUniformBufferRange(uint32 shader, const String& uniformBufferName,
+			uint32 buffer, uintptr offset, uintptr dataSize);
 	void setShaderSampler(uint32 shader, const String& samplerName,
 		uint32 texture, uint32 sampler, uint32 unit);
 	uint32 releaseShaderProgram(uint32 shader);
@@ -196,13 +249,31 @@ public:
 	void clear(uint32 fbo,
 			bool shouldClearColor, bool shouldClearDepth, bool shouldClearStencil,
 			const Color& color, uint32 stencil);
+	/**
+	 * Returns the pipeline state handle for drawParams, creating it the first
+	 * time those params are seen. Equal params always give the same handle,
+	 * and handles live as long as the device.
+	 */
+	uint32 getPipelineState(const DrawParams& drawParams);
+
+	/** Looks up the pipeline state of drawParams; prefer passing a handle. */
 	void draw(uint32 fbo, uint32 shader, uint32 vao, const DrawParams& drawParams,
 			uint32 numInstances, uint32 numElements);
+	void draw(uint32 fbo, uint32 shader, uint32 vao, uint32 pipelineState,
+			uint32 numInstances, uint32 numElements);
 private:
+	struct VertexElementLayout
+	{
+		uint32 attribute;
+		uint32 elementSize;
+		enum VertexElementType elementType;
+	};
+
 	struct VertexArray
 	{
 		uint32* buffers;
 		uintptr* bufferSizes;
+		struct VertexElementLayout* elementLayouts;
 		uint32  numBuffers;
 		uint32  numElements;
 		uint32  instanceComponentsStartIndex;
@@ -222,18 +293,53 @@ private:
 		int32 height;
 	};
 
+	// Pipeline state is applied in groups of related fields. Each distinct
+	// group value gets an id, so the groups that differ between two states
+	// are found by comparing ids rather than fields.
+	enum PipelineStateGroup
+	{
+		PIPELINE_GROUP_BLEND,
+		PIPELINE_GROUP_SCISSOR,
+		PIPELINE_GROUP_FACE_CULLING,
+		PIPELINE_GROUP_DEPTH,
+		PIPELINE_GROUP_STENCIL,
+		NUM_PIPELINE_GROUPS
+	};
+
+	struct PipelineState
+	{
+		DrawParams params;
+		uint32 groupIds[NUM_PIPELINE_GROUPS];
+	};
+
 	static bool isInitialized;
 	DeviceContext context;
 	String shaderVersion;
 	uint32 version;
+	uintptr uniformBufferOffsetAlignment;
 	Map<uint32, VertexArray> vaoMap;
 	Map<uint32, FBOData> fboMap;
 	Map<uint32, ShaderProgram> shaderProgramMap;
+	Map<uint32, GLsync> fenceMap;
+	uint32 lastFence;
+	FrameArena frameArena;
+	// Handle n is pipelineStates[n-1]; 0 means the GL state is unknown
+	Array<PipelineState> pipelineStates;
+	Map<Array<uint32>, uint32> pipelineStateMap;
+	Map<Array<uint32>, uint32> pipelineGroupMaps[NUM_PIPELINE_GROUPS];
+	// Kept between lookups so they don't allocate once grown
+	Array<uint32> pipelineStateKey;
+	Array<uint32> pipelineGroupKey;
+	// Draws passing DrawParams usually repeat the last ones, which skips
+	// the lookup; 0 until the first such draw
+	DrawParams lastDrawParams;
+	uint32 lastDrawParamsState;
 
 	uint32 boundFBO;
 	uint32 viewportFBO;
 	uint32 boundVAO;
 	uint32 boundShader;
+	uint32 boundPipelineState;
 	enum FaceCulling currentFaceCulling;
 	enum DrawFunc currentDepthFunc;
 	enum BlendFunc currentSourceBlend;
@@ -254,6 +360,11 @@ private:
 	void setViewport(uint32 fbo);
 	void setVAO(uint32 vao);
 	void setShader(uint32 shader);
+	void setPipelineState(uint32 pipelineState);
+	void setPipelineStateGroup(const DrawParams& params, enum PipelineStateGroup group);
+	static void getPipelineGroupKey(const DrawParams& params,
+			enum PipelineStateGroup group, Array<uint32>& key);
+	static bool areDrawParamsEqual(const DrawParams& a, const DrawParams& b);
 	void setFaceCulling(enum FaceCulling faceCulling);
 	void setDepthTest(bool shouldWrite, enum DrawFunc depthFunc);
 	void setBlending(enum BlendFunc sourceBlend, enum BlendFunc destBlend);
@@ -9,3 +9,12 @@
 #include "generic/genericVecmath.hpp"
 	typedef GenericVector PlatformVector;
 #endif
+
+#if SIMD_SUPPORTED_LEVEL >= SIMD_LEVEL_x86_AVX
+#include "avx/avxVecmath.hpp"
+	typedef AVXVector8 PlatformVector8;
+#else
+	struct GenericVector8;
+	typedef GenericVector8 PlatformVector8;
+#include "generic/genericVecmath8.hpp"
+#endif
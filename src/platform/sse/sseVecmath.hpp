@@ -3,6 +3,7 @@
 #include "core/memory.hpp"
 #include "math/math.hpp"
 #include "platform/platformSIMDInclude.hpp"
+#include <limits>
 
 #define SSEVector_SHUFFLEMASK(a0,a1,b2,b3) ((a0) | ((a1)<<2) | ((b2)<<4) | ((b3)<<6))
 #define SSEVector_Swizzle_0101(vec)               _mm_movelh_ps(vec, vec)
@@ -167,6 +168,12 @@ public:
 		mat[3] = make(0.0f, 0.0f, 0.0f, 1.0f);
 	}
 	
+	static FORCEINLINE void transpose4(SSEVector& vec0, SSEVector& vec1,
+			SSEVector& vec2, SSEVector& vec3)
+	{
+		_MM_TRANSPOSE4_PS(vec0.data, vec1.data, vec2.data, vec3.data);
+	}
+
 	static FORCEINLINE SSEVector make(uint32 x, uint32 y, uint32 z, uint32 w)
 	{
 		union { __m128 vecf; __m128i veci; } vecData;
@@ -203,7 +210,12 @@ public:
 
 	static FORCEINLINE SSEVector load3f(const float* vals, float w)
 	{
-		return make(vals[0], vals[1], vals[2], w);
+		// Two loads instead of three, without reading past vals[2]
+		__m128 xy = _mm_castpd_ps(_mm_load_sd((const double*)vals));
+		__m128 zw = _mm_unpacklo_ps(_mm_load_ss(vals + 2), _mm_set_ss(w));
+		SSEVector vec;
+		vec.data = _mm_movelh_ps(xy, zw);
+		return vec;
 	}
 
 	static FORCEINLINE SSEVector load1f(float val)
@@ -237,7 +249,8 @@ public:
 
 	FORCEINLINE void store3f(float* result) const
 	{
-		Memory::memcpy(result, &data, sizeof(float) * 3);
+		_mm_storel_pi((__m64*)result, data);
+		_mm_store_ss(result + 2, _mm_movehl_ps(data, data));
 	}
 
 	FORCEINLINE void store1f(float* result) const
@@ -348,13 +361,177 @@ public:
 		return vec;
 	}
 
+	// Transcendentals use Cephes-style minimax polynomials. Max error
+	// against the correctly rounded result, as measured by
+	// tests/transcendental_tests.cpp:
+	// - sin, cos, sincos: 2 ulp for |x| <= 8192.
+	// - exp: 1 ulp for normal results. Inputs above ~88.72 give inf; below
+	//   ~-103.9 give 0.
+	// - ln: 1 ulp for x > 0, including denormals. 0 gives -inf and negative
+	//   inputs give NaN.
+	// - pow: 0.501 ulp, so all but correctly rounded, including denormal
+	//   bases. Computed as 2^(exp * log2(x)) in double using small
+	//   tables; in float the error would grow with |exp * log2(x)|. A
+	//   negative base gives NaN unless exp is an integer, in which case the
+	//   result is computed on |x| and is negative for odd exp.
 	FORCEINLINE SSEVector pow(const SSEVector& exp) const
 	{
-		return make(
-				Math::pow((*this)[0], exp[0]),
-				Math::pow((*this)[1], exp[1]),
-				Math::pow((*this)[2], exp[2]),
-				Math::pow((*this)[3], exp[3]));
+		// x = 2^k * z with z in [0.7, 1.4), where
+		// log2(x) = k + log2(c) + log2(z/c) for the table entry c nearest z.
+		// Denormals are scaled up by 2^23 first.
+		const __m128 SIGN_MASK = _mm_castsi128_ps(_mm_set1_epi32((int32)0x80000000));
+		__m128 base = _mm_andnot_ps(SIGN_MASK, data);
+		__m128 isDenormal = _mm_cmplt_ps(base, _mm_set1_ps(1.17549435e-38f));
+		__m128 x = _mm_or_ps(_mm_and_ps(isDenormal, _mm_mul_ps(base, _mm_set1_ps(8388608.0f))),
+				_mm_andnot_ps(isDenormal, base));
+		__m128i ix = _mm_sub_epi32(_mm_castps_si128(x),
+				_mm_and_si128(_mm_castps_si128(isDenormal), _mm_set1_epi32(23 << 23)));
+		__m128i tmp = _mm_sub_epi32(ix, _mm_set1_epi32(0x3F330000));
+		__m128i top = _mm_and_si128(tmp, _mm_set1_epi32((int32)0xFF800000));
+		__m128 z = _mm_castsi128_ps(_mm_sub_epi32(ix, top));
+		__m128i k = _mm_srai_epi32(top, 23);
+		int32 indices[4];
+		_mm_storeu_si128((__m128i*)indices,
+				_mm_and_si128(_mm_srli_epi32(tmp, 23 - POW_TABLE_BITS),
+					_mm_set1_epi32(POW_TABLE_SIZE - 1)));
+
+		__m128d lo = exp2Double(_mm_mul_pd(_mm_cvtps_pd(exp.data),
+					log2Double(_mm_cvtps_pd(z), _mm_cvtepi32_pd(k), indices[0], indices[1])));
+		__m128d hi = exp2Double(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(exp.data, exp.data)),
+					log2Double(_mm_cvtps_pd(_mm_movehl_ps(z, z)),
+						_mm_cvtepi32_pd(_mm_shuffle_epi32(k, SSEVector_SHUFFLEMASK(2,3,2,3))),
+						indices[2], indices[3])));
+		SSEVector result;
+		result.data = _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+
+		// Floats of magnitude 2^23 and up are all integers, and only those
+		// below 2^24 can be odd. isOdd holds just the sign bit in odd lanes.
+		__m128i truncated = _mm_cvttps_epi32(exp.data);
+		SSEVector isInteger;
+		isInteger.data = _mm_or_ps(
+				_mm_cmpge_ps(_mm_andnot_ps(SIGN_MASK, exp.data), _mm_set1_ps(8388608.0f)),
+				_mm_cmpeq_ps(_mm_cvtepi32_ps(truncated), exp.data));
+		__m128 isOdd = _mm_and_ps(isInteger.data,
+				_mm_castsi128_ps(_mm_slli_epi32(truncated, 31)));
+
+		// A zero or infinite base gives 0 or inf depending on the exponent's
+		// sign, a negative finite base with a non-integer exponent gives NaN,
+		// and a zero exponent gives 1 for any base. A base of magnitude 1 is
+		// exactly 1 in magnitude, since log2(1) from the tables is not quite
+		// 0. Negative bases with odd exponents then take the base's sign.
+		const SSEVector zero(SSEVector::load1f(0.0f));
+		const SSEVector nan(SSEVector::load1f(std::numeric_limits<float>::quiet_NaN()));
+		const SSEVector inf(SSEVector::load1f(std::numeric_limits<float>::infinity()));
+		SSEVector absBase;
+		absBase.data = base;
+		result = result.select(absBase < inf, zero.select(exp < zero, inf));
+		result = result.select((*this >= zero) | isInteger | (absBase == inf), nan);
+		result = result.select(*this == *this, nan);
+		result = zero.select(exp > zero, inf).select(*this == zero, result);
+		result = SSEVector::load1f(1.0f).select(absBase == SSEVector::load1f(1.0f), result);
+		result.data = _mm_xor_ps(result.data, _mm_and_ps(isOdd, data));
+		result = result.select(exp == exp, nan);
+		return SSEVector::load1f(1.0f).select(exp == zero, result);
+	}
+
+	FORCEINLINE SSEVector exp() const
+	{
+		// e^x = 2^n * e^r, with n = round(x/ln(2)) and |r| <= ln(2)/2. ln(2)
+		// is split in two so r keeps full precision.
+		const __m128 ONE = _mm_set1_ps(1.0f);
+		__m128 x = _mm_min_ps(_mm_set1_ps(88.8f), data);
+		x = _mm_max_ps(_mm_set1_ps(-104.0f), x);
+
+		__m128 fn = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)),
+				_mm_set1_ps(0.5f));
+		__m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(fn));
+		fn = _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, fn), ONE));
+		x = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(0.693359375f)));
+		x = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(-2.12194440e-4f)));
+
+		__m128 z = _mm_mul_ps(x, x);
+		__m128 y = _mm_set1_ps(1.9875691500e-4f);
+		y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.3981999507e-3f));
+		y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(8.3334519073e-3f));
+		y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(4.1665795894e-2f));
+		y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(1.6666665459e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y, x), _mm_set1_ps(5.0000001201e-1f));
+		y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(y, z), x), ONE);
+
+		// 2^n is applied in two steps so results near the ends of the range,
+		// where 2^n alone is not a normal float, still come out right.
+		__m128i n = _mm_cvttps_epi32(fn);
+		__m128i n1 = _mm_srai_epi32(n, 1);
+		__m128i n2 = _mm_sub_epi32(n, n1);
+		const __m128i BIAS = _mm_set1_epi32(127);
+		y = _mm_mul_ps(y, _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n1, BIAS), 23)));
+		y = _mm_mul_ps(y, _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(n2, BIAS), 23)));
+
+		SSEVector vec;
+		vec.data = y;
+		return vec.select(*this == *this, *this);
+	}
+
+	FORCEINLINE SSEVector ln() const
+	{
+		// ln(x) = e*ln(2) + ln(m), with x = m * 2^e and m in
+		// [sqrt(0.5), sqrt(2)). Denormals are scaled up by 2^25 first.
+		const __m128 ONE = _mm_set1_ps(1.0f);
+		__m128 isDenormal = _mm_cmplt_ps(data, _mm_set1_ps(1.17549435e-38f));
+		__m128 x = _mm_or_ps(_mm_and_ps(isDenormal, _mm_mul_ps(data, _mm_set1_ps(33554432.0f))),
+				_mm_andnot_ps(isDenormal, data));
+
+		__m128i bits = _mm_castps_si128(x);
+		__m128i exponent = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126));
+		__m128 e = _mm_sub_ps(_mm_cvtepi32_ps(exponent), _mm_and_ps(isDenormal,
+					_mm_set1_ps(25.0f)));
+		__m128 m = _mm_castsi128_ps(_mm_or_si128(
+					_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)),
+					_mm_set1_epi32(0x3F000000)));
+
+		// m is in [0.5, 1); move it to [sqrt(0.5), sqrt(2)) and subtract 1
+		__m128 isSmall = _mm_cmplt_ps(m, _mm_set1_ps(0.707106781186547524f));
+		e = _mm_sub_ps(e, _mm_and_ps(isSmall, ONE));
+		m = _mm_sub_ps(_mm_add_ps(m, _mm_and_ps(isSmall, m)), ONE);
+
+		__m128 z = _mm_mul_ps(m, m);
+		__m128 y = _mm_set1_ps(7.0376836292e-2f);
+		y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.1514610310e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(1.1676998740e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.2420140846e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(1.4249322787e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-1.6668057665e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(2.0000714765e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(-2.4999993993e-1f));
+		y = _mm_add_ps(_mm_mul_ps(y, m), _mm_set1_ps(3.3333331174e-1f));
+		y = _mm_mul_ps(_mm_mul_ps(y, m), z);
+		y = _mm_add_ps(y, _mm_mul_ps(e, _mm_set1_ps(-2.12194440e-4f)));
+		y = _mm_sub_ps(y, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+		y = _mm_add_ps(_mm_add_ps(m, y), _mm_mul_ps(e, _mm_set1_ps(0.693359375f)));
+
+		// ln(inf) = inf and NaN stays NaN; ln(0) = -inf, ln(x < 0) = NaN
+		const SSEVector zero(SSEVector::load1f(0.0f));
+		const SSEVector inf(SSEVector::load1f(std::numeric_limits<float>::infinity()));
+		SSEVector vec;
+		vec.data = y;
+		vec = vec.select(*this < inf, *this);
+		vec = vec.select(*this != zero, -inf);
+		return vec.select(*this >= zero,
+				SSEVector::load1f(std::numeric_limits<float>::quiet_NaN()));
+	}
+
+	FORCEINLINE SSEVector sin() const
+	{
+		SSEVector outSin, outCos;
+		sincos(&outSin, &outCos);
+		return outSin;
+	}
+
+	FORCEINLINE SSEVector cos() const
+	{
+		SSEVector outSin, outCos;
+		sincos(&outSin, &outCos);
+		return outCos;
 	}
 
 	FORCEINLINE SSEVector rsqrt() const
@@ -393,16 +570,114 @@ public:
 		return (*this) * rlen3();
 	}
 
+	template<Precision::Level precision>
+	FORCEINLINE SSEVector rsqrt() const
+	{
+		if(precision == Precision::EXACT) {
+			return rsqrt();
+		}
+		SSEVector vec;
+		vec.data = _mm_rsqrt_ps(data);
+		if(precision == Precision::REFINED) {
+			// y' = y * (1.5 - 0.5 * x * y * y)
+			__m128 halfXY = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), data), vec.data);
+			vec.data = _mm_mul_ps(vec.data,
+					_mm_sub_ps(_mm_set1_ps(1.5f), _mm_mul_ps(halfXY, vec.data)));
+		}
+		return vec;
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE SSEVector reciprocal() const
+	{
+		if(precision == Precision::EXACT) {
+			return reciprocal();
+		}
+		SSEVector vec;
+		vec.data = _mm_rcp_ps(data);
+		if(precision == Precision::REFINED) {
+			// y' = y * (2 - x * y)
+			vec.data = _mm_mul_ps(vec.data,
+					_mm_sub_ps(_mm_set1_ps(2.0f), _mm_mul_ps(data, vec.data)));
+		}
+		return vec;
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE SSEVector rlen4() const
+	{
+		return dot4(*this).rsqrt<precision>();
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE SSEVector rlen3() const
+	{
+		return dot3(*this).rsqrt<precision>();
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE SSEVector normalize4() const
+	{
+		return (*this) * rlen4<precision>();
+	}
+
+	template<Precision::Level precision>
+	FORCEINLINE SSEVector normalize3() const
+	{
+		return (*this) * rlen3<precision>();
+	}
+
 	FORCEINLINE void sincos(SSEVector* outSin, SSEVector* outCos) const
 	{
-		float outSinVals[4];
-		float outCosVals[4];
-		Math::sincos(&outSinVals[0], &outCosVals[0], (*this)[0]);
-		Math::sincos(&outSinVals[1], &outCosVals[1], (*this)[1]);
-		Math::sincos(&outSinVals[2], &outCosVals[2], (*this)[2]);
-		Math::sincos(&outSinVals[3], &outCosVals[3], (*this)[3]);
-		*outSin = SSEVector::load4f(outSinVals);
-		*outCos = SSEVector::load4f(outCosVals);
+		// Reduce |x| to r in [-pi/4, pi/4] with x = j*pi/4 + r and j even.
+		// j picks which polynomial gives sin and cos, and their signs. The
+		// reduction is done in double, with pi/4 split so that j times the
+		// high part is exact; in float, results near a root of sin or cos
+		// would lose most of their bits.
+		const __m128 SIGN_MASK = _mm_castsi128_ps(_mm_set1_epi32((int32)0x80000000));
+		__m128 x = _mm_andnot_ps(SIGN_MASK, data);
+		__m128 sinSign = _mm_and_ps(SIGN_MASK, data);
+
+		__m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+		j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+		const __m128d PI_OVER_4_HI = _mm_set1_pd(0.7853981633961666);
+		const __m128d PI_OVER_4_LO = _mm_set1_pd(1.2816720757972595e-12);
+		__m128d jLo = _mm_cvtepi32_pd(j);
+		__m128d jHi = _mm_cvtepi32_pd(_mm_shuffle_epi32(j, SSEVector_SHUFFLEMASK(2,3,2,3)));
+		__m128d rLo = _mm_sub_pd(_mm_cvtps_pd(x), _mm_mul_pd(jLo, PI_OVER_4_HI));
+		__m128d rHi = _mm_sub_pd(_mm_cvtps_pd(_mm_movehl_ps(x, x)),
+				_mm_mul_pd(jHi, PI_OVER_4_HI));
+		rLo = _mm_sub_pd(rLo, _mm_mul_pd(jLo, PI_OVER_4_LO));
+		rHi = _mm_sub_pd(rHi, _mm_mul_pd(jHi, PI_OVER_4_LO));
+		x = _mm_movelh_ps(_mm_cvtpd_ps(rLo), _mm_cvtpd_ps(rHi));
+
+		const __m128i FOUR = _mm_set1_epi32(4);
+		sinSign = _mm_xor_ps(sinSign,
+				_mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, FOUR), 29)));
+		__m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(
+					_mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), FOUR), 29));
+		__m128 useSinPoly = _mm_castsi128_ps(_mm_cmpeq_epi32(
+					_mm_and_si128(j, _mm_set1_epi32(2)), _mm_setzero_si128()));
+
+		__m128 z = _mm_mul_ps(x, x);
+		__m128 cosPoly = _mm_set1_ps(2.443315711809948e-5f);
+		cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(-1.388731625493765e-3f));
+		cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(4.166664568298827e-2f));
+		cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+		cosPoly = _mm_sub_ps(cosPoly, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+		cosPoly = _mm_add_ps(cosPoly, _mm_set1_ps(1.0f));
+
+		__m128 sinPoly = _mm_set1_ps(-1.9515295891e-4f);
+		sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(8.3321608736e-3f));
+		sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(-1.6666654611e-1f));
+		sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), x), x);
+
+		__m128 sinVal = _mm_or_ps(_mm_and_ps(useSinPoly, sinPoly),
+				_mm_andnot_ps(useSinPoly, cosPoly));
+		__m128 cosVal = _mm_or_ps(_mm_and_ps(useSinPoly, cosPoly),
+				_mm_andnot_ps(useSinPoly, sinPoly));
+		outSin->data = _mm_xor_ps(sinVal, sinSign);
+		outCos->data = _mm_xor_ps(cosVal, cosSign);
 	}
 
 	FORCEINLINE SSEVector quatMul(const SSEVector& other) const
@@ -472,6 +747,11 @@ public:
 		return !_mm_movemask_ps(data);
 	}
 
+	FORCEINLINE uint32 toBitmask() const
+	{
+		return (uint32)_mm_movemask_ps(data);
+	}
+
 	FORCEINLINE SSEVector operator==(const SSEVector& other) const
 	{
 		SSEVector vec;
@@ -562,6 +842,141 @@ public:
 private:
 	__m128 data;
 
+	// pow's log2 and exp2 use tables of POW_TABLE_SIZE entries, so only
+	// short polynomials are needed and everything fits in double.
+	enum
+	{
+		POW_TABLE_BITS = 5,
+		POW_TABLE_SIZE = 1 << POW_TABLE_BITS
+	};
+
+	// For subinterval i of [0.7, 1.4): 1/c, rounded so z/c is exact in
+	// double, and log2(c)
+	static const double* getPowLog2Table()
+	{
+		static const double table[POW_TABLE_SIZE][2] = {
+			{ 1.414364643394947, -0.5001541154780597 },
+			{ 1.3837837874889374, -0.46861854334657943 },
+			{ 1.3544973582029343, -0.4377575797257948 },
+			{ 1.3264248669147491, -0.407542958869028 },
+			{ 1.2994923889636993, -0.3779481840706117 },
+			{ 1.2736318409442902, -0.3489483089890232 },
+			{ 1.2487804889678955, -0.3205199018381684 },
+			{ 1.2248803824186325, -0.29264086749923773 },
+			{ 1.201877936720848, -0.2652903827133184 },
+			{ 1.1797235012054443, -0.23844876621190622 },
+			{ 1.1583710387349129, -0.21209743813127926 },
+			{ 1.1377777755260468, -0.1862188059277822 },
+			{ 1.117903932929039, -0.16079621551401993 },
+			{ 1.09871244430542, -0.13581385265849083 },
+			{ 1.0801687762141228, -0.11125675089180113 },
+			{ 1.0622406601905823, -0.08711065873148414 },
+			{ 1.0448979586362839, -0.0633620602416463 },
+			{ 1.0281124487519264, -0.03999806646234075 },
+			{ 1.0118577107787132, -0.017006429966352522 },
+			{ 0.9903288185596466, 0.01402047258228403 },
+			{ 0.9624060168862343, 0.05528243272998478 },
+			{ 0.9343065693974495, 0.09803208287655081 },
+			{ 0.9078014194965363, 0.1395513507192755 },
+			{ 0.8827586211264133, 0.17990908930113927 },
+			{ 0.8590604029595852, 0.2191685200002941 },
+			{ 0.8366013057529926, 0.25738784516994095 },
+			{ 0.8152866251766682, 0.294620747170121 },
+			{ 0.7950310558080673, 0.33091687828256877 },
+			{ 0.7757575772702694, 0.366322211432623 },
+			{ 0.7573964484035969, 0.40087943875947346 },
+			{ 0.7398843914270401, 0.434628230827809 },
+			{ 0.7231638431549072, 0.46760554739576854 },
+		};
+		return &table[0][0];
+	}
+
+	// 2^(i/POW_TABLE_SIZE)
+	static const double* getPowExp2Table()
+	{
+		static const double table[POW_TABLE_SIZE] = {
+			1.0,
+			1.0218971486541166,
+			1.0442737824274138,
+			1.0671404006768237,
+			1.0905077326652577,
+			1.1143867425958924,
+			1.1387886347566916,
+			1.1637248587775775,
+			1.189207115002721,
+			1.215247359980469,
+			1.241857812073484,
+			1.2690509571917332,
+			1.2968395546510096,
+			1.3252366431597413,
+			1.3542555469368927,
+			1.383909881963832,
+			1.4142135623730951,
+			1.4451808069770467,
+			1.4768261459394993,
+			1.5091644275934228,
+			1.5422108254079407,
+			1.5759808451078865,
+			1.6104903319492543,
+			1.645755478153965,
+			1.681792830507429,
+			1.718619298122478,
+			1.7562521603732995,
+			1.7947090750031072,
+			1.8340080864093424,
+			1.8741676341103,
+			1.9152065613971474,
+			1.9571441241754002,
+		};
+		return table;
+	}
+
+	// log2 of 2 values given as z and k, using table entries i0 and i1
+	static FORCEINLINE __m128d log2Double(__m128d z, __m128d k, int32 i0, int32 i1)
+	{
+		const double* table = getPowLog2Table();
+		__m128d entry0 = _mm_loadu_pd(table + i0*2);
+		__m128d entry1 = _mm_loadu_pd(table + i1*2);
+		__m128d r = _mm_sub_pd(_mm_mul_pd(z, _mm_unpacklo_pd(entry0, entry1)),
+				_mm_set1_pd(1.0));
+
+		// log2(1 + r) for |r| < 0.016, error below 4e-12
+		__m128d y = _mm_set1_pd(0.28853900817779266);
+		y = _mm_add_pd(_mm_mul_pd(y, r), _mm_set1_pd(-0.36067376022224085));
+		y = _mm_add_pd(_mm_mul_pd(y, r), _mm_set1_pd(0.4808983469629878));
+		y = _mm_add_pd(_mm_mul_pd(y, r), _mm_set1_pd(-0.7213475204444817));
+		y = _mm_add_pd(_mm_mul_pd(y, r), _mm_set1_pd(1.4426950408889634));
+		y = _mm_mul_pd(y, r);
+		return _mm_add_pd(_mm_add_pd(k, _mm_unpackhi_pd(entry0, entry1)), y);
+	}
+
+	// 2^x of 2 doubles. Clamped to a range that still overflows or
+	// underflows once converted to float.
+	static FORCEINLINE __m128d exp2Double(__m128d x)
+	{
+		x = _mm_min_pd(_mm_max_pd(x, _mm_set1_pd(-160.0)), _mm_set1_pd(160.0));
+		__m128i n = _mm_cvtpd_epi32(_mm_mul_pd(x, _mm_set1_pd((double)POW_TABLE_SIZE)));
+		__m128d r = _mm_sub_pd(x, _mm_mul_pd(_mm_cvtepi32_pd(n),
+					_mm_set1_pd(1.0/POW_TABLE_SIZE)));
+
+		// 2^r for |r| <= 1/64, error below 2e-12
+		__m128d y = _mm_set1_pd(0.009618129107628477);
+		y = _mm_add_pd(_mm_mul_pd(y, r), _mm_set1_pd(0.05550410866482158));
+		y = _mm_add_pd(_mm_mul_pd(y, r), _mm_set1_pd(0.24022650695910072));
+		y = _mm_add_pd(_mm_mul_pd(y, r), _mm_set1_pd(0.6931471805599453));
+		y = _mm_add_pd(_mm_mul_pd(y, r), _mm_set1_pd(1.0));
+
+		const double* table = getPowExp2Table();
+		int32 i0 = _mm_cvtsi128_si32(n) & (POW_TABLE_SIZE - 1);
+		int32 i1 = _mm_cvtsi128_si32(_mm_srli_si128(n, 4)) & (POW_TABLE_SIZE - 1);
+		__m128d fraction = _mm_loadh_pd(_mm_load_sd(table + i0), table + i1);
+		__m128i biased = _mm_add_epi32(_mm_srai_epi32(n, POW_TABLE_BITS),
+				_mm_set1_epi32(1023));
+		__m128d scale = _mm_castsi128_pd(_mm_slli_epi64(
+					_mm_unpacklo_epi32(biased, _mm_setzero_si128()), 52));
+		return _mm_mul_pd(_mm_mul_pd(y, fraction), scale);
+	}
+
 	static FORCEINLINE __m128 horizontalAdd(__m128 t0)
 	{
 	#if SIMD_SUPPORTED_LEVEL >= SIMD_LEVEL_x86_SSSE3
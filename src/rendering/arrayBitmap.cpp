@@ -6,7 +6,8 @@ ArrayBitmap::ArrayBitmap(int32 widthIn, int32 heightIn) :
 	width(widthIn), height(heightIn)
 {
 	assertCheck(width > 0 && height > 0);
-	pixels = (int32*)Memory::malloc(getPixelsSize());
+	pixels = (int32*)Memory::malloc(getPixelsSize(), Memory::DEFAULT_ALIGNMENT,
+			MEMORY_TAG_TEXTURES);
 }
 
 ArrayBitmap::ArrayBitmap(int32 widthIn, int32 heightIn, int32* pixelsIn) :
@@ -15,7 +16,7 @@ ArrayBitmap::ArrayBitmap(int32 widthIn, int32 heightIn, int32* pixelsIn) :
 	assertCheck(width > 0 && height > 0);
 	assertCheck(pixelsIn != nullptr);
 	uintptr size = getPixelsSize();
-	pixels = (int32*)Memory::malloc(size);
+	pixels = (int32*)Memory::malloc(size, Memory::DEFAULT_ALIGNMENT, MEMORY_TAG_TEXTURES);
 	Memory::memcpy(pixels, pixelsIn, size);
 }
 
@@ -27,7 +28,7 @@ ArrayBitmap::ArrayBitmap(int32 widthIn, int32 heightIn, int32* pixelsIn, int32 o
 	assertCheck(pixelsIn != nullptr);
 	assertCheck(offsetX > 0 && offsetY > 0 && rowOffset > 0);
 	uintptr size = getPixelsSize();
-	pixels = (int32*)Memory::malloc(size);
+	pixels = (int32*)Memory::malloc(size, Memory::DEFAULT_ALIGNMENT, MEMORY_TAG_TEXTURES);
 	int32* pixelsSrc = pixelsIn + offsetY + offsetX * rowOffset;
 
 	for(uintptr i = 0; i < (uintptr)height;
@@ -56,7 +57,8 @@ bool ArrayBitmap::load(const String& fileName)
 		width = texWidth;
 		height = texHeight;
 		pixels = (int32*)Memory::free(pixels);
-		pixels = (int32*)Memory::malloc(getPixelsSize());
+		pixels = (int32*)Memory::malloc(getPixelsSize(), Memory::DEFAULT_ALIGNMENT,
+			MEMORY_TAG_TEXTURES);
 		Memory::memcpy(pixels, data, getPixelsSize());
 	}
 
@@ -0,0 +1,117 @@
+#include "dirtyRangeTracker.hpp"
+#include "math/math.hpp"
+
+DirtyRangeTracker::DirtyRangeTracker(uint32 elementsPerPage, uint32 mergeDistanceIn) :
+	numElements(0),
+	pageShift(Math::floorLog2(elementsPerPage)),
+	mergeDistance(mergeDistanceIn)
+{
+	assertCheck(elementsPerPage == getElementsPerPage());
+}
+
+void DirtyRangeTracker::resize(uint32 newNumElements)
+{
+	uint32 oldNumElements = numElements;
+	numElements = newNumElements;
+	pageBits.resize((getNumPages() + 63)/64, 0);
+	if(newNumElements > oldNumElements) {
+		markDirty(oldNumElements, newNumElements - oldNumElements);
+		return;
+	}
+
+	// Pages past the end must stay clear so getRanges never reports them
+	uint32 numPages = getNumPages();
+	if(!pageBits.empty() && (numPages & 63) != 0) {
+		pageBits.back() &= ((uint64)1 << (numPages & 63)) - 1;
+	}
+}
+
+void DirtyRangeTracker::markDirty(uint32 index)
+{
+	assertCheck(index < numElements);
+	uint32 page = index >> pageShift;
+	pageBits[page >> 6] |= (uint64)1 << (page & 63);
+}
+
+void DirtyRangeTracker::markDirty(uint32 start, uint32 count)
+{
+	if(count == 0) {
+		return;
+	}
+	assertCheck(start + count <= numElements);
+	markPagesDirty(start >> pageShift, ((start + count - 1) >> pageShift) + 1);
+}
+
+void DirtyRangeTracker::markAllDirty()
+{
+	markPagesDirty(0, getNumPages());
+}
+
+void DirtyRangeTracker::clear()
+{
+	for(uint32 i = 0; i < pageBits.size(); i++) {
+		pageBits[i] = 0;
+	}
+}
+
+bool DirtyRangeTracker::isDirty(uint32 index) const
+{
+	assertCheck(index < numElements);
+	uint32 page = index >> pageShift;
+	return (pageBits[page >> 6] >> (page & 63)) & 1;
+}
+
+bool DirtyRangeTracker::isAnyDirty() const
+{
+	for(uint32 i = 0; i < pageBits.size(); i++) {
+		if(pageBits[i] != 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void DirtyRangeTracker::getRanges(Array<Range>& result) const
+{
+	result.clear();
+	uint32 rangeStartPage = 0;
+	uint32 rangeEndPage = 0;
+	bool inRange = false;
+	for(uint32 word = 0; word < pageBits.size(); word++) {
+		uint64 bits = pageBits[word];
+		while(bits != 0) {
+			uint32 page = word * 64 + Math::getNumTrailingZeroes(bits);
+			bits &= bits - 1;
+			if(inRange && page - rangeEndPage <= mergeDistance) {
+				rangeEndPage = page + 1;
+				continue;
+			}
+			if(inRange) {
+				Range range = { rangeStartPage << pageShift,
+					(rangeEndPage - rangeStartPage) << pageShift };
+				result.push_back(range);
+			}
+			rangeStartPage = page;
+			rangeEndPage = page + 1;
+			inRange = true;
+		}
+	}
+	if(inRange) {
+		// Only the last range can reach the partial page at the end
+		uint32 start = rangeStartPage << pageShift;
+		Range range = { start,
+			Math::min(rangeEndPage << pageShift, numElements) - start };
+		result.push_back(range);
+	}
+}
+
+void DirtyRangeTracker::markPagesDirty(uint32 startPage, uint32 endPage)
+{
+	for(uint32 page = startPage; page < endPage; ) {
+		uint32 bit = page & 63;
+		uint32 amt = Math::min(endPage - page, 64 - bit);
+		uint64 mask = amt == 64 ? ~(uint64)0 : (((uint64)1 << amt) - 1) << bit;
+		pageBits[page >> 6] |= mask;
+		page += amt;
+	}
+}
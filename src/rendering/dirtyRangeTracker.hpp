@@ -0,0 +1,53 @@
+#pragma once
+
+#include "core/common.hpp"
+#include "dataStructures/array.hpp"
+
+/**
+ * Tracks which elements of a buffer changed since the last upload, and
+ * turns them into a short list of ranges to upload.
+ *
+ * Elements are tracked in pages, one bit per page, so marking is O(1) and
+ * finding the dirty pages skips 64 clean ones at a time. Dirty pages with at
+ * most mergeDistance clean pages between them are merged into one range,
+ * since each upload call costs more than re-sending a few unchanged pages.
+ */
+class DirtyRangeTracker
+{
+public:
+	/** A span of elements, not pages. */
+	struct Range
+	{
+		uint32 start;
+		uint32 count;
+	};
+
+	/** elementsPerPage must be a power of 2. */
+	DirtyRangeTracker(uint32 elementsPerPage = 64, uint32 mergeDistance = 1);
+
+	/** Elements added by growing start out dirty. */
+	void resize(uint32 numElements);
+	void markDirty(uint32 index);
+	void markDirty(uint32 start, uint32 count);
+	void markAllDirty();
+	void clear();
+
+	bool isDirty(uint32 index) const;
+	bool isAnyDirty() const;
+	/** Replaces the contents of result with the merged dirty ranges. */
+	void getRanges(Array<Range>& result) const;
+
+	FORCEINLINE uint32 size() const { return numElements; }
+	FORCEINLINE uint32 getElementsPerPage() const { return 1 << pageShift; }
+private:
+	Array<uint64> pageBits;
+	uint32 numElements;
+	uint32 pageShift;
+	uint32 mergeDistance;
+
+	FORCEINLINE uint32 getNumPages() const
+	{
+		return (numElements + getElementsPerPage() - 1) >> pageShift;
+	}
+	void markPagesDirty(uint32 startPage, uint32 endPage);
+};
@@ -61,9 +61,22 @@ uint32 IndexedModel::getNumIndices() const
 	return indices.size();
 }
 
-void IndexedModel::allocateElement(uint32 elementSize)
+const Array<uint32>& IndexedModel::getIndices() const
+{
+	return indices;
+}
+
+const Array<float>& IndexedModel::getElement(uint32 elementIndex) const
+{
+	assertCheck(elementIndex < elementSizes.size());
+	return elements[elementIndex];
+}
+
+void IndexedModel::allocateElement(uint32 elementSize,
+		enum RenderDevice::VertexElementType elementType)
 {
 	elementSizes.push_back(elementSize);
+	elementTypes.push_back(elementType);
 	elements.push_back(Array<float>());
 }
 
@@ -72,11 +85,21 @@ void IndexedModel::setInstancedElementStartIndex(uint32 elementIndex)
 	instancedElementsStartIndex = elementIndex;
 }
 
+void IndexedModel::allocateInstancedElements(enum InstanceFormat::Format format)
+{
+	setInstancedElementStartIndex(elementSizes.size());
+	for(uint32 i = 0; i < InstanceFormat::getNumElements(format); i++) {
+		allocateElement(InstanceFormat::getElementSize(format, i),
+				InstanceFormat::getElementType(format, i));
+	}
+}
+
 //void IndexedModel::clear()
 //{
 //	instancedElementsStartIndex = -1;
 //	indices.clear();
 //	elementSizes.clear();
+//	elementTypes.clear();
 //	elements.clear();
 //}
 
@@ -88,7 +111,8 @@ uint32 IndexedModel::createVertexArray(RenderDevice& device,
 		0 : (numVertexComponents - instancedElementsStartIndex);
 	numVertexComponents -= numInstanceComponents;
 
-	Array<const float*> vertexDataArray;
+	Array<const float*, FrameArena> vertexDataArray(device.getFrameArena());
+	vertexDataArray.reserve(numVertexComponents);
 	for(uint32 i = 0; i < numVertexComponents; i++) {
 		vertexDataArray.push_back(&(elements[i][0]));
 	}
@@ -100,6 +124,6 @@ uint32 IndexedModel::createVertexArray(RenderDevice& device,
 	uint32 numIndices = indices.size();
 	
 	return device.createVertexArray(vertexData, vertexElementSizes,
-			numVertexComponents, numInstanceComponents, numVertices, &indices[0],
+			&elementTypes[0], numVertexComponents, numInstanceComponents, numVertices, &indices[0],
 			numIndices, usage);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "renderDevice.hpp"
+#include "instanceFormat.hpp"
 
 class IndexedModel
 {
@@ -10,8 +11,11 @@ public:
 	uint32 createVertexArray(RenderDevice& device,
 			enum RenderDevice::BufferUsage usage) const;
 
-	void allocateElement(uint32 elementSize);
+	void allocateElement(uint32 elementSize, enum RenderDevice::VertexElementType
+			elementType = RenderDevice::ELEMENT_TYPE_FLOAT);
 	void setInstancedElementStartIndex(uint32 elementIndex);
+	/** Begins instanced data with the elements that hold format. */
+	void allocateInstancedElements(enum InstanceFormat::Format format);
 
 	void addElement1f(uint32 elementIndex, float e0);
 	void addElement2f(uint32 elementIndex, float e0, float e1);
@@ -24,9 +28,12 @@ public:
 	void addIndices4i(uint32 i0, uint32 i1, uint32 i2, uint32 i3);
 
 	uint32 getNumIndices() const;
+	const Array<uint32>& getIndices() const;
+	const Array<float>& getElement(uint32 elementIndex) const;
 private:
 	Array<uint32> indices;
 	Array<uint32> elementSizes;
+	Array<enum RenderDevice::VertexElementType> elementTypes;
 	Array<Array<float> > elements;
 	uint32 instancedElementsStartIndex;
 };
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "core/common.hpp"
+#include "dirtyRangeTracker.hpp"
+
+/**
+ * One instanced element of a VertexArray that only uploads the instances
+ * marked dirty since the last update, instead of the whole buffer.
+ *
+ * The caller keeps the instance data; update reads the dirty spans from it
+ * and sends each one with an offset upload. Growing the buffer makes the
+ * next update send everything, as the device buffer has to be reallocated.
+ *
+ * Buffer is VertexArray, or anything with the same updateBuffer and
+ * updateBufferRange functions, which lets the uploads be tested without a
+ * GPU.
+ */
+template<typename Buffer>
+class InstanceBuffer
+{
+public:
+	/** See DirtyRangeTracker for instancesPerPage and mergeDistance. */
+	InstanceBuffer(Buffer& vertexArray, uint32 bufferIndex, uintptr instanceSize,
+			uint32 instancesPerPage = 64, uint32 mergeDistance = 1);
+
+	FORCEINLINE void resize(uint32 numInstances) { dirtyRanges.resize(numInstances); }
+	FORCEINLINE void markDirty(uint32 index) { dirtyRanges.markDirty(index); }
+	FORCEINLINE void markDirty(uint32 start, uint32 count)
+	{
+		dirtyRanges.markDirty(start, count);
+	}
+	FORCEINLINE void markAllDirty() { dirtyRanges.markAllDirty(); }
+
+	/** Uploads the dirty instances of data, which holds size() instances. */
+	void update(const void* data);
+
+	FORCEINLINE uint32 size() const { return dirtyRanges.size(); }
+	/** Bytes sent by the last update. */
+	FORCEINLINE uintptr getBytesUploaded() const { return bytesUploaded; }
+	/** Upload calls made by the last update. */
+	FORCEINLINE uint32 getNumUploads() const { return numUploads; }
+	FORCEINLINE uint64 getTotalBytesUploaded() const { return totalBytesUploaded; }
+private:
+	Buffer* vertexArray;
+	uint32 bufferIndex;
+	uintptr instanceSize;
+	uint32 capacity;
+	DirtyRangeTracker dirtyRanges;
+	Array<DirtyRangeTracker::Range> ranges;
+	uintptr bytesUploaded;
+	uint32 numUploads;
+	uint64 totalBytesUploaded;
+
+	NULL_COPY_AND_ASSIGN(InstanceBuffer);
+};
+
+template<typename Buffer>
+InstanceBuffer<Buffer>::InstanceBuffer(Buffer& vertexArrayIn, uint32 bufferIndexIn,
+		uintptr instanceSizeIn, uint32 instancesPerPage, uint32 mergeDistance) :
+	vertexArray(&vertexArrayIn),
+	bufferIndex(bufferIndexIn),
+	instanceSize(instanceSizeIn),
+	capacity(0),
+	dirtyRanges(instancesPerPage, mergeDistance),
+	bytesUploaded(0),
+	numUploads(0),
+	totalBytesUploaded(0) {}
+
+template<typename Buffer>
+void InstanceBuffer<Buffer>::update(const void* data)
+{
+	bytesUploaded = 0;
+	numUploads = 0;
+	uint32 numInstances = size();
+	if(numInstances > capacity) {
+		// The device buffer is reallocated, so nothing in it can be kept
+		bytesUploaded = numInstances * instanceSize;
+		numUploads = 1;
+		vertexArray->updateBuffer(bufferIndex, data, bytesUploaded);
+		capacity = numInstances;
+	} else {
+		dirtyRanges.getRanges(ranges);
+		for(uint32 i = 0; i < ranges.size(); i++) {
+			uintptr offset = ranges[i].start * instanceSize;
+			uintptr rangeSize = ranges[i].count * instanceSize;
+			vertexArray->updateBufferRange(bufferIndex, offset,
+					(const uint8*)data + offset, rangeSize);
+			bytesUploaded += rangeSize;
+		}
+		numUploads = ranges.size();
+	}
+	totalBytesUploaded += bytesUploaded;
+	dirtyRanges.clear();
+}
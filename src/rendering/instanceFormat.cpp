@@ -0,0 +1,275 @@
+#include "instanceFormat.hpp"
+
+struct InstanceFormatLayout
+{
+	uint32 numElements;
+	uint32 elementSizes[InstanceFormat::MAX_ELEMENTS];
+	enum RenderDevice::VertexElementType elementTypes[InstanceFormat::MAX_ELEMENTS];
+	const char* shaderDefine;
+};
+
+static const InstanceFormatLayout layouts[InstanceFormat::NUM_FORMATS] = {
+	// mat4
+	{ 1, { 16, 0 }, { RenderDevice::ELEMENT_TYPE_FLOAT, RenderDevice::ELEMENT_TYPE_FLOAT },
+		"INSTANCE_FORMAT_MATRIX" },
+	// vec4(translation, scale.x), vec4(rotation), vec2(scale.yz)
+	{ 1, { 10, 0 }, { RenderDevice::ELEMENT_TYPE_FLOAT, RenderDevice::ELEMENT_TYPE_FLOAT },
+		"INSTANCE_FORMAT_TRANSLATION_ROTATION_SCALE" },
+	// vec4(translation, scale), vec4(rotation)
+	{ 1, { 8, 0 }, { RenderDevice::ELEMENT_TYPE_FLOAT, RenderDevice::ELEMENT_TYPE_FLOAT },
+		"INSTANCE_FORMAT_TRANSLATION_ROTATION_UNIFORM_SCALE" },
+	// vec4(translation, scale), uint(rotation)
+	{ 2, { 4, 1 }, { RenderDevice::ELEMENT_TYPE_FLOAT, RenderDevice::ELEMENT_TYPE_UINT },
+		"INSTANCE_FORMAT_SMALLEST_THREE_UNIFORM_SCALE" },
+};
+
+// The three smallest components of a unit quaternion lie in
+// [-1/sqrt(2), 1/sqrt(2)], which is mapped onto [0, 1023].
+static const float SMALLEST_THREE_RANGE = 0.70710678f;
+static const float SMALLEST_THREE_MAX = 1023.0f;
+// Adding 2^23 to a float in [0, 2^23) rounds it to an integer held in the
+// low mantissa bits, which converts 4 lanes at once without leaving floats.
+static const float FLOAT_TO_INT_MAGIC = 8388608.0f;
+
+uint32 InstanceFormat::getNumElements(enum Format format)
+{
+	assertCheck(format < NUM_FORMATS);
+	return layouts[format].numElements;
+}
+
+uint32 InstanceFormat::getElementSize(enum Format format, uint32 element)
+{
+	assertCheck(element < getNumElements(format));
+	return layouts[format].elementSizes[element];
+}
+
+enum RenderDevice::VertexElementType InstanceFormat::getElementType(enum Format format,
+		uint32 element)
+{
+	assertCheck(element < getNumElements(format));
+	return layouts[format].elementTypes[element];
+}
+
+uintptr InstanceFormat::getInstanceSize(enum Format format)
+{
+	uintptr result = 0;
+	for(uint32 i = 0; i < getNumElements(format); i++) {
+		result += getElementSize(format, i) * sizeof(float);
+	}
+	return result;
+}
+
+const char* InstanceFormat::getShaderDefine(enum Format format)
+{
+	assertCheck(format < NUM_FORMATS);
+	return layouts[format].shaderDefine;
+}
+
+void InstanceFormat::pack(enum Format format, const Transform* transforms,
+		void* const* elementData, uint32 count)
+{
+	switch(format) {
+		case FORMAT_MATRIX:
+			Matrix::transformMatrixBatch(transforms, (Matrix*)elementData[0], count);
+			break;
+		case FORMAT_TRANSLATION_ROTATION_SCALE:
+			packTranslationRotationScale(transforms, (float*)elementData[0], count);
+			break;
+		case FORMAT_TRANSLATION_ROTATION_UNIFORM_SCALE:
+			packTranslationRotationUniformScale(transforms, (float*)elementData[0], count);
+			break;
+		case FORMAT_SMALLEST_THREE_UNIFORM_SCALE:
+			packSmallestThreeUniformScale(transforms, (float*)elementData[0],
+					(uint32*)elementData[1], count);
+			break;
+		default:
+			assertCheck(false);
+	}
+}
+
+Matrix InstanceFormat::unpack(enum Format format, const void* const* elementData,
+		uint32 index)
+{
+	if(format == FORMAT_MATRIX) {
+		return ((const Matrix*)elementData[0])[index];
+	}
+
+	const float* data = (const float*)elementData[0] + index * getElementSize(format, 0);
+	Vector3f translation(data[0], data[1], data[2]);
+	Vector3f scale(data[3]);
+	Quaternion rotation;
+	switch(format) {
+		case FORMAT_TRANSLATION_ROTATION_SCALE:
+			rotation = Quaternion(Vector::load4f(data + 4));
+			scale = Vector3f(data[3], data[8], data[9]);
+			break;
+		case FORMAT_TRANSLATION_ROTATION_UNIFORM_SCALE:
+			rotation = Quaternion(Vector::load4f(data + 4));
+			break;
+		case FORMAT_SMALLEST_THREE_UNIFORM_SCALE:
+			rotation = unpackQuaternionSmallestThree(((const uint32*)elementData[1])[index]);
+			break;
+		default:
+			assertCheck(false);
+	}
+	return Matrix::transformMatrix(translation, rotation, scale);
+}
+
+void InstanceFormat::packTranslationRotationScale(const Transform* transforms,
+		float* result, uint32 count)
+{
+	for(uint32 i = 0; i < count; i++, result += 10) {
+		Vector translation = transforms[i].getTranslation().toVector();
+		Vector scale = transforms[i].getScale().toVector();
+		// The scale's 3 floats start at result[7] so they never write past
+		// this instance; the rotation is stored after and takes result[7]
+		// back, leaving scale y and z in result[8] and result[9].
+		scale.store3f(result + 7);
+		transforms[i].getRotation().toVector().store4f(result + 4);
+		translation.select(VectorConstants::MASK_W, scale.replicate(0)).store4f(result);
+	}
+}
+
+void InstanceFormat::packTranslationRotationUniformScale(const Transform* transforms,
+		float* result, uint32 count)
+{
+	for(uint32 i = 0; i < count; i++, result += 8) {
+		Vector translation = transforms[i].getTranslation().toVector();
+		Vector scale = transforms[i].getScale().toVector().replicate(0);
+		translation.select(VectorConstants::MASK_W, scale).store4f(result);
+		transforms[i].getRotation().toVector().store4f(result + 4);
+	}
+}
+
+// Packs the rotations of 4 transforms the same way as
+// packQuaternionSmallestThree. The quaternions are transposed so each lane
+// holds one of them, which turns the search for the largest component and
+// the removal of it into per-lane selects.
+static FORCEINLINE void packQuaternionsSmallestThree4(const Transform* transforms,
+		uint32* result)
+{
+	static const Vector range(Vector::load1f(SMALLEST_THREE_RANGE));
+	static const Vector quantizeScale(
+			Vector::load1f(0.5f * SMALLEST_THREE_MAX / SMALLEST_THREE_RANGE));
+	static const Vector quantizeBias(
+			Vector::load1f(0.5f * SMALLEST_THREE_MAX + FLOAT_TO_INT_MAGIC));
+	static const Vector magic(Vector::load1f(FLOAT_TO_INT_MAGIC));
+	static const Vector fieldShift(Vector::load1f(1024.0f));
+
+	Vector x = transforms[0].getRotation().toVector();
+	Vector y = transforms[1].getRotation().toVector();
+	Vector z = transforms[2].getRotation().toVector();
+	Vector w = transforms[3].getRotation().toVector();
+	Vector::transpose4(x, y, z, w);
+
+	Vector absX = x.abs();
+	Vector absY = y.abs();
+	Vector absZ = z.abs();
+	Vector absW = w.abs();
+	Vector largestValue = absX.max(absY).max(absZ).max(absW);
+	// Set where the largest component is at or before each index, so ties
+	// go to the first one like the scalar version.
+	Vector upToX = absX >= largestValue;
+	Vector upToY = upToX | (absY >= largestValue);
+	Vector upToZ = upToY | (absZ >= largestValue);
+
+	Vector largest = x.select(upToX, y.select(upToY, z.select(upToZ, w)));
+	Vector flip = largest ^ largest.abs();
+	Vector components[3] = {
+		y.select(upToX, x) ^ flip,
+		z.select(upToY, y) ^ flip,
+		w.select(upToZ, z) ^ flip
+	};
+	for(uint32 i = 0; i < 3; i++) {
+		components[i] = components[i].min(range).max(-range)
+			.mad(quantizeScale, quantizeBias) - magic;
+	}
+	Vector largestIndex = Vector::load1f(3.0f) - (VectorConstants::ONE & upToX) -
+		(VectorConstants::ONE & upToY) - (VectorConstants::ONE & upToZ);
+
+	// Variable shifts of each lane are slow, so the 10 bit fields are
+	// combined while still floats, into halves small enough to stay exact.
+	uint32 high[4];
+	uint32 low[4];
+	(largestIndex.mad(fieldShift, components[0]) + magic).store4f((float*)high);
+	(components[1].mad(fieldShift, components[2]) + magic).store4f((float*)low);
+	for(uint32 i = 0; i < 4; i++) {
+		result[i] = ((high[i] & 0xFFF) << 20) | (low[i] & 0xFFFFF);
+	}
+}
+
+void InstanceFormat::packSmallestThreeUniformScale(const Transform* transforms,
+		float* translationScaleResult, uint32* rotationResult, uint32 count)
+{
+	for(uint32 i = 0; i < count; i++, translationScaleResult += 4) {
+		Vector translation = transforms[i].getTranslation().toVector();
+		Vector scale = transforms[i].getScale().toVector().replicate(0);
+		translation.select(VectorConstants::MASK_W, scale).store4f(translationScaleResult);
+	}
+
+	uint32 i = 0;
+	for(; i + 4 <= count; i += 4) {
+		packQuaternionsSmallestThree4(transforms + i, rotationResult + i);
+	}
+	for(; i < count; i++) {
+		rotationResult[i] = packQuaternionSmallestThree(transforms[i].getRotation());
+	}
+}
+
+uint32 InstanceFormat::packQuaternionSmallestThree(const Quaternion& rotation)
+{
+	static const Vector range(Vector::load1f(SMALLEST_THREE_RANGE));
+	static const Vector quantizeScale(
+			Vector::load1f(0.5f * SMALLEST_THREE_MAX / SMALLEST_THREE_RANGE));
+	static const Vector quantizeBias(
+			Vector::load1f(0.5f * SMALLEST_THREE_MAX + FLOAT_TO_INT_MAGIC));
+
+	Vector quat = rotation.toVector();
+	float magnitudes[4];
+	quat.abs().store4f(magnitudes);
+	uint32 largest = 0;
+	for(uint32 i = 1; i < 4; i++) {
+		if(magnitudes[i] > magnitudes[largest]) {
+			largest = i;
+		}
+	}
+
+	// q and -q are the same rotation, so flip it to make the dropped
+	// component positive. The clamp only catches rounding error.
+	if(quat[largest] < 0.0f) {
+		quat = -quat;
+	}
+	Vector quantized = quat.min(range).max(-range).mad(quantizeScale, quantizeBias);
+	uint32 bits[4];
+	quantized.store4f((float*)bits);
+
+	uint32 result = largest << 30;
+	uint32 shift = 20;
+	for(uint32 i = 0; i < 4; i++) {
+		if(i != largest) {
+			result |= (bits[i] & 0x3FF) << shift;
+			shift -= 10;
+		}
+	}
+	return result;
+}
+
+Quaternion InstanceFormat::unpackQuaternionSmallestThree(uint32 packed)
+{
+	uint32 largest = packed >> 30;
+	uint32 shift = 20;
+	float components[4];
+	float lengthSquared = 0.0f;
+	for(uint32 i = 0; i < 4; i++) {
+		if(i == largest) {
+			continue;
+		}
+		float quantized = (float)((packed >> shift) & 0x3FF);
+		components[i] = (quantized * (2.0f/SMALLEST_THREE_MAX) - 1.0f) *
+			SMALLEST_THREE_RANGE;
+		lengthSquared += components[i] * components[i];
+		shift -= 10;
+	}
+	components[largest] = Math::sqrt(Math::max(1.0f - lengthSquared, 0.0f));
+	return Quaternion(Vector::load4f(components));
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "renderDevice.hpp"
+#include "math/transform.hpp"
+
+/**
+ * Layouts for per-instance transform data.
+ *
+ * FORMAT_MATRIX uploads the full 64 byte matrix. The other formats upload
+ * the parts of the transform instead, and the vertex shader rebuilds the
+ * matrix from them (see res/shaders/instancing.glh). That costs a few
+ * instructions per vertex but shrinks the per-frame upload, which is the
+ * biggest cost of instanced rendering here:
+ *
+ *  FORMAT_TRANSLATION_ROTATION_SCALE          40 bytes
+ *  FORMAT_TRANSLATION_ROTATION_UNIFORM_SCALE  32 bytes
+ *  FORMAT_SMALLEST_THREE_UNIFORM_SCALE        20 bytes
+ *
+ * The uniform scale formats only keep the x component of the scale. The
+ * smallest three format drops the largest quaternion component, which the
+ * shader recovers from the unit length, and stores the rest as 10 bit
+ * integers. That is within about 0.1 degrees of the original rotation.
+ *
+ * Each format may span several vertex array elements. Allocate them with
+ * IndexedModel::allocateInstancedElements, and fill them with pack.
+ */
+class InstanceFormat
+{
+public:
+	enum Format
+	{
+		FORMAT_MATRIX = 0,
+		FORMAT_TRANSLATION_ROTATION_SCALE,
+		FORMAT_TRANSLATION_ROTATION_UNIFORM_SCALE,
+		FORMAT_SMALLEST_THREE_UNIFORM_SCALE,
+		NUM_FORMATS
+	};
+
+	enum
+	{
+		MAX_ELEMENTS = 2
+	};
+
+	static uint32 getNumElements(enum Format format);
+	/** Size of one instance in the element, in 4-byte components. */
+	static uint32 getElementSize(enum Format format, uint32 element);
+	static enum RenderDevice::VertexElementType getElementType(enum Format format,
+			uint32 element);
+	/** Total upload size of one instance, in bytes. */
+	static uintptr getInstanceSize(enum Format format);
+	/** Name to #define before the shader text to pick the matching decoder. */
+	static const char* getShaderDefine(enum Format format);
+
+	/**
+	 * Packs count transforms into format. elementData holds one destination
+	 * per element, each with room for count instances of that element.
+	 */
+	static void pack(enum Format format, const Transform* transforms,
+			void* const* elementData, uint32 count);
+	/**
+	 * Rebuilds the matrix for one packed instance the same way the shader
+	 * does.
+	 */
+	static Matrix unpack(enum Format format, const void* const* elementData,
+			uint32 index);
+
+	static void packTranslationRotationScale(const Transform* transforms,
+			float* result, uint32 count);
+	static void packTranslationRotationUniformScale(const Transform* transforms,
+			float* result, uint32 count);
+	static void packSmallestThreeUniformScale(const Transform* transforms,
+			float* translationScaleResult, uint32* rotationResult, uint32 count);
+
+	/**
+	 * Packs a unit quaternion into 32 bits: the index of the largest
+	 * component in the top 2 bits, then the other three in index order, 10
+	 * bits each.
+	 */
+	static uint32 packQuaternionSmallestThree(const Quaternion& rotation);
+	static Quaternion unpackQuaternionSmallestThree(uint32 packed);
+};
@@ -6,8 +6,9 @@
 
 bool ModelLoader::loadModels(const String& fileName,
 			Array<IndexedModel>& models, Array<uint32>& modelMaterialIndices,
-			Array<MaterialSpec>& materials)
+			Array<MaterialSpec>& materials, enum InstanceFormat::Format instanceFormat)
 {
+	MemoryTagScope memoryTag(MEMORY_TAG_MESHES);
 	Assimp::Importer importer;
 	const aiScene* scene = importer.ReadFile(fileName.c_str(), 
 											 aiProcess_Triangulate |
@@ -30,8 +31,7 @@ bool ModelLoader::loadModels(const String& fileName,
 		newModel.allocateElement(2); // TexCoords
 		newModel.allocateElement(3); // Normals
 		newModel.allocateElement(3); // Tangents
-		newModel.setInstancedElementStartIndex(4); // Begin instanced data
-		newModel.allocateElement(16); // Transform matrix
+		newModel.allocateInstancedElements(instanceFormat); // Transforms
 
 		const aiVector3D aiZeroVector(0.0f, 0.0f, 0.0f);
 		for(uint32 i = 0; i < model->mNumVertices; i++) {
@@ -7,5 +7,6 @@ namespace ModelLoader
 {
 	bool loadModels(const String& fileName,
 			Array<IndexedModel>& models, Array<uint32>& modelMaterialIndices,
-			Array<MaterialSpec>& materials);
+			Array<MaterialSpec>& materials,
+			enum InstanceFormat::Format instanceFormat = InstanceFormat::FORMAT_MATRIX);
 }
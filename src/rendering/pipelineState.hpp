@@ -0,0 +1,28 @@
+#pragma once
+
+#include "renderDevice.hpp"
+
+/**
+ * Handle to the fixed-function state of a set of DrawParams. Drawing with a
+ * handle skips comparing the params when the state is already bound, and
+ * otherwise only applies the groups of state that differ.
+ *
+ * Handles are shared by every PipelineState made from equal params and
+ * stay valid for the life of the device, so they can be freely copied.
+ */
+class PipelineState
+{
+public:
+	inline PipelineState(RenderDevice& device,
+			const RenderDevice::DrawParams& drawParams) :
+		deviceId(device.getPipelineState(drawParams)) {}
+
+	inline uint32 getId() const;
+private:
+	uint32 deviceId;
+};
+
+inline uint32 PipelineState::getId() const
+{
+	return deviceId;
+}
@@ -4,6 +4,7 @@
 #include "shader.hpp"
 #include "vertexArray.hpp"
 #include "renderTarget.hpp"
+#include "pipelineState.hpp"
 
 class RenderContext
 {
@@ -20,6 +21,11 @@ public:
 	inline void draw(Shader& shader, VertexArray& vertexArray, 
 			const RenderDevice::DrawParams& drawParams, uint32 numInstances,
 			uint32 numIndices);
+	inline void draw(Shader& shader, VertexArray& vertexArray,
+			const PipelineState& pipelineState, uint32 numInstances=1);
+	inline void draw(Shader& shader, VertexArray& vertexArray,
+			const PipelineState& pipelineState, uint32 numInstances,
+			uint32 numIndices);
 
 private:
 	RenderDevice* device;
@@ -41,6 +47,21 @@ inline void RenderContext::draw(Shader& shader, VertexArray& vertexArray,
 			drawParams, numInstances, numIndices);
 }
 
+inline void RenderContext::draw(Shader& shader, VertexArray& vertexArray,
+			const PipelineState& pipelineState, uint32 numInstances)
+{
+	device->draw(target->getId(), shader.getId(), vertexArray.getId(),
+			pipelineState.getId(), numInstances, vertexArray.getNumIndices());
+}
+
+inline void RenderContext::draw(Shader& shader, VertexArray& vertexArray,
+			const PipelineState& pipelineState, uint32 numInstances,
+			uint32 numIndices)
+{
+	device->draw(target->getId(), shader.getId(), vertexArray.getId(),
+			pipelineState.getId(), numInstances, numIndices);
+}
+
 inline void RenderContext::clear(bool shouldClearColor, bool shouldClearDepth,
 		bool shouldClearStencil, const Color& color, uint32 stencil)
 {
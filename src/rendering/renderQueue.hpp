@@ -0,0 +1,338 @@
+#pragma once
+
+#include "core/common.hpp"
+#include "core/memory.hpp"
+#include "dataStructures/array.hpp"
+#include "dataStructures/string.hpp"
+
+/**
+ * Records draws for a frame and submits them sorted by a 64-bit key, so
+ * draws sharing state are issued together regardless of the order they
+ * were recorded in.
+ *
+ * From the top bit down, the key holds the target, then the pass, then
+ * either the state (pipeline, shader, material, vertex array) followed by
+ * depth, for front to back drawing within each state, or depth first, for
+ * passes set to SORT_BACK_TO_FRONT. Targets are ordered by when they are
+ * first drawn to each frame, so rendering to a texture before drawing with
+ * it still works. Passes are ordered by number.
+ *
+ * Ids are truncated to fit their field. Ids that collide are sorted as one,
+ * which can cost state changes but never changes what is drawn, as the
+ * draws keep their full ids.
+ *
+ * Each draw can carry a range of a uniform buffer, such as a
+ * UniformBufferArena block, which flush binds to the block named by
+ * setUniformBufferName just before the draw is issued.
+ *
+ * Device is RenderDevice, or anything with the same draw function taking a
+ * pipeline state handle and setShaderUniformBufferRange.
+ */
+template<typename Device>
+class RenderQueue
+{
+public:
+	enum SortMode
+	{
+		SORT_STATE_FRONT_TO_BACK,
+		SORT_BACK_TO_FRONT
+	};
+
+	static const uint32 MAX_TARGETS = 16;
+	static const uint32 MAX_PASSES = 16;
+
+	/**
+	 * Called during flush before the first draw using a material, and
+	 * whenever the material changes. Binds the material's textures and
+	 * uniforms for the draws that follow.
+	 */
+	typedef void (*MaterialCallback)(uint32 material, void* userData);
+
+	RenderQueue(Device& device);
+
+	void setPassSortMode(uint32 pass, enum SortMode mode);
+	void setMaterialCallback(MaterialCallback callback, void* userData);
+	/** Shader uniform block that draws' uniform buffer ranges are bound to. */
+	void setUniformBufferName(const String& name);
+
+	/**
+	 * Records a draw. Depth is the distance from the viewer, and must not be
+	 * negative. Material is an id for the caller's material callback; 0 if
+	 * the draw has none. The uniform buffer range is bound for this draw
+	 * alone; a uniform buffer of 0 binds nothing.
+	 */
+	void submit(uint32 fbo, uint32 pass, uint32 pipelineState, uint32 shader,
+			uint32 material, uint32 vao, float depth,
+			uint32 numInstances, uint32 numIndices, uint32 uniformBuffer = 0,
+			uintptr uniformOffset = 0, uintptr uniformSize = 0);
+	/** Sorts and issues the recorded draws, then empties the queue. */
+	void flush();
+
+	/** Draws issued by the last flush. */
+	FORCEINLINE uint32 getNumDraws() const { return numDraws; }
+	/** Target, pipeline, shader, material and vertex array changes in the last flush. */
+	FORCEINLINE uint32 getNumStateChanges() const { return numStateChanges; }
+	/** State changes the last flush would have made without sorting. */
+	FORCEINLINE uint32 getNumUnsortedStateChanges() const
+	{
+		return numUnsortedStateChanges;
+	}
+	/**
+	 * Unsorted state changes less sorted ones. Negative when sorting cost
+	 * state changes, as back to front passes and colliding ids can.
+	 */
+	FORCEINLINE int32 getNumStateChangesSaved() const
+	{
+		return (int32)numUnsortedStateChanges - (int32)numStateChanges;
+	}
+
+	/** Sorts keys in ascending order, moving indices along with them. */
+	static void radixSort(uint64* keys, uint32* indices, uint32 count,
+			uint64* tempKeys, uint32* tempIndices);
+private:
+	struct DrawPacket
+	{
+		uint32 fbo;
+		uint32 pipelineState;
+		uint32 shader;
+		uint32 material;
+		uint32 vao;
+		uint32 numInstances;
+		uint32 numIndices;
+		uint32 uniformBuffer;
+		uintptr uniformOffset;
+		uintptr uniformSize;
+	};
+
+	Device* device;
+	enum SortMode passSortModes[MAX_PASSES];
+	MaterialCallback materialCallback;
+	void* materialUserData;
+	String uniformBufferName;
+
+	Array<DrawPacket> packets;
+	Array<uint64> keys;
+	Array<uint32> indices;
+	Array<uint64> tempKeys;
+	Array<uint32> tempIndices;
+	Array<uint32> targets;
+
+	uint32 numDraws;
+	uint32 numStateChanges;
+	uint32 numUnsortedStateChanges;
+	uint32 numPendingUnsortedStateChanges;
+
+	uint32 getTargetIndex(uint32 fbo);
+	static uint32 countStateChanges(const DrawPacket& previous, const DrawPacket& current);
+
+	NULL_COPY_AND_ASSIGN(RenderQueue);
+};
+
+template<typename Device>
+RenderQueue<Device>::RenderQueue(Device& deviceIn) :
+	device(&deviceIn),
+	materialCallback(nullptr),
+	materialUserData(nullptr),
+	numDraws(0),
+	numStateChanges(0),
+	numUnsortedStateChanges(0),
+	numPendingUnsortedStateChanges(0)
+{
+	for(uint32 i = 0; i < MAX_PASSES; i++) {
+		passSortModes[i] = SORT_STATE_FRONT_TO_BACK;
+	}
+}
+
+template<typename Device>
+void RenderQueue<Device>::setPassSortMode(uint32 pass, enum SortMode mode)
+{
+	assertCheck(pass < MAX_PASSES);
+	passSortModes[pass] = mode;
+}
+
+template<typename Device>
+void RenderQueue<Device>::setMaterialCallback(MaterialCallback callback, void* userData)
+{
+	materialCallback = callback;
+	materialUserData = userData;
+}
+
+template<typename Device>
+void RenderQueue<Device>::setUniformBufferName(const String& name)
+{
+	uniformBufferName = name;
+}
+
+template<typename Device>
+void RenderQueue<Device>::submit(uint32 fbo, uint32 pass, uint32 pipelineState,
+		uint32 shader, uint32 material, uint32 vao, float depth,
+		uint32 numInstances, uint32 numIndices, uint32 uniformBuffer,
+		uintptr uniformOffset, uintptr uniformSize)
+{
+	assertCheck(pass < MAX_PASSES);
+	DrawPacket packet;
+	packet.fbo = fbo;
+	packet.pipelineState = pipelineState;
+	packet.shader = shader;
+	packet.material = material;
+	packet.vao = vao;
+	packet.numInstances = numInstances;
+	packet.numIndices = numIndices;
+	packet.uniformBuffer = uniformBuffer;
+	packet.uniformOffset = uniformOffset;
+	packet.uniformSize = uniformSize;
+
+	// Non-negative floats order the same as their bits, so the top bits of
+	// the float are a depth that needs no range.
+	uint32 depthBits = 0;
+	if(depth > 0.0f) {
+		Memory::memcpy(&depthBits, &depth, sizeof(depthBits));
+	}
+
+	uint64 key = (uint64)getTargetIndex(fbo) << 60 | (uint64)pass << 56;
+	if(passSortModes[pass] == SORT_BACK_TO_FRONT) {
+		key |= (uint64)(~depthBits >> 7 & 0xFFFFFF) << 32
+			| (uint64)(pipelineState & 0xFF) << 24
+			| (uint64)(shader & 0xFF) << 16
+			| (uint64)(material & 0xFF) << 8
+			| (uint64)(vao & 0xFF);
+	} else {
+		key |= (uint64)(pipelineState & 0xFF) << 48
+			| (uint64)(shader & 0x3FF) << 38
+			| (uint64)(material & 0x3FF) << 28
+			| (uint64)(vao & 0x3FF) << 18
+			| (uint64)(depthBits >> 13 & 0x3FFFF);
+	}
+
+	if(packets.empty()) {
+		numPendingUnsortedStateChanges = 0;
+	} else {
+		numPendingUnsortedStateChanges += countStateChanges(packets.back(), packet);
+	}
+	keys.push_back(key);
+	indices.push_back(packets.size());
+	packets.push_back(packet);
+}
+
+template<typename Device>
+void RenderQueue<Device>::flush()
+{
+	numDraws = packets.size();
+	numStateChanges = 0;
+	numUnsortedStateChanges = numPendingUnsortedStateChanges;
+	numPendingUnsortedStateChanges = 0;
+	if(numDraws == 0) {
+		targets.clear();
+		return;
+	}
+
+	tempKeys.resize(numDraws);
+	tempIndices.resize(numDraws);
+	radixSort(&keys[0], &indices[0], numDraws, &tempKeys[0], &tempIndices[0]);
+
+	const DrawPacket* previous = nullptr;
+	for(uint32 i = 0; i < numDraws; i++) {
+		const DrawPacket& packet = packets[indices[i]];
+		if(previous != nullptr) {
+			numStateChanges += countStateChanges(*previous, packet);
+		}
+		if(materialCallback != nullptr
+				&& (previous == nullptr || previous->material != packet.material)) {
+			materialCallback(packet.material, materialUserData);
+		}
+		// The binding is per shader, so a new shader needs it again even
+		// for the same range
+		if(packet.uniformBuffer != 0 && (previous == nullptr
+					|| previous->shader != packet.shader
+					|| previous->uniformBuffer != packet.uniformBuffer
+					|| previous->uniformOffset != packet.uniformOffset
+					|| previous->uniformSize != packet.uniformSize)) {
+			assertCheck(!uniformBufferName.empty());
+			device->setShaderUniformBufferRange(packet.shader, uniformBufferName,
+					packet.uniformBuffer, packet.uniformOffset, packet.uniformSize);
+		}
+		device->draw(packet.fbo, packet.shader, packet.vao, packet.pipelineState,
+				packet.numInstances, packet.numIndices);
+		previous = &packet;
+	}
+
+	packets.clear();
+	keys.clear();
+	indices.clear();
+	targets.clear();
+}
+
+template<typename Device>
+void RenderQueue<Device>::radixSort(uint64* keys, uint32* indices, uint32 count,
+		uint64* tempKeys, uint32* tempIndices)
+{
+	// All eight digit histograms are built in one pass over the keys
+	uint32 counts[8][256];
+	Memory::memzero(counts, sizeof(counts));
+	for(uint32 i = 0; i < count; i++) {
+		uint64 key = keys[i];
+		for(uint32 digit = 0; digit < 8; digit++) {
+			counts[digit][(key >> (digit * 8)) & 0xFF]++;
+		}
+	}
+
+	uint64* srcKeys = keys;
+	uint32* srcIndices = indices;
+	uint64* destKeys = tempKeys;
+	uint32* destIndices = tempIndices;
+	for(uint32 digit = 0; digit < 8; digit++) {
+		uint32 shift = digit * 8;
+		// Digits every key shares, such as unused passes, don't need a pass
+		if(counts[digit][(srcKeys[0] >> shift) & 0xFF] == count) {
+			continue;
+		}
+
+		uint32 offsets[256];
+		uint32 total = 0;
+		for(uint32 i = 0; i < 256; i++) {
+			offsets[i] = total;
+			total += counts[digit][i];
+		}
+		for(uint32 i = 0; i < count; i++) {
+			uint32 dest = offsets[(srcKeys[i] >> shift) & 0xFF]++;
+			destKeys[dest] = srcKeys[i];
+			destIndices[dest] = srcIndices[i];
+		}
+
+		uint64* swapKeys = srcKeys;
+		srcKeys = destKeys;
+		destKeys = swapKeys;
+		uint32* swapIndices = srcIndices;
+		srcIndices = destIndices;
+		destIndices = swapIndices;
+	}
+
+	if(srcKeys != keys) {
+		Memory::memcpy(keys, srcKeys, count * sizeof(uint64));
+		Memory::memcpy(indices, srcIndices, count * sizeof(uint32));
+	}
+}
+
+template<typename Device>
+uint32 RenderQueue<Device>::getTargetIndex(uint32 fbo)
+{
+	for(uint32 i = 0; i < targets.size(); i++) {
+		if(targets[i] == fbo) {
+			return i;
+		}
+	}
+	assertCheck(targets.size() < MAX_TARGETS);
+	targets.push_back(fbo);
+	return targets.size() - 1;
+}
+
+template<typename Device>
+uint32 RenderQueue<Device>::countStateChanges(const DrawPacket& previous,
+		const DrawPacket& current)
+{
+	return (previous.fbo != current.fbo)
+		+ (previous.pipelineState != current.pipelineState)
+		+ (previous.shader != current.shader)
+		+ (previous.material != current.material)
+		+ (previous.vao != current.vao);
+}
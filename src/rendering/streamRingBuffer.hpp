@@ -0,0 +1,228 @@
+#pragma once
+
+#include "core/common.hpp"
+#include "core/memory.hpp"
+#include "math/math.hpp"
+#include "dataStructures/array.hpp"
+
+/**
+ * Ring buffer allocator for data rewritten every frame, such as instance
+ * transforms and dynamic vertices.
+ *
+ * Where the device supports persistent mapping, allocations are pointers
+ * straight into GPU-visible memory and nothing is copied. Each frame's
+ * allocations are guarded by a fence at endFrame, and are only reused
+ * once that fence is signaled, so a writer never stalls on data the GPU is
+ * still reading unless the ring is too small for the frames in flight.
+ * endFrame also retires the frames whose fences have signaled since, so
+ * only the frames the GPU is still working on hold a fence.
+ *
+ * Otherwise allocations come from a CPU copy that flush uploads, and
+ * wrapping around orphans the buffer instead of waiting on fences.
+ *
+ * Device is RenderDevice, or anything with the same stream buffer and
+ * fence functions, which lets the allocation and fencing be tested without
+ * a GPU.
+ */
+template<typename Device>
+class StreamRingBuffer
+{
+public:
+	StreamRingBuffer(Device& device, uintptr size);
+	~StreamRingBuffer();
+
+	/**
+	 * Returns space for size bytes in the current frame, at an alignment
+	 * that must be a power of 2, and sets offset to its place in the buffer.
+	 *
+	 * Waits on older frames' fences if the ring is full. Returns nullptr,
+	 * without waiting, if size is larger than the whole ring, and after
+	 * waiting if the current frame alone has no room left.
+	 */
+	void* allocate(uintptr size, uintptr alignment, uintptr* offset);
+	/** Makes this frame's writes visible to the device. Call before drawing with them. */
+	void flush();
+	/** Call once the draws using this frame's allocations are issued. */
+	void endFrame();
+
+	FORCEINLINE uint32 getId() const { return deviceId; }
+	FORCEINLINE uintptr getSize() const { return size; }
+	FORCEINLINE bool isPersistentlyMapped() const { return persistentlyMapped; }
+	/** Number of times allocate had to wait on a fence so far. */
+	FORCEINLINE uint32 getNumFenceWaits() const { return numFenceWaits; }
+	/** Frames whose fences haven't been seen to signal yet. */
+	FORCEINLINE uint32 getNumFramesInFlight() const { return numFramesInFlight; }
+private:
+	struct Frame
+	{
+		uint32 fence;
+		uintptr bytes;
+	};
+
+	Device* device;
+	uint32 deviceId;
+	uintptr size;
+	uint8* data;
+	bool persistentlyMapped;
+
+	uintptr head;
+	uintptr usedBytes;
+	uintptr frameBytes;
+	// Ring of numFramesInFlight frames, oldest first from oldestFrame,
+	// which grows when every entry is in use
+	Array<Frame> framesInFlight;
+	uint32 oldestFrame;
+	uint32 numFramesInFlight;
+	uint32 numFenceWaits;
+
+	// Unflushed writes when not persistently mapped. After a wrap, the
+	// writes before it end at wrapEnd and are uploaded first.
+	uintptr flushStart;
+	uintptr wrapEnd;
+
+	void addFrame(const Frame& frame);
+	void retireOldestFrame();
+
+	NULL_COPY_AND_ASSIGN(StreamRingBuffer);
+};
+
+template<typename Device>
+StreamRingBuffer<Device>::StreamRingBuffer(Device& deviceIn, uintptr sizeIn) :
+	device(&deviceIn),
+	size(sizeIn),
+	head(0),
+	usedBytes(0),
+	frameBytes(0),
+	oldestFrame(0),
+	numFramesInFlight(0),
+	numFenceWaits(0),
+	flushStart(0),
+	wrapEnd(0)
+{
+	void* mappedData = nullptr;
+	deviceId = device->createStreamBuffer(size, &mappedData);
+	persistentlyMapped = mappedData != nullptr;
+	data = persistentlyMapped ? (uint8*)mappedData : (uint8*)Memory::malloc(size);
+}
+
+template<typename Device>
+StreamRingBuffer<Device>::~StreamRingBuffer()
+{
+	for(uint32 i = 0; i < numFramesInFlight; i++) {
+		device->releaseFence(framesInFlight[(oldestFrame + i) % framesInFlight.size()].fence);
+	}
+	if(!persistentlyMapped) {
+		Memory::free(data);
+	}
+	deviceId = device->releaseStreamBuffer(deviceId);
+}
+
+template<typename Device>
+void* StreamRingBuffer<Device>::allocate(uintptr allocSize, uintptr alignment,
+		uintptr* offset)
+{
+	assertCheck((alignment & (alignment - 1)) == 0);
+	if(allocSize > size) {
+		return nullptr;
+	}
+	uintptr start = (head + alignment - 1) & ~(alignment - 1);
+	bool wraps = start + allocSize > size;
+	if(wraps) {
+		start = 0;
+	}
+	// Skipped bytes count as used until their frame retires
+	uintptr needed = (wraps ? size - head : start - head) + allocSize;
+
+	while(size - usedBytes < needed) {
+		if(numFramesInFlight == 0) {
+			return nullptr;
+		}
+		device->waitFence(framesInFlight[oldestFrame].fence);
+		retireOldestFrame();
+		numFenceWaits++;
+	}
+
+	if(wraps && !persistentlyMapped) {
+		// Draws issued so far keep the old storage. Unflushed writes are
+		// still in the CPU copy, and are uploaded to the new storage.
+		device->orphanStreamBuffer(deviceId, size);
+		wrapEnd = head;
+	}
+	usedBytes += needed;
+	frameBytes += needed;
+	head = start + allocSize;
+	*offset = start;
+	return data + start;
+}
+
+template<typename Device>
+void StreamRingBuffer<Device>::flush()
+{
+	if(persistentlyMapped) {
+		return;
+	}
+	if(wrapEnd != 0) {
+		if(wrapEnd > flushStart) {
+			device->updateStreamBuffer(deviceId, flushStart, data + flushStart,
+					wrapEnd - flushStart);
+		}
+		flushStart = 0;
+		wrapEnd = 0;
+	}
+	if(head > flushStart) {
+		device->updateStreamBuffer(deviceId, flushStart, data + flushStart,
+				head - flushStart);
+	}
+	flushStart = head;
+}
+
+template<typename Device>
+void StreamRingBuffer<Device>::endFrame()
+{
+	if(!persistentlyMapped) {
+		// Orphaning stands in for fences, so only the current frame has to
+		// fit in the ring.
+		flush();
+		usedBytes = 0;
+		frameBytes = 0;
+		return;
+	}
+
+	while(numFramesInFlight > 0
+			&& device->isFenceSignaled(framesInFlight[oldestFrame].fence)) {
+		device->releaseFence(framesInFlight[oldestFrame].fence);
+		retireOldestFrame();
+	}
+
+	Frame frame;
+	frame.fence = device->createFence();
+	frame.bytes = frameBytes;
+	addFrame(frame);
+	frameBytes = 0;
+}
+
+template<typename Device>
+void StreamRingBuffer<Device>::addFrame(const Frame& frame)
+{
+	uint32 capacity = framesInFlight.size();
+	if(numFramesInFlight == capacity) {
+		Array<Frame> frames(Math::max(capacity * 2, 4u));
+		for(uint32 i = 0; i < numFramesInFlight; i++) {
+			frames[i] = framesInFlight[(oldestFrame + i) % capacity];
+		}
+		framesInFlight.swap(frames);
+		oldestFrame = 0;
+		capacity = framesInFlight.size();
+	}
+	framesInFlight[(oldestFrame + numFramesInFlight) % capacity] = frame;
+	numFramesInFlight++;
+}
+
+// The oldest frame's fence must already be waited on or released
+template<typename Device>
+void StreamRingBuffer<Device>::retireOldestFrame()
+{
+	usedBytes -= framesInFlight[oldestFrame].bytes;
+	oldestFrame = (oldestFrame + 1) % framesInFlight.size();
+	numFramesInFlight--;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "streamRingBuffer.hpp"
+#include "dataStructures/string.hpp"
+
+/**
+ * Shared uniform buffer that per-draw constant blocks are sub-allocated
+ * from, instead of each block having a buffer of its own.
+ *
+ * Blocks are written linearly into a StreamRingBuffer at the device's
+ * uniform buffer offset alignment, and each draw binds its block's range.
+ * A frame's blocks are written first, then flushed together, which is a
+ * single upload at most, before any of them are drawn with.
+ *
+ * Device is RenderDevice, or anything StreamRingBuffer accepts that also
+ * has getUniformBufferOffsetAlignment and setShaderUniformBufferRange.
+ */
+template<typename Device>
+class UniformBufferArena
+{
+public:
+	struct Block
+	{
+		void* data;
+		uintptr offset;
+		uintptr size;
+	};
+
+	UniformBufferArena(Device& device, uintptr size);
+
+	/**
+	 * Sets block to dataSize bytes of this frame's space to write to. Returns
+	 * false, with block empty, if the frame has run out of space.
+	 */
+	bool allocate(uintptr dataSize, Block* block);
+	/** Allocates a block and copies data into it. */
+	bool upload(const void* data, uintptr dataSize, Block* block);
+	/** Makes this frame's blocks visible to the device. Call before binding them. */
+	FORCEINLINE void flush() { ring.flush(); }
+	/** Binds block to the named uniform block of shader for the next draws. */
+	void bind(uint32 shader, const String& uniformBufferName, const Block& block);
+	/** Call once the draws using this frame's blocks are issued. */
+	void endFrame();
+
+	FORCEINLINE uint32 getId() const { return ring.getId(); }
+	/** Blocks allocated so far this frame. */
+	FORCEINLINE uint32 getNumBlocks() const { return numBlocks; }
+	/** Bytes allocated so far this frame, not counting alignment padding. */
+	FORCEINLINE uintptr getBytesAllocated() const { return bytesAllocated; }
+private:
+	Device* device;
+	StreamRingBuffer<Device> ring;
+	uintptr alignment;
+	uint32 numBlocks;
+	uintptr bytesAllocated;
+
+	NULL_COPY_AND_ASSIGN(UniformBufferArena);
+};
+
+template<typename Device>
+UniformBufferArena<Device>::UniformBufferArena(Device& deviceIn, uintptr size) :
+	device(&deviceIn),
+	ring(deviceIn, size),
+	alignment(deviceIn.getUniformBufferOffsetAlignment()),
+	numBlocks(0),
+	bytesAllocated(0) {}
+
+template<typename Device>
+bool UniformBufferArena<Device>::allocate(uintptr dataSize, Block* block)
+{
+	block->data = ring.allocate(dataSize, alignment, &block->offset);
+	block->size = dataSize;
+	if(block->data == nullptr) {
+		block->offset = 0;
+		block->size = 0;
+		return false;
+	}
+	numBlocks++;
+	bytesAllocated += dataSize;
+	return true;
+}
+
+template<typename Device>
+bool UniformBufferArena<Device>::upload(const void* data, uintptr dataSize,
+		Block* block)
+{
+	if(!allocate(dataSize, block)) {
+		return false;
+	}
+	Memory::memcpy(block->data, data, dataSize);
+	return true;
+}
+
+template<typename Device>
+void UniformBufferArena<Device>::bind(uint32 shader, const String& uniformBufferName,
+		const Block& block)
+{
+	device->setShaderUniformBufferRange(shader, uniformBufferName, ring.getId(),
+			block.offset, block.size);
+}
+
+template<typename Device>
+void UniformBufferArena<Device>::endFrame()
+{
+	ring.endFrame();
+	numBlocks = 0;
+	bytesAllocated = 0;
+}
@@ -17,6 +17,9 @@ public:
 	}
 
 	inline void updateBuffer(uint32 bufferIndex, const void* data, uintptr dataSize);
+	inline void updateBufferRange(uint32 bufferIndex, uintptr offset,
+			const void* data, uintptr dataSize);
+	inline void setBufferSource(uint32 bufferIndex, uint32 buffer, uintptr offset);
 
 	inline uint32 getId();
 	inline uint32 getNumIndices();
@@ -44,3 +47,14 @@ inline void VertexArray::updateBuffer(uint32 bufferIndex,
 	return device->updateVertexArrayBuffer(deviceId, bufferIndex, data, dataSize);
 }
 
+inline void VertexArray::updateBufferRange(uint32 bufferIndex, uintptr offset,
+		const void* data, uintptr dataSize)
+{
+	device->updateVertexArrayBufferRange(deviceId, bufferIndex, offset, data, dataSize);
+}
+
+inline void VertexArray::setBufferSource(uint32 bufferIndex, uint32 buffer,
+		uintptr offset)
+{
+	device->setVertexArrayBufferSource(deviceId, bufferIndex, buffer, offset);
+}
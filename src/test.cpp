@@ -1,10 +1,32 @@
 #include "tests.hpp"
 #include "core/timing.hpp"
 #include "math/transform.hpp"
+#include "math/matrixArray4.hpp"
+#include "math/affineMatrix.hpp"
+#include "math/packedTransform.hpp"
+#include "math/transformStream.hpp"
 #include "math/sphere.hpp"
 #include "math/aabb.hpp"
 #include "math/plane.hpp"
 #include "math/intersects.hpp"
+#include "math/aabbArray.hpp"
+#include "math/sphereArray.hpp"
+#include "math/bvh.hpp"
+#include "math/rayPacket.hpp"
+#include "math/dynamicAABBTree.hpp"
+#include "math/sweepAndPrune.hpp"
+#include "math/simdKernels.hpp"
+#include "core/cpuInfo.hpp"
+#include "core/frameArena.hpp"
+#include "core/memoryTracker.hpp"
+#include "rendering/modelLoader.hpp"
+#include "rendering/instanceFormat.hpp"
+#include "rendering/dirtyRangeTracker.hpp"
+#include "dataStructures/array.hpp"
+#include "dataStructures/map.hpp"
+#include "dataStructures/string.hpp"
+#include "platform/generic/sizeClassAllocator.hpp"
+#include <thread>
 
 static void testSphere()
 {
@@ -294,6 +316,1140 @@ void testMemory()
 
 }
 
+static Transform randomTransform()
+{
+	return Transform(
+			Vector3f(Math::randf(-10.0f, 10.0f), Math::randf(-10.0f, 10.0f),
+				Math::randf(-10.0f, 10.0f)),
+			Quaternion(Vector3f(Math::randf(), Math::randf(),
+					Math::randf() + 0.1f).normalized(), Math::randf(-3.0f, 3.0f)),
+			Vector3f(Math::randf(0.5f, 2.0f), Math::randf(0.5f, 2.0f),
+				Math::randf(0.5f, 2.0f)));
+}
+
+static void testMatrixBatch()
+{
+	// Odd count so both the SIMD body and the scalar tail are covered
+	const uint32 count = 19;
+	Array<Transform> transforms;
+	for(uint32 i = 0; i < count; i++) {
+		transforms.push_back(randomTransform());
+	}
+	Array<Matrix> batchResult(count);
+	Matrix::transformMatrixBatch(&transforms[0], &batchResult[0], count);
+	for(uint32 i = 0; i < count; i++) {
+		assert(batchResult[i].equals(transforms[i].toMatrix()));
+	}
+
+	Matrix pre(Matrix::perspective(Math::toRadians(35.0f), 4.0f/3.0f, 0.1f, 1000.0f));
+	Matrix post(randomTransform().toMatrix());
+	Array<Matrix> mulResult(count);
+	Matrix::mulBatch(pre, &batchResult[0], post, &mulResult[0], count);
+	for(uint32 i = 0; i < count; i++) {
+		assert(mulResult[i].equals(pre * batchResult[i] * post, 1.e-3f));
+	}
+}
+
+static void testMatrixArray4()
+{
+	// Odd count so the identity-padded last group is covered
+	const uint32 count = 19;
+	Matrix proj(Matrix::perspective(Math::toRadians(35.0f), 4.0f/3.0f, 0.1f, 1000.0f));
+	Array<Matrix> affine(count);
+	Array<Matrix> projected(count);
+	for(uint32 i = 0; i < count; i++) {
+		affine[i] = randomTransform().toMatrix();
+		projected[i] = proj * affine[i];
+	}
+
+	Array<Matrix> result(count);
+	MatrixArray4::inverseBatch(&projected[0], &result[0], count);
+	for(uint32 i = 0; i < count; i++) {
+		assert(result[i].equals(projected[i].inverse(), 1.e-3f));
+		assert((result[i] * projected[i]).equals(Matrix::identity(), 1.e-3f));
+	}
+	MatrixArray4::inverseAffineBatch(&affine[0], &result[0], count);
+	for(uint32 i = 0; i < count; i++) {
+		assert(result[i].equals(affine[i].inverse()));
+	}
+	MatrixArray4::toNormalMatrixAffineBatch(&affine[0], &result[0], count);
+	for(uint32 i = 0; i < count; i++) {
+		assert(result[i].equals(affine[i].toNormalMatrix()));
+	}
+
+	// Results may overwrite the input
+	result = affine;
+	MatrixArray4::inverseAffineBatch(&result[0], &result[0], count);
+	for(uint32 i = 0; i < count; i++) {
+		assert(result[i].equals(affine[i].inverse()));
+	}
+
+	MatrixArray4 mats(MatrixArray4::load(&affine[0]));
+	(mats * MatrixArray4::load(&projected[0])).store(&result[0]);
+	for(uint32 i = 0; i < 4; i++) {
+		assert(result[i].equals(affine[i] * projected[i], 1.e-3f));
+	}
+	float dets[4];
+	mats.determinant4x4().store4f(dets);
+	for(uint32 i = 0; i < 4; i++) {
+		assert(Math::abs(dets[i] - affine[i].determinant4x4()) < 1.e-3f);
+	}
+}
+
+static void testAffineMatrix()
+{
+	const uint32 count = 19;
+	Array<Transform> transforms;
+	Array<Matrix> mats(count);
+	for(uint32 i = 0; i < count; i++) {
+		transforms.push_back(randomTransform());
+		mats[i] = transforms[i].toMatrix();
+		assert(mats[i].isAffine());
+	}
+
+	for(uint32 i = 0; i < count; i++) {
+		AffineMatrix affine(mats[i]);
+		AffineMatrix other(mats[(i + 1) % count]);
+		assert((affine * other).toMatrix().equals(mats[i] * mats[(i + 1) % count], 1.e-3f));
+		assert(affine.inverse().toMatrix().equals(mats[i].inverse()));
+		assert((affine * affine.inverse()).equals(AffineMatrix::identity()));
+		assert(transforms[i].inverse().equals(mats[i].inverse()));
+		assert(Math::abs(affine.determinant() - mats[i].determinant3x3()) < 1.e-3f);
+		assert(mats[i].toNormalMatrix().equals(mats[i].inverse().transpose()));
+
+		Vector point(Vector::make(Math::randf(-10.0f, 10.0f), Math::randf(-10.0f, 10.0f),
+					Math::randf(-10.0f, 10.0f), 1.0f));
+		assert(affine.transform(point).notEquals(mats[i].transform(point), 1.e-4f)
+				.isZero4f());
+	}
+
+	// Projective matrices still take the general path
+	Matrix proj(Matrix::perspective(Math::toRadians(35.0f), 4.0f/3.0f, 0.1f, 1000.0f));
+	assert(!proj.isAffine());
+	assert(proj.toNormalMatrix().equals(proj.inverse().transpose()));
+
+	Array<Matrix> normals(count);
+	Matrix::toNormalMatrixBatch(&mats[0], &normals[0], count);
+	for(uint32 i = 0; i < count; i++) {
+		assert(normals[i].equals(mats[i].inverse().transpose()));
+	}
+}
+
+static void testPackedTransform()
+{
+	Vector3f vec(1.0f, -2.0f, 3.0f);
+	Float3 packed(vec);
+	assert(packed.x == 1.0f && packed.y == -2.0f && packed.z == 3.0f);
+	assert(packed.load() == vec);
+
+	// Odd count so the kernels' scalar tail is covered
+	const uint32 count = 19;
+	Array<Transform> transforms;
+	Array<PackedTransform> packedTransforms;
+	TransformStream stream;
+	for(uint32 i = 0; i < count; i++) {
+		transforms.push_back(randomTransform());
+		packedTransforms.push_back(PackedTransform(transforms[i]));
+		stream.add(transforms[i]);
+	}
+	for(uint32 i = 0; i < count; i++) {
+		Transform unpacked(packedTransforms[i].load());
+		Transform fromStream(stream.get(i));
+		assert(unpacked.toMatrix() == transforms[i].toMatrix());
+		assert(fromStream.toMatrix() == transforms[i].toMatrix());
+	}
+
+	const SIMDKernelTable* tables[] = {
+		SIMDKernels::getBaselineTable(), SIMDKernels::getAVX2Table()
+	};
+	for(uint32 i = 0; i < ARRAY_SIZE_IN_ELEMENTS(tables); i++) {
+		if(tables[i] == nullptr
+				|| &SIMDKernels::select(tables[i]->simdLevel) != tables[i]) {
+			continue;
+		}
+		Array<Matrix> mats(count);
+		stream.toMatrices(&mats[0]);
+		for(uint32 j = 0; j < count; j++) {
+			assert(mats[j].equals(transforms[j].toMatrix()));
+		}
+	}
+	SIMDKernels::select(SIMD_LEVEL_x86_AVX2);
+
+	stream.removeSwap(3);
+	assert(stream.size() == count - 1);
+	assert(stream.get(3).toMatrix() == transforms[count - 1].toMatrix());
+}
+
+// Packs transforms into format, returning the element arrays
+static void packInstances(enum InstanceFormat::Format format,
+		const Array<Transform>& transforms, Array<float>* data, void** elements)
+{
+	for(uint32 i = 0; i < InstanceFormat::getNumElements(format); i++) {
+		data[i].resize(transforms.size() * InstanceFormat::getElementSize(format, i));
+		elements[i] = &data[i][0];
+	}
+	InstanceFormat::pack(format, &transforms[0], elements, (uint32)transforms.size());
+}
+
+static void testInstanceFormat()
+{
+	assert(InstanceFormat::getInstanceSize(InstanceFormat::FORMAT_MATRIX) == 64);
+	assert(InstanceFormat::getInstanceSize(
+				InstanceFormat::FORMAT_TRANSLATION_ROTATION_SCALE) == 40);
+	assert(InstanceFormat::getInstanceSize(
+				InstanceFormat::FORMAT_TRANSLATION_ROTATION_UNIFORM_SCALE) == 32);
+	assert(InstanceFormat::getInstanceSize(
+				InstanceFormat::FORMAT_SMALLEST_THREE_UNIFORM_SCALE) == 20);
+
+	// Either sign of a quaternion is the same rotation, and packs the same
+	Quaternion rotation(Vector3f(0.2f, -1.0f, 0.4f).normalized(), 2.5f);
+	uint32 packed = InstanceFormat::packQuaternionSmallestThree(rotation);
+	assert(packed == InstanceFormat::packQuaternionSmallestThree(
+				Quaternion(-rotation.toVector())));
+	Quaternion unpacked(InstanceFormat::unpackQuaternionSmallestThree(packed));
+	assert(Math::abs(unpacked.dot(rotation)) > 0.99999f);
+	unpacked = InstanceFormat::unpackQuaternionSmallestThree(
+			InstanceFormat::packQuaternionSmallestThree(Quaternion(0.0f, 0.0f, 0.0f, 1.0f)));
+	assert(unpacked.toVector()[3] > 0.99999f);
+
+	// Odd count so any unaligned tails are covered
+	const uint32 count = 19;
+	Array<Transform> transforms;
+	Array<Transform> uniformTransforms;
+	for(uint32 i = 0; i < count; i++) {
+		transforms.push_back(randomTransform());
+		uniformTransforms.push_back(transforms[i]);
+		uniformTransforms[i].setScale(Vector3f(transforms[i].getScale()[0]));
+	}
+
+	// The 10 bit rotation is off by about 1e-3 per component
+	const float errorMargins[] = { 1.e-4f, 1.e-4f, 1.e-4f, 1.e-2f };
+	for(uint32 format = 0; format < InstanceFormat::NUM_FORMATS; format++) {
+		const Array<Transform>& source =
+			format >= InstanceFormat::FORMAT_TRANSLATION_ROTATION_UNIFORM_SCALE
+			? uniformTransforms : transforms;
+		Array<float> data[InstanceFormat::MAX_ELEMENTS];
+		void* elements[InstanceFormat::MAX_ELEMENTS];
+		packInstances((enum InstanceFormat::Format)format, source, data, elements);
+		for(uint32 i = 0; i < count; i++) {
+			Matrix mat(InstanceFormat::unpack((enum InstanceFormat::Format)format,
+						elements, i));
+			assert(mat.equals(source[i].toMatrix(), errorMargins[format]));
+		}
+		if(format == InstanceFormat::FORMAT_SMALLEST_THREE_UNIFORM_SCALE) {
+			// The 4-wide kernel must match the single quaternion version
+			for(uint32 i = 0; i < count; i++) {
+				assert(((uint32*)elements[1])[i] ==
+						InstanceFormat::packQuaternionSmallestThree(source[i].getRotation()));
+			}
+		}
+	}
+}
+
+static void testDirtyRangeTracker()
+{
+	// 4 elements per page, merging across a single clean page
+	DirtyRangeTracker tracker(4, 1);
+	Array<DirtyRangeTracker::Range> ranges;
+	tracker.resize(30);
+	tracker.getRanges(ranges);
+	assert(ranges.size() == 1 && ranges[0].start == 0 && ranges[0].count == 30);
+	tracker.clear();
+	assert(!tracker.isAnyDirty());
+	tracker.getRanges(ranges);
+	assert(ranges.empty());
+
+	tracker.markDirty(5);
+	assert(tracker.isDirty(4) && tracker.isDirty(7) && !tracker.isDirty(8));
+	tracker.markDirty(13);
+	tracker.markDirty(25);
+	tracker.markDirty(29);
+	tracker.getRanges(ranges);
+	assert(ranges.size() == 2);
+	assert(ranges[0].start == 4 && ranges[0].count == 12);
+	assert(ranges[1].start == 24 && ranges[1].count == 6);
+
+	// Growing marks the new elements, across several words of pages
+	tracker.clear();
+	tracker.resize(1000);
+	tracker.getRanges(ranges);
+	assert(ranges.size() == 1 && ranges[0].start == 28 && ranges[0].count == 972);
+	tracker.clear();
+	tracker.markDirty(250, 300);
+	tracker.getRanges(ranges);
+	assert(ranges.size() == 1 && ranges[0].start == 248 && ranges[0].count == 304);
+
+	// Shrinking drops dirty pages past the end
+	tracker.markAllDirty();
+	tracker.resize(10);
+	tracker.getRanges(ranges);
+	assert(ranges.size() == 1 && ranges[0].start == 0 && ranges[0].count == 10);
+}
+
+static void getTestFrustum(Plane* planes)
+{
+	Matrix viewProjection(
+			Matrix::perspective(Math::toRadians(35.0f), 4.0f/3.0f, 0.1f, 100.0f) *
+			Transform(Vector3f(1.0f, -2.0f, 3.0f)).toMatrix());
+	viewProjection.extractFrustumPlanes(planes);
+}
+
+static AABB randomAABB()
+{
+	Vector3f center(Math::randf(-60.0f, 60.0f), Math::randf(-60.0f, 60.0f),
+			Math::randf(-120.0f, 20.0f));
+	Vector3f extents(Math::randf(0.1f, 8.0f), Math::randf(0.1f, 8.0f),
+			Math::randf(0.1f, 8.0f));
+	return AABB(center - extents, center + extents);
+}
+
+static void testAABBArray()
+{
+	Plane planes[6];
+	getTestFrustum(planes);
+
+	AABBArray aabbs;
+	const uint32 count = 1000;
+	for(uint32 i = 0; i < count; i++) {
+		aabbs.add(randomAABB());
+	}
+	Array<uint64> visibleBits(aabbs.getNumBitmaskWords());
+	Array<uint64> intersectingBits(aabbs.getNumBitmaskWords());
+	aabbs.cullFrustum(planes, &visibleBits[0], &intersectingBits[0]);
+
+	uint32 numVisible = 0;
+	uint32 numIntersecting = 0;
+	for(uint32 i = 0; i < count; i++) {
+		Vector3f center, extents;
+		aabbs.get(i).getCenterAndExtents(center, extents);
+		bool isVisible = true;
+		bool isInside = true;
+		for(uint32 j = 0; j < 6; j++) {
+			bool isFullyInside, isPartiallyInside;
+			Intersects::intersectPlaneAABBFast(center.toVector(1.0f),
+					extents.toVector(0.0f), planes[j], planes[j].abs(),
+					isFullyInside, isPartiallyInside);
+			isVisible = isVisible && isPartiallyInside;
+			isInside = isInside && isFullyInside;
+		}
+		bool visibleBit = (visibleBits[i/64] >> (i%64)) & 1;
+		bool intersectingBit = (intersectingBits[i/64] >> (i%64)) & 1;
+		assert(visibleBit == isVisible);
+		assert(intersectingBit == (isVisible && !isInside));
+		numVisible += isVisible;
+		numIntersecting += intersectingBit;
+	}
+	// Make sure the test data covers all three outcomes
+	assert(numVisible > 0 && numVisible < count);
+	assert(numIntersecting > 0 && numIntersecting < numVisible);
+
+	aabbs.removeSwap(0);
+	assert(aabbs.size() == count - 1);
+}
+
+static Sphere randomSphere()
+{
+	return Sphere(Vector3f(Math::randf(-60.0f, 60.0f), Math::randf(-60.0f, 60.0f),
+				Math::randf(-120.0f, 20.0f)), Math::randf(0.1f, 8.0f));
+}
+
+static void testSphereArray()
+{
+	Plane planes[6];
+	getTestFrustum(planes);
+
+	SphereArray spheres;
+	const uint32 count = 1001;
+	for(uint32 i = 0; i < count; i++) {
+		spheres.add(randomSphere());
+	}
+	Array<uint64> visibleBits(spheres.getNumBitmaskWords());
+	Array<uint64> intersectingBits(spheres.getNumBitmaskWords());
+	Array<uint32> visibleIndices(spheres.size());
+	spheres.cullFrustum(planes, &visibleBits[0], &intersectingBits[0]);
+	uint32 numVisibleIndices = spheres.cullFrustum(planes, &visibleIndices[0]);
+
+	uint32 numVisible = 0;
+	uint32 numIntersecting = 0;
+	for(uint32 i = 0; i < count; i++) {
+		Sphere sphere = spheres.get(i);
+		bool isVisible = true;
+		bool isInside = true;
+		for(uint32 j = 0; j < 6; j++) {
+			bool isFullyInside, isPartiallyInside;
+			Intersects::intersectPlaneSphere(sphere, planes[j],
+					isFullyInside, isPartiallyInside);
+			isVisible = isVisible && isPartiallyInside;
+			isInside = isInside && isFullyInside;
+		}
+		bool visibleBit = (visibleBits[i/64] >> (i%64)) & 1;
+		bool intersectingBit = (intersectingBits[i/64] >> (i%64)) & 1;
+		assert(visibleBit == isVisible);
+		assert(intersectingBit == (isVisible && !isInside));
+		if(isVisible) {
+			assert(numVisible < numVisibleIndices);
+			assert(visibleIndices[numVisible] == i);
+			numVisible++;
+		}
+		numIntersecting += intersectingBit;
+	}
+	assert(numVisible == numVisibleIndices);
+	assert(numVisible > 0 && numVisible < count);
+	assert(numIntersecting > 0 && numIntersecting < numVisible);
+}
+
+// Brute force Moller-Trumbore for checking BVH results
+static void testSIMDKernelTable(const SIMDKernelTable& table)
+{
+	// Odd sizes exercise the partial words at the end
+	const uint32 numBits = 64*5 + 37;
+	uint64 bits[6];
+	for(uint32 i = 0; i < ARRAY_SIZE_IN_ELEMENTS(bits); i++) {
+		bits[i] = ((uint64)Math::rand() << 32) ^ (uint64)Math::rand();
+	}
+	bits[1] = 0;
+	bits[2] = ~((uint64)0);
+	uint32 indices[numBits];
+	uint32 numIndices = table.bitmaskToIndices(bits, numBits, indices);
+	uint32 expected = 0;
+	for(uint32 i = 0; i < numBits; i++) {
+		if(bits[i/64] & (((uint64)1) << (i%64))) {
+			assert(expected < numIndices && indices[expected] == i);
+			expected++;
+		}
+	}
+	assert(numIndices == expected);
+
+	// Large enough to take the streaming path, from a misaligned source
+	const uintptr copySize = 3*1024*1024 + 77;
+	Array<uint8> src(copySize + 3);
+	Array<uint8> dest(copySize + 1);
+	for(uintptr i = 0; i < src.size(); i++) {
+		src[i] = (uint8)(i * 7 + (i >> 9));
+	}
+	dest[copySize] = 0xCD;
+	table.memcpy(&dest[0], &src[3], copySize);
+	for(uintptr i = 0; i < copySize; i++) {
+		assert(dest[i] == src[i + 3]);
+	}
+	assert(dest[copySize] == 0xCD);
+}
+
+static void testSIMDKernels()
+{
+	// Every build linked in must match the baseline, which the tests above
+	// already check against the scalar code. Selecting SIMD_LEVEL_NONE
+	// always picks the baseline.
+	Plane planes[6];
+	getTestFrustum(planes);
+	AABBArray aabbs;
+	SphereArray spheres;
+	for(uint32 i = 0; i < 1001; i++) {
+		aabbs.add(randomAABB());
+		spheres.add(randomSphere());
+	}
+	Array<uint64> baseVisible(aabbs.getNumBitmaskWords());
+	Array<uint64> baseIntersecting(aabbs.getNumBitmaskWords());
+	Array<uint64> baseSphereVisible(spheres.getNumBitmaskWords());
+	Array<uint32> baseIndices(spheres.size());
+	SIMDKernels::select(SIMD_LEVEL_NONE);
+	aabbs.cullFrustum(planes, &baseVisible[0], &baseIntersecting[0]);
+	spheres.cullFrustum(planes, &baseSphereVisible[0]);
+	uint32 numBaseIndices = spheres.cullFrustum(planes, &baseIndices[0]);
+
+	const SIMDKernelTable* tables[] = {
+		SIMDKernels::getBaselineTable(), SIMDKernels::getAVX2Table()
+	};
+	for(uint32 i = 0; i < ARRAY_SIZE_IN_ELEMENTS(tables); i++) {
+		if(tables[i] == nullptr
+				|| &SIMDKernels::select(tables[i]->simdLevel) != tables[i]) {
+			continue;
+		}
+		testSIMDKernelTable(*tables[i]);
+		testMatrixBatch();
+
+		Array<uint64> visible(baseVisible.size());
+		Array<uint64> intersecting(baseIntersecting.size());
+		aabbs.cullFrustum(planes, &visible[0], &intersecting[0]);
+		assert(visible == baseVisible && intersecting == baseIntersecting);
+		spheres.cullFrustum(planes, &visible[0]);
+		assert(visible == baseSphereVisible);
+		Array<uint32> indices(spheres.size());
+		uint32 numIndices = spheres.cullFrustum(planes, &indices[0]);
+		assert(numIndices == numBaseIndices);
+		for(uint32 j = 0; j < numIndices; j++) {
+			assert(indices[j] == baseIndices[j]);
+		}
+	}
+	SIMDKernels::select(SIMD_LEVEL_x86_AVX2);
+}
+
+static bool intersectRayTriangle(const Vector3f& start, const Vector3f& dir,
+		const Vector3f& v0, const Vector3f& v1, const Vector3f& v2, float& distance)
+{
+	Vector3f edge1 = v1 - v0;
+	Vector3f edge2 = v2 - v0;
+	Vector3f p = dir.cross(edge2);
+	float det = edge1.dot(p);
+	if(Math::abs(det) < 1.e-12f) {
+		return false;
+	}
+	Vector3f s = start - v0;
+	float u = s.dot(p) / det;
+	Vector3f q = s.cross(edge1);
+	float v = dir.dot(q) / det;
+	distance = edge2.dot(q) / det;
+	return u >= 0.0f && v >= 0.0f && u + v <= 1.0f && distance >= 0.0f;
+}
+
+static void testBVH()
+{
+	const uint32 numTriangles = 5000;
+	Array<float> positions;
+	Array<uint32> indices;
+	for(uint32 i = 0; i < numTriangles; i++) {
+		Vector3f center(Math::randf(-50.0f, 50.0f), Math::randf(-50.0f, 50.0f),
+				Math::randf(-50.0f, 50.0f));
+		for(uint32 j = 0; j < 3; j++) {
+			positions.push_back(center[0] + Math::randf(-3.0f, 3.0f));
+			positions.push_back(center[1] + Math::randf(-3.0f, 3.0f));
+			positions.push_back(center[2] + Math::randf(-3.0f, 3.0f));
+			indices.push_back(i*3 + j);
+		}
+	}
+
+	BVH bvh;
+	bvh.build(&positions[0], &indices[0], numTriangles, 4);
+	assert(bvh.getNumTriangles() == numTriangles);
+	assert(bvh.getNumNodes() > 2 && bvh.getNumNodes() <= numTriangles * 2);
+
+	uint32 numHits = 0;
+	for(uint32 i = 0; i < 500; i++) {
+		Vector3f start(Math::randf(-60.0f, 60.0f), Math::randf(-60.0f, 60.0f),
+				Math::randf(-60.0f, 60.0f));
+		Vector3f dir = (Vector3f(Math::randf(-30.0f, 30.0f), Math::randf(-30.0f, 30.0f),
+				Math::randf(-30.0f, 30.0f)) - start).normalized();
+		float maxDistance = Math::randf(20.0f, 200.0f);
+
+		bool expectedHit = false;
+		float expectedDistance = maxDistance;
+		for(uint32 j = 0; j < numTriangles; j++) {
+			const float* v = &positions[j*9];
+			float distance;
+			if(intersectRayTriangle(start, dir, Vector3f(v[0], v[1], v[2]),
+						Vector3f(v[3], v[4], v[5]), Vector3f(v[6], v[7], v[8]), distance)
+					&& distance < expectedDistance) {
+				expectedDistance = distance;
+				expectedHit = true;
+			}
+		}
+
+		uint32 triangleIndex;
+		float distance;
+		bool hit = bvh.closestHit(start, dir, maxDistance, triangleIndex, distance);
+		assert(hit == expectedHit);
+		assert(bvh.anyHit(start, dir, maxDistance) == expectedHit);
+		if(hit) {
+			assert(Math::abs(distance - expectedDistance) < 1.e-3f);
+			const float* v = &positions[triangleIndex*9];
+			float triangleDistance;
+			assert(intersectRayTriangle(start, dir, Vector3f(v[0], v[1], v[2]),
+						Vector3f(v[3], v[4], v[5]), Vector3f(v[6], v[7], v[8]),
+						triangleDistance));
+			assert(Math::abs(triangleDistance - expectedDistance) < 1.e-3f);
+			numHits++;
+		}
+	}
+	assert(numHits > 0 && numHits < 500);
+
+	AABB query(Vector3f(-10.0f, -20.0f, -5.0f), Vector3f(15.0f, 5.0f, 10.0f));
+	Array<uint32> found;
+	uint32 numFound = bvh.overlapAABB(query, found);
+	assert(numFound == found.size());
+	uint32 numExpected = 0;
+	for(uint32 i = 0; i < numTriangles; i++) {
+		const float* v = &positions[i*9];
+		AABB bounds(Vector3f(Math::min3(v[0], v[3], v[6]), Math::min3(v[1], v[4], v[7]),
+					Math::min3(v[2], v[5], v[8])),
+				Vector3f(Math::max3(v[0], v[3], v[6]), Math::max3(v[1], v[4], v[7]),
+					Math::max3(v[2], v[5], v[8])));
+		if(bounds.intersects(query)) {
+			bool listed = false;
+			for(uint32 j = 0; j < found.size() && !listed; j++) {
+				listed = found[j] == i;
+			}
+			assert(listed);
+			numExpected++;
+		}
+	}
+	assert(numFound == numExpected && numFound > 0);
+}
+
+// Scalar reference for RayPacket: AABB::intersectRay tests the whole line,
+// so clip it to [0, maxDistance] here.
+static bool intersectRayAABBScalar(const AABB& aabb, const Vector3f& start,
+		const Vector3f& rayDir, float maxDistance, float& distance)
+{
+	float p1, p2;
+	if(!aabb.intersectRay(start, rayDir, p1, p2)) {
+		return false;
+	}
+	distance = Math::max(p1, 0.0f);
+	return p2 >= distance && distance <= maxDistance;
+}
+
+static void randomCoherentRays(Array<Vector3f>& starts, Array<Vector3f>& rayDirs,
+		Array<float>& maxDistances, uint32 count)
+{
+	// Rays fanning out from one eye point, in scanline order
+	Vector3f eye(Math::randf(-5.0f, 5.0f), Math::randf(-5.0f, 5.0f), 30.0f);
+	uint32 width = (uint32)Math::sqrt((float)count) + 1;
+	for(uint32 i = 0; i < count; i++) {
+		float x = (float)(i % width)/(float)width * 2.0f - 1.0f;
+		float y = (float)(i / width)/(float)width * 2.0f - 1.0f;
+		starts.push_back(eye);
+		rayDirs.push_back(Vector3f(x, y, -1.5f).normalized());
+		maxDistances.push_back(Math::randf(20.0f, 200.0f));
+	}
+}
+
+static void testRayPacket()
+{
+	Vector3f starts[] = { Vector3f(0.0f,0.0f,-3.0f), Vector3f(0.99f,0.0f,-3.0f),
+		Vector3f(1.01f,0.0f,-3.0f), Vector3f(0.0f,0.0f,0.0f), Vector3f(0.0f,0.0f,3.0f) };
+	Vector3f dir(0.0f,0.0f,1.0f);
+	Vector3f dirs[] = { dir, dir, dir, dir, dir };
+	float maxDistances[] = { 10.0f, 10.0f, 10.0f, 10.0f, 10.0f };
+	AABB aabb(Vector3f(-1.0f,-1.0f,-1.0f), Vector3f(1.0f,1.0f,1.0f));
+	RayPacket packet(starts, dirs, maxDistances, ARRAY_SIZE_IN_ELEMENTS(starts));
+	RayPacketVector distances;
+	uint32 hitMask = packet.intersectAABB(aabb, distances);
+	assert(hitMask == 0xB);
+	assert(Math::abs(distances[0] - 2.0f) < 1.e-4f);
+	assert(Math::abs(distances[1] - 2.0f) < 1.e-4f);
+	assert(distances[3] == 0.0f);
+	RayPacket partialPacket(starts, dirs, maxDistances, 1);
+	assert(partialPacket.intersectAABB(aabb, distances) == 1);
+
+	Array<AABB> aabbs;
+	for(uint32 i = 0; i < 300; i++) {
+		aabbs.push_back(randomAABB());
+	}
+	Array<Vector3f> rayStarts;
+	Array<Vector3f> rayDirs;
+	Array<float> rayMaxDistances;
+	const uint32 numRays = 1001;
+	randomCoherentRays(rayStarts, rayDirs, rayMaxDistances, numRays);
+	Array<uint32> hitIndices(numRays);
+	Array<float> hitDistances(numRays);
+	RayPacket::nearestHits(&rayStarts[0], &rayDirs[0], &rayMaxDistances[0], numRays,
+			&aabbs[0], (uint32)aabbs.size(), &hitIndices[0], &hitDistances[0]);
+
+	uint32 numHits = 0;
+	for(uint32 i = 0; i < numRays; i++) {
+		uint32 expectedIndex = (uint32)-1;
+		float expectedDistance = rayMaxDistances[i];
+		for(uint32 j = 0; j < aabbs.size(); j++) {
+			float distance;
+			if(intersectRayAABBScalar(aabbs[j], rayStarts[i], rayDirs[i],
+						expectedDistance, distance)) {
+				expectedIndex = j;
+				expectedDistance = distance;
+			}
+		}
+		assert(hitIndices[i] == expectedIndex);
+		assert(Math::abs(hitDistances[i] - expectedDistance) < 1.e-3f);
+		numHits += expectedIndex != (uint32)-1;
+	}
+	assert(numHits > 0 && numHits < numRays);
+}
+
+static void checkDynamicAABBTree(const DynamicAABBTree& tree, const Array<uint32>& proxies)
+{
+	AABB query(Vector3f(-20.0f, -20.0f, -40.0f), Vector3f(20.0f, 10.0f, 0.0f));
+	Array<uint32> found;
+	tree.queryOverlaps(query, found);
+	uint32 numExpected = 0;
+	for(uint32 i = 0; i < proxies.size(); i++) {
+		if(tree.getFatAABB(proxies[i]).intersects(query)) {
+			bool listed = false;
+			for(uint32 j = 0; j < found.size() && !listed; j++) {
+				listed = found[j] == proxies[i];
+			}
+			assert(listed);
+			numExpected++;
+		}
+	}
+	assert(found.size() == numExpected);
+
+	Array<DynamicAABBTree::Pair> pairs;
+	tree.queryPairs(pairs);
+	uint32 numExpectedPairs = 0;
+	for(uint32 i = 0; i < proxies.size(); i++) {
+		for(uint32 j = 0; j < proxies.size(); j++) {
+			if(proxies[i] < proxies[j] &&
+					tree.getFatAABB(proxies[i]).intersects(tree.getFatAABB(proxies[j]))) {
+				numExpectedPairs++;
+			}
+		}
+	}
+	assert(pairs.size() == numExpectedPairs);
+	for(uint32 i = 0; i < pairs.size(); i++) {
+		assert(pairs[i].proxyA < pairs[i].proxyB);
+		assert(tree.getFatAABB(pairs[i].proxyA).intersects(
+					tree.getFatAABB(pairs[i].proxyB)));
+	}
+
+	// Rotations should keep the tree within a small factor of log2(n)
+	assert(tree.getNumProxies() == proxies.size());
+	assert(tree.getHeight() <= 2 * Math::ceilLog2((uint32)proxies.size()) + 2);
+}
+
+static void testDynamicAABBTree()
+{
+	DynamicAABBTree tree(0.5f, 2.0f);
+	Array<uint32> proxies;
+	Array<AABB> aabbs;
+	for(uint32 i = 0; i < 1000; i++) {
+		aabbs.push_back(randomAABB());
+		proxies.push_back(tree.createProxy(aabbs.back(), i));
+		assert(tree.getUserData(proxies.back()) == i);
+		assert(tree.getFatAABB(proxies.back()).contains(aabbs.back()));
+	}
+	checkDynamicAABBTree(tree, proxies);
+
+	uint32 numReinserted = 0;
+	for(uint32 frame = 0; frame < 10; frame++) {
+		for(uint32 i = 0; i < proxies.size(); i++) {
+			Vector3f displacement(Math::randf(-1.0f, 1.0f), Math::randf(-1.0f, 1.0f),
+					Math::randf(-1.0f, 1.0f));
+			aabbs[i] = aabbs[i].translate(displacement);
+			numReinserted += tree.moveProxy(proxies[i], aabbs[i], displacement);
+			assert(tree.getFatAABB(proxies[i]).contains(aabbs[i]));
+		}
+	}
+	assert(numReinserted > 0 && numReinserted < 10 * proxies.size());
+	checkDynamicAABBTree(tree, proxies);
+
+	// Remove every other proxy, then let the freed nodes be reused
+	for(uint32 i = 0; i < proxies.size(); i += 2) {
+		tree.destroyProxy(proxies[i]);
+	}
+	Array<uint32> remaining;
+	for(uint32 i = 1; i < proxies.size(); i += 2) {
+		assert(tree.getUserData(proxies[i]) == i);
+		remaining.push_back(proxies[i]);
+	}
+	checkDynamicAABBTree(tree, remaining);
+	for(uint32 i = 0; i < 200; i++) {
+		remaining.push_back(tree.createProxy(randomAABB(), 1000 + i));
+	}
+	checkDynamicAABBTree(tree, remaining);
+}
+
+static void checkSweepAndPrune(SweepAndPrune& sap, const Array<AABB>& aabbs,
+		const Array<uint32>& handles)
+{
+	Array<SweepAndPrune::Pair> pairs;
+	sap.findPairs(pairs);
+	uint32 numExpected = 0;
+	for(uint32 i = 0; i < handles.size(); i++) {
+		for(uint32 j = i + 1; j < handles.size(); j++) {
+			if(!aabbs[i].intersects(aabbs[j])) {
+				continue;
+			}
+			uint32 handleA = Math::min(handles[i], handles[j]);
+			uint32 handleB = Math::max(handles[i], handles[j]);
+			bool listed = false;
+			for(uint32 k = 0; k < pairs.size() && !listed; k++) {
+				listed = pairs[k].handleA == handleA && pairs[k].handleB == handleB;
+			}
+			assert(listed);
+			numExpected++;
+		}
+	}
+	assert(pairs.size() == numExpected);
+	for(uint32 i = 1; i < pairs.size(); i++) {
+		assert(pairs[i-1].handleA < pairs[i].handleA ||
+				(pairs[i-1].handleA == pairs[i].handleA &&
+				 pairs[i-1].handleB < pairs[i].handleB));
+	}
+}
+
+static void testSweepAndPrune()
+{
+	SweepAndPrune sap;
+	Array<AABB> aabbs;
+	Array<uint32> handles;
+	for(uint32 i = 0; i < 1000; i++) {
+		aabbs.push_back(randomAABB());
+		handles.push_back(sap.add(aabbs.back()));
+	}
+	checkSweepAndPrune(sap, aabbs, handles);
+
+	for(uint32 frame = 0; frame < 5; frame++) {
+		for(uint32 i = 0; i < handles.size(); i++) {
+			aabbs[i] = aabbs[i].translate(Vector3f(Math::randf(-1.0f, 1.0f),
+						Math::randf(-1.0f, 1.0f), Math::randf(-1.0f, 1.0f)));
+			sap.update(handles[i], aabbs[i]);
+		}
+		checkSweepAndPrune(sap, aabbs, handles);
+	}
+	// Small moves should be repaired incrementally, without a full re-sort
+	assert(sap.getNumSortShifts() > 0 &&
+			sap.getNumSortShifts() < handles.size() * Math::ceilLog2((uint32)handles.size()));
+
+	// Remove a third of the objects, then add new ones into the freed handles
+	for(uint32 i = 0; i < handles.size(); i += 2) {
+		sap.remove(handles[i]);
+		handles[i] = handles.back();
+		handles.pop_back();
+		aabbs[i] = aabbs.back();
+		aabbs.pop_back();
+	}
+	assert(sap.size() == handles.size());
+	checkSweepAndPrune(sap, aabbs, handles);
+	for(uint32 i = 0; i < 300; i++) {
+		aabbs.push_back(randomAABB());
+		handles.push_back(sap.add(aabbs.back()));
+	}
+	checkSweepAndPrune(sap, aabbs, handles);
+}
+
+
+static void allocateBlocks(Array<void*>* blocks, uint32 count, uintptr size)
+{
+	for(uint32 i = 0; i < count; i++) {
+		blocks->push_back(Memory::malloc(size));
+	}
+}
+
+static void testSizeClassAllocator()
+{
+	assert(SizeClassAllocator::getSizeClass(0, 16) == 0);
+	assert(SizeClassAllocator::getSizeClass(16, 16) == 0);
+	assert(SizeClassAllocator::getSizeClass(17, 8) == 1);
+	assert(SizeClassAllocator::getBlockSize(SizeClassAllocator::getSizeClass(129, 16)) == 160);
+	assert(SizeClassAllocator::getBlockSize(SizeClassAllocator::getSizeClass(1000, 16)) == 1024);
+	assert(SizeClassAllocator::getSizeClass(1025, 16) == SizeClassAllocator::NUM_SIZE_CLASSES);
+	assert(SizeClassAllocator::getBlockSize(SizeClassAllocator::getSizeClass(8, 64)) == 64);
+	assert(SizeClassAllocator::getBlockSize(SizeClassAllocator::getSizeClass(100, 64)) == 128);
+	assert(SizeClassAllocator::getSizeClass(8, 2048) == SizeClassAllocator::NUM_SIZE_CLASSES);
+	for(uintptr size = 1; size <= SizeClassAllocator::MAX_SIZE; size++) {
+		uintptr blockSize = SizeClassAllocator::getBlockSize(
+				SizeClassAllocator::getSizeClass(size, 16));
+		assert(blockSize >= size && blockSize < size + Math::max(size/4, (uintptr)16));
+	}
+
+	// Every size and alignment, small and large, freed both ways
+	const uint32 alignments[] = { 8, 16, 32, 64, 256, 4096 };
+	for(uint32 a = 0; a < ARRAY_SIZE_IN_ELEMENTS(alignments); a++) {
+		Array<uint8*> blocks;
+		for(uintptr size = 1; size < 1200; size += 7) {
+			uint8* block = (uint8*)Memory::malloc(size, alignments[a]);
+			assert(((uintptr)block & (alignments[a] - 1)) == 0);
+			assert(Memory::getAllocSize(block) >= size);
+			Memory::memset(block, (uint8)size, size);
+			blocks.push_back(block);
+		}
+		for(uintptr i = 0, size = 1; i < blocks.size(); i++, size += 7) {
+			assert(blocks[i][0] == (uint8)size && blocks[i][size - 1] == (uint8)size);
+			if((i & 1) == 0) {
+				Memory::free(blocks[i], size, alignments[a]);
+			} else {
+				Memory::free(blocks[i]);
+			}
+		}
+	}
+
+	// Enough blocks to overflow the thread cache and span several slabs
+	Array<uint32*> blocks;
+	for(uint32 i = 0; i < 20000; i++) {
+		uint32* block = (uint32*)Memory::malloc(48);
+		block[0] = i;
+		block[11] = i;
+		blocks.push_back(block);
+	}
+	for(uint32 i = 0; i < blocks.size(); i++) {
+		assert(blocks[i][0] == i && blocks[i][11] == i);
+		Memory::free(blocks[i], 48);
+	}
+
+	// Blocks freed by a thread other than their allocator, and the cache of
+	// a thread that exits
+	Array<void*> threadBlocks;
+	std::thread allocator(allocateBlocks, &threadBlocks, 5000, 96);
+	allocator.join();
+	for(uint32 i = 0; i < threadBlocks.size(); i++) {
+		assert(SizeClassAllocator::owns(threadBlocks[i]));
+		Memory::free(threadBlocks[i]);
+	}
+	threadBlocks.clear();
+	std::thread exiting(allocateBlocks, &threadBlocks, 1, 96);
+	exiting.join();
+	Memory::free(threadBlocks[0]);
+}
+
+static void testRealloc()
+{
+	// Blocks stay put within their size class, and move when it changes
+	uint8* block = (uint8*)Memory::malloc(40);
+	Memory::memset(block, (uint8)1, 40);
+	assert(Memory::realloc(block, 48) == block);
+	block = (uint8*)Memory::realloc(block, 600);
+	assert(SizeClassAllocator::owns(block) && block[0] == 1 && block[39] == 1);
+	block = (uint8*)Memory::realloc(block, 5000);
+	assert(!SizeClassAllocator::owns(block) && block[0] == 1 && block[39] == 1);
+	assert(Memory::getAllocSize(block) == 5000);
+	block = (uint8*)Memory::realloc(block, 20);
+	assert(SizeClassAllocator::owns(block) && block[19] == 1);
+	Memory::free(block, 20);
+
+	// Large blocks grown step by step, through the size where they are
+	// mapped, keep their contents and alignment
+	const uint32 alignments[] = { 16, 64, 4096, 8192 };
+	for(uint32 a = 0; a < ARRAY_SIZE_IN_ELEMENTS(alignments); a++) {
+		uint32 alignment = alignments[a];
+		uint32* data = (uint32*)Memory::malloc(2048, alignment);
+		uintptr count = 0;
+		for(uintptr size = 2048; size <= 2 * 1024 * 1024; size = size * 3 / 2) {
+			data = (uint32*)Memory::realloc(data, size, alignment);
+			assert(((uintptr)data & (alignment - 1)) == 0);
+			assert(Memory::getAllocSize(data) == size);
+			for(uintptr i = 0; i < count; i++) {
+				assert(data[i] == i);
+			}
+			for(count = 0; count < size / sizeof(uint32); count++) {
+				data[count] = count;
+			}
+		}
+		// Shrinking keeps what fits
+		data = (uint32*)Memory::realloc(data, 100000, alignment);
+		assert(data[0] == 0 && data[100000 / sizeof(uint32) - 1] == 100000 / sizeof(uint32) - 1);
+		Memory::free(data, 100000, alignment);
+	}
+
+	assert(Memory::realloc(Memory::realloc(nullptr, 100), 0) == nullptr);
+}
+
+static void fillFromArena(FrameArena* arena, uint32** blocks, uint32 count, uint32 value)
+{
+	for(uint32 i = 0; i < count; i++) {
+		blocks[i] = arena->allocate<uint32>(8 + i % 32);
+		for(uint32 j = 0; j < 8 + i % 32; j++) {
+			blocks[i][j] = value;
+		}
+	}
+}
+
+static void testFrameArena()
+{
+	FrameArena arena(4096);
+	uint8* a = (uint8*)arena.allocate(100, 16);
+	uint8* b = (uint8*)arena.allocate(1, 64);
+	uint8* c = (uint8*)arena.allocate(10000);
+	assert(((uintptr)a & 15) == 0 && ((uintptr)b & 63) == 0 && ((uintptr)c & 15) == 0);
+	assert(b >= a + 100 && (c + 10000 <= a || c >= b + 1));
+	Memory::memset(c, (uint8)3, 10000);
+	arena.endFrame();
+	assert(arena.getBytesAllocatedLastFrame() == 10101 && arena.getHighWaterMark() == 10101);
+	// The oversized block was freed, and the chunk is reused
+	assert(arena.getBytesReserved() == 4096);
+	assert(arena.allocate(100, 16) == a);
+
+	// Containers taking memory from the arena reuse it every frame
+	for(uint32 frame = 0; frame < 4; frame++) {
+		Array<uint32, FrameArena> values(arena);
+		for(uint32 i = 0; i < 1000; i++) {
+			values.push_back(i);
+		}
+		assert(values[999] == 999);
+		arena.endFrame();
+	}
+	uintptr reserved = arena.getBytesReserved();
+	assert(arena.getHighWaterMark() >= 4000);
+	for(uint32 frame = 0; frame < 4; frame++) {
+		Array<uint32, FrameArena> values(arena);
+		values.resize(1000);
+		arena.endFrame();
+	}
+	assert(arena.getBytesReserved() == reserved);
+
+	// Double buffered data survives the next frame
+	FrameArena doubleBuffered(4096, 2);
+	uint32* first = doubleBuffered.allocate<uint32>(16);
+	first[15] = 1;
+	doubleBuffered.endFrame();
+	uint32* second = doubleBuffered.allocate<uint32>(16);
+	assert(second != first && first[15] == 1);
+	doubleBuffered.endFrame();
+	assert(doubleBuffered.allocate<uint32>(16) == first);
+
+	// Threads get chunks of their own
+	const uint32 numThreads = 4;
+	const uint32 count = 2000;
+	Array<uint32*> blocks(numThreads * count);
+	std::thread threads[numThreads];
+	for(uint32 i = 0; i < numThreads; i++) {
+		threads[i] = std::thread(fillFromArena, &arena, &blocks[i * count], count, i);
+	}
+	for(uint32 i = 0; i < numThreads; i++) {
+		threads[i].join();
+	}
+	uintptr bytes = 0;
+	for(uint32 i = 0; i < blocks.size(); i++) {
+		uint32 size = 8 + (i % count) % 32;
+		for(uint32 j = 0; j < size; j++) {
+			assert(blocks[i][j] == i / count);
+		}
+		bytes += size * sizeof(uint32);
+	}
+	arena.endFrame();
+	assert(arena.getBytesAllocatedLastFrame() == bytes);
+
+	// Threads that have exited give their slot to the next, so many short
+	// lived threads in turn share one chunk rather than taking one each
+	FrameArena shortLived;
+	for(uint32 i = 0; i < 2 * FrameArena::MAX_THREADS; i++) {
+		uint32* block;
+		std::thread thread(fillFromArena, &shortLived, &block, 1, i);
+		thread.join();
+		assert(block[0] == i);
+	}
+	assert(shortLived.getBytesReserved() == FrameArena::DEFAULT_CHUNK_SIZE);
+}
+
+static void testContainerAllocators()
+{
+	// Containers on the heap are the standard ones
+	Array<int32> heapArray;
+	std::vector<int32>& stdArray = heapArray;
+	stdArray.push_back(1);
+	String heapString = std::string("abc");
+	assert(heapArray[0] == 1 && heapString.size() == 3);
+
+	// Map nodes come from the pool, and are reused once freed
+	PoolAllocator pool;
+	{
+		Map<int32, int32, PoolAllocator> map(pool);
+		for(int32 i = 0; i < 1000; i++) {
+			map[i] = i * 2;
+		}
+		assert(map.size() == 1000 && map[999] == 1998);
+		assert(pool.getNumBlocksUsed() == 1000);
+		void* node = &*map.find(500);
+		map.erase(500);
+		map[2000] = 1;
+		assert((void*)&*map.find(2000) == node);
+	}
+	assert(pool.getNumBlocksUsed() == 0 && pool.getBlockSize() >= 40);
+
+	// Anything larger than a block goes to the heap
+	Array<uint32, PoolAllocator> poolArray(pool);
+	poolArray.resize(1000, 7);
+	assert(poolArray[999] == 7 && pool.getNumBlocksUsed() == 0);
+
+	// Reserved arrays within the buffer never touch the heap
+	FixedBufferAllocator<256> buffer;
+	{
+		Array<float, FixedBufferAllocator<256> > values(buffer);
+		values.reserve(64);
+		for(uint32 i = 0; i < 64; i++) {
+			values.push_back((float)i);
+		}
+		assert(buffer.owns(&values[0]) && buffer.getBytesUsed() == 256);
+		values.push_back(64.0f);
+		assert(!buffer.owns(&values[0]) && values[64] == 64.0f && values[0] == 0.0f);
+	}
+	assert(buffer.getBytesUsed() == 0);
+
+	FrameArena arena;
+	BasicString<FrameArena> name("a string too long for the short string buffer", arena);
+	name += " and then some";
+	assert(name.size() == 59 && name[58] == 'e');
+}
+
+static void testMemoryTracker()
+{
+	// The tracker is called directly, so this runs whether or not Memory
+	// goes through it. Stats are compared with what they were before, as
+	// the rest of the process allocates too.
+	MemoryTagStats before;
+	MemoryTagStats after;
+	MemoryTracker::getStats(MEMORY_TAG_SHADERS, &before);
+	void* blocks[100];
+	{
+		MemoryTagScope tag(MEMORY_TAG_SHADERS);
+		assert(MemoryTracker::getCurrentTag() == MEMORY_TAG_SHADERS);
+		for(uint32 i = 0; i < 100; i++) {
+			blocks[i] = MemoryTracker::malloc(100, 16);
+		}
+	}
+	assert(MemoryTracker::getCurrentTag() == MEMORY_TAG_UNTAGGED);
+	assert(MemoryTracker::getTag(blocks[0]) == MEMORY_TAG_SHADERS);
+	MemoryTracker::getStats(MEMORY_TAG_SHADERS, &after);
+	assert(after.liveBytes == before.liveBytes + 100 * 100);
+	assert(after.numAllocations == before.numAllocations + 100);
+
+	// Blocks keep their tag and alignment through realloc, which counts as
+	// a free and an allocation
+	uint8* block = (uint8*)MemoryTracker::malloc(64, 64, MEMORY_TAG_MESHES);
+	assert(((uintptr)block & 63) == 0 && MemoryTracker::getTag(block) == MEMORY_TAG_MESHES);
+	block[63] = 7;
+	block = (uint8*)MemoryTracker::realloc(block, 100000, 64);
+	assert(((uintptr)block & 63) == 0 && block[63] == 7);
+	assert(MemoryTracker::getTag(block) == MEMORY_TAG_MESHES);
+	assert(MemoryTracker::getAllocSize(block) >= 100000);
+	MemoryTracker::free(block);
+
+	// Frees and peaks, including from a thread that has since exited
+	std::thread thread([&blocks]() {
+		for(uint32 i = 0; i < 100; i++) {
+			MemoryTracker::free(blocks[i]);
+		}
+		MemoryTracker::free(MemoryTracker::malloc(1024 * 1024, 16, MEMORY_TAG_SHADERS));
+	});
+	thread.join();
+	MemoryTracker::getStats(MEMORY_TAG_SHADERS, &after);
+	assert(after.liveBytes == before.liveBytes);
+	assert(after.numFrees == before.numFrees + 101);
+	assert(after.bytesAllocated == before.bytesAllocated + 100 * 100 + 1024 * 1024);
+	// Peaks are taken from live bytes the threads have passed on, which
+	// can be up to 64KB per thread behind
+	assert(after.peakBytes + 64 * 1024 >= before.liveBytes + 1024 * 1024);
+
+	// Allocations over the hard budget fail, and over the soft one only warn
+	uint64 liveBytes = after.liveBytes;
+	MemoryTracker::setBudget(MEMORY_TAG_SHADERS, liveBytes + 1000, liveBytes + 300000);
+	assert(MemoryTracker::malloc(400000, 16, MEMORY_TAG_SHADERS) == nullptr);
+	block = (uint8*)MemoryTracker::malloc(200000, 16, MEMORY_TAG_SHADERS);
+	assert(block != nullptr);
+	assert(MemoryTracker::realloc(block, 400000, 16) == nullptr);
+	MemoryTracker::free(block);
+	MemoryTracker::setBudget(MEMORY_TAG_SHADERS, 0, 0);
+	block = (uint8*)MemoryTracker::malloc(400000, 16, MEMORY_TAG_SHADERS);
+	assert(block != nullptr);
+	MemoryTracker::free(block);
+
+	// Reports can be measured first. The buffer is on the stack, as
+	// allocating it would change what is reported.
+	uintptr length = MemoryTracker::writeReport(nullptr, 0, MEMORY_REPORT_JSON);
+	char report[4096];
+	assert(length < sizeof(report));
+	assert(MemoryTracker::writeReport(report, sizeof(report), MEMORY_REPORT_JSON) == length);
+	assert(strlen(report) == length && report[0] == '{' && report[length - 1] == '}');
+	assert(strstr(report, "\"name\":\"Shaders\"") != nullptr);
+	char shortReport[16];
+	length = MemoryTracker::writeReport(shortReport, sizeof(shortReport), MEMORY_REPORT_TEXT);
+	assert(length > sizeof(shortReport) && strlen(shortReport) == sizeof(shortReport) - 1);
+
+#if MEMORY_TRACKING
+	// Memory goes through the tracker
+	block = (uint8*)Memory::malloc(32, 16, MEMORY_TAG_TEXTURES);
+	assert(MemoryTracker::getTag(block) == MEMORY_TAG_TEXTURES);
+	Memory::free(block, 32);
+#endif
+}
 
 void Tests::runTests()
 {
@@ -303,6 +1459,24 @@ void Tests::runTests()
 	testPlane();
 	testIntersects();
 	testMemory();
+	testMatrixBatch();
+	testAABBArray();
+	testSphereArray();
+	testSIMDKernels();
+	testBVH();
+	testRayPacket();
+	testDynamicAABBTree();
+	testSweepAndPrune();
+	testMatrixArray4();
+	testAffineMatrix();
+	testPackedTransform();
+	testInstanceFormat();
+	testDirtyRangeTracker();
+	testSizeClassAllocator();
+	testRealloc();
+	testFrameArena();
+	testContainerAllocators();
+	testMemoryTracker();
 }
 
 inline void naiveMatrixMultiply(float* output, float* input, float* other)
@@ -452,8 +1626,1229 @@ inline void naiveMatrixInverse(void* dest, void* src)
 	}
 }
 
+static void benchmarkTranscendentals()
+{
+	// Results in Mvalues/s, scalar (Math, which is libm apart from sincos)
+	// against Vector:
+	//                    sincos      exp          ln           pow
+	// -O2 -msse2:        86 / 243    173 / 353    164 / 257    91 / 79
+	// -O2 -mavx2 -mfma:  94 / 275    172 / 466    169 / 319    90 / 103
+	// pow is held back by being computed in double for full precision.
+	const uint32 count = 4096;
+	const uint32 iterations = 1000;
+	Array<float> inputs(count);
+	Array<float> outputs(count);
+	for(uint32 i = 0; i < count; i++) {
+		inputs[i] = Math::randf(0.01f, 10.0f);
+	}
+
+	enum { FUNC_SINCOS, FUNC_EXP, FUNC_LN, FUNC_POW, NUM_FUNCS };
+	const char* names[NUM_FUNCS] = { "sincos", "exp", "ln", "pow" };
+	for(uint32 func = 0; func < NUM_FUNCS; func++) {
+		double startTime = Time::getTime();
+		for(uint32 j = 0; j < iterations; j++) {
+			for(uint32 i = 0; i < count; i++) {
+				float val = inputs[i];
+				float outSin, outCos;
+				switch(func) {
+				case FUNC_SINCOS:
+					Math::sincos(&outSin, &outCos, val);
+					outputs[i] = outSin + outCos;
+					break;
+				case FUNC_EXP:
+					outputs[i] = Math::exp(val);
+					break;
+				case FUNC_LN:
+					outputs[i] = Math::ln(val);
+					break;
+				default:
+					outputs[i] = Math::pow(val, 2.2f);
+					break;
+				}
+			}
+		}
+		double scalarTime = Time::getTime() - startTime;
+
+		const Vector gamma(Vector::load1f(2.2f));
+		startTime = Time::getTime();
+		for(uint32 j = 0; j < iterations; j++) {
+			for(uint32 i = 0; i < count; i += 4) {
+				Vector val(Vector::load4f(&inputs[i]));
+				Vector outSin, outCos;
+				switch(func) {
+				case FUNC_SINCOS:
+					val.sincos(&outSin, &outCos);
+					(outSin + outCos).store4f(&outputs[i]);
+					break;
+				case FUNC_EXP:
+					val.exp().store4f(&outputs[i]);
+					break;
+				case FUNC_LN:
+					val.ln().store4f(&outputs[i]);
+					break;
+				default:
+					val.pow(gamma).store4f(&outputs[i]);
+					break;
+				}
+			}
+		}
+		double vectorTime = Time::getTime() - startTime;
+
+		double values = (double)count * (double)iterations;
+		DEBUG_LOG("Performance", "NONE",
+				"%s: scalar %.1f Mvalues/s, Vector %.1f Mvalues/s (%.1fx)", names[func],
+				values/(scalarTime*1000000.0), values/(vectorTime*1000000.0),
+				scalarTime/vectorTime);
+	}
+}
+
+template<Precision::Level precision>
+static double timeNormalize3(const Array<Vector>& inputs, Array<Vector>& outputs,
+		uint32 iterations)
+{
+	double startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		for(uint32 i = 0; i < inputs.size(); i++) {
+			outputs[i] = inputs[i].normalize3<precision>();
+		}
+	}
+	return Time::getTime() - startTime;
+}
+
+static void benchmarkNormalize()
+{
+	// Results in Mvectors/s, for independent vectors:
+	//                     EXACT    REFINED    ESTIMATE
+	// -O2 -msse2:         341      314        434
+	// -O2 -mavx2 -mfma:   359      540        755
+	// With SSE2 the shuffles in dot3 dominate and the extra Newton-Raphson
+	// work costs more than the divide it replaces. The gap grows in
+	// dependent chains, where divide latency cannot be hidden.
+	const uint32 count = 4096;
+	const uint32 iterations = 2000;
+	Array<Vector> inputs;
+	Array<Vector> outputs(count);
+	for(uint32 i = 0; i < count; i++) {
+		inputs.push_back(Vector::make(Math::randf(-10.0f, 10.0f), Math::randf(-10.0f, 10.0f),
+					Math::randf(-10.0f, 10.0f), 0.0f));
+	}
+
+	double exactTime = timeNormalize3<Precision::EXACT>(inputs, outputs, iterations);
+	double refinedTime = timeNormalize3<Precision::REFINED>(inputs, outputs, iterations);
+	double estimateTime = timeNormalize3<Precision::ESTIMATE>(inputs, outputs, iterations);
+	double vectors = (double)count * (double)iterations;
+	DEBUG_LOG("Performance", "NONE",
+			"normalize3: EXACT %.1f Mvectors/s, REFINED %.1f Mvectors/s, "
+			"ESTIMATE %.1f Mvectors/s", vectors/(exactTime*1000000.0),
+			vectors/(refinedTime*1000000.0), vectors/(estimateTime*1000000.0));
+}
+
+static void benchmarkMatrixBatch()
+{
+	// Each size is run enough times to process 10M instances in total.
+	// Results in instances/ms for -O2 -mavx2 -mfma:
+	// 1k:   toMatrix 131472, transformMatrixBatch 231904 (1.76x)
+	//       matrix multiply 116978, mulBatch 203138 (1.74x)
+	// 100k: toMatrix 110682, transformMatrixBatch 169609 (1.53x)
+	//       matrix multiply 104473, mulBatch 112394 (1.08x)
+	// 1M:   toMatrix 53218, transformMatrixBatch 75535 (1.42x)
+	//       matrix multiply 47260, mulBatch 62660 (1.33x)
+	// Past 100k the working set leaves cache and both become bandwidth bound.
+	const uint32 sizes[] = { 1000, 100000, 1000000 };
+	const uint32 totalInstances = 10000000;
+	for(uint32 sizeIndex = 0; sizeIndex < ARRAY_SIZE_IN_ELEMENTS(sizes); sizeIndex++) {
+		uint32 count = sizes[sizeIndex];
+		uint32 iterations = totalInstances/count;
+		Array<Transform> transforms;
+		for(uint32 i = 0; i < count; i++) {
+			transforms.push_back(randomTransform());
+		}
+		Array<Matrix> base(count);
+		Array<Matrix> result(count);
+		Matrix pre(Matrix::perspective(Math::toRadians(35.0f), 4.0f/3.0f, 0.1f, 1000.0f));
+		Matrix post(randomTransform().toMatrix());
+
+		double startTime = Time::getTime();
+		for(uint32 j = 0; j < iterations; j++) {
+			for(uint32 i = 0; i < count; i++) {
+				base[i] = transforms[i].toMatrix();
+			}
+		}
+		double scalarTransformTime = Time::getTime() - startTime;
+
+		startTime = Time::getTime();
+		for(uint32 j = 0; j < iterations; j++) {
+			Matrix::transformMatrixBatch(&transforms[0], &base[0], count);
+		}
+		double batchTransformTime = Time::getTime() - startTime;
+
+		startTime = Time::getTime();
+		for(uint32 j = 0; j < iterations; j++) {
+			for(uint32 i = 0; i < count; i++) {
+				result[i] = pre * base[i] * post;
+			}
+		}
+		double scalarMulTime = Time::getTime() - startTime;
+
+		startTime = Time::getTime();
+		for(uint32 j = 0; j < iterations; j++) {
+			Matrix::mulBatch(pre, &base[0], post, &result[0], count);
+		}
+		double batchMulTime = Time::getTime() - startTime;
+
+		double instances = (double)count * (double)iterations;
+		DEBUG_LOG("Performance", "NONE",
+				"%u instances: toMatrix %.0f/ms, transformMatrixBatch %.0f/ms, "
+				"matrix multiply %.0f/ms, mulBatch %.0f/ms", count,
+				instances/(scalarTransformTime*1000.0), instances/(batchTransformTime*1000.0),
+				instances/(scalarMulTime*1000.0), instances/(batchMulTime*1000.0));
+	}
+}
+
+static void benchmarkMatrixArray4()
+{
+	// Results in matrices/ms for 10k random transform matrices, -O2, with the
+	// SoA multiply done on data already in MatrixArray4 layout:
+	//                   -msse2                   -mavx2 -mfma
+	// multiply          Matrix 110k, SoA 103k    Matrix 145k, SoA 144k
+	// inverse           Matrix 65k,  SoA 69k     Matrix 79k,  SoA 73k
+	// affine inverse    SoA 83k                  SoA 107k
+	// normal matrix     Matrix 44k,  SoA 79k     Matrix 50k,  SoA 85k
+	// The affine kernels skip the bottom row, and the normal matrix needs no
+	// separate transpose, so those are where the layout pays off.
+	// The normal matrix row was measured against inverse().transpose(); the
+	// AffineMatrix path Matrix::toNormalMatrix now takes is faster than SoA.
+	const uint32 count = 10000;
+	const uint32 iterations = 100;
+	Array<Matrix> mats(count);
+	Array<Matrix> others(count);
+	for(uint32 i = 0; i < count; i++) {
+		mats[i] = randomTransform().toMatrix();
+		others[i] = randomTransform().toMatrix();
+	}
+	Array<Matrix> result(count);
+	double instances = (double)count * (double)iterations;
+
+	double startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		for(uint32 i = 0; i < count; i++) {
+			result[i] = mats[i] * others[i];
+		}
+	}
+	double scalarTime = Time::getTime() - startTime;
+	// Products are only worth doing in SoA layout when both inputs and the
+	// result stay in it; converting costs as much as the multiply saves.
+	Array<MatrixArray4> soaMats(count/4);
+	Array<MatrixArray4> soaOthers(count/4);
+	Array<MatrixArray4> soaResult(count/4);
+	for(uint32 i = 0; i < count/4; i++) {
+		soaMats[i] = MatrixArray4::load(&mats[i*4]);
+		soaOthers[i] = MatrixArray4::load(&others[i*4]);
+	}
+	startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		for(uint32 i = 0; i < count/4; i++) {
+			soaResult[i] = soaMats[i] * soaOthers[i];
+		}
+	}
+	double batchTime = Time::getTime() - startTime;
+	DEBUG_LOG("Performance", "NONE", "multiply: Matrix %.0f/ms, MatrixArray4 %.0f/ms",
+			instances/(scalarTime*1000.0), instances/(batchTime*1000.0));
+
+	startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		for(uint32 i = 0; i < count; i++) {
+			result[i] = mats[i].inverse();
+		}
+	}
+	scalarTime = Time::getTime() - startTime;
+	startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		MatrixArray4::inverseBatch(&mats[0], &result[0], count);
+	}
+	batchTime = Time::getTime() - startTime;
+	startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		MatrixArray4::inverseAffineBatch(&mats[0], &result[0], count);
+	}
+	double affineTime = Time::getTime() - startTime;
+	DEBUG_LOG("Performance", "NONE", "inverse: Matrix %.0f/ms, MatrixArray4 %.0f/ms, "
+			"MatrixArray4 affine %.0f/ms", instances/(scalarTime*1000.0),
+			instances/(batchTime*1000.0), instances/(affineTime*1000.0));
+
+	startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		for(uint32 i = 0; i < count; i++) {
+			result[i] = mats[i].toNormalMatrix();
+		}
+	}
+	scalarTime = Time::getTime() - startTime;
+	startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		MatrixArray4::toNormalMatrixAffineBatch(&mats[0], &result[0], count);
+	}
+	batchTime = Time::getTime() - startTime;
+	DEBUG_LOG("Performance", "NONE", "normal matrix: Matrix %.0f/ms, MatrixArray4 affine %.0f/ms",
+			instances/(scalarTime*1000.0), instances/(batchTime*1000.0));
+}
+
+static void benchmarkAffineMatrix()
+{
+	// Results in matrices/ms for 10k random transform matrices, -O2:
+	//                                   -msse2    -mavx2 -mfma
+	// normal matrix, inverse/transpose  43k       45k
+	// Matrix::toNormalMatrix            98k       112k
+	// Matrix::toNormalMatrixBatch       130k      137k
+	// Matrix::inverse                   65k       78k
+	// AffineMatrix::inverse             95k       121k
+	// Transform, toMatrix().inverse()   39k       43k
+	// Transform::inverse                44k       49k
+	// Matrix multiply                   110k      178k
+	// AffineMatrix multiply             131k      201k
+	// Transform::inverse is mostly the cost of building the matrix.
+	const uint32 count = 10000;
+	const uint32 iterations = 100;
+	Array<Transform> transforms;
+	Array<Matrix> mats(count);
+	Array<AffineMatrix> affineMats(count);
+	for(uint32 i = 0; i < count; i++) {
+		transforms.push_back(randomTransform());
+		mats[i] = transforms[i].toMatrix();
+		affineMats[i] = AffineMatrix(mats[i]);
+	}
+	Array<Matrix> result(count);
+	Array<AffineMatrix> affineResult(count);
+	double instances = (double)count * (double)iterations;
+
+	double startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		for(uint32 i = 0; i < count; i++) {
+			result[i] = mats[i].inverse().transpose();
+		}
+	}
+	double generalTime = Time::getTime() - startTime;
+	startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		for(uint32 i = 0; i < count; i++) {
+			result[i] = mats[i].toNormalMatrix();
+		}
+	}
+	double affineTime = Time::getTime() - startTime;
+	startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		Matrix::toNormalMatrixBatch(&mats[0], &result[0], count);
+	}
+	double batchTime = Time::getTime() - startTime;
+	DEBUG_LOG("Performance", "NONE", "normal matrix: inverse().transpose() %.0f/ms, "
+			"toNormalMatrix %.0f/ms, toNormalMatrixBatch %.0f/ms",
+			instances/(generalTime*1000.0), instances/(affineTime*1000.0),
+			instances/(batchTime*1000.0));
+
+	startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		for(uint32 i = 0; i < count; i++) {
+			result[i] = mats[i].inverse();
+		}
+	}
+	generalTime = Time::getTime() - startTime;
+	startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		for(uint32 i = 0; i < count; i++) {
+			affineResult[i] = affineMats[i].inverse();
+		}
+	}
+	affineTime = Time::getTime() - startTime;
+	startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		for(uint32 i = 0; i < count; i++) {
+			result[i] = transforms[i].inverse();
+		}
+	}
+	double transformTime = Time::getTime() - startTime;
+	startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		for(uint32 i = 0; i < count; i++) {
+			result[i] = transforms[i].toMatrix().inverse();
+		}
+	}
+	double transformGeneralTime = Time::getTime() - startTime;
+	DEBUG_LOG("Performance", "NONE", "inverse: Matrix %.0f/ms, AffineMatrix %.0f/ms, "
+			"Transform::toMatrix().inverse() %.0f/ms, Transform::inverse %.0f/ms",
+			instances/(generalTime*1000.0), instances/(affineTime*1000.0),
+			instances/(transformGeneralTime*1000.0), instances/(transformTime*1000.0));
+
+	startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		for(uint32 i = 0; i < count; i++) {
+			result[i] = mats[i] * mats[count - 1 - i];
+		}
+	}
+	generalTime = Time::getTime() - startTime;
+	startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		for(uint32 i = 0; i < count; i++) {
+			affineResult[i] = affineMats[i] * affineMats[count - 1 - i];
+		}
+	}
+	affineTime = Time::getTime() - startTime;
+	DEBUG_LOG("Performance", "NONE", "multiply: Matrix %.0f/ms, AffineMatrix %.0f/ms",
+			instances/(generalTime*1000.0), instances/(affineTime*1000.0));
+}
+
+static void benchmarkPackedTransform()
+{
+	// Results in transforms/ms, -O2 -msse2 (-mavx2 -mfma similar):
+	//                               10k      1M
+	// translate Transform           685k     286k
+	// translate PackedTransform     480k     178k
+	// translate TransformStream     2297k    1296k
+	// transformMatrixBatch          225k     69k
+	// TransformStream::toMatrices   236k     80k
+	// Packing alone does not pay on this machine: the 3-float loads and
+	// stores cost more than the bandwidth saved, even out of cache. The SoA
+	// streams win because whole components move 8 at a time.
+	const uint32 sizes[] = { 10000, 1000000 };
+	const uint32 totalInstances = 20000000;
+	for(uint32 sizeIndex = 0; sizeIndex < ARRAY_SIZE_IN_ELEMENTS(sizes); sizeIndex++) {
+		uint32 count = sizes[sizeIndex];
+		uint32 iterations = totalInstances/count;
+		Array<Transform> transforms;
+		Array<PackedTransform> packedTransforms;
+		TransformStream stream;
+		stream.reserve(count);
+		for(uint32 i = 0; i < count; i++) {
+			transforms.push_back(randomTransform());
+			packedTransforms.push_back(PackedTransform(transforms[i]));
+			stream.add(transforms[i]);
+		}
+		Array<Matrix> result(count);
+
+		// Moves every transform, the typical read-modify-write pass over a
+		// large set, then builds the instance matrices.
+		const Vector3f offset(0.001f, 0.0f, -0.001f);
+		double startTime = Time::getTime();
+		for(uint32 j = 0; j < iterations; j++) {
+			for(uint32 i = 0; i < count; i++) {
+				transforms[i].setTranslation(transforms[i].getTranslation() + offset);
+			}
+		}
+		double transformTime = Time::getTime() - startTime;
+
+		startTime = Time::getTime();
+		for(uint32 j = 0; j < iterations; j++) {
+			for(uint32 i = 0; i < count; i++) {
+				Float3& translation = packedTransforms[i].translation;
+				translation.store(translation.load() + offset);
+			}
+		}
+		double packedTime = Time::getTime() - startTime;
+
+		float offsets[4];
+		offset.toVector().store4f(offsets);
+		startTime = Time::getTime();
+		for(uint32 j = 0; j < iterations; j++) {
+			for(uint32 k = 0; k < 3; k++) {
+				float* translation = stream.getStream(TransformStream::STREAM_TRANSLATION_X + k);
+				const Vector8 amt(Vector8::load1f(offsets[k]));
+				for(uint32 i = 0; i < count; i += 8) {
+					(Vector8::loadAligned(translation + i) + amt).storeAligned(translation + i);
+				}
+			}
+		}
+		double streamTime = Time::getTime() - startTime;
+
+		startTime = Time::getTime();
+		for(uint32 j = 0; j < iterations; j++) {
+			Matrix::transformMatrixBatch(&transforms[0], &result[0], count);
+		}
+		double batchTime = Time::getTime() - startTime;
+
+		startTime = Time::getTime();
+		for(uint32 j = 0; j < iterations; j++) {
+			stream.toMatrices(&result[0]);
+		}
+		double streamBatchTime = Time::getTime() - startTime;
+
+		double instances = (double)count * (double)iterations;
+		DEBUG_LOG("Performance", "NONE", "%u transforms: translate Transform %.0f/ms, "
+				"PackedTransform %.0f/ms, TransformStream %.0f/ms; to matrices "
+				"transformMatrixBatch %.0f/ms, TransformStream::toMatrices %.0f/ms", count,
+				instances/(transformTime*1000.0), instances/(packedTime*1000.0),
+				instances/(streamTime*1000.0), instances/(batchTime*1000.0),
+				instances/(streamBatchTime*1000.0));
+	}
+}
+
+static void benchmarkInstanceFormat()
+{
+	// Results for 1000 instances, -O2 -msse2 (AVX2 matrix kernel):
+	//                                            bytes   packs/ms
+	// FORMAT_MATRIX                              64      232k
+	// FORMAT_TRANSLATION_ROTATION_SCALE          40      247k
+	// FORMAT_TRANSLATION_ROTATION_UNIFORM_SCALE  32      531k
+	// FORMAT_SMALLEST_THREE_UNIFORM_SCALE        20      153k
+	// Every format packs 1000 instances in a few microseconds, so the upload
+	// size is what matters. Smallest three is 3.2x smaller than a matrix but
+	// is the slowest to pack; the 32 byte format is both half the size and
+	// the fastest.
+	const char* names[] = { "matrix", "translation/rotation/scale",
+		"translation/rotation/uniform scale", "smallest three/uniform scale" };
+	const uint32 count = 1000;
+	const uint32 iterations = 20000;
+	Array<Transform> transforms;
+	for(uint32 i = 0; i < count; i++) {
+		transforms.push_back(randomTransform());
+	}
+	for(uint32 format = 0; format < InstanceFormat::NUM_FORMATS; format++) {
+		enum InstanceFormat::Format instanceFormat = (enum InstanceFormat::Format)format;
+		Array<float> data[InstanceFormat::MAX_ELEMENTS];
+		void* elements[InstanceFormat::MAX_ELEMENTS];
+		packInstances(instanceFormat, transforms, data, elements);
+
+		double startTime = Time::getTime();
+		for(uint32 j = 0; j < iterations; j++) {
+			InstanceFormat::pack(instanceFormat, &transforms[0], elements, count);
+		}
+		double packTime = Time::getTime() - startTime;
+
+		double instances = (double)count * (double)iterations;
+		DEBUG_LOG("Performance", "NONE", "Instance format %s: %u bytes per instance, "
+				"packs %.0f/ms", names[format],
+				(uint32)InstanceFormat::getInstanceSize(instanceFormat),
+				instances/(packTime*1000.0));
+	}
+}
+
+static void benchmarkDirtyRangeTracker()
+{
+	// Results for 1M 32 byte instances with randomly scattered changes, the
+	// worst case for paging, -O2 -msse2:
+	// dirty    bytes sent   uploads   tracking
+	// 1000     6.6%         843       7 us
+	// 10000    59.2%        1995      42 us
+	// 100000   100%         1         230 us
+	// Marking is cheap enough for every change. Once most pages hold a
+	// change, merging turns the update back into one full upload.
+	const uint32 count = 1000000;
+	const uint32 iterations = 100;
+	const uintptr instanceSize = 32;
+	const uint32 numDirtyCounts[] = { 1000, 10000, 100000 };
+	for(uint32 k = 0; k < ARRAY_SIZE_IN_ELEMENTS(numDirtyCounts); k++) {
+		uint32 numDirty = numDirtyCounts[k];
+		DirtyRangeTracker tracker;
+		tracker.resize(count);
+		Array<DirtyRangeTracker::Range> ranges;
+		Array<uint32> dirtyIndices;
+		for(uint32 i = 0; i < numDirty; i++) {
+			dirtyIndices.push_back((uint32)(Math::randf() * (count - 1)));
+		}
+
+		uint64 bytes = 0;
+		uint64 numRanges = 0;
+		double startTime = Time::getTime();
+		for(uint32 j = 0; j < iterations; j++) {
+			tracker.clear();
+			for(uint32 i = 0; i < numDirty; i++) {
+				tracker.markDirty(dirtyIndices[i]);
+			}
+			tracker.getRanges(ranges);
+			for(uint32 i = 0; i < ranges.size(); i++) {
+				bytes += ranges[i].count * instanceSize;
+			}
+			numRanges += ranges.size();
+		}
+		double trackTime = Time::getTime() - startTime;
+
+		DEBUG_LOG("Performance", "NONE", "DirtyRangeTracker, %u of %u instances dirty: "
+				"%.1f%% of the bytes in %.0f uploads, %.1f us per frame", numDirty, count,
+				100.0 * (double)bytes/((double)count * instanceSize * iterations),
+				(double)numRanges/iterations, trackTime * 1000000.0/iterations);
+	}
+}
+
+static double timeAllocFreePairs(bool useMemory, const uint32* sizes, uint32 iterations)
+{
+	double startTime = Time::getTime();
+	for(uint32 i = 0; i < iterations; i++) {
+		uint32 size = sizes[i & 1023];
+		void* block = useMemory ? Memory::malloc(size) : ::malloc(size);
+		*(volatile uint8*)block = 0;
+		if(useMemory) {
+			Memory::free(block, size);
+		} else {
+			::free(block);
+		}
+	}
+	return Time::getTime() - startTime;
+}
+
+static double timeAllocFreeBatch(bool useMemory, bool sizedFree, const uint32* sizes,
+		const uint32* freeOrder, void** blocks, uint32 count, uint32 iterations)
+{
+	double startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		for(uint32 i = 0; i < count; i++) {
+			blocks[i] = useMemory ? Memory::malloc(sizes[i]) : ::malloc(sizes[i]);
+		}
+		for(uint32 i = 0; i < count; i++) {
+			uint32 index = freeOrder[i];
+			if(!useMemory) {
+				::free(blocks[index]);
+			} else if(sizedFree) {
+				Memory::free(blocks[index], sizes[index]);
+			} else {
+				Memory::free(blocks[index]);
+			}
+		}
+	}
+	return Time::getTime() - startTime;
+}
+
+static void benchmarkSizeClassAllocator()
+{
+	// Results for blocks of 16 to 256 bytes, -O2 -msse2, glibc:
+	//                                   glibc      Memory     Memory, unsized free
+	// malloc/free pairs                 14.2 ns    7.9 ns
+	// 100k mallocs, then shuffled frees 186.8 ns   109.8 ns   109.1 ns
+	// The batches are bound by cache misses on the blocks themselves, which
+	// hides the lookup a sized free skips. Blocks also carry no header: a 40
+	// byte std::map<int32, int32> node now takes 48 bytes rather than the 80
+	// that ::malloc used for it plus the old alignment slack and header.
+	const uint32 count = 100000;
+	Array<uint32> sizes(count);
+	Array<uint32> freeOrder(count);
+	for(uint32 i = 0; i < count; i++) {
+		sizes[i] = 16 + (uint32)(Math::randf() * 240.0f);
+		freeOrder[i] = i;
+	}
+	for(uint32 i = count - 1; i > 0; i--) {
+		uint32 j = (uint32)(Math::randf() * i);
+		uint32 temp = freeOrder[i];
+		freeOrder[i] = freeOrder[j];
+		freeOrder[j] = temp;
+	}
+	Array<void*> blocks(count);
+
+	const uint32 pairIterations = 10000000;
+	double glibcPairTime = timeAllocFreePairs(false, &sizes[0], pairIterations);
+	double memoryPairTime = timeAllocFreePairs(true, &sizes[0], pairIterations);
+
+	const uint32 batchIterations = 20;
+	double glibcBatchTime = timeAllocFreeBatch(false, false, &sizes[0], &freeOrder[0],
+			&blocks[0], count, batchIterations);
+	double memoryBatchTime = timeAllocFreeBatch(true, true, &sizes[0], &freeOrder[0],
+			&blocks[0], count, batchIterations);
+	double unsizedBatchTime = timeAllocFreeBatch(true, false, &sizes[0], &freeOrder[0],
+			&blocks[0], count, batchIterations);
+
+	double pairScale = 1000000000.0/pairIterations;
+	double batchScale = 1000000000.0/((double)count * batchIterations);
+	DEBUG_LOG("Performance", "NONE", "Allocation pairs: glibc %.1f ns, Memory %.1f ns",
+			glibcPairTime * pairScale, memoryPairTime * pairScale);
+	DEBUG_LOG("Performance", "NONE", "Allocation batches: glibc %.1f ns, Memory %.1f ns, "
+			"Memory with unsized free %.1f ns", glibcBatchTime * batchScale,
+			memoryBatchTime * batchScale, unsizedBatchTime * batchScale);
+}
+
+enum ReallocMethod
+{
+	REALLOC_COPY,
+	REALLOC_MEMORY,
+	REALLOC_GLIBC
+};
+
+// Appends vertices to an array resized to fit after every batch, or to 1.5
+// times its size when it runs out if growGeometric is set
+static double timeVertexArrayGrowth(enum ReallocMethod method, bool growGeometric,
+		uintptr vertexSize, uintptr batchSize, uintptr maxVertices, uint32 iterations)
+{
+	double startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		uint8* vertices = nullptr;
+		uintptr capacity = 0;
+		for(uintptr count = 0; count < maxVertices; count += batchSize) {
+			uintptr size = (count + batchSize) * vertexSize;
+			if(size > capacity) {
+				uintptr newCapacity = growGeometric ? Math::max(size, capacity * 3 / 2) : size;
+				if(method == REALLOC_COPY) {
+					uint8* newVertices = (uint8*)Memory::malloc(newCapacity);
+					if(vertices != nullptr) {
+						Memory::memcpy(newVertices, vertices, capacity);
+						Memory::free(vertices, capacity);
+					}
+					vertices = newVertices;
+				} else if(method == REALLOC_MEMORY) {
+					vertices = (uint8*)Memory::realloc(vertices, newCapacity);
+				} else {
+					vertices = (uint8*)::realloc(vertices, newCapacity);
+				}
+				capacity = newCapacity;
+			}
+			Memory::memset(vertices + count * vertexSize, (uint8)j, batchSize * vertexSize);
+		}
+		if(method == REALLOC_GLIBC) {
+			::free(vertices);
+		} else {
+			Memory::free(vertices, capacity);
+		}
+	}
+	return Time::getTime() - startTime;
+}
+
+static void benchmarkRealloc()
+{
+	// Results in ms for a 32 byte vertex array grown 1000 vertices at a time
+	// to 8 MB, -O2 -msse2, glibc:
+	//                       malloc + copy   Memory::realloc   ::realloc
+	// resized to fit        700 ms          5.8 ms            1.4 ms
+	// grown by 1.5x         22 ms           6.0 ms            1.2 ms
+	// Neither realloc copies once the array is mapped. The gap to ::realloc
+	// is page faults: each array here gets a fresh mapping, where glibc
+	// reuses the heap it kept from the previous one (about 5x fewer faults).
+	const uintptr vertexSize = 32;
+	const uintptr batchSize = 1000;
+	const uintptr maxVertices = 8 * 1024 * 1024 / vertexSize;
+	const uint32 iterations = 10;
+	const char* growthNames[] = { "resized to fit", "grown by 1.5x" };
+	for(uint32 i = 0; i < 2; i++) {
+		double times[3];
+		for(uint32 method = REALLOC_COPY; method <= REALLOC_GLIBC; method++) {
+			times[method] = timeVertexArrayGrowth((enum ReallocMethod)method, i == 1,
+					vertexSize, batchSize, maxVertices, iterations);
+		}
+		DEBUG_LOG("Performance", "NONE", "Vertex array %s: malloc + copy %.2f ms, "
+				"Memory::realloc %.2f ms, ::realloc %.2f ms", growthNames[i],
+				times[REALLOC_COPY] * 1000.0/iterations,
+				times[REALLOC_MEMORY] * 1000.0/iterations,
+				times[REALLOC_GLIBC] * 1000.0/iterations);
+	}
+}
+
+template<typename ArrayType>
+static double timeTemporaryArrays(FrameArena& arena, const ArrayType& prototype,
+		uint32 arraysPerFrame, uint32 arraySize, uint32 frames)
+{
+	double startTime = Time::getTime();
+	for(uint32 frame = 0; frame < frames; frame++) {
+		for(uint32 i = 0; i < arraysPerFrame; i++) {
+			ArrayType values(prototype);
+			values.resize(arraySize + (i & 15));
+			*(volatile uint32*)&values[0] = i;
+		}
+		arena.endFrame();
+	}
+	return Time::getTime() - startTime;
+}
+
+static void benchmarkFrameArena()
+{
+	// Results for 1000 temporary arrays of 16 to 31 uint32 per frame, sized
+	// up front like the device's name buffers, -O2 -msse2:
+	// std::allocator (size class allocator) 28.7 ns per array
+	// FrameArena                            18.5 ns per array
+	// Grown to 64 by push_back instead, the two are within noise, as the
+	// push_backs cost more than the allocations.
+	const uint32 arraysPerFrame = 1000;
+	const uint32 arraySize = 16;
+	const uint32 frames = 1000;
+	FrameArena arena;
+	double heapTime = timeTemporaryArrays(arena, Array<uint32>(), arraysPerFrame,
+			arraySize, frames);
+	double arenaTime = timeTemporaryArrays(arena,
+			Array<uint32, FrameArena>(arena),
+			arraysPerFrame, arraySize, frames);
+	double scale = 1000000000.0/((double)arraysPerFrame * frames);
+	DEBUG_LOG("Performance", "NONE", "Temporary arrays: std::allocator %.1f ns, "
+			"FrameArena %.1f ns, arena high-water mark %.1f KB",
+			heapTime * scale, arenaTime * scale, (double)arena.getHighWaterMark()/1024.0);
+}
+
+template<typename MapType>
+static double timeMapInsertErase(MapType& map, const int32* keys, uint32 count,
+		uint32 iterations)
+{
+	double startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		for(uint32 i = 0; i < count; i++) {
+			map[keys[i]] = i;
+		}
+		for(uint32 i = 0; i < count; i++) {
+			map.erase(keys[i]);
+		}
+	}
+	return Time::getTime() - startTime;
+}
+
+static void benchmarkContainerAllocators()
+{
+	// Results in ns per insert and erase, for 10k random keys, -O2 -msse2:
+	// Map<int32, int32>                 359 ns
+	// Map<int32, int32, PoolAllocator>  318 ns
+	// The tree walk costs more than the node allocation, which the size
+	// class allocator already makes cheap.
+	const uint32 count = 10000;
+	const uint32 iterations = 100;
+	Array<int32> keys(count);
+	for(uint32 i = 0; i < count; i++) {
+		keys[i] = (int32)(Math::randf() * 1000000.0f);
+	}
+	Map<int32, int32> heapMap;
+	PoolAllocator pool;
+	Map<int32, int32, PoolAllocator> poolMap(pool);
+	double heapTime = timeMapInsertErase(heapMap, &keys[0], count, iterations);
+	double poolTime = timeMapInsertErase(poolMap, &keys[0], count, iterations);
+	double scale = 1000000000.0/((double)count * iterations);
+	DEBUG_LOG("Performance", "NONE", "Map insert and erase: heap %.1f ns, pool %.1f ns",
+			heapTime * scale, poolTime * scale);
+}
+
+static double timeTrackedAllocFreePairs(bool tracked, const uint32* sizes, uint32 iterations)
+{
+	double startTime = Time::getTime();
+	for(uint32 i = 0; i < iterations; i++) {
+		uint32 size = sizes[i & 1023];
+		if(tracked) {
+			void* block = MemoryTracker::malloc(size, 16);
+			*(volatile uint8*)block = 0;
+			MemoryTracker::free(block);
+		} else {
+			void* block = PlatformMemory::malloc(size, 16);
+			*(volatile uint8*)block = 0;
+			PlatformMemory::free(block, size, 16);
+		}
+	}
+	return Time::getTime() - startTime;
+}
+
+static void benchmarkMemoryTracker()
+{
+	// Results for malloc/free pairs of 16 to 256 bytes, -O2 -msse2:
+	// Untracked   5.8 ns
+	// Tracked    13.5 ns
+	// Counting takes no lock or atomic add; the difference is the calls and
+	// the header, and matters little next to what is done with the memory.
+	const uint32 count = 1024;
+	const uint32 iterations = 10000000;
+	Array<uint32> sizes(count);
+	for(uint32 i = 0; i < count; i++) {
+		sizes[i] = 16 + (uint32)(Math::randf() * 240.0f);
+	}
+	double untrackedTime = timeTrackedAllocFreePairs(false, &sizes[0], iterations);
+	double trackedTime = timeTrackedAllocFreePairs(true, &sizes[0], iterations);
+	double scale = 1000000000.0/iterations;
+	DEBUG_LOG("Performance", "NONE", "Allocation pairs: untracked %.1f ns, tracked %.1f ns",
+			untrackedTime * scale, trackedTime * scale);
+}
+
+static void benchmarkAABBCulling()
+{
+	// Results for 100k boxes in boxes/ms:
+	// -O2 -msse2:         scalar 43689, cullFrustum 145000 (3.3x)
+	// -O2 -mavx2 -mfma:   scalar 49807, cullFrustum 345933 (6.9x)
+	// -O2 -msse2, AVX2 kernels picked at runtime: scalar 54319, cullFrustum 384143
+	const uint32 count = 100000;
+	const uint32 iterations = 100;
+	Plane planes[6];
+	Plane absPlanes[6];
+	getTestFrustum(planes);
+	for(uint32 i = 0; i < 6; i++) {
+		absPlanes[i] = planes[i].abs();
+	}
+
+	AABBArray aabbs;
+	Array<AABB> aabbList;
+	for(uint32 i = 0; i < count; i++) {
+		aabbList.push_back(randomAABB());
+		aabbs.add(aabbList.back());
+	}
+
+	Array<uint64> visibleBits(aabbs.getNumBitmaskWords());
+	double startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		Memory::memzero(&visibleBits[0], visibleBits.size() * sizeof(uint64));
+		for(uint32 i = 0; i < count; i++) {
+			Vector3f center, extents;
+			aabbList[i].getCenterAndExtents(center, extents);
+			bool isVisible = true;
+			for(uint32 k = 0; k < 6 && isVisible; k++) {
+				bool isFullyInside;
+				Intersects::intersectPlaneAABBFast(center.toVector(1.0f),
+						extents.toVector(0.0f), planes[k], absPlanes[k],
+						isFullyInside, isVisible);
+			}
+			visibleBits[i/64] |= ((uint64)isVisible) << (i%64);
+		}
+	}
+	double scalarTime = Time::getTime() - startTime;
+
+	startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		aabbs.cullFrustum(planes, &visibleBits[0]);
+	}
+	double batchTime = Time::getTime() - startTime;
+
+	double boxes = (double)count * (double)iterations;
+	DEBUG_LOG("Performance", "NONE",
+			"%u AABBs: scalar cull %.0f boxes/ms, AABBArray::cullFrustum %.0f boxes/ms",
+			count, boxes/(scalarTime*1000.0), boxes/(batchTime*1000.0));
+}
+
+static void benchmarkSphereCulling()
+{
+	// Results for 1M spheres in spheres/ms (16 bytes read per sphere):
+	// -O2 -msse2:         scalar 49240, cullFrustum 289915 (4.64 GB/s, 5.9x)
+	// -O2 -mavx2 -mfma:   scalar 48406, cullFrustum 590909 (9.45 GB/s, 12.2x)
+	const uint32 count = 1000000;
+	const uint32 iterations = 20;
+	Plane planes[6];
+	getTestFrustum(planes);
+
+	SphereArray spheres;
+	Array<Sphere> sphereList;
+	for(uint32 i = 0; i < count; i++) {
+		sphereList.push_back(randomSphere());
+		spheres.add(sphereList.back());
+	}
+
+	Array<uint32> visibleIndices(count);
+	uint32 numVisible = 0;
+	double startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		numVisible = 0;
+		for(uint32 i = 0; i < count; i++) {
+			bool isVisible = true;
+			for(uint32 k = 0; k < 6 && isVisible; k++) {
+				bool isFullyInside;
+				Intersects::intersectPlaneSphere(sphereList[i], planes[k],
+						isFullyInside, isVisible);
+			}
+			if(isVisible) {
+				visibleIndices[numVisible++] = i;
+			}
+		}
+	}
+	double scalarTime = Time::getTime() - startTime;
+
+	startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		numVisible = spheres.cullFrustum(planes, &visibleIndices[0]);
+	}
+	double batchTime = Time::getTime() - startTime;
+
+	double numSpheres = (double)count * (double)iterations;
+	DEBUG_LOG("Performance", "NONE",
+			"%u spheres (%u visible): scalar cull %.0f spheres/ms, "
+			"SphereArray::cullFrustum %.0f spheres/ms (%.2f GB/s)",
+			count, numVisible, numSpheres/(scalarTime*1000.0),
+			numSpheres/(batchTime*1000.0), numSpheres*16.0/(batchTime*1.e9));
+}
+
+static void benchmarkSIMDKernels()
+{
+	// Results for a 64 MB copy and 1M bits, about 1/3 set:
+	// C library memcpy:                  12.2 ms
+	// -O2 -msse2 baseline:               memcpy 10.9 ms, bitmaskToIndices 2867 bits/us
+	// AVX2 unit (-mavx2 -mfma):          memcpy 8.5 ms, bitmaskToIndices 9739 bits/us
+	DEBUG_LOG("Performance", "NONE", "%s", SIMDKernels::getReport().c_str());
+
+	const uintptr copySize = 64*1024*1024;
+	const uint32 numBits = 1024*1024;
+	const uint32 iterations = 20;
+	Array<uint8> src(copySize, 1);
+	Array<uint8> dest(copySize, 0);
+	Array<uint64> bits(numBits/64);
+	for(uint32 i = 0; i < bits.size(); i++) {
+		// About a third of the bits set, in runs like a culling result
+		bits[i] = (i % 3 == 0) ? ~((uint64)0) : ((uint64)Math::rand() << 32) & (uint64)Math::rand();
+	}
+	Array<uint32> indices(numBits);
+
+	double startTime = Time::getTime();
+	for(uint32 j = 0; j < iterations; j++) {
+		Memory::memcpy(&dest[0], &src[0], copySize);
+	}
+	double libcCopyTime = (Time::getTime() - startTime)/iterations;
+	DEBUG_LOG("Performance", "NONE", "C library memcpy, %u MB: %.2f ms",
+			(uint32)(copySize >> 20), libcCopyTime*1000.0);
+
+	const SIMDKernelTable* tables[] = {
+		SIMDKernels::getBaselineTable(), SIMDKernels::getAVX2Table()
+	};
+	for(uint32 i = 0; i < ARRAY_SIZE_IN_ELEMENTS(tables); i++) {
+		if(tables[i] == nullptr || tables[i]->simdLevel > CPUInfo::getSIMDLevel()) {
+			continue;
+		}
+		const SIMDKernelTable& table = *tables[i];
+		startTime = Time::getTime();
+		for(uint32 j = 0; j < iterations; j++) {
+			table.memcpy(&dest[0], &src[0], copySize);
+		}
+		double copyTime = (Time::getTime() - startTime)/iterations;
+
+		uint32 numIndices = 0;
+		startTime = Time::getTime();
+		for(uint32 j = 0; j < iterations; j++) {
+			numIndices = table.bitmaskToIndices(&bits[0], numBits, &indices[0]);
+		}
+		double indexTime = (Time::getTime() - startTime)/iterations;
+		DEBUG_LOG("Performance", "NONE",
+				"%s kernels: memcpy %.2f ms, bitmaskToIndices %.0f bits/us (%u set)",
+				table.name, copyTime*1000.0, numBits/(indexTime*1000000.0), numIndices);
+	}
+}
+
+static void benchmarkBVH()
+{
+	// Results for terrain02.obj (32768 triangles), -O2 -msse2, single core VM:
+	// build 17.4 ms, closestHit 1.45 Mrays/s, anyHit 1.92 Mrays/s.
+	// Parallel build time matches serial there; it only helps with more cores.
+	Array<IndexedModel> models;
+	Array<uint32> modelMaterialIndices;
+	Array<MaterialSpec> materials;
+	if(!ModelLoader::loadModels("./res/models/terrain02.obj", models,
+				modelMaterialIndices, materials) || models.size() == 0) {
+		return;
+	}
+	const Array<float>& positions = models[0].getElement(0);
+	const Array<uint32>& indices = models[0].getIndices();
+	uint32 numTriangles = (uint32)indices.size()/3;
+
+	BVH bvh;
+	double startTime = Time::getTime();
+	bvh.build(&positions[0], &indices[0], numTriangles, 1);
+	double serialBuildTime = Time::getTime() - startTime;
+	startTime = Time::getTime();
+	bvh.build(&positions[0], &indices[0], numTriangles);
+	double parallelBuildTime = Time::getTime() - startTime;
+
+	// Closest hit: rays cast down onto the terrain from above. Any hit:
+	// short occlusion rays between random points just above the surface.
+	const uint32 numRays = 1000000;
+	AABB bounds = bvh.getBounds();
+	Vector3f mins = bounds.getMinExtents();
+	Vector3f maxs = bounds.getMaxExtents();
+	Array<Vector3f> starts;
+	Array<Vector3f> dirs;
+	for(uint32 i = 0; i < numRays; i++) {
+		starts.push_back(Vector3f(Math::randf(mins[0], maxs[0]), maxs[1] + 1.0f,
+					Math::randf(mins[2], maxs[2])));
+		dirs.push_back(Vector3f(Math::randf(-0.3f, 0.3f), -1.0f,
+					Math::randf(-0.3f, 0.3f)).normalized());
+	}
+
+	uint32 numHits = 0;
+	startTime = Time::getTime();
+	for(uint32 i = 0; i < numRays; i++) {
+		uint32 triangleIndex;
+		float distance;
+		numHits += bvh.closestHit(starts[i], dirs[i], 1.e30f, triangleIndex, distance);
+	}
+	double closestTime = Time::getTime() - startTime;
+
+	for(uint32 i = 0; i < numRays; i++) {
+		starts[i] = Vector3f(starts[i][0], Math::randf(mins[1], maxs[1]), starts[i][2]);
+		dirs[i] = Vector3f(Math::randf(-1.0f, 1.0f), Math::randf(-0.2f, 0.2f),
+				Math::randf(-1.0f, 1.0f));
+	}
+	uint32 numOccluded = 0;
+	startTime = Time::getTime();
+	for(uint32 i = 0; i < numRays; i++) {
+		numOccluded += bvh.anyHit(starts[i], dirs[i], 1.0f);
+	}
+	double anyTime = Time::getTime() - startTime;
+
+	DEBUG_LOG("Performance", "NONE",
+			"BVH over %u triangles (%u nodes): build %.2f ms (1 thread), "
+			"%.2f ms (all threads)", numTriangles, bvh.getNumNodes(),
+			serialBuildTime*1000.0, parallelBuildTime*1000.0);
+	DEBUG_LOG("Performance", "NONE",
+			"BVH closestHit %.2f Mrays/s (%u hits), anyHit %.2f Mrays/s (%u hits)",
+			numRays/(closestTime*1.e6), numHits, numRays/(anyTime*1.e6), numOccluded);
+}
+
+static void benchmarkRayPacket()
+{
+	// Results in ray-box tests/ms, nearest hit of 100k coherent rays:
+	// -O2 -msse2:         scalar 138586, nearestHits (4 wide) 236063 (1.7x)
+	// -O2 -mavx2 -mfma:   scalar 156055, nearestHits (8 wide) 440002 (2.8x)
+	const uint32 numRays = 100000;
+	const uint32 numAABBs = 256;
+	Array<AABB> aabbs;
+	for(uint32 i = 0; i < numAABBs; i++) {
+		aabbs.push_back(randomAABB());
+	}
+	Array<Vector3f> starts;
+	Array<Vector3f> rayDirs;
+	Array<float> maxDistances;
+	randomCoherentRays(starts, rayDirs, maxDistances, numRays);
+	Array<uint32> hitIndices(numRays);
+	Array<float> hitDistances(numRays);
+
+	double startTime = Time::getTime();
+	for(uint32 i = 0; i < numRays; i++) {
+		hitIndices[i] = (uint32)-1;
+		hitDistances[i] = maxDistances[i];
+		for(uint32 j = 0; j < numAABBs; j++) {
+			float distance;
+			if(intersectRayAABBScalar(aabbs[j], starts[i], rayDirs[i],
+						hitDistances[i], distance)) {
+				hitIndices[i] = j;
+				hitDistances[i] = distance;
+			}
+		}
+	}
+	double scalarTime = Time::getTime() - startTime;
+
+	startTime = Time::getTime();
+	RayPacket::nearestHits(&starts[0], &rayDirs[0], &maxDistances[0], numRays,
+			&aabbs[0], numAABBs, &hitIndices[0], &hitDistances[0]);
+	double packetTime = Time::getTime() - startTime;
+
+	double numTests = (double)numRays * (double)numAABBs;
+	DEBUG_LOG("Performance", "NONE",
+			"%u rays x %u boxes: scalar %.0f ray-box tests/ms, "
+			"RayPacket::nearestHits (%u wide) %.0f ray-box tests/ms",
+			numRays, numAABBs, numTests/(scalarTime*1000.0), RAY_PACKET_SIZE,
+			numTests/(packetTime*1000.0));
+}
+
+static void benchmarkDynamicAABBTree()
+{
+	// Results for 50k bodies at -O2 -msse2: inserting all 59 ms, moving all
+	// 15.9 ms/frame with ~20% leaving their fat AABB, queryPairs 20.4 ms/frame.
+	const uint32 numBodies = 50000;
+	const uint32 numFrames = 20;
+	const float worldSize = 500.0f;
+	Array<AABB> aabbs;
+	Array<Vector3f> velocities;
+	for(uint32 i = 0; i < numBodies; i++) {
+		Vector3f center(Math::randf(-worldSize, worldSize), Math::randf(-worldSize, worldSize),
+				Math::randf(-worldSize, worldSize));
+		Vector3f extents(Math::randf(0.5f, 3.0f), Math::randf(0.5f, 3.0f),
+				Math::randf(0.5f, 3.0f));
+		aabbs.push_back(AABB(center - extents, center + extents));
+		velocities.push_back(Vector3f(Math::randf(-0.3f, 0.3f), Math::randf(-0.3f, 0.3f),
+				Math::randf(-0.3f, 0.3f)));
+	}
+
+	double startTime = Time::getTime();
+	DynamicAABBTree tree(0.2f, 4.0f);
+	Array<uint32> proxies;
+	for(uint32 i = 0; i < numBodies; i++) {
+		proxies.push_back(tree.createProxy(aabbs[i], i));
+	}
+	double buildTime = Time::getTime() - startTime;
+
+	Array<DynamicAABBTree::Pair> pairs;
+	uint32 numReinserted = 0;
+	double moveTime = 0.0;
+	double pairTime = 0.0;
+	for(uint32 frame = 0; frame < numFrames; frame++) {
+		startTime = Time::getTime();
+		for(uint32 i = 0; i < numBodies; i++) {
+			aabbs[i] = aabbs[i].translate(velocities[i]);
+			numReinserted += tree.moveProxy(proxies[i], aabbs[i], velocities[i]);
+		}
+		moveTime += Time::getTime() - startTime;
+
+		startTime = Time::getTime();
+		pairs.clear();
+		tree.queryPairs(pairs);
+		pairTime += Time::getTime() - startTime;
+	}
+
+	DEBUG_LOG("Performance", "NONE",
+			"DynamicAABBTree, %u bodies: insert all %.2f ms, move %.2f ms/frame "
+			"(%.1f%% reinserted), queryPairs %.2f ms/frame (%u pairs), height %u",
+			numBodies, buildTime*1000.0, moveTime*1000.0/numFrames,
+			100.0*numReinserted/((double)numBodies*numFrames),
+			pairTime*1000.0/numFrames, (uint32)pairs.size(), tree.getHeight());
+}
+
+static void benchmarkSweepAndPrune(uint32 numBodies, bool compareBruteForce)
+{
+	// Results at -O2, bodies drifting ~0.3 units/frame in a 1000 unit cube:
+	//                      5k bodies   50k bodies
+	// -msse2:              0.31 ms     11.8 ms   (brute force 5k: 7.9 ms)
+	// -mavx2 -mfma:        0.19 ms     7.4 ms    (brute force 5k: 9.1 ms)
+	const uint32 numFrames = 20;
+	const float worldSize = 500.0f;
+	Array<AABB> aabbs;
+	Array<Vector3f> velocities;
+	for(uint32 i = 0; i < numBodies; i++) {
+		Vector3f center(Math::randf(-worldSize, worldSize), Math::randf(-worldSize, worldSize),
+				Math::randf(-worldSize, worldSize));
+		Vector3f extents(Math::randf(0.5f, 3.0f), Math::randf(0.5f, 3.0f),
+				Math::randf(0.5f, 3.0f));
+		aabbs.push_back(AABB(center - extents, center + extents));
+		velocities.push_back(Vector3f(Math::randf(-0.3f, 0.3f), Math::randf(-0.3f, 0.3f),
+				Math::randf(-0.3f, 0.3f)));
+	}
+
+	SweepAndPrune sap;
+	Array<uint32> handles;
+	for(uint32 i = 0; i < numBodies; i++) {
+		handles.push_back(sap.add(aabbs[i]));
+	}
+	Array<SweepAndPrune::Pair> pairs;
+	sap.findPairs(pairs);
+
+	double startTime = Time::getTime();
+	uint32 numShifts = 0;
+	for(uint32 frame = 0; frame < numFrames; frame++) {
+		for(uint32 i = 0; i < numBodies; i++) {
+			aabbs[i] = aabbs[i].translate(velocities[i]);
+			sap.update(handles[i], aabbs[i]);
+		}
+		sap.findPairs(pairs);
+		numShifts += sap.getNumSortShifts();
+	}
+	double sapTime = (Time::getTime() - startTime)/numFrames;
+
+	DEBUG_LOG("Performance", "NONE",
+			"SweepAndPrune, %u bodies: update + findPairs %.2f ms/frame (%u pairs, "
+			"%u sort shifts/frame)", numBodies, sapTime*1000.0, (uint32)pairs.size(),
+			numShifts/numFrames);
+
+	if(compareBruteForce) {
+		uint32 numBruteForcePairs = 0;
+		startTime = Time::getTime();
+		for(uint32 i = 0; i < numBodies; i++) {
+			for(uint32 j = i + 1; j < numBodies; j++) {
+				numBruteForcePairs += aabbs[i].intersects(aabbs[j]);
+			}
+		}
+		double bruteForceTime = Time::getTime() - startTime;
+		assertCheck(numBruteForcePairs == pairs.size());
+		DEBUG_LOG("Performance", "NONE", "Brute force pairs, %u bodies: %.2f ms",
+				numBodies, bruteForceTime*1000.0);
+	}
+}
+
 void Tests::runPerformanceTests()
 {
+	benchmarkTranscendentals();
+	benchmarkNormalize();
+	benchmarkMatrixBatch();
+	benchmarkMatrixArray4();
+	benchmarkAffineMatrix();
+	benchmarkPackedTransform();
+	benchmarkInstanceFormat();
+	benchmarkDirtyRangeTracker();
+	benchmarkSizeClassAllocator();
+	benchmarkRealloc();
+	benchmarkFrameArena();
+	benchmarkContainerAllocators();
+	benchmarkMemoryTracker();
+	benchmarkAABBCulling();
+	benchmarkSphereCulling();
+	benchmarkSIMDKernels();
+	benchmarkBVH();
+	benchmarkRayPacket();
+	benchmarkDynamicAABBTree();
+	benchmarkSweepAndPrune(5000, true);
+	benchmarkSweepAndPrune(50000, false);
+
 	double startTime = Time::getTime();
 	Transform transform;
 	Matrix transformMat = transform.toMatrix();
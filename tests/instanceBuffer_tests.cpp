@@ -0,0 +1,110 @@
+#include "minunit.h"
+#include "../src/rendering/instanceBuffer.hpp"
+
+struct Upload
+{
+	uint32 bufferIndex;
+	uintptr offset;
+	const void* data;
+	uintptr dataSize;
+	bool isWholeBuffer;
+};
+
+// Records the uploads InstanceBuffer makes, in place of a VertexArray
+struct MockBuffer
+{
+	Array<Upload> uploads;
+
+	void updateBuffer(uint32 bufferIndex, const void* data, uintptr dataSize)
+	{
+		Upload upload = { bufferIndex, 0, data, dataSize, true };
+		uploads.push_back(upload);
+	}
+	void updateBufferRange(uint32 bufferIndex, uintptr offset, const void* data,
+			uintptr dataSize)
+	{
+		Upload upload = { bufferIndex, offset, data, dataSize, false };
+		uploads.push_back(upload);
+	}
+};
+
+const char* grow_tests()
+{
+	MockBuffer buffer;
+	InstanceBuffer<MockBuffer> instances(buffer, 4, 12, 4, 1);
+	uint8 data[40 * 12];
+
+	// The first update has to create the whole buffer
+	instances.resize(32);
+	instances.update(data);
+	mu_assert(buffer.uploads.size() == 1 && buffer.uploads[0].isWholeBuffer,
+			"First update not a whole upload");
+	mu_assert(buffer.uploads[0].bufferIndex == 4 && buffer.uploads[0].data == data
+			&& buffer.uploads[0].dataSize == 32 * 12, "Whole upload misplaced");
+	mu_assert(instances.getBytesUploaded() == 32 * 12 && instances.getNumUploads() == 1,
+			"Whole upload miscounted");
+
+	// Growing past what was uploaded sends everything again, dirty or not
+	instances.resize(40);
+	instances.update(data);
+	mu_assert(buffer.uploads.size() == 2 && buffer.uploads[1].isWholeBuffer
+			&& buffer.uploads[1].dataSize == 40 * 12, "Growth not a whole upload");
+	mu_assert(instances.getTotalBytesUploaded() == 72 * 12, "Total bytes miscounted");
+
+	// Shrinking keeps the buffer, so only the dirty page is sent
+	instances.resize(20);
+	instances.markDirty(19);
+	instances.update(data);
+	mu_assert(buffer.uploads.size() == 3 && !buffer.uploads[2].isWholeBuffer
+			&& buffer.uploads[2].offset == 16 * 12 && buffer.uploads[2].dataSize == 4 * 12,
+			"Shrunk buffer not updated in place");
+	return NULL;
+}
+
+const char* partial_update_tests()
+{
+	MockBuffer buffer;
+	InstanceBuffer<MockBuffer> instances(buffer, 0, 12, 4, 1);
+	uint8 data[32 * 12];
+	instances.resize(32);
+	instances.update(data);
+
+	// Pages 1 and 5 are too far apart to merge
+	instances.markDirty(5);
+	instances.markDirty(20, 2);
+	instances.update(data);
+	mu_assert(buffer.uploads.size() == 3, "Dirty pages not uploaded separately");
+	mu_assert(buffer.uploads[1].offset == 4 * 12 && buffer.uploads[1].dataSize == 4 * 12
+			&& buffer.uploads[1].data == data + 4 * 12, "First range misplaced");
+	mu_assert(buffer.uploads[2].offset == 20 * 12 && buffer.uploads[2].dataSize == 4 * 12
+			&& buffer.uploads[2].data == data + 20 * 12, "Second range misplaced");
+	mu_assert(instances.getBytesUploaded() == 8 * 12 && instances.getNumUploads() == 2,
+			"Partial upload miscounted");
+
+	// Pages 1 and 3 merge over the clean page between them
+	instances.markDirty(4);
+	instances.markDirty(12);
+	instances.update(data);
+	mu_assert(buffer.uploads.size() == 4 && buffer.uploads[3].offset == 4 * 12
+			&& buffer.uploads[3].dataSize == 12 * 12, "Close pages not merged");
+
+	// Nothing dirty, nothing sent
+	instances.update(data);
+	mu_assert(buffer.uploads.size() == 4 && instances.getBytesUploaded() == 0
+			&& instances.getNumUploads() == 0, "Clean buffer uploaded");
+	mu_assert(instances.getTotalBytesUploaded() == (32 + 8 + 12) * 12,
+			"Total bytes miscounted");
+	return NULL;
+}
+
+const char* all_tests()
+{
+	mu_suite_start();
+
+	mu_run_test(grow_tests);
+	mu_run_test(partial_update_tests);
+
+	return NULL;
+}
+
+RUN_TESTS(all_tests);
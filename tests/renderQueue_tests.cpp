@@ -0,0 +1,178 @@
+#include "minunit.h"
+#include "../src/rendering/renderQueue.hpp"
+#include <algorithm>
+#include <stdlib.h>
+
+struct Draw
+{
+	uint32 fbo;
+	uint32 shader;
+	uint32 vao;
+	uint32 pipelineState;
+	uint32 numInstances;
+	uintptr uniformOffset;
+};
+
+struct MockDevice
+{
+	Array<Draw> draws;
+	uintptr uniformOffset;
+	uint32 numUniformBinds;
+
+	MockDevice() :
+		uniformOffset(0),
+		numUniformBinds(0) {}
+
+	void draw(uint32 fbo, uint32 shader, uint32 vao, uint32 pipelineState,
+			uint32 numInstances, uint32 numElements)
+	{
+		Draw draw = { fbo, shader, vao, pipelineState, numInstances, uniformOffset };
+		draws.push_back(draw);
+	}
+
+	void setShaderUniformBufferRange(uint32 shader, const String& uniformBufferName,
+			uint32 buffer, uintptr offset, uintptr dataSize)
+	{
+		uniformOffset = offset;
+		numUniformBinds++;
+	}
+};
+
+static void bindMaterial(uint32 material, void* userData)
+{
+	((Array<uint32>*)userData)->push_back(material);
+}
+
+const char* state_sort_tests()
+{
+	MockDevice device;
+	RenderQueue<MockDevice> queue(device);
+	Array<uint32> materials;
+	queue.setMaterialCallback(bindMaterial, &materials);
+
+	// Two shaders interleaved, recorded far to near
+	for(uint32 i = 0; i < 8; i++) {
+		queue.submit(0, 0, 1, 1 + (i & 1), 5, 3, 100.0f - i, i, 36);
+	}
+	queue.flush();
+
+	mu_assert(device.draws.size() == 8 && queue.getNumDraws() == 8, "Draws lost");
+	for(uint32 i = 0; i < 4; i++) {
+		mu_assert(device.draws[i].shader == 1 && device.draws[i + 4].shader == 2,
+				"Draws not grouped by shader");
+	}
+	mu_assert(device.draws[0].numInstances == 6 && device.draws[3].numInstances == 0,
+			"Draws with equal state not front to back");
+	mu_assert(queue.getNumUnsortedStateChanges() == 7 && queue.getNumStateChanges() == 1
+			&& queue.getNumStateChangesSaved() == 6, "State changes miscounted");
+	mu_assert(materials.size() == 1 && materials[0] == 5, "Material bound more than once");
+
+	queue.flush();
+	mu_assert(queue.getNumDraws() == 0 && device.draws.size() == 8,
+			"Queue not emptied by flush");
+	return NULL;
+}
+
+const char* pass_and_target_tests()
+{
+	MockDevice device;
+	RenderQueue<MockDevice> queue(device);
+	queue.setPassSortMode(1, RenderQueue<MockDevice>::SORT_BACK_TO_FRONT);
+
+	// Transparent pass recorded first and near to far, with mixed state
+	queue.submit(0, 1, 2, 7, 0, 3, 1.0f, 0, 36);
+	queue.submit(0, 1, 2, 8, 0, 3, 2.0f, 1, 36);
+	queue.submit(0, 1, 2, 7, 0, 3, 3.0f, 2, 36);
+	queue.submit(0, 0, 1, 7, 0, 3, 5.0f, 3, 36);
+	// A later target stays after the window, despite its id
+	queue.submit(9, 0, 1, 7, 0, 3, 1.0f, 4, 36);
+	queue.flush();
+
+	mu_assert(device.draws[0].numInstances == 3, "Opaque pass not first");
+	mu_assert(device.draws[1].numInstances == 2 && device.draws[2].numInstances == 1
+			&& device.draws[3].numInstances == 0, "Transparent pass not back to front");
+	mu_assert(device.draws[4].fbo == 9, "Targets reordered");
+
+	// Next frame, the other target comes first
+	queue.submit(0, 0, 1, 7, 0, 3, 1.0f, 5, 36);
+	queue.submit(9, 0, 1, 7, 0, 3, 1.0f, 6, 36);
+	queue.submit(0, 0, 1, 7, 0, 3, 1.0f, 7, 36);
+	queue.flush();
+	mu_assert(device.draws[5].fbo == 0 && device.draws[6].fbo == 0
+			&& device.draws[7].fbo == 9, "Target order not taken from first use");
+
+	// Depth comes before state back to front, so sorting can cost changes
+	queue.submit(0, 1, 2, 1, 0, 3, 10.0f, 8, 36);
+	queue.submit(0, 1, 2, 1, 0, 3, 9.0f, 9, 36);
+	queue.submit(0, 1, 2, 2, 0, 3, 9.5f, 10, 36);
+	queue.flush();
+	mu_assert(device.draws[8].numInstances == 8 && device.draws[9].numInstances == 10
+			&& device.draws[10].numInstances == 9, "Transparent pass not back to front");
+	mu_assert(queue.getNumUnsortedStateChanges() == 1 && queue.getNumStateChanges() == 2
+			&& queue.getNumStateChangesSaved() == -1, "State changes saved not negative");
+	return NULL;
+}
+
+const char* uniform_buffer_tests()
+{
+	MockDevice device;
+	RenderQueue<MockDevice> queue(device);
+	queue.setUniformBufferName("SceneData");
+
+	// Each draw's block is bound at flush, not when it was submitted
+	queue.submit(0, 0, 1, 1, 0, 3, 2.0f, 0, 36, 4, 256, 64);
+	queue.submit(0, 0, 1, 1, 0, 3, 1.0f, 1, 36, 4, 0, 64);
+	queue.submit(0, 0, 1, 1, 0, 3, 3.0f, 2, 36, 4, 0, 64);
+	queue.flush();
+	mu_assert(device.draws[0].numInstances == 1 && device.draws[0].uniformOffset == 0,
+			"Nearest draw used another draw's block");
+	mu_assert(device.draws[1].numInstances == 0 && device.draws[1].uniformOffset == 256,
+			"Middle draw used another draw's block");
+	mu_assert(device.draws[2].numInstances == 2 && device.draws[2].uniformOffset == 0,
+			"Farthest draw used another draw's block");
+	mu_assert(device.numUniformBinds == 3, "Blocks not bound once per change");
+	return NULL;
+}
+
+const char* radix_sort_tests()
+{
+	srand(1);
+	const uint32 count = 10000;
+	Array<uint64> keys(count);
+	Array<uint32> indices(count);
+	Array<uint64> tempKeys(count);
+	Array<uint32> tempIndices(count);
+	for(uint32 i = 0; i < count; i++) {
+		// Few distinct high bits, like real keys, so some digits are skipped
+		keys[i] = (uint64)(rand() & 3) << 60 | (uint64)rand() << 20 | (rand() & 0xFF);
+		indices[i] = i;
+	}
+	Array<uint64> expected(keys);
+	std::sort(expected.begin(), expected.end());
+	Array<uint64> original(keys);
+
+	RenderQueue<MockDevice>::radixSort(&keys[0], &indices[0], count,
+			&tempKeys[0], &tempIndices[0]);
+	for(uint32 i = 0; i < count; i++) {
+		mu_assert(keys[i] == expected[i], "Keys not sorted");
+		mu_assert(original[indices[i]] == keys[i], "Indices not moved with keys");
+		if(i > 0 && keys[i] == keys[i - 1]) {
+			mu_assert(indices[i] > indices[i - 1], "Sort not stable");
+		}
+	}
+	return NULL;
+}
+
+const char* all_tests()
+{
+	mu_suite_start();
+
+	mu_run_test(state_sort_tests);
+	mu_run_test(pass_and_target_tests);
+	mu_run_test(uniform_buffer_tests);
+	mu_run_test(radix_sort_tests);
+
+	return NULL;
+}
+
+RUN_TESTS(all_tests);
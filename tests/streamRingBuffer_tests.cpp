@@ -0,0 +1,252 @@
+#include "minunit.h"
+#include "../src/rendering/uniformBufferArena.hpp"
+
+// Records what StreamRingBuffer asks of the device. Fences are signaled
+// when waited on, like a GPU that finishes as soon as the CPU waits, or
+// once lastSignaledFence reaches them.
+struct MockDevice
+{
+	bool supportsPersistentMapping;
+	Array<uint8> storage;
+	Array<uint32> waitedFences;
+	uint32 numFences;
+	uint32 lastSignaledFence;
+	uint32 numReleasedFences;
+	uint32 numOrphans;
+	uintptr bytesUpdated;
+	uintptr lastUpdateOffset;
+	uintptr boundOffset;
+	uintptr boundSize;
+
+	MockDevice(bool persistent) :
+		supportsPersistentMapping(persistent),
+		numFences(0), lastSignaledFence(0), numReleasedFences(0), numOrphans(0),
+		bytesUpdated(0), lastUpdateOffset(0), boundOffset(0), boundSize(0) {}
+
+	uint32 createStreamBuffer(uintptr dataSize, void** mappedData)
+	{
+		storage.resize(dataSize);
+		*mappedData = supportsPersistentMapping ? &storage[0] : nullptr;
+		return 1;
+	}
+	void orphanStreamBuffer(uint32 buffer, uintptr dataSize)
+	{
+		numOrphans++;
+	}
+	void updateStreamBuffer(uint32 buffer, uintptr offset, const void* data,
+			uintptr dataSize)
+	{
+		Memory::memcpy(&storage[offset], data, dataSize);
+		bytesUpdated += dataSize;
+		lastUpdateOffset = offset;
+	}
+	uint32 releaseStreamBuffer(uint32 buffer) { return 0; }
+
+	uint32 createFence() { return ++numFences; }
+	void waitFence(uint32 fence) { waitedFences.push_back(fence); }
+	bool isFenceSignaled(uint32 fence) { return fence <= lastSignaledFence; }
+	uint32 releaseFence(uint32 fence)
+	{
+		numReleasedFences++;
+		return 0;
+	}
+
+	uintptr getUniformBufferOffsetAlignment() const { return 256; }
+	void setShaderUniformBufferRange(uint32 shader, const String& uniformBufferName,
+			uint32 buffer, uintptr offset, uintptr dataSize)
+	{
+		boundOffset = offset;
+		boundSize = dataSize;
+	}
+};
+
+const char* persistent_tests()
+{
+	MockDevice device(true);
+	StreamRingBuffer<MockDevice> ring(device, 1024);
+	mu_assert(ring.isPersistentlyMapped(), "Mapped buffer not used persistently");
+
+	uintptr offset;
+	uint8* first = (uint8*)ring.allocate(100, 16, &offset);
+	mu_assert(first == &device.storage[0] && offset == 0, "First allocation misplaced");
+	uint8* second = (uint8*)ring.allocate(100, 64, &offset);
+	mu_assert(offset == 128 && second == first + 128, "Allocation not aligned");
+	ring.endFrame();
+	mu_assert(device.numFences == 1, "Frame not fenced");
+
+	// Frames 2 and 3 fill the ring without waiting
+	ring.allocate(400, 16, &offset);
+	ring.endFrame();
+	mu_assert(offset == 240, "Second frame not after the first");
+	ring.allocate(256, 16, &offset);
+	ring.endFrame();
+	mu_assert(device.waitedFences.empty(), "Waited while the ring had room");
+
+	// Only 128 bytes are left at the end, so this wraps to the start, which
+	// frame 1 still holds.
+	ring.allocate(200, 16, &offset);
+	mu_assert(offset == 0, "Allocation did not wrap");
+	mu_assert(device.waitedFences.size() == 1 && device.waitedFences[0] == 1,
+			"Wrap did not wait on the oldest frame only");
+	ring.endFrame();
+
+	// Needs frames 2 and 3 retired as well
+	ring.allocate(600, 16, &offset);
+	mu_assert(offset == 208, "Allocation misplaced after wrap");
+	mu_assert(device.waitedFences.size() == 3 && device.waitedFences[2] == 3,
+			"Frames not retired in order");
+	mu_assert(ring.getNumFenceWaits() == 3, "Fence waits miscounted");
+
+	// Even an empty ring can't hold this
+	mu_assert(ring.allocate(2048, 16, &offset) == nullptr, "Oversized allocation succeeded");
+	return NULL;
+}
+
+const char* signaled_fence_tests()
+{
+	MockDevice device(true);
+	StreamRingBuffer<MockDevice> ring(device, 1024);
+	uintptr offset;
+
+	// Unsignaled frames stay in flight, past the first few entries
+	for(uint32 i = 0; i < 6; i++) {
+		ring.allocate(100, 16, &offset);
+		ring.endFrame();
+	}
+	mu_assert(ring.getNumFramesInFlight() == 6, "Unsignaled frames retired");
+
+	// The first 5 have signaled, so the next frame ends with them released,
+	// and they are never waited on
+	device.lastSignaledFence = 5;
+	ring.allocate(100, 16, &offset);
+	ring.endFrame();
+	mu_assert(ring.getNumFramesInFlight() == 2 && device.numReleasedFences == 5,
+			"Signaled frames not retired at endFrame");
+
+	// Frames 6 and 7 still hold the ring, in order, after the entries wrap
+	for(uint32 i = 0; i < 3; i++) {
+		ring.allocate(100, 16, &offset);
+		ring.endFrame();
+	}
+	ring.allocate(600, 16, &offset);
+	mu_assert(device.waitedFences.size() == 2 && device.waitedFences[0] == 6
+			&& device.waitedFences[1] == 7, "Frames not waited on in order");
+	mu_assert(ring.getNumFenceWaits() == 2, "Released frames counted as waits");
+	return NULL;
+}
+
+const char* too_large_frame_tests()
+{
+	MockDevice device(true);
+	StreamRingBuffer<MockDevice> ring(device, 256);
+	uintptr offset;
+	mu_assert(ring.allocate(200, 16, &offset) != nullptr, "Allocation failed");
+	// The current frame can't be retired, so there is nothing to wait on
+	mu_assert(ring.allocate(100, 16, &offset) == nullptr,
+			"Allocation overwrote the current frame");
+	mu_assert(device.waitedFences.empty(), "Waited on a fence that doesn't exist");
+	ring.endFrame();
+	mu_assert(ring.allocate(100, 16, &offset) != nullptr, "Allocation failed after frame");
+
+	// Retiring every frame wouldn't make room, so none are waited on
+	ring.endFrame();
+	uint32 numFenceWaits = ring.getNumFenceWaits();
+	uint32 numWaitedFences = device.waitedFences.size();
+	mu_assert(ring.getNumFramesInFlight() == 1, "Frame not in flight");
+	mu_assert(ring.allocate(300, 16, &offset) == nullptr, "Oversized allocation succeeded");
+	mu_assert(ring.getNumFenceWaits() == numFenceWaits
+			&& device.waitedFences.size() == numWaitedFences,
+			"Waited on fences for an oversized allocation");
+	mu_assert(ring.getNumFramesInFlight() == 1, "Frame retired for an oversized allocation");
+	return NULL;
+}
+
+const char* fallback_tests()
+{
+	MockDevice device(false);
+	{
+		StreamRingBuffer<MockDevice> ring(device, 256);
+		mu_assert(!ring.isPersistentlyMapped(), "Fallback buffer reported as mapped");
+
+		uintptr offset;
+		uint8* data = (uint8*)ring.allocate(100, 16, &offset);
+		mu_assert(data < &device.storage[0] || data >= &device.storage[0] + 256,
+				"Fallback allocation points at device storage");
+		Memory::memset(data, (uint8)7, 100);
+		ring.flush();
+		mu_assert(device.bytesUpdated == 100 && device.storage[99] == 7,
+				"Flush did not upload the writes");
+		ring.flush();
+		mu_assert(device.bytesUpdated == 100, "Flush uploaded twice");
+		ring.endFrame();
+
+		// Wrapping orphans instead of waiting, and uploads both sides
+		data = (uint8*)ring.allocate(100, 16, &offset);
+		Memory::memset(data, (uint8)8, 100);
+		data = (uint8*)ring.allocate(100, 16, &offset);
+		Memory::memset(data, (uint8)9, 100);
+		mu_assert(offset == 0 && device.numOrphans == 1, "Wrap did not orphan");
+		ring.flush();
+		// Includes the 12 bytes of alignment padding before the second write
+		mu_assert(device.bytesUpdated == 312, "Wrapped writes not uploaded");
+		mu_assert(device.storage[112] == 8 && device.storage[0] == 9,
+				"Wrapped writes uploaded to the wrong place");
+		ring.endFrame();
+		mu_assert(device.numFences == 0 && device.waitedFences.empty(),
+				"Fallback used fences");
+	}
+	mu_assert(device.numReleasedFences == 0, "Released fences never created");
+	return NULL;
+}
+
+const char* uniform_buffer_arena_tests()
+{
+	MockDevice device(false);
+	UniformBufferArena<MockDevice> arena(device, 1024);
+	float constants[4] = { 1.0f, 2.0f, 3.0f, 4.0f };
+
+	UniformBufferArena<MockDevice>::Block first;
+	UniformBufferArena<MockDevice>::Block second;
+	mu_assert(arena.upload(constants, sizeof(constants), &first), "Upload failed");
+	mu_assert(arena.upload(constants, sizeof(constants), &second), "Upload failed");
+	mu_assert(first.offset == 0 && second.offset == 256,
+			"Blocks not at the offset alignment");
+	mu_assert(arena.getNumBlocks() == 2 && arena.getBytesAllocated() == 32,
+			"Blocks miscounted");
+
+	// Both blocks go up together
+	arena.flush();
+	mu_assert(device.bytesUpdated == 272, "Blocks not uploaded in one go");
+	mu_assert(*(float*)&device.storage[256 + 12] == 4.0f, "Block data not uploaded");
+
+	arena.bind(1, "Block", second);
+	mu_assert(device.boundOffset == 256 && device.boundSize == sizeof(constants),
+			"Wrong range bound");
+
+	UniformBufferArena<MockDevice>::Block block;
+	arena.allocate(256, &block);
+	arena.allocate(256, &block);
+	mu_assert(!arena.allocate(16, &block), "Frame allocated past the arena");
+	mu_assert(block.data == nullptr && block.offset == 0 && block.size == 0,
+			"Failed block not left empty");
+	arena.endFrame();
+	mu_assert(arena.getNumBlocks() == 0, "Block count not reset");
+	mu_assert(arena.allocate(16, &block) && block.offset == 0,
+			"Arena not reused after the frame");
+	return NULL;
+}
+
+const char* all_tests()
+{
+	mu_suite_start();
+
+	mu_run_test(persistent_tests);
+	mu_run_test(signaled_fence_tests);
+	mu_run_test(too_large_frame_tests);
+	mu_run_test(fallback_tests);
+	mu_run_test(uniform_buffer_arena_tests);
+
+	return NULL;
+}
+
+RUN_TESTS(all_tests);
@@ -0,0 +1,193 @@
+#include "minunit.h"
+#include "../src/math/vecmath.hpp"
+#include "../src/math/math.hpp"
+#include <math.h>
+#include <string.h>
+
+// Checks Vector's sin, cos, exp, ln and pow against double precision libm,
+// in ulps of the correctly rounded float result. The bounds are the ones
+// documented in the platform vector headers.
+
+static const uint32 numSamples = 1 << 20;
+
+static float randomFloat(float minVal, float maxVal)
+{
+	return minVal + (maxVal - minVal) * ((float)rand() / (float)RAND_MAX);
+}
+
+// A positive float with every exponent equally likely, denormals included
+static float randomPositiveFloat()
+{
+	uint32 bits = ((uint32)rand() << 8) ^ (uint32)rand();
+	bits &= 0x7FFFFFFF;
+	if((bits >> 23) == 0xFF) {
+		bits &= ~(1u << 30);
+	}
+	float result;
+	memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+static double ulpError(float result, double reference)
+{
+	float rounded = (float)reference;
+	if(isinf(rounded)) {
+		return result == rounded ? 0.0 : INFINITY;
+	}
+	double ulp = (double)nextafterf(fabsf(rounded), INFINITY) - (double)fabsf(rounded);
+	return fabs((double)result - reference) / ulp;
+}
+
+// Runs func on 4 inputs at a time and returns the worst error against ref
+template<typename Func, typename Ref>
+static double maxUlpError(const float* inputs, const float* inputs2, uint32 count,
+		Func func, Ref ref)
+{
+	double maxError = 0.0;
+	for(uint32 i = 0; i + 4 <= count; i += 4) {
+		float results[4];
+		func(Vector::load4f(inputs + i), Vector::load4f(inputs2 + i)).store4f(results);
+		for(uint32 j = 0; j < 4; j++) {
+			double error = ulpError(results[j], ref(inputs[i+j], inputs2[i+j]));
+			maxError = error > maxError ? error : maxError;
+		}
+	}
+	return maxError;
+}
+
+static Vector vecSin(const Vector& x, const Vector&) { return x.sin(); }
+static Vector vecCos(const Vector& x, const Vector&) { return x.cos(); }
+static Vector vecExp(const Vector& x, const Vector&) { return x.exp(); }
+static Vector vecLn(const Vector& x, const Vector&) { return x.ln(); }
+static Vector vecPow(const Vector& x, const Vector& y) { return x.pow(y); }
+static double refSin(float x, float) { return sin((double)x); }
+static double refCos(float x, float) { return cos((double)x); }
+static double refExp(float x, float) { return exp((double)x); }
+static double refLn(float x, float) { return log((double)x); }
+static double refPow(float x, float y) { return pow((double)x, (double)y); }
+
+static float inputs[numSamples];
+static float inputs2[numSamples];
+
+const char* sincos_tests()
+{
+	for(uint32 i = 0; i < numSamples; i++) {
+		inputs[i] = i < numSamples/2 ? randomFloat(-8192.0f, 8192.0f)
+			: randomFloat(-MATH_TWO_PI, MATH_TWO_PI);
+	}
+	double sinError = maxUlpError(inputs, inputs, numSamples, vecSin, refSin);
+	double cosError = maxUlpError(inputs, inputs, numSamples, vecCos, refCos);
+	printf("sin max error %.2f ulp, cos max error %.2f ulp\n", sinError, cosError);
+	mu_assert(sinError <= 2.0, "Vector sin error above 2 ulp");
+	mu_assert(cosError <= 2.0, "Vector cos error above 2 ulp");
+
+	Vector outSin, outCos;
+	Vector angles(Vector::make(0.0f, -0.0f, MATH_HALF_PI, -MATH_PI));
+	angles.sincos(&outSin, &outCos);
+	mu_assert(outSin[0] == 0.0f && outCos[0] == 1.0f, "Vector sincos(0) failed");
+	mu_assert(outSin[1] == 0.0f && signbit(outSin[1]), "Vector sin(-0) failed");
+	mu_assert(outSin[2] == 1.0f, "Vector sin(pi/2) failed");
+	mu_assert(outCos[3] == -1.0f, "Vector cos(-pi) failed");
+	return NULL;
+}
+
+const char* exp_tests()
+{
+	for(uint32 i = 0; i < numSamples; i++) {
+		inputs[i] = randomFloat(-87.3f, 88.7f);
+	}
+	double expError = maxUlpError(inputs, inputs, numSamples, vecExp, refExp);
+	printf("exp max error %.2f ulp\n", expError);
+	mu_assert(expError <= 1.0, "Vector exp error above 1 ulp");
+
+	Vector special(Vector::make(0.0f, 89.0f, -105.0f, INFINITY).exp());
+	mu_assert(special[0] == 1.0f, "Vector exp(0) failed");
+	mu_assert(isinf(special[1]), "Vector exp overflow failed");
+	mu_assert(special[2] == 0.0f, "Vector exp underflow failed");
+	mu_assert(isinf(special[3]), "Vector exp(inf) failed");
+	mu_assert(isnan(Vector::load1f(NAN).exp()[0]), "Vector exp(NaN) failed");
+	return NULL;
+}
+
+const char* ln_tests()
+{
+	for(uint32 i = 0; i < numSamples; i++) {
+		inputs[i] = randomPositiveFloat();
+	}
+	double lnError = maxUlpError(inputs, inputs, numSamples, vecLn, refLn);
+	printf("ln max error %.2f ulp\n", lnError);
+	mu_assert(lnError <= 1.0, "Vector ln error above 1 ulp");
+
+	Vector special(Vector::make(1.0f, 0.0f, -1.0f, INFINITY).ln());
+	mu_assert(special[0] == 0.0f, "Vector ln(1) failed");
+	mu_assert(isinf(special[1]) && special[1] < 0.0f, "Vector ln(0) failed");
+	mu_assert(isnan(special[2]), "Vector ln(-1) failed");
+	mu_assert(isinf(special[3]) && special[3] > 0.0f, "Vector ln(inf) failed");
+	return NULL;
+}
+
+const char* pow_tests()
+{
+	uint32 count = 0;
+	while(count < numSamples) {
+		float x = expf(randomFloat(-8.0f, 8.0f));
+		float y = randomFloat(-8.0f, 8.0f);
+		if(fabsf(y * logf(x)) < 80.0f) {
+			inputs[count] = x;
+			inputs2[count] = y;
+			count++;
+		}
+	}
+	double powError = maxUlpError(inputs, inputs2, numSamples, vecPow, refPow);
+	printf("pow max error %.3f ulp\n", powError);
+	mu_assert(powError <= 0.501, "Vector pow error above 0.501 ulp");
+
+	// Denormal bases, with exponents that keep the result normal
+	for(uint32 i = 0; i < numSamples; i++) {
+		inputs[i] = randomFloat(1.0f, 8388607.0f) * 1.40129846e-45f;
+		inputs2[i] = randomFloat(-0.5f, 0.5f);
+	}
+	powError = maxUlpError(inputs, inputs2, numSamples, vecPow, refPow);
+	printf("pow max error %.3f ulp with denormal bases\n", powError);
+	mu_assert(powError <= 0.501, "Vector pow error above 0.501 ulp with denormal bases");
+
+	Vector special(Vector::make(0.0f, 0.0f, 5.0f, -2.0f).pow(
+				Vector::make(2.0f, -1.0f, 0.0f, 0.5f)));
+	mu_assert(special[0] == 0.0f, "Vector pow(0, 2) failed");
+	mu_assert(isinf(special[1]), "Vector pow(0, -1) failed");
+	mu_assert(special[2] == 1.0f, "Vector pow(5, 0) failed");
+	mu_assert(isnan(special[3]), "Vector pow(-2, 0.5) failed");
+	Vector special2(Vector::make(INFINITY, INFINITY, NAN, 3.0f).pow(
+				Vector::make(0.001f, -2.0f, 1.0f, 9.0f)));
+	mu_assert(isinf(special2[0]), "Vector pow(inf, 0.001) failed");
+	mu_assert(special2[1] == 0.0f, "Vector pow(inf, -2) failed");
+	mu_assert(isnan(special2[2]), "Vector pow(NaN, 1) failed");
+	mu_assert(special2[3] == 19683.0f, "Vector pow(3, 9) failed");
+	Vector negative(Vector::make(-2.0f, -2.0f, -8.0f, -2.0f).pow(
+				Vector::make(3.0f, 2.0f, -1.0f, -0.5f)));
+	mu_assert(negative[0] == -8.0f, "Vector pow(-2, 3) failed");
+	mu_assert(negative[1] == 4.0f, "Vector pow(-2, 2) failed");
+	mu_assert(negative[2] == -0.125f, "Vector pow(-8, -1) failed");
+	mu_assert(isnan(negative[3]), "Vector pow(-2, -0.5) failed");
+	Vector negative2(Vector::make(-0.0f, -0.0f, -INFINITY, -1.0f).pow(
+				Vector::make(3.0f, -1.0f, 3.0f, 16777216.0f)));
+	mu_assert(negative2[0] == 0.0f && signbit(negative2[0]), "Vector pow(-0, 3) failed");
+	mu_assert(isinf(negative2[1]) && negative2[1] < 0.0f, "Vector pow(-0, -1) failed");
+	mu_assert(isinf(negative2[2]) && negative2[2] < 0.0f, "Vector pow(-inf, 3) failed");
+	mu_assert(negative2[3] == 1.0f, "Vector pow(-1, 2^24) failed");
+	return NULL;
+}
+
+const char* all_tests()
+{
+	mu_suite_start();
+
+    mu_run_test(sincos_tests);
+    mu_run_test(exp_tests);
+    mu_run_test(ln_tests);
+    mu_run_test(pow_tests);
+
+    return NULL;
+}
+
+RUN_TESTS(all_tests);
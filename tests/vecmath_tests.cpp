@@ -207,6 +207,57 @@ const char* length_normal_tests()
 	return NULL;
 }
 
+// Worst relative error of rsqrt and reciprocal at a given precision
+template<Precision::Level precision>
+static void precisionErrors(float* rsqrtError, float* reciprocalError)
+{
+	*rsqrtError = 0.0f;
+	*reciprocalError = 0.0f;
+	for(uint32 i = 0; i < 100000; i++) {
+		float vals[4];
+		for(uint32 j = 0; j < 4; j++) {
+			vals[j] = Math::pow(10.0f, ((float)rand()/(float)RAND_MAX) * 12.0f - 6.0f);
+		}
+		Vector test(Vector::load4f(vals));
+		Vector rsqrtVals = test.rsqrt<precision>();
+		Vector reciprocalVals = test.reciprocal<precision>();
+		for(uint32 j = 0; j < 4; j++) {
+			float rsqrtRelError = Math::abs(rsqrtVals[j] * Math::sqrt(vals[j]) - 1.0f);
+			float reciprocalRelError = Math::abs(reciprocalVals[j] * vals[j] - 1.0f);
+			*rsqrtError = Math::max(*rsqrtError, rsqrtRelError);
+			*reciprocalError = Math::max(*reciprocalError, reciprocalRelError);
+		}
+	}
+}
+
+const char* precision_tests()
+{
+	// Hardware estimates are documented to within 1.5*2^-12; a Newton step
+	// roughly squares that.
+	float rsqrtError, reciprocalError;
+	precisionErrors<Precision::ESTIMATE>(&rsqrtError, &reciprocalError);
+	mu_assert(rsqrtError < 3.7e-4f, "Vector rsqrt<ESTIMATE> failed");
+	mu_assert(reciprocalError < 3.7e-4f, "Vector reciprocal<ESTIMATE> failed");
+	precisionErrors<Precision::REFINED>(&rsqrtError, &reciprocalError);
+	mu_assert(rsqrtError < 1.e-6f, "Vector rsqrt<REFINED> failed");
+	mu_assert(reciprocalError < 1.e-6f, "Vector reciprocal<REFINED> failed");
+	precisionErrors<Precision::EXACT>(&rsqrtError, &reciprocalError);
+	mu_assert(rsqrtError < 3.e-7f, "Vector rsqrt<EXACT> failed");
+	mu_assert(reciprocalError < 3.e-7f, "Vector reciprocal<EXACT> failed");
+
+	Vector test(Vector::make(1.0f, 2.0f, 3.0f, 4.0f));
+	Vector one(Vector::load1f(1.0f));
+	mu_assert(test.normalize3<Precision::ESTIMATE>().rlen3().notEquals(one, 1.e-3f)
+			.isZero4f(), "Vector normalize3<ESTIMATE> failed");
+	mu_assert(test.normalize3<Precision::REFINED>().rlen3().notEquals(one, errorMargin)
+			.isZero4f(), "Vector normalize3<REFINED> failed");
+	mu_assert(test.normalize4<Precision::REFINED>().rlen4().notEquals(one, errorMargin)
+			.isZero4f(), "Vector normalize4<REFINED> failed");
+	mu_assert((test.normalize3<Precision::EXACT>() != test.normalize3()).isZero4f(),
+			"Vector normalize3<EXACT> failed");
+	return NULL;
+}
+
 const char* all_tests()
 {
 	mu_suite_start();
@@ -224,6 +275,7 @@ const char* all_tests()
     mu_run_test(dotcross_tests);
     mu_run_test(highermath_tests);
     mu_run_test(length_normal_tests);
+    mu_run_test(precision_tests);
 
     return NULL;
 }
@@ -0,0 +1,214 @@
+#include "minunit.h"
+#include "../src/math/vecmath.hpp"
+#include "../src/platform/generic/genericVecmath.hpp"
+#include "../src/platform/generic/genericVecmath8.hpp"
+
+static const float errorMargin=1e-4f;
+
+static const float valsA[8] = { 1.0f, -2.0f, 3.0f, 4.0f, 0.5f, 6.0f, -7.0f, 2.0f };
+static const float valsB[8] = { 3.0f, 4.0f, -5.0f, 8.6f, 2.0f, -1.5f, 0.25f, 9.0f };
+
+// Checks that both halves of an 8-wide result match the 4-wide reference
+template<typename V8>
+static bool matchesReference(const V8& vec, const GenericVector& lo,
+		const GenericVector& hi)
+{
+	for(uint32 i = 0; i < 4; i++) {
+		if(!Math::equals(vec[i], lo[i], errorMargin) ||
+				!Math::equals(vec[i+4], hi[i], errorMargin)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+template<typename V8>
+static const char* load_store_tests()
+{
+	V8 test(V8::load8f(valsA));
+	for(uint32 i = 0; i < 8; i++) {
+		mu_assert(test[i] == valsA[i], "Vector8 load8f failed");
+	}
+
+	V8 test2(V8::load2x4f(valsB, valsA));
+	for(uint32 i = 0; i < 4; i++) {
+		mu_assert(test2[i] == valsB[i], "Vector8 load2x4f failed");
+		mu_assert(test2[i+4] == valsA[i], "Vector8 load2x4f failed");
+	}
+
+	V8 test3(V8::load1f(133.7f));
+	for(uint32 i = 0; i < 8; i++) {
+		mu_assert(test3[i] == 133.7f, "Vector8 load1f failed");
+	}
+
+	float* aligned = (float*)Memory::malloc(sizeof(float)*8, 32);
+	test.storeAligned(aligned);
+	V8 test4(V8::loadAligned(aligned));
+	for(uint32 i = 0; i < 8; i++) {
+		mu_assert(test4[i] == valsA[i], "Vector8 aligned load/store failed");
+	}
+	Memory::free(aligned);
+
+	float out0[4];
+	float out1[4];
+	test.store2x4f(out0, out1);
+	for(uint32 i = 0; i < 4; i++) {
+		mu_assert(out0[i] == valsA[i], "Vector8 store2x4f failed");
+		mu_assert(out1[i] == valsA[i+4], "Vector8 store2x4f failed");
+	}
+	return NULL;
+}
+
+template<typename V8>
+static const char* math_funcs_tests()
+{
+	V8 a(V8::load8f(valsA));
+	V8 b(V8::load8f(valsB));
+	GenericVector aLo(GenericVector::load4f(&valsA[0]));
+	GenericVector aHi(GenericVector::load4f(&valsA[4]));
+	GenericVector bLo(GenericVector::load4f(&valsB[0]));
+	GenericVector bHi(GenericVector::load4f(&valsB[4]));
+
+	mu_assert(matchesReference(a + b, aLo + bLo, aHi + bHi), "Vector8 add failed");
+	mu_assert(matchesReference(a - b, aLo - bLo, aHi - bHi), "Vector8 sub failed");
+	mu_assert(matchesReference(a * b, aLo * bLo, aHi * bHi), "Vector8 mul failed");
+	mu_assert(matchesReference(a / b, aLo / bLo, aHi / bHi), "Vector8 div failed");
+	mu_assert(matchesReference(a.mad(b, a), aLo.mad(bLo, aLo), aHi.mad(bHi, aHi)),
+			"Vector8 mad failed");
+	mu_assert(matchesReference(a.min(b), aLo.min(bLo), aHi.min(bHi)),
+			"Vector8 min failed");
+	mu_assert(matchesReference(a.max(b), aLo.max(bLo), aHi.max(bHi)),
+			"Vector8 max failed");
+	mu_assert(matchesReference(a.abs(), aLo.abs(), aHi.abs()), "Vector8 abs failed");
+	mu_assert(matchesReference(-a, -aLo, -aHi), "Vector8 neg failed");
+	mu_assert(matchesReference(b.abs().rsqrt(), bLo.abs().rsqrt(), bHi.abs().rsqrt()),
+			"Vector8 rsqrt failed");
+	mu_assert(matchesReference(b.reciprocal(), bLo.reciprocal(), bHi.reciprocal()),
+			"Vector8 reciprocal failed");
+	mu_assert(matchesReference(b.abs().template rsqrt<Precision::REFINED>(),
+				bLo.abs().rsqrt(), bHi.abs().rsqrt()), "Vector8 rsqrt<REFINED> failed");
+	mu_assert(matchesReference(b.template reciprocal<Precision::REFINED>(),
+				bLo.reciprocal(), bHi.reciprocal()), "Vector8 reciprocal<REFINED> failed");
+	mu_assert(matchesReference(a.template normalize3<Precision::REFINED>(),
+				aLo.normalize3(), aHi.normalize3()), "Vector8 normalize3<REFINED> failed");
+	for(uint32 i = 0; i < 4; i++) {
+		mu_assert(matchesReference(a.replicate(i), aLo.replicate(i), aHi.replicate(i)),
+				"Vector8 replicate failed");
+	}
+	return NULL;
+}
+
+template<typename V8>
+static const char* dotcross_tests()
+{
+	V8 a(V8::load8f(valsA));
+	V8 b(V8::load8f(valsB));
+	GenericVector aLo(GenericVector::load4f(&valsA[0]));
+	GenericVector aHi(GenericVector::load4f(&valsA[4]));
+	GenericVector bLo(GenericVector::load4f(&valsB[0]));
+	GenericVector bHi(GenericVector::load4f(&valsB[4]));
+
+	mu_assert(matchesReference(a.dot3(b), aLo.dot3(bLo), aHi.dot3(bHi)),
+			"Vector8 dot3 failed");
+	mu_assert(matchesReference(a.dot4(b), aLo.dot4(bLo), aHi.dot4(bHi)),
+			"Vector8 dot4 failed");
+
+	V8 cross(a.cross3(b));
+	GenericVector crossLo(aLo.cross3(bLo));
+	GenericVector crossHi(aHi.cross3(bHi));
+	for(uint32 i = 0; i < 3; i++) {
+		mu_assert(Math::equals(cross[i], crossLo[i], errorMargin),
+				"Vector8 cross3 failed");
+		mu_assert(Math::equals(cross[i+4], crossHi[i], errorMargin),
+				"Vector8 cross3 failed");
+	}
+
+	mu_assert(matchesReference(a.normalize3(), aLo.normalize3(), aHi.normalize3()),
+			"Vector8 normalize3 failed");
+	mu_assert(matchesReference(a.normalize4(), aLo.normalize4(), aHi.normalize4()),
+			"Vector8 normalize4 failed");
+	return NULL;
+}
+
+template<typename V8>
+static const char* compare_select_tests()
+{
+	V8 a(V8::load8f(valsA));
+	V8 b(V8::load8f(valsB));
+
+	uint32 expectedLess = 0;
+	for(uint32 i = 0; i < 8; i++) {
+		expectedLess |= (valsA[i] < valsB[i] ? 1 : 0) << i;
+	}
+	mu_assert((a < b).toBitmask() == expectedLess, "Vector8 less/toBitmask failed");
+	mu_assert((a >= b).toBitmask() == (~expectedLess & 0xFF),
+			"Vector8 greaterEquals failed");
+	mu_assert((a != a).isZero8f(), "Vector8 notEquals failed");
+	mu_assert((a == a).toBitmask() == 0xFF, "Vector8 equals failed");
+	mu_assert(a.notEquals(a + V8::load1f(1e-6f), errorMargin).isZero8f(),
+			"Vector8 notEquals with margin failed");
+	mu_assert(((a < b) & (a >= b)).isZero8f(), "Vector8 and failed");
+	mu_assert(((a < b) | (a >= b)).toBitmask() == 0xFF, "Vector8 or failed");
+	mu_assert(((a < b) ^ (a < b)).isZero8f(), "Vector8 xor failed");
+
+	V8 selected(a.select(a < b, b));
+	for(uint32 i = 0; i < 8; i++) {
+		mu_assert(selected[i] == Math::min(valsA[i], valsB[i]), "Vector8 select failed");
+	}
+	return NULL;
+}
+
+template<typename V8>
+static const char* transpose_tests()
+{
+	float vals[4][8];
+	for(uint32 i = 0; i < 4; i++) {
+		for(uint32 j = 0; j < 8; j++) {
+			vals[i][j] = (float)(i*8 + j);
+		}
+	}
+	V8 rows[4];
+	for(uint32 i = 0; i < 4; i++) {
+		rows[i] = V8::load8f(vals[i]);
+	}
+	V8::transpose4(rows[0], rows[1], rows[2], rows[3]);
+	for(uint32 i = 0; i < 4; i++) {
+		for(uint32 j = 0; j < 4; j++) {
+			mu_assert(rows[i][j] == vals[j][i], "Vector8 transpose4 failed");
+			mu_assert(rows[i][j+4] == vals[j][i+4], "Vector8 transpose4 failed");
+		}
+	}
+	return NULL;
+}
+
+const char* generic_tests()
+{
+	const char* result;
+	if((result = load_store_tests<GenericVector8>()) != NULL) { return result; }
+	if((result = math_funcs_tests<GenericVector8>()) != NULL) { return result; }
+	if((result = dotcross_tests<GenericVector8>()) != NULL) { return result; }
+	if((result = transpose_tests<GenericVector8>()) != NULL) { return result; }
+	return compare_select_tests<GenericVector8>();
+}
+
+const char* platform_tests()
+{
+	const char* result;
+	if((result = load_store_tests<Vector8>()) != NULL) { return result; }
+	if((result = math_funcs_tests<Vector8>()) != NULL) { return result; }
+	if((result = dotcross_tests<Vector8>()) != NULL) { return result; }
+	if((result = transpose_tests<Vector8>()) != NULL) { return result; }
+	return compare_select_tests<Vector8>();
+}
+
+const char* all_tests()
+{
+	mu_suite_start();
+
+    mu_run_test(generic_tests);
+    mu_run_test(platform_tests);
+
+    return NULL;
+}
+
+RUN_TESTS(all_tests);